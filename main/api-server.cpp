@@ -0,0 +1,501 @@
+#include "api-server.h"
+#include "config.h"
+#include "logging.h"
+#include "statistics.h"
+#include "lora-manager.h"
+#include "system-monitor.h"
+#include "metrics-history.h"
+#include "radio-tx.h"
+#include "sx127x.h"
+#include "esp_timer.h"
+#include "openmetrics-writer.h"
+#include "trace.h"
+#include "profiler.h"
+#include "heap-profiler.h"
+#include "stack-audit.h"
+#include "log-history.h"
+
+ApiServer apiServer;
+
+static const char* const SERIES_NAMES[HISTORY_SERIES_COUNT] = {"pdr", "rtt", "rssi", "snr", "heap", "cpu"};
+static const char* const TIER_NAMES[HISTORY_TIER_COUNT] = {"seconds", "minutes", "hours"};
+
+// Значение параметра name из строки запроса вида a=1&b=2, без копирования
+static bool queryParam(const char* query, const char* name, const char*& value, size_t& length) {
+    size_t nameLength = strlen(name);
+    const char* p = query;
+    while (p && *p) {
+        if (strncmp(p, name, nameLength) == 0 && p[nameLength] == '=') {
+            value = p + nameLength + 1;
+            const char* end = strchr(value, '&');
+            length = end ? (size_t)(end - value) : strlen(value);
+            return true;
+        }
+        p = strchr(p, '&');
+        if (p) p++;
+    }
+    return false;
+}
+
+// Страница журнала: опрашивает /api/log с курсором и дописывает только новые
+// строки - текст, уже показанный клиенту, по сети больше не идёт
+static const char LOG_PAGE_HTML[] =
+    "<!DOCTYPE html><html><head><meta charset=\"utf-8\">"
+    "<meta name=\"viewport\" content=\"width=device-width\"><title>Журнал</title>"
+    "<style>body{margin:0;background:#111;color:#ddd}"
+    "pre{margin:0;padding:8px;font:13px monospace;white-space:pre-wrap}</style></head>"
+    "<body><pre id=\"log\"></pre><script>"
+    "let cursor=0,first=true;const log=document.getElementById('log');"
+    "async function poll(){let delay=1000;try{"
+    "const r=await fetch('/api/log?limit=100&cursor='+cursor);const j=await r.json();"
+    "const bottom=innerHeight+scrollY>=document.body.scrollHeight-8;"
+    "if(j.lost&&!first)log.append('... пропущено '+j.lost+' байт\\n');"
+    "if(j.lines.length)log.append(j.lines.join('\\n')+'\\n');"
+    "if(log.textContent.length>262144)log.textContent=log.textContent.slice(-131072);"
+    "if(bottom)scrollTo(0,document.body.scrollHeight);"
+    "if(j.lines.length==100)delay=0;cursor=j.next;first=false;"
+    "}catch(e){delay=3000}setTimeout(poll,delay)}poll();"
+    "</script></body></html>";
+
+// Индекс имени в таблице или -1
+static int lookup(const char* const* names, int count, const char* value, size_t length) {
+    for (int i = 0; i < count; i++) {
+        if (strlen(names[i]) == length && strncmp(names[i], value, length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+ApiServer::ApiServer() : _server(API_HTTP_PORT) {
+    _started = false;
+    memset(&_stats, 0, sizeof(_stats));
+    memset(&_scrapeStats, 0, sizeof(_scrapeStats));
+}
+
+ApiRequestStats ApiServer::getStats() const {
+    return _stats;
+}
+
+ApiRequestStats ApiServer::getScrapeStats() const {
+    return _scrapeStats;
+}
+
+// Строка до \r\n; лишнее сверх size отбрасывается. false - таймаут или обрыв
+bool ApiServer::readLine(WiFiClient& client, char* line, size_t size) {
+    size_t used = 0;
+    uint32_t start = millis();
+    while (millis() - start < API_REQUEST_TIMEOUT_MS) {
+        if (!client.available()) {
+            if (!client.connected()) {
+                return false;
+            }
+            vTaskDelay(pdMS_TO_TICKS(1));
+            continue;
+        }
+        char c = client.read();
+        if (c == '\r') {
+            continue;
+        }
+        if (c == '\n') {
+            line[used] = '\0';
+            return true;
+        }
+        if (used + 1 < size) {
+            line[used++] = c;
+        }
+    }
+    return false;
+}
+
+void ApiServer::process() {
+    if (WiFi.getMode() == WIFI_OFF) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        return;
+    }
+    if (!_started) {
+        _server.begin();
+        _server.setNoDelay(true);
+        _started = true;
+        logger.println("HTTP API: порт " + String(API_HTTP_PORT));
+    }
+
+    WiFiClient client = _server.available();
+    if (!client) {
+        vTaskDelay(pdMS_TO_TICKS(20));
+        return;
+    }
+
+    // "GET /api/history?series=rtt HTTP/1.1"
+    char line[128];
+    if (!readLine(client, line, sizeof(line))) {
+        client.stop();
+        return;
+    }
+    char header[128];
+    while (readLine(client, header, sizeof(header)) && header[0] != '\0') {
+        // Заголовки не нужны
+    }
+
+    char* path = strchr(line, ' ');
+    if (strncmp(line, "GET ", 4) != 0 || path == nullptr) {
+        client.print("HTTP/1.1 405 Method Not Allowed\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+        client.stop();
+        return;
+    }
+    path++;
+    char* end = strchr(path, ' ');
+    if (end) *end = '\0';
+    char* query = strchr(path, '?');
+    if (query) *query++ = '\0';
+
+    respond(client, path, query ? query : "");
+    client.stop();
+}
+
+// Затраты ответа в метрики запросов
+static void recordRequest(ApiRequestStats& stats, size_t bytes, uint32_t elapsedUs, int32_t heapDelta) {
+    stats.requests++;
+    stats.lastBytes = bytes;
+    stats.lastUs = elapsedUs;
+    stats.lastHeapDelta = heapDelta;
+    stats.maxUs = max(stats.maxUs, elapsedUs);
+}
+
+void ApiServer::respond(WiFiClient& client, const char* path, const char* query) {
+    enum { STATS, HISTORY, TASKS, METRICS, TRACE, PROFILE, HEAP, HEAP_FOLDED, STACKS, STACKS_HEADER, LOG, LOG_PAGE } route;
+    if (strcmp(path, "/api/stats") == 0) {
+        route = STATS;
+    } else if (strcmp(path, "/api/history") == 0) {
+        route = HISTORY;
+    } else if (strcmp(path, "/api/tasks") == 0 && systemMonitor) {
+        route = TASKS;
+    } else if (strcmp(path, "/metrics") == 0) {
+        route = METRICS;
+    } else if (strcmp(path, "/trace") == 0) {
+        route = TRACE;
+    } else if (strcmp(path, "/profile") == 0 && profiler) {
+        route = PROFILE;
+    } else if (strcmp(path, "/api/heap") == 0) {
+        route = HEAP;
+    } else if (strcmp(path, "/heap") == 0) {
+        route = HEAP_FOLDED;
+    } else if (strcmp(path, "/api/stacks") == 0) {
+        route = STACKS;
+    } else if (strcmp(path, "/stacks.h") == 0) {
+        route = STACKS_HEADER;
+    } else if (strcmp(path, "/api/log") == 0) {
+        route = LOG;
+    } else if (strcmp(path, "/log") == 0) {
+        route = LOG_PAGE;
+    } else {
+        client.print("HTTP/1.1 404 Not Found\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+        return;
+    }
+
+    uint32_t heapBefore = ESP.getFreeHeap();
+    int64_t startUs = esp_timer_get_time();
+
+    // Длина тела заранее неизвестна - конец ответа обозначает закрытие соединения
+    client.print("HTTP/1.1 200 OK\r\nContent-Type: ");
+    client.print(route == METRICS ? "application/openmetrics-text; version=1.0.0; charset=utf-8"
+                 : route == PROFILE || route == HEAP_FOLDED || route == STACKS_HEADER ? "text/plain"
+                 : route == LOG_PAGE ? "text/html; charset=utf-8"
+                                    : "application/json");
+    client.print("\r\nConnection: close\r\n\r\n");
+    size_t bytes;
+    if (route == METRICS) {
+        OpenMetricsWriter out(client);
+        writeMetrics(out);
+        bytes = out.finish();
+    } else if (route == TRACE) {
+        bytes = traceWriteChrome(client);
+    } else if (route == PROFILE) {
+        bytes = profiler->writeFolded(client);
+    } else if (route == HEAP_FOLDED) {
+        bytes = heapProfileWriteFolded(client);
+    } else if (route == STACKS_HEADER) {
+        bytes = stackAuditor.writeHeader(client);
+    } else if (route == LOG_PAGE) {
+        bytes = client.write((const uint8_t*)LOG_PAGE_HTML, sizeof(LOG_PAGE_HTML) - 1);
+    } else {
+        JsonWriter json(client);
+        switch (route) {
+            case HISTORY: writeHistory(json, query); break;
+            case TASKS:   systemMonitor->writeTasksJson(json); break;
+            case HEAP:    heapProfileWriteJson(json); break;
+            case STACKS:  stackAuditor.writeJson(json); break;
+            case LOG:     writeLog(json, query); break;
+            default:      writeStats(json); break;
+        }
+        bytes = json.flush();
+    }
+
+    uint32_t elapsedUs = (uint32_t)(esp_timer_get_time() - startUs);
+    int32_t heapDelta = (int32_t)heapBefore - (int32_t)ESP.getFreeHeap();
+    recordRequest(_stats, bytes, elapsedUs, heapDelta);
+    if (route == METRICS) {
+        recordRequest(_scrapeStats, bytes, elapsedUs, heapDelta);
+    }
+}
+
+void ApiServer::writeStats(JsonWriter& json) {
+    json.beginObject();
+
+    if (loraManager) {
+        json.key("lora");
+        json.beginObject();
+        json.field("frequency", (int32_t)loraManager->getFrequency());
+        json.field("sf", (int32_t)loraManager->getSpreadingFactor());
+        json.field("bw", loraManager->getBandwidth(), 1);
+        json.field("cr", (int32_t)loraManager->getCodingRate());
+        json.field("tx_power", (int32_t)loraManager->getTxPower());
+        json.field("implicit_length", (int32_t)loraManager->getImplicitLength());
+        json.field("packets_total", (uint32_t)loraManager->getPacketsTotal());
+        json.field("packets_success", (uint32_t)loraManager->getPacketsSuccess());
+        json.field("last_rssi", loraManager->getLastRssi(), 1);
+        json.endObject();
+    }
+
+    json.key("packets");
+    json.beginObject();
+    json.field("sent", totalSent.value());
+    json.field("received", totalReceived.value());
+    json.field("pdr", successRateSmoothed.value(), 1);
+    json.endObject();
+
+    json.key("rtt");
+    json.beginObject();
+    HistogramSnapshot rtt = rttHistogram.snapshot();
+    json.field("count", rtt.count);
+    json.field("last_us", rttLastUs.value(), 0);
+    json.field("min_us", rtt.min);
+    json.field("avg_us", rttAvgUs.value(), 0);
+    json.field("max_us", rtt.max);
+    json.key("histogram");
+    json.beginArray();
+    for (uint8_t i = 0; i < rttHistogram.bucketCount(); i++) {
+        json.value(rtt.buckets[i]);
+    }
+    json.endArray();
+    json.endObject();
+
+    RadioTxStats tx = radioTx.getStats();
+    json.key("tx");
+    json.beginObject();
+    json.field("submitted", (uint32_t)tx.submitted);
+    json.field("completed", (uint32_t)tx.completed);
+    json.field("rejected", (uint32_t)tx.rejected);
+    json.field("failed", (uint32_t)tx.failed);
+    json.field("queued", (uint32_t)tx.queued);
+    json.field("in_flight", tx.inFlight);
+    json.field("wait_us", (uint32_t)tx.lastWaitUs);
+    json.field("latency_avg_us", (uint32_t)tx.avgLatencyUs);
+    json.field("latency_max_us", (uint32_t)tx.maxLatencyUs);
+    json.endObject();
+
+    json.key("rx");
+    json.beginObject();
+    ReceivePollStats poll = receivePollSnapshot();
+    json.field("availability", rxAvailability.value(), 2);
+    json.field("stalls", poll.stalls);
+    json.field("max_gap_us", poll.maxGapUs);
+    json.endObject();
+
+    SpiStats spi = radio.getSpiStats();
+    json.key("spi");
+    json.beginObject();
+    json.field("transactions", (uint32_t)spi.transactions);
+    json.field("bus_us", (uint32_t)spi.busUs);
+    json.endObject();
+
+    json.field("free_heap", (uint32_t)ESP.getFreeHeap());
+    json.field("uptime_ms", (uint32_t)millis());
+    json.endObject();
+}
+
+// Целые строки журнала после байтового курсора клиента; next - курсор следующего запроса
+void ApiServer::writeLog(JsonWriter& json, const char* query) {
+    const char* value;
+    size_t length;
+    uint32_t cursor = 0;
+    if (queryParam(query, "cursor", value, length)) {
+        cursor = strtoul(value, nullptr, 10);
+    }
+    uint32_t limit = LOG_API_MAX_LINES;
+    if (queryParam(query, "limit", value, length)) {
+        limit = constrain(strtoul(value, nullptr, 10), 1UL, (unsigned long)LOG_API_MAX_LINES);
+    }
+
+    char line[256];
+    uint32_t lost = 0;
+    json.beginObject();
+    json.key("lines");
+    json.beginArray();
+    for (uint32_t i = 0; i < limit; i++) {
+        uint32_t skipped;
+        if (!logHistory.readLine(cursor, line, sizeof(line), skipped)) {
+            lost += skipped;
+            break;
+        }
+        lost += skipped;
+        json.value((const char*)line);
+    }
+    json.endArray();
+    json.field("next", cursor);
+    json.field("head", logHistory.head());
+    json.field("lost", lost);
+    json.endObject();
+}
+
+// Интервалы как [min, max, avg, count], пустые - null; от старых к новым
+void ApiServer::writeHistory(JsonWriter& json, const char* query) {
+    const char* value;
+    size_t length;
+    HistoryTier tier = HISTORY_MINUTES;
+    if (queryParam(query, "tier", value, length)) {
+        int index = lookup(TIER_NAMES, HISTORY_TIER_COUNT, value, length);
+        if (index >= 0) tier = (HistoryTier)index;
+    }
+    int only = -1;
+    if (queryParam(query, "series", value, length)) {
+        only = lookup(SERIES_NAMES, HISTORY_SERIES_COUNT, value, length);
+    }
+
+    json.beginObject();
+    json.field("tier", TIER_NAMES[tier]);
+    json.field("bucket_s", (uint32_t)MetricsHistory::bucketSeconds(tier));
+    json.key("series");
+    json.beginObject();
+    for (uint8_t s = 0; s < HISTORY_SERIES_COUNT; s++) {
+        if (only >= 0 && only != s) {
+            continue;
+        }
+        json.key(SERIES_NAMES[s]);
+        json.beginArray();
+        metricsHistory.visit((HistorySeries)s, tier, MetricsHistory::capacity(tier),
+                             [&json](const HistoryBucket& bucket) {
+            if (bucket.count == 0) {
+                json.null();
+                return;
+            }
+            json.beginArray();
+            json.value(bucket.min);
+            json.value(bucket.max);
+            json.value(bucket.avg());
+            json.value((uint32_t)bucket.count);
+            json.endArray();
+        });
+        json.endArray();
+    }
+    json.endObject();
+    json.endObject();
+}
+
+// Реестр метрик, затем радио, система, WiFi и затраты прошлого опроса
+void ApiServer::writeMetrics(OpenMetricsWriter& out) {
+    for (const Metric* m = Metric::first(); m; m = m->next()) {
+        out.metric(*m);
+    }
+
+    if (loraManager) {
+        out.family("lora_frequency_hz", "gauge", "Current LoRa frequency");
+        out.sample("lora_frequency_hz", nullptr, (uint32_t)loraManager->getFrequency());
+        out.family("lora_spreading_factor", "gauge", "Current LoRa spreading factor");
+        out.sample("lora_spreading_factor", nullptr, (uint32_t)loraManager->getSpreadingFactor());
+    }
+
+    RadioTxStats tx = radioTx.getStats();
+    out.family("lora_tx_submitted", "counter", "Frames submitted for transmission");
+    out.sample("lora_tx_submitted", "_total", tx.submitted);
+    out.family("lora_tx_completed", "counter", "Frames transmitted (TxDone)");
+    out.sample("lora_tx_completed", "_total", tx.completed);
+    out.family("lora_tx_rejected", "counter", "Frames rejected, transmit queue full");
+    out.sample("lora_tx_rejected", "_total", tx.rejected);
+    out.family("lora_tx_failed", "counter", "Frames failed, no mutex or no TxDone");
+    out.sample("lora_tx_failed", "_total", tx.failed);
+    out.family("lora_tx_queued", "gauge", "Frames waiting in the transmit queue");
+    out.sample("lora_tx_queued", nullptr, (uint32_t)tx.queued);
+    out.family("lora_tx_latency_max_us", "gauge", "Maximum TxDone to completion latency");
+    out.sample("lora_tx_latency_max_us", nullptr, tx.maxLatencyUs);
+
+    SpiStats spi = radio.getSpiStats();
+    out.family("lora_spi_transactions", "counter", "SPI transactions with the radio");
+    out.sample("lora_spi_transactions", "_total", spi.transactions);
+    out.family("lora_spi_busy_us", "counter", "Time the SPI bus was busy with the radio");
+    out.sample("lora_spi_busy_us", "_total", spi.busUs);
+
+    out.family("system_free_heap_bytes", "gauge", "Free heap");
+    out.sample("system_free_heap_bytes", nullptr, (uint32_t)ESP.getFreeHeap());
+    out.family("system_min_free_heap_bytes", "gauge", "Minimum free heap since boot");
+    out.sample("system_min_free_heap_bytes", nullptr, (uint32_t)ESP.getMinFreeHeap());
+    out.family("system_heap_free_bytes", "gauge", "Free heap per capability");
+    for (uint8_t i = 0; i < heapCapsCount(); i++) {
+        HeapCapsInfo caps = heapCapsInfo(i);
+        out.sample("system_heap_free_bytes", nullptr, caps.free, "caps", caps.name);
+    }
+    out.family("system_heap_largest_free_block_bytes", "gauge", "Largest free heap block per capability");
+    for (uint8_t i = 0; i < heapCapsCount(); i++) {
+        HeapCapsInfo caps = heapCapsInfo(i);
+        out.sample("system_heap_largest_free_block_bytes", nullptr, caps.largest, "caps", caps.name);
+    }
+    out.family("system_heap_fragmentation_percent", "gauge", "1 - largest free block / free heap, per capability");
+    for (uint8_t i = 0; i < heapCapsCount(); i++) {
+        HeapCapsInfo caps = heapCapsInfo(i);
+        out.sample("system_heap_fragmentation_percent", nullptr, caps.fragmentation, 1, "caps", caps.name);
+    }
+    out.family("system_uptime_seconds", "gauge", "Time since boot");
+    out.sample("system_uptime_seconds", nullptr, (uint32_t)(millis() / 1000));
+
+    if (systemMonitor) {
+        out.family("system_cpu_percent", "gauge", "Total CPU load");
+        out.sample("system_cpu_percent", nullptr, systemMonitor->getTotalCpuUsage());
+        out.family("system_core_cpu_percent", "gauge", "CPU load per core over the last second");
+        char core[2] = {'0', '\0'};
+        for (uint8_t i = 0; i < portNUM_PROCESSORS; i++) {
+            core[0] = '0' + i;
+            out.sample("system_core_cpu_percent", nullptr, systemMonitor->getCoreUsage(i, CPU_WINDOW_1S), 1, "core", core);
+        }
+        // Семейство - одним блоком: таблица задач копируется порциями на каждое
+        SystemMonitor::TaskInfo tasks[SYSTEM_MONITOR_COPY_ROWS];
+        uint16_t first = 0;
+        uint16_t count;
+        out.family("system_task_cpu_percent", "gauge", "CPU load per FreeRTOS task, 10 s average");
+        while ((count = systemMonitor->getTasksInfo(tasks, SYSTEM_MONITOR_COPY_ROWS, first)) > 0) {
+            first += count;
+            for (uint16_t i = 0; i < count; i++) {
+                out.sample("system_task_cpu_percent", nullptr, tasks[i].cpu[CPU_WINDOW_10S], 1, "task", tasks[i].name);
+            }
+        }
+        out.family("system_task_stack_free_bytes", "gauge", "Stack high water mark per FreeRTOS task");
+        first = 0;
+        while ((count = systemMonitor->getTasksInfo(tasks, SYSTEM_MONITOR_COPY_ROWS, first)) > 0) {
+            first += count;
+            for (uint16_t i = 0; i < count; i++) {
+                out.sample("system_task_stack_free_bytes", nullptr, (uint32_t)tasks[i].stackHighWater, "task",
+                           tasks[i].name);
+            }
+        }
+        uint8_t stackCount = 0;
+        const StackAuditEntry* stacks = stackAuditor.getEntries(stackCount);
+        out.family("system_task_stack_size_bytes", "gauge", "Stack size per application task");
+        for (uint8_t i = 0; i < stackCount; i++) {
+            if (stacks[i].size > 0) {
+                out.sample("system_task_stack_size_bytes", nullptr, stacks[i].size, "task", stacks[i].name);
+            }
+        }
+    }
+
+    if (WiFi.status() == WL_CONNECTED) {
+        out.family("wifi_rssi_dbm", "gauge", "WiFi station signal strength");
+        out.sample("wifi_rssi_dbm", nullptr, (float)WiFi.RSSI(), 0);
+    }
+
+    // Затраты опроса видны со следующего опроса
+    out.family("api_scrape_duration_us", "gauge", "Duration of the previous /metrics response");
+    out.sample("api_scrape_duration_us", nullptr, _scrapeStats.lastUs);
+    out.family("api_scrape_bytes", "gauge", "Size of the previous /metrics response");
+    out.sample("api_scrape_bytes", nullptr, _scrapeStats.lastBytes);
+    out.family("api_scrape_heap_delta_bytes", "gauge", "Heap consumed by the previous /metrics response");
+    out.sample("api_scrape_heap_delta_bytes", nullptr, (float)_scrapeStats.lastHeapDelta, 0);
+}
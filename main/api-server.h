@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include "json-writer.h"
+#include "openmetrics-writer.h"
+
+// Затраты последнего ответа
+struct ApiRequestStats {
+    uint32_t requests;
+    uint32_t lastBytes;
+    uint32_t lastUs;        // От разбора запроса до отправки последней порции
+    int32_t lastHeapDelta;  // Свободная куча до минус после ответа, байт
+    uint32_t maxUs;
+};
+
+// HTTP API только для чтения (порт API_HTTP_PORT):
+//   GET /api/stats                              - статистика LoRa, RTT, передачи и приёма
+//   GET /api/history?series=rtt&tier=minutes    - интервалы истории метрик
+//       series: pdr, rtt, rssi, snr, heap, cpu (без параметра - все ряды);
+//       tier: seconds, minutes, hours (по умолчанию minutes)
+//   GET /api/tasks                              - задачи FreeRTOS
+//   GET /metrics                                - все метрики в формате OpenMetrics (Prometheus)
+//   GET /trace                                  - кольца трассировки в формате Chrome trace JSON
+//   GET /api/log?cursor=N                       - строки веб-журнала после байтового курсора N
+//   GET /log                                    - страница журнала: опрашивает /api/log по курсору
+//
+// Ответы пишутся JsonWriter и OpenMetricsWriter прямо в сокет порциями, без сборки String:
+// запрос обслуживается без выделения памяти под тело, история читается из колец
+// на месте. Соединение закрывается после ответа (Connection: close).
+class ApiServer {
+public:
+    ApiServer();
+
+    // Один шаг задачи API: приём клиента и ответ
+    void process();
+
+    ApiRequestStats getStats() const;
+    // Только /metrics
+    ApiRequestStats getScrapeStats() const;
+
+private:
+    bool readLine(WiFiClient& client, char* line, size_t size);
+    void respond(WiFiClient& client, const char* path, const char* query);
+    void writeStats(JsonWriter& json);
+    void writeHistory(JsonWriter& json, const char* query);
+    void writeLog(JsonWriter& json, const char* query);
+    void writeMetrics(OpenMetricsWriter& out);
+
+    WiFiServer _server;
+    bool _started;
+    ApiRequestStats _stats;
+    ApiRequestStats _scrapeStats;
+};
+
+// Глобальный экземпляр API
+extern ApiServer apiServer;
@@ -0,0 +1,250 @@
+#include "channel-plan.h"
+#include "config.h"
+
+ChannelPlan::ChannelPlan() {
+    _count = 1;
+    _seed = 0;
+    _currentChannel = 0;
+    _hopIndex = 0;
+    _linkMask = 0;
+    _home = true;
+    _pending = false;
+    _pendingPacketId = -1;
+    _pendingChannel = 0;
+    _pendingHop = 0;
+    _pendingMask = 0;
+    _pendingSince = 0;
+    _pendingTimeout = 0;
+    _peerAdvance = false;
+    _peerHop = 0;
+    _peerMask = 0;
+    _lastHeard = 0;
+    for (int i = 0; i < CHANNEL_PLAN_MAX; i++) {
+        _sequence[i] = i;
+        _stats[i] = {0, 0, 100.0f, -120.0f, 0};
+    }
+}
+
+void ChannelPlan::configure(uint8_t count, uint32_t seed) {
+    _count = constrain(count, 1, CHANNEL_PLAN_MAX);
+    _seed = seed;
+
+    // Перестановка каналов по seed (xorshift32 + Fisher-Yates): одинакова на обоих узлах
+    uint32_t state = seed ? seed : 0x9E3779B9;
+    for (int i = 0; i < _count; i++) {
+        _sequence[i] = i;
+    }
+    for (int i = _count - 1; i > 0; i--) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        int j = state % (i + 1);
+        uint8_t tmp = _sequence[i];
+        _sequence[i] = _sequence[j];
+        _sequence[j] = tmp;
+    }
+
+    for (int i = 0; i < CHANNEL_PLAN_MAX; i++) {
+        _stats[i] = {0, 0, 100.0f, -120.0f, 0};
+    }
+    goHome();
+}
+
+bool ChannelPlan::isEnabled() const {
+    return _count > 1;
+}
+
+uint8_t ChannelPlan::getChannelCount() const {
+    return _count;
+}
+
+long ChannelPlan::getFrequency(uint8_t channel) const {
+    if (channel == 0 || channel >= _count) {
+        return LORA_FREQUENCY;
+    }
+    return LORA_CHANNEL_BASE + (long)(channel - 1) * LORA_CHANNEL_STEP;
+}
+
+uint8_t ChannelPlan::channelForHop(uint32_t hop, uint32_t mask) const {
+    if (!isEnabled()) {
+        return 0;
+    }
+    // Исключённые каналы пропускаются, следующий по последовательности берётся вместо них
+    for (int i = 0; i < _count; i++) {
+        uint8_t channel = _sequence[(hop + i) % _count];
+        if (channel == 0 || !(mask & (1UL << channel))) {
+            return channel;
+        }
+    }
+    return 0;
+}
+
+uint8_t ChannelPlan::getCurrentChannel() const {
+    return _currentChannel;
+}
+
+uint32_t ChannelPlan::getHopIndex() const {
+    return _hopIndex;
+}
+
+uint32_t ChannelPlan::getLinkMask() const {
+    return _linkMask;
+}
+
+bool ChannelPlan::isHome() const {
+    return _home;
+}
+
+bool ChannelPlan::advance(uint32_t hop, uint32_t mask, uint32_t now) {
+    if (isWaitingAck(now)) {
+        _peerAdvance = true;
+        _peerHop = hop;
+        _peerMask = mask;
+        return false;
+    }
+    // ACK своего обмена опоздал: обмен неудачен, пир ведёт дальше
+    if (_pending) {
+        _pending = false;
+        recordResult(_pendingChannel, false, now);
+    }
+    hopTo(hop, mask);
+    return true;
+}
+
+bool ChannelPlan::isWaitingAck(uint32_t now) const {
+    return _pending && now - _pendingSince < _pendingTimeout;
+}
+
+void ChannelPlan::hopTo(uint32_t hop, uint32_t mask) {
+    _hopIndex = hop + 1;
+    _linkMask = mask & ~1UL;
+    _currentChannel = channelForHop(_hopIndex, _linkMask);
+    _home = false;
+}
+
+void ChannelPlan::goHome() {
+    _currentChannel = 0;
+    _home = true;
+}
+
+void ChannelPlan::beginExchange(int packetId, uint32_t hop, uint32_t mask, uint32_t now, uint32_t ackTimeoutMs) {
+    _pending = true;
+    _pendingPacketId = packetId;
+    _pendingChannel = _currentChannel;
+    _pendingHop = hop;
+    _pendingMask = mask;
+    _pendingSince = now;
+    _pendingTimeout = ackTimeoutMs;
+    _peerAdvance = false;
+}
+
+bool ChannelPlan::completeExchange(int packetId, uint32_t now) {
+    if (!_pending || packetId != _pendingPacketId) {
+        return false;
+    }
+    _pending = false;
+    _peerAdvance = false;
+    recordResult(_pendingChannel, true, now);
+    hopTo(_pendingHop, _pendingMask);
+    return true;
+}
+
+bool ChannelPlan::failPendingExchange(uint32_t now) {
+    if (!_pending) {
+        return false;
+    }
+    resolveFailedExchange(now);
+    return true;
+}
+
+void ChannelPlan::resolveFailedExchange(uint32_t now) {
+    _pending = false;
+    recordResult(_pendingChannel, false, now);
+    // Пир, чей HLO мы подтвердили, уже перешёл на следующий шаг
+    if (_peerAdvance) {
+        _peerAdvance = false;
+        hopTo(_peerHop, _peerMask);
+    } else {
+        goHome();
+    }
+}
+
+void ChannelPlan::onHeard(uint32_t now) {
+    _lastHeard = now;
+}
+
+bool ChannelPlan::expireExchange(uint32_t now) {
+    if (!_pending || isWaitingAck(now)) {
+        return false;
+    }
+    uint8_t channel = _currentChannel;
+    resolveFailedExchange(now);
+    return _currentChannel != channel;
+}
+
+bool ChannelPlan::checkResync(uint32_t now) {
+    if (!isEnabled() || _home || now - _lastHeard < HOP_RESYNC_MS) {
+        return false;
+    }
+    goHome();
+    return true;
+}
+
+void ChannelPlan::recordResult(uint8_t channel, bool success, uint32_t now) {
+    if (channel >= _count) {
+        return;
+    }
+    ChannelStats& stats = _stats[channel];
+    stats.attempts++;
+    if (success) stats.successes++;
+    stats.pdr = (ALPHA * (success ? 100.0f : 0.0f)) + ((1 - ALPHA) * stats.pdr);
+
+    if (channel == 0 || stats.attempts < HOP_BLACKLIST_MIN_TRIES || stats.pdr >= HOP_BLACKLIST_PDR) {
+        return;
+    }
+
+    // Оставляем хотя бы два рабочих канала, иначе перестройка теряет смысл
+    uint8_t blacklisted = 0;
+    for (int i = 1; i < _count; i++) {
+        if (_stats[i].blacklistedUntil) blacklisted++;
+    }
+    if (_count - blacklisted > 2 && stats.blacklistedUntil == 0) {
+        stats.blacklistedUntil = now + HOP_BLACKLIST_MS;
+    }
+}
+
+void ChannelPlan::recordRssi(uint8_t channel, float rssi) {
+    if (channel >= _count) {
+        return;
+    }
+    ChannelStats& stats = _stats[channel];
+    stats.rssi = stats.rssi <= -120.0f ? rssi : (ALPHA * rssi) + ((1 - ALPHA) * stats.rssi);
+}
+
+void ChannelPlan::expireBlacklist(uint32_t now) {
+    for (int i = 1; i < _count; i++) {
+        ChannelStats& stats = _stats[i];
+        if (stats.blacklistedUntil != 0 && (int32_t)(now - stats.blacklistedUntil) >= 0) {
+            // Срок исключения истёк: канал получает новый шанс
+            stats.blacklistedUntil = 0;
+            stats.pdr = 100.0f;
+            stats.attempts = 0;
+            stats.successes = 0;
+        }
+    }
+}
+
+uint32_t ChannelPlan::getBlacklistMask(uint32_t now) const {
+    uint32_t mask = 0;
+    for (int i = 1; i < _count; i++) {
+        uint32_t until = _stats[i].blacklistedUntil;
+        if (until != 0 && (int32_t)(now - until) < 0) {
+            mask |= 1UL << i;
+        }
+    }
+    return mask;
+}
+
+const ChannelStats& ChannelPlan::getStats(uint8_t channel) const {
+    return _stats[channel < CHANNEL_PLAN_MAX ? channel : 0];
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <Arduino.h>
+
+// Максимальное число каналов в частотном плане (маска исключённых каналов - 32 бита)
+#define CHANNEL_PLAN_MAX 16
+
+// Статистика качества канала
+struct ChannelStats {
+    uint32_t attempts;          // Отправлено HLO на этом канале
+    uint32_t successes;         // Получено ACK
+    float pdr;                  // Сглаженная успешность доставки, %
+    float rssi;                 // Сглаженный RSSI принятых кадров, dBm
+    uint32_t blacklistedUntil;  // millis(), до которого канал исключён (0 - не исключён)
+};
+
+// Частотный план с псевдослучайной перестройкой частоты.
+//
+// Канал 0 - "домашний" (LORA_FREQUENCY): на нём узлы встречаются после потери
+// синхронизации, он никогда не исключается. Последовательность каналов - перестановка,
+// построенная из общего для линка seed, поэтому одинакова на обоих узлах.
+// Номер шага (hop) передаётся в HLO вместе с маской исключённых каналов,
+// по ним оба узла выбирают канал следующего обмена.
+//
+// Состояние перестройки одно на узел: пока свой обмен HLO/ACK ждёт ACK,
+// HLO пира канал не меняет (advance() откладывает переход), иначе ACK своего
+// обмена пришёл бы на уже покинутый канал. Если ACK так и не пришёл за время
+// ожидания, узел выполняет отложенный переход пира - пир уже там, - а без него
+// возвращается на домашний канал. Обмен, чьё ожидание истекло, переходу пира
+// не мешает.
+//
+// Вызовы - из задач радио под spi_lock_mutex; веб-интерфейс только читает.
+class ChannelPlan {
+public:
+    ChannelPlan();
+
+    // Настройка плана: count каналов (1 - перестройка выключена), общий seed линка
+    void configure(uint8_t count, uint32_t seed);
+    bool isEnabled() const;
+    uint8_t getChannelCount() const;
+    long getFrequency(uint8_t channel) const;
+
+    // Канал для шага hop с учётом маски исключённых каналов
+    uint8_t channelForHop(uint32_t hop, uint32_t mask) const;
+
+    // Текущее состояние перестройки
+    uint8_t getCurrentChannel() const;
+    uint32_t getHopIndex() const;
+    uint32_t getLinkMask() const;
+    bool isHome() const;
+
+    // Ответ на HLO пира: переход на шаг после hop. false - ждём ACK своего
+    // обмена, переход отложен до его завершения
+    bool advance(uint32_t hop, uint32_t mask, uint32_t now);
+    // Потеря синхронизации: возврат на домашний канал
+    void goHome();
+
+    // Обмен HLO/ACK, начатый этим узлом; ACK ждём ackTimeoutMs (эфир HLO и ACK с запасом)
+    void beginExchange(int packetId, uint32_t hop, uint32_t mask, uint32_t now, uint32_t ackTimeoutMs);
+    // ACK получен: true, если он завершает текущий обмен (канал сменился)
+    bool completeExchange(int packetId, uint32_t now);
+    // ACK так и не пришёл: true, если обмен был и узел сменил канал (на
+    // отложенный шаг пира или домашний)
+    bool failPendingExchange(uint32_t now);
+    // То же по истечении ожидания ACK; true, если канал сменился
+    bool expireExchange(uint32_t now);
+
+    // Любой принятый кадр; после долгой тишины checkResync возвращает на домашний канал
+    void onHeard(uint32_t now);
+    bool checkResync(uint32_t now);
+
+    // Учёт качества каналов
+    void recordResult(uint8_t channel, bool success, uint32_t now);
+    void recordRssi(uint8_t channel, float rssi);
+    // Снятие исключения с каналов, срок которых истёк (задача радио)
+    void expireBlacklist(uint32_t now);
+    // Маска исключённых каналов; состояние не меняет
+    uint32_t getBlacklistMask(uint32_t now) const;
+    const ChannelStats& getStats(uint8_t channel) const;
+
+private:
+    void hopTo(uint32_t hop, uint32_t mask);
+    bool isWaitingAck(uint32_t now) const;
+    // Обмен без ACK: отложенный переход пира или домашний канал
+    void resolveFailedExchange(uint32_t now);
+
+    uint8_t _count;
+    uint32_t _seed;
+    uint8_t _sequence[CHANNEL_PLAN_MAX];
+    ChannelStats _stats[CHANNEL_PLAN_MAX];
+
+    uint8_t _currentChannel;
+    uint32_t _hopIndex;
+    uint32_t _linkMask;
+    bool _home;
+
+    bool _pending;
+    int _pendingPacketId;
+    uint8_t _pendingChannel;
+    uint32_t _pendingHop;
+    uint32_t _pendingMask;
+    uint32_t _pendingSince;
+    uint32_t _pendingTimeout;
+    bool _peerAdvance;            // HLO пира пришёл во время ожидания ACK
+    uint32_t _peerHop;
+    uint32_t _peerMask;
+    uint32_t _lastHeard;
+};
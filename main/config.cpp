@@ -1,9 +1,29 @@
 #include "config.h"
-#include <LoRa.h>
+#include "trace.h"
 
 // Определение глобальных переменных
 SemaphoreHandle_t spi_lock_mutex;
 
+bool spiLock(TickType_t timeout) {
+    TRACE_BEGIN(TRACE_SPI_WAIT, 0);
+    bool taken = xSemaphoreTake(spi_lock_mutex, timeout) == pdTRUE;
+    TRACE_END(TRACE_SPI_WAIT, taken);
+    if (taken) {
+        TRACE_ASYNC_BEGIN(TRACE_SPI_HOLD, 0);
+    }
+    return taken;
+}
+
+void spiUnlock() {
+    TRACE_ASYNC_END(TRACE_SPI_HOLD, 0);
+    xSemaphoreGive(spi_lock_mutex);
+}
+
 #if defined(CONFIG_IDF_TARGET_ESP32S3)
 Adafruit_NeoPixel strip(NUM_LEDS, LED_PIN, NEO_GRB + NEO_KHZ800);
-#endif
\ No newline at end of file
+#endif
+
+uint32_t getNodeId() {
+    // Первые байты MAC - OUI производителя, уникальна только младшая часть
+    return (uint32_t)(ESP.getEfuseMac() >> 16);
+}
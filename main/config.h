@@ -3,7 +3,6 @@
 
 #include <Arduino.h>
 #include <SPI.h>
-// Не включаем LoRa.h здесь, чтобы избежать конфликта
 #include <Adafruit_NeoPixel.h>
 
 // Определение доступности дисплея в зависимости от типа платы
@@ -23,6 +22,146 @@
 #define LORA_MAX_ATTEMPTS 5
 #define LORA_TX_POWER     10
 
+// Частотный план для перестройки частоты (канал 0 - LORA_FREQUENCY)
+#define LORA_CHANNEL_COUNT      1          // По умолчанию перестройка выключена
+#define LORA_CHANNEL_BASE       433175000  // Частота канала 1, Гц
+#define LORA_CHANNEL_STEP       200000     // Шаг между каналами, Гц
+#define HOP_RESYNC_MS           65000      // Возврат на домашний канал после тишины
+#define HOP_ACK_MARGIN_MS       1000       // Запас ожидания ACK сверх эфира HLO и ACK
+#define HOP_BLACKLIST_PDR       30         // Канал исключается при успешности ниже, %
+#define HOP_BLACKLIST_MIN_TRIES 4          // Минимум попыток перед исключением
+#define HOP_BLACKLIST_MS        600000     // Время исключения канала
+
+// Синхронизация времени по маякам
+#define TIME_SYNC_BEACON_MS       60000   // Период маяков опорного узла
+#define TIME_SYNC_ROOT_TIMEOUT_MS 300000  // Опорный узел считается пропавшим
+#define TIME_SYNC_OUTLIER_US      5000    // Отсчёт дальше от прогноза отбрасывается
+
+// Очередь исходящих сообщений (store-and-forward) на LittleFS
+#define TXQ_DIR             "/txq"
+#define TXQ_SEGMENT_BYTES   4096     // Размер сегмента
+#define TXQ_MAX_BYTES       65536    // Предел объёма очереди, дальше вытесняются старые
+#define TXQ_FLUSH_MS        2000     // Период пакетного сброса на флеш
+#define TXQ_FLUSH_BYTES     512      // Сброс раньше срока при таком объёме буфера
+#define TXQ_PEER_TIMEOUT_MS 90000    // Пир считается пропавшим без трафика
+#define TXQ_MAX_RETRIES     5        // Повторов без DAK до паузы доставки
+#define TXQ_ACK_MARGIN_MS   500      // Запас ожидания DAK сверх эфирного времени
+
+// Шлюз LoRa -> UDP/MQTT
+#define GATEWAY_QUEUE_LENGTH 32    // Кадров в очереди между приёмом и шлюзом
+#define GATEWAY_BATCH_MAX    8     // Кадров в одном пакете
+#define GATEWAY_BATCH_MS     1000  // Максимальное ожидание заполнения пакета
+#define GATEWAY_RETRY_MS     5000  // Пауза после ошибки отправки/подключения
+#define GATEWAY_RETRY_MAX_MS 60000 // Предел паузы между попытками подключения (удваивается с GATEWAY_RETRY_MS)
+#define GATEWAY_SOCKET_TIMEOUT_S 3 // Подключение TCP и ожидание ответа брокера, с; много меньше периода WDT (60 с)
+#define GATEWAY_DEFAULT_PORT 1700
+#define GATEWAY_MQTT_BUFFER  2048  // Размер буфера PubSubClient
+#define GATEWAY_UDP_PAYLOAD  1460  // Пакет не больше: одна датаграмма без фрагментации IP
+#define GATEWAY_SEND_ATTEMPTS 3    // Неудачных отправок при связи, после которых пакет отбрасывается
+
+// Двоичный режим модема по последовательному порту
+#define MODEM_DEFAULT_BAUD    921600
+#define MODEM_RING_BYTES      8192   // Кольцевой буфер кадров для хоста
+#define MODEM_TX_QUEUE_LENGTH 4      // Запросов хоста на передачу
+#define MODEM_POLL_MS         5      // Период опроса порта
+
+// Захват пакетов (pcap)
+#define CAPTURE_DIR        "/cap"
+#define CAPTURE_FILE_BYTES 32768  // Размер одного файла кольца
+#define CAPTURE_FILES      4      // Файлов в кольце на LittleFS
+#define CAPTURE_TCP_PORT   19000
+
+// Сканирование эфира
+#define SCAN_DEFAULT_RATE_HZ   20     // Отсчётов RSSI в секунду (по всем частотам)
+#define SCAN_SETTLE_US         2000   // Установление RSSI после перестройки
+#define SCAN_BUSY_MARGIN_DB    10     // Отсчёт занят, если выше уровня шума на столько dB
+#define SCAN_BUSY_OCCUPANCY    30     // Канал исключается из перестройки при занятости выше, %
+#define SCAN_HEATMAP_ROWS      30     // Строк тепловой карты (окно занятости)
+#define SCAN_HEATMAP_PERIOD_MS 10000  // Длительность строки тепловой карты
+#define SCAN_HIST_WINDOW       2048   // Отсчётов в гистограмме уровня шума до "старения"
+
+// Ограничение занятости эфира (433 МГц ISM: 10%)
+#define LORA_DUTY_CYCLE_PERCENT 10
+#define DUTY_CYCLE_WINDOW_MS    3600000  // Окно учёта, определяет максимальный "запас"
+
+// Неявный заголовок: короткие кадры (HLO/ACK, DAK, CFA/CFC/CFK) дополняются нулями
+// до фиксированной длины. Длинные (CFG, TSB, DAT) уходят с явным заголовком: перед
+// ними передаётся неявный кадр "EXP:<длина>", и приёмник принимает следующий кадр
+// в явном режиме. Минимум вмещает EXP и ACK
+#define LORA_IMPLICIT_MIN_LENGTH 16
+#define LORA_EXPLICIT_GAP_MS     30   // Пауза между EXP и кадром: приёмник успевает сменить режим
+#define LORA_EXPLICIT_MARGIN_MS  100  // Запас ожидания явного кадра после EXP
+#define LORA_CRC_DEFAULT         false  // CRC полезной нагрузки (умолчание модема - выкл.)
+
+// Ожидание TxDone сверх расчётного эфирного времени кадра
+#define LORA_TX_TIMEOUT_MARGIN_MS 200
+#define RADIO_TX_QUEUE_LEN        4    // Кадров в очереди асинхронной передачи
+#define RX_POLL_STALL_MS          100  // Промежуток между опросами приёма, считающийся простоем
+
+// История метрик: интервалов в кольце каждого уровня (~22 KB на 6 рядов)
+#define HISTORY_SECOND_BUCKETS 60   // 1 минута по секундам
+#define HISTORY_MINUTE_BUCKETS 120  // 2 часа по минутам
+#define HISTORY_HOUR_BUCKETS   48   // 2 суток по часам
+
+// Монитор задач: буферы отсчёта загрузки CPU выделены заранее (~140 байт на задачу)
+#define SYSTEM_MONITOR_MAX_TASKS 40
+#define SYSTEM_MONITOR_COPY_ROWS 8   // Строк таблицы задач в одной копии на стеке читателя
+
+// Стеки задач (размеры - в task-stacks.h, его генерирует аудит стеков)
+#define TASK_STATIC_STACKS     0    // 1 - стеки задач приложения в .bss, а не в куче
+#define STACK_AUDIT_MARGIN_PCT 30   // Запас рекомендуемого размера сверх замеченного использования
+#define STACK_AUDIT_WARN_PCT   75   // Тревога: занято не меньше, %
+#define STACK_AUDIT_CRIT_PCT   90
+#define STACK_AUDIT_MIN_FREE   512  // Критично при меньшем остатке, байт (и для системных задач)
+#define STACK_AUDIT_MIN_SIZE   2048 // Рекомендация не меньше, байт
+
+// Отложенный журнал (log-ring.h)
+#define LOG_RING_SIZE       4096  // Байт в кольце записей, степень двойки
+#define LOG_RING_MAX_RECORD 128   // Наибольшая запись: заголовок 12 байт и аргументы
+#define LOG_RING_LINE       192   // Наибольшая строка после форматирования
+#define LOG_FLUSH_MS        50    // Период вывода задачей журнала
+#define LOG_HISTORY_SIZE       8192   // История веб-журнала во внутренней памяти, байт (степень двойки)
+#define LOG_HISTORY_PSRAM_SIZE 131072 // То же в PSRAM, если она есть
+#define LOG_HISTORY_READ_CHUNK 64     // Байт истории, копируемых под блокировкой за раз
+#define LOG_API_MAX_LINES      100    // Строк в одном ответе /api/log
+#define LOG_WEB_RESEND_ALL     0      // 1 - виджет журнала уходит каждую секунду (прежнее поведение, для сравнения)
+#define LOG_BUILD_LEVEL     0     // Вызовы LOGD/LOGI/LOGW/LOGE строгостью ниже не компилируются:
+                                  // 0 - отладка, 1 - информация, 2 - предупреждения, 3 - ошибки
+
+// Трассировка событий (trace.h): 0 - точки трассировки не компилируются
+#define TRACE_ENABLED     1
+#define TRACE_RING_EVENTS 256   // Событий в кольце каждого ядра (16 байт на событие)
+
+// Профилировщик (profiler.h): умолчания, меняются на вкладке системы
+#define PROFILER_TIMER_FIRST      2     // Аппаратные таймеры PROFILER_TIMER_FIRST + ядро
+#define PROFILER_DEFAULT_RATE_HZ  250
+#define PROFILER_MAX_RATE_HZ      5000
+#define PROFILER_DEFAULT_DEPTH    6
+#define PROFILER_MAX_DEPTH        16
+#define PROFILER_DEFAULT_SAMPLES  512   // Отсчётов в кольце ядра, (глубина + 2) * 4 + 2 байт на отсчёт
+#define PROFILER_MAX_SAMPLES      4096
+#define PROFILER_DEFAULT_OVERHEAD 2     // Предел доли ядра на отсчёты, %
+
+// Профиль кучи (heap-profiler.h). HEAP_PROFILER_WRAP 1 требует флагов компоновщика
+// -Wl,--wrap=malloc,--wrap=free,--wrap=realloc,--wrap=calloc, иначе сборка не скомпонуется
+#define HEAP_PROFILER_WRAP         0
+#define HEAP_PROFILER_SAMPLE_EVERY 16    // Каждое N-е выделение попадает в выборку со стеком
+#define HEAP_PROFILER_DEPTH        6     // Адресов в стеке места вызова
+#define HEAP_PROFILER_SITES        64    // Мест вызова в таблице (~40 байт на место)
+#define HEAP_PROFILER_LIVE         256   // Живых выделений выборки (12 байт на запись)
+#define HEAP_PROFILER_LEAK_TOP     8     // Мест вызова в отчёте об утечках
+
+// HTTP API (JSON)
+#define API_HTTP_PORT          8080
+#define API_REQUEST_TIMEOUT_MS 1000  // Ожидание строки запроса и заголовков
+
+// Веб-интерфейс
+#define UI_LABEL_SIZE          192   // Буфер подписи на стеке, байт (кириллица в UTF-8 - 2 байта на символ)
+
+// Согласованная смена параметров LoRa
+#define PARAM_SWITCH_RETRY_MS    20000   // Повтор CFG/CFC (с запасом на эфирное время SF12)
+#define PARAM_SWITCH_ROLLBACK_MS 120000  // Откат, если на новых параметрах нет трафика
+
 // Display configuration
 #if DISPLAY_ENABLED
   #define TFT_CS     5       
@@ -41,17 +180,22 @@
 // Общие параметры
 #define ALPHA 0.2  // Коэффициент сглаживания EWMA
 
-// Настройка пинов для разных плат
+// Настройка пинов для разных плат. Выводы радиомодуля - параметр шаблона
+// драйвера SX127x (sx127x.h), поэтому задаются как constexpr, а не макросы
 #if defined(CONFIG_IDF_TARGET_ESP32S3)
-  #define LORA_SS          10
-  #define LORA_RST         14
-  #define LORA_DIO0        9
+  struct LoRaBoardPins {
+      static constexpr uint8_t ss = 10;
+      static constexpr uint8_t rst = 14;
+      static constexpr uint8_t dio0 = 9;
+  };
   #define LED_PIN     48
   #define NUM_LEDS    1
 #elif defined(CONFIG_IDF_TARGET_ESP32)
-  #define LORA_SS          15
-  #define LORA_RST         14
-  #define LORA_DIO0        4
+  struct LoRaBoardPins {
+      static constexpr uint8_t ss = 15;
+      static constexpr uint8_t rst = 14;
+      static constexpr uint8_t dio0 = 4;
+  };
   #define LED_BUILTIN 2
 #else
   #error "Unsupported ESP32 variant"
@@ -60,6 +204,13 @@
 // Глобальные переменные, используемые в разных модулях
 extern SemaphoreHandle_t spi_lock_mutex;
 
+// Захват и освобождение spi_lock_mutex с точками трассировки ожидания и владения шиной
+bool spiLock(TickType_t timeout);
+void spiUnlock();
+
+// Идентификатор узла (младшие байты MAC)
+uint32_t getNodeId();
+
 #if defined(CONFIG_IDF_TARGET_ESP32S3)
 extern Adafruit_NeoPixel strip;
 #endif
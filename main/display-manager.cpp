@@ -3,7 +3,8 @@
 #include "statistics.h"
 #include "lora-manager.h"
 #include "wifi-manager.h"
-#include "plot-manager.h"
+#include "metrics-history.h"
+#include "trace.h"
 
 // Глобальный экземпляр менеджера дисплея
 extern DisplayManager* displayManager;
@@ -35,7 +36,7 @@ bool DisplayManager::setupDisplay() {
     #if DISPLAY_ENABLED
     _display = new Adafruit_ST7735(TFT_CS, TFT_DC, TFT_RESET);
     
-    if (xSemaphoreTake(spi_lock_mutex, pdMS_TO_TICKS(10000))) {
+    if (spiLock(pdMS_TO_TICKS(10000))) {
         // Инициализируем дисплей
         _display->initR(INITR_144GREENTAB); // Используем initR вместо begin
         _display->setSPISpeed(26000000); // 26 МГц
@@ -45,7 +46,7 @@ bool DisplayManager::setupDisplay() {
         _display->setRotation(1);  // 0-3, поворот экрана
         _display->fillScreen(ST7735_BLACK);
 
-        xSemaphoreGive(spi_lock_mutex);
+        spiUnlock();
         
         // Настройка подсветки, если используется управляемая подсветка
         #ifdef TFT_LED
@@ -104,9 +105,9 @@ void DisplayManager::applySettings() {
 
 void DisplayManager::clear() {
     if (_display != nullptr && _enabled) {
-        if (xSemaphoreTake(spi_lock_mutex, pdMS_TO_TICKS(1000))) {
+        if (spiLock(pdMS_TO_TICKS(1000))) {
             _display->fillScreen(ST7735_BLACK);
-            xSemaphoreGive(spi_lock_mutex);
+            spiUnlock();
         } else {
             logger.println(error_() + "Не удалось захватить мьютекс для очистки дисплея");
         }
@@ -128,9 +129,9 @@ void DisplayManager::enableDisplay(bool enable) {
     
     if (_display != nullptr) {
         if (!enable) {
-            if (xSemaphoreTake(spi_lock_mutex, pdMS_TO_TICKS(1000))) {
+            if (spiLock(pdMS_TO_TICKS(1000))) {
                 _display->fillScreen(ST7735_BLACK);
-                xSemaphoreGive(spi_lock_mutex);
+                spiUnlock();
                 #ifdef TFT_LED
                 analogWrite(TFT_LED, 0);  // Выключаем подсветку
                 #endif
@@ -208,7 +209,8 @@ void DisplayManager::updateCurrentPage() {
         _lastUpdateTime = millis();
         lastPartialUpdate = millis();
         
-        if (xSemaphoreTake(spi_lock_mutex, pdMS_TO_TICKS(1000))) {
+        if (spiLock(pdMS_TO_TICKS(1000))) {
+            TRACE_SCOPE(TRACE_DISPLAY_REDRAW, _currentPage);
             // Clear screen before redrawing
             _display->fillScreen(ST7735_BLACK);
             
@@ -226,10 +228,13 @@ void DisplayManager::updateCurrentPage() {
                 case PAGE_SYSTEM_INFO:
                     DisplayUI::drawSystemInfoPage(_display);
                     break;
+                case PAGE_SPECTRUM:
+                    DisplayUI::drawSpectrumPage(_display);
+                    break;
                 case PAGE_LOGS:
                     _currentPage = PAGE_SYSTEM_INFO;
                     _needUpdate = true;
-                    xSemaphoreGive(spi_lock_mutex);
+                    spiUnlock();
                     return;
             }
             
@@ -240,7 +245,7 @@ void DisplayManager::updateCurrentPage() {
             bool loraActive = true;
             DisplayUI::drawStatusBar(_display, wifiConnected, loraActive);
 
-            xSemaphoreGive(spi_lock_mutex);
+            spiUnlock();
         } else {
             logger.println(error_() + "Не удалось захватить мьютекс для обновления страницы");
             _needUpdate = true; // Попробуем обновить в следующий раз
@@ -261,6 +266,13 @@ void DisplayManager::updateCurrentPage() {
             case PAGE_LORA_STATUS:
                 // Update only the changing stats
                 break;
+            case PAGE_SPECTRUM:
+                // Тепловая карта перерисовывается без очистки экрана
+                if (spiLock(pdMS_TO_TICKS(100))) {
+                    DisplayUI::drawSpectrumHeatmap(_display);
+                    spiUnlock();
+                }
+                break;
         }
     }
     
@@ -282,10 +294,10 @@ void DisplayManager::showInfo(String text, int duration) {
     _tempMessageDuration = duration;
     _isError = false;
     
-    if (xSemaphoreTake(spi_lock_mutex, pdMS_TO_TICKS(1000))) {
+    if (spiLock(pdMS_TO_TICKS(1000))) {
         _display->fillScreen(ST7735_BLACK);
         DisplayUI::drawInfoMessage(_display, _tempMessage);
-        xSemaphoreGive(spi_lock_mutex);
+        spiUnlock();
     } else {
         logger.println(error_() + "Не удалось захватить мьютекс для отображения информации");
     }
@@ -301,10 +313,10 @@ void DisplayManager::showError(String text, int duration) {
     _tempMessageDuration = duration;
     _isError = true;
     
-    if (xSemaphoreTake(spi_lock_mutex, pdMS_TO_TICKS(1000))) {
+    if (spiLock(pdMS_TO_TICKS(1000))) {
         _display->fillScreen(ST7735_BLACK);
         DisplayUI::drawErrorMessage(_display, _tempMessage);
-        xSemaphoreGive(spi_lock_mutex);
+        spiUnlock();
     } else {
         logger.println(error_() + "Не удалось захватить мьютекс для отображения ошибки");
     }
@@ -14,6 +14,7 @@ enum DisplayPage {
     PAGE_LORA_STATUS,
     PAGE_WIFI_STATUS,
     PAGE_SYSTEM_INFO,
+    PAGE_SPECTRUM,
     PAGE_LOGS,
     PAGE_COUNT
 };
@@ -1,7 +1,8 @@
 #include "display-ui.h"
 #include "statistics.h"
-#include "plot-manager.h"
+#include "metrics-history.h"
 #include "system-monitor.h"
+#include "spectrum-scan.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <vector>  // Для использования std::vector
@@ -182,6 +183,85 @@ void drawLoRaStatusPage(Adafruit_ST7735* display) {
     display->print("%");
     
     drawProgressBar(display, 5, 95, SCREEN_WIDTH - 10, 10, loraManager->getSuccessRate());
+
+    // Успешность доставки за последние 2 часа по минутам
+    display->fillRect(5, 107, SCREEN_WIDTH - 10, 13, COLOR_BACKGROUND);
+    drawHistoryGraph(display, 5, 107, SCREEN_WIDTH - 10, 13, HISTORY_PDR, HISTORY_MINUTES);
+}
+
+// Цвет ячейки тепловой карты по занятости, %
+static uint16_t occupancyColor(uint8_t occupancy) {
+    if (occupancy == 0xFF) return COLOR_PROGRESS_BG;
+    if (occupancy < 5) return 0x0010;     // Тёмно-синий
+    if (occupancy < 15) return ST77XX_BLUE;
+    if (occupancy < 30) return COLOR_SUCCESS;
+    if (occupancy < 60) return COLOR_WARNING;
+    return COLOR_ERROR;
+}
+
+// Отрисовка страницы занятости эфира
+void drawSpectrumPage(Adafruit_ST7735* display) {
+    drawHeader(display, "Spectrum");
+
+    if (spectrumScanner == nullptr || !spectrumScanner->isEnabled()) {
+        drawCenteredText(display, 60, "Scan disabled", COLOR_TEXT, 1);
+        return;
+    }
+    drawSpectrumHeatmap(display);
+}
+
+void drawSpectrumHeatmap(Adafruit_ST7735* display) {
+    if (spectrumScanner == nullptr || !spectrumScanner->isEnabled()) {
+        return;
+    }
+    const int top = 24;
+    const int rowHeight = 2;
+    uint8_t count = spectrumScanner->getChannelCount();
+    if (count == 0) {
+        return;
+    }
+    int columnWidth = (SCREEN_WIDTH - 8) / count;
+
+    // Новые строки снизу, каждая строка - SCAN_HEATMAP_PERIOD_MS
+    static uint8_t heatmap[SCAN_HEATMAP_ROWS][SCAN_MAX_CHANNELS];
+    uint8_t rows = spectrumScanner->getHeatmap(heatmap, SCAN_HEATMAP_ROWS);
+    for (int r = 0; r < SCAN_HEATMAP_ROWS; r++) {
+        int source = r - (SCAN_HEATMAP_ROWS - rows);
+        for (uint8_t ch = 0; ch < count; ch++) {
+            uint8_t value = source >= 0 ? heatmap[source][ch] : 0xFF;
+            display->fillRect(4 + ch * columnWidth, top + r * rowHeight, columnWidth - 1, rowHeight, occupancyColor(value));
+        }
+    }
+
+    int y = top + SCAN_HEATMAP_ROWS * rowHeight + 4;
+    display->fillRect(0, y, SCREEN_WIDTH, 20, COLOR_BACKGROUND);
+    display->setTextColor(COLOR_TEXT);
+    display->setTextSize(1);
+    display->setCursor(5, y);
+    int quietest = loraManager ? spectrumScanner->getQuietestChannel(loraManager->channelPlan()) : -1;
+    if (quietest >= 0) {
+        display->print("Quiet: ch ");
+        display->print(quietest);
+    }
+    // Самая занятая частота списка сканирования
+    float busiest = -1;
+    ScanChannelStats busiestStats = {};
+    for (uint8_t i = 0; i < count; i++) {
+        ScanChannelStats stats = spectrumScanner->getChannelStats(i);
+        if (stats.occupancy > busiest) {
+            busiest = stats.occupancy;
+            busiestStats = stats;
+        }
+    }
+    if (busiest >= 0) {
+        display->setCursor(5, y + 10);
+        display->print(String(busiestStats.frequency / 1e6, 3));
+        display->print(" ");
+        display->print((int)busiest);
+        display->print("% ");
+        display->print((int)busiestStats.noiseFloor);
+        display->print("dBm");
+    }
 }
 
 // Отрисовка страницы статуса WiFi
@@ -270,8 +350,6 @@ void drawSystemInfoPage(Adafruit_ST7735* display) {
     display->print(" kB");
     
     if (systemMonitor != nullptr) {
-        systemMonitor->update();
-        
         display->setCursor(5, 60);
         display->print("CPU Usage: ");
         display->print(systemMonitor->getTotalCpuUsage());
@@ -366,8 +444,6 @@ void drawCpuMonitorPage(Adafruit_ST7735* display) {
         return;
     }
     
-    systemMonitor->update();
-    
     display->setTextSize(1);
     display->setTextColor(COLOR_TEXT);
     display->setCursor(5, 15);
@@ -382,10 +458,11 @@ void drawCpuMonitorPage(Adafruit_ST7735* display) {
 
     display->drawLine(0, 35, 128, 35, COLOR_HEADER);
     
-    uint16_t taskCount = 0;
-    SystemMonitor::TaskInfo* tasks = systemMonitor->getTasksInfo(taskCount);
+    // Страница показывает первые строки таблицы: копии одной порции хватает
+    SystemMonitor::TaskInfo tasks[SYSTEM_MONITOR_COPY_ROWS];
+    uint16_t taskCount = systemMonitor->getTasksInfo(tasks, SYSTEM_MONITOR_COPY_ROWS);
     
-    if (tasks != nullptr && taskCount > 0) {
+    if (taskCount > 0) {
         uint8_t displayLimit = min(6, (int)taskCount);
         
         display->setCursor(5, 40);
@@ -403,18 +480,19 @@ void drawCpuMonitorPage(Adafruit_ST7735* display) {
             display->print(shortName);
             
             display->setCursor(70, y);
-            display->print(tasks[i].cpuUsage);
+            uint8_t cpu = (uint8_t)(tasks[i].cpu[CPU_WINDOW_10S] + 0.5f);
+            display->print(cpu);
             display->print("%");
             
             display->setCursor(95, y);
             display->print(tasks[i].stackHighWater);
             
             uint16_t barColor;
-            if (tasks[i].cpuUsage > 50) barColor = COLOR_ERROR;
-            else if (tasks[i].cpuUsage > 20) barColor = COLOR_WARNING;
+            if (cpu > 50) barColor = COLOR_ERROR;
+            else if (cpu > 20) barColor = COLOR_WARNING;
             else barColor = COLOR_SUCCESS;
             
-            int barWidth = map(tasks[i].cpuUsage, 0, 100, 0, 60);
+            int barWidth = map(cpu, 0, 100, 0, 60);
             display->drawRect(0, y, 3, 8, barColor);
             if (barWidth > 0) {
                 display->fillRect(0, y, 3, 8, barColor);
@@ -514,33 +592,40 @@ void drawHeader(Adafruit_ST7735* display, String title, uint16_t color) {
     display->print(title);
 }
 
-// Функция для отрисовки миниграфика
-void drawMiniGraph(Adafruit_ST7735* display, int x, int y, int width, int height, const uint32_t* data, int dataPoints, uint16_t lineColor) {
-    uint32_t maxVal = 0;
-    uint32_t minVal = UINT32_MAX;
-    
-    for (int i = 0; i < dataPoints; i++) {
-        if (data[i] > maxVal) maxVal = data[i];
-        if (data[i] < minVal) minVal = data[i];
-    }
-    
-    if (maxVal == minVal) {
-        maxVal += 10;
-        minVal = (minVal > 10) ? minVal - 10 : 0;
+// Миниграфик ряда истории: интервалы читаются прямо из кольца, без копии
+void drawHistoryGraph(Adafruit_ST7735* display, int x, int y, int width, int height, HistorySeries series, HistoryTier tier, uint16_t lineColor) {
+    uint16_t points = min((int)MetricsHistory::capacity(tier), width);
+    HistoryBucket range = metricsHistory.summary(series, tier, points);
+    if (range.count == 0) {
+        return;
     }
-    
-    for (int i = 1; i < dataPoints; i++) {
-        int x1 = x + (width * (i - 1)) / dataPoints;
-        int y1 = y + height - ((height * (data[i - 1] - minVal)) / (maxVal - minVal));
-        
-        int x2 = x + (width * i) / dataPoints;
-        int y2 = y + height - ((height * (data[i] - minVal)) / (maxVal - minVal));
-        
-        y1 = constrain(y1, y, y + height - 1);
-        y2 = constrain(y2, y, y + height - 1);
-        
-        display->drawLine(x1, y1, x2, y2, lineColor);
+    float minVal = range.min;
+    float maxVal = range.max;
+    if (maxVal - minVal < 1.0f) {
+        maxVal += 0.5f;
+        minVal -= 0.5f;
     }
+
+    int index = 0;
+    int prevX = -1;
+    int prevY = 0;
+    metricsHistory.visit(series, tier, points, [&](const HistoryBucket& bucket) {
+        int px = x + (width * index++) / points;
+        if (bucket.count == 0) {
+            // Интервал без значений - разрыв линии
+            prevX = -1;
+            return;
+        }
+        int py = y + height - 1 - (int)((height - 1) * (bucket.avg() - minVal) / (maxVal - minVal));
+        py = constrain(py, y, y + height - 1);
+        if (prevX >= 0) {
+            display->drawLine(prevX, prevY, px, py, lineColor);
+        } else {
+            display->drawPixel(px, py, lineColor);
+        }
+        prevX = px;
+        prevY = py;
+    });
 }
 
 // Функция для форматирования IP-адреса
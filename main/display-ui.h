@@ -7,6 +7,7 @@
 #include "statistics.h"
 #include "wifi-manager.h"
 #include "lora-manager.h"
+#include "metrics-history.h"
 
 namespace DisplayUI {
     // Константы для UI
@@ -43,6 +44,10 @@ namespace DisplayUI {
     
     void drawSystemInfoPage(Adafruit_ST7735* display);
     
+    // Занятость эфира: тепловая карта (строки - время, столбцы - частоты)
+    void drawSpectrumPage(Adafruit_ST7735* display);
+    void drawSpectrumHeatmap(Adafruit_ST7735* display);
+    
     void drawLogsPage(Adafruit_ST7735* display, const String* logLines, int lineCount);
     
     void drawCpuMonitorPage(Adafruit_ST7735* display);
@@ -57,8 +62,8 @@ namespace DisplayUI {
     
     void drawHeader(Adafruit_ST7735* display, String title, uint16_t color = COLOR_HEADER);
     
-    // Функция для отрисовки миниграфика
-    void drawMiniGraph(Adafruit_ST7735* display, int x, int y, int width, int height, const uint32_t* data, int dataPoints, uint16_t lineColor = COLOR_SUCCESS);
+    // Миниграфик ряда истории метрик (средние интервалов, масштаб по min/max окна)
+    void drawHistoryGraph(Adafruit_ST7735* display, int x, int y, int width, int height, HistorySeries series, HistoryTier tier, uint16_t lineColor = COLOR_SUCCESS);
     
     // Функция для форматирования IP-адреса
     String formatIP(IPAddress ip);
@@ -6,9 +6,6 @@
 #define DEFAULT_AP_SSID "ESP32_LoRa"
 #define DEFAULT_AP_PASS "12345678"
 
-// Максимальное количество точек на графике
-#define MAX_PLOT_POINTS 100
-
 // Идентификаторы для полей базы данных
 #define DB_NAMESPACE lora_config
 
@@ -39,7 +36,36 @@ DB_KEYS(
     lora_coding_rate_selected, // Coding Rate (скорость кодирования) (номер выбранного поля)
     lora_max_attempts,// Максимальное количество попыток
     lora_tx_power,    // Мощность передачи
+    lora_implicit_len,// Длина кадра в режиме неявного заголовка (0 - явный заголовок)
+    lora_crc,         // CRC полезной нагрузки
     apply_lora,       // Кнопка применения настроек LoRa
+    lora_hop_channels,// Число каналов перестройки частоты (1 - выключена)
+    lora_hop_seed,    // Общий для линка seed последовательности каналов
+
+    // Шлюз LoRa -> UDP/MQTT
+    gw_mode,          // Режим (0 - выкл., 1 - UDP, 2 - MQTT)
+    gw_host,          // Адрес сервера или брокера
+    gw_port,          // Порт
+    gw_topic,         // Префикс топиков MQTT
+
+    // Двоичный режим модема
+    modem_enabled,    // Порт занят протоколом модема
+    modem_baud,       // Скорость порта в режиме модема
+
+    // Захват пакетов
+    capture_mode,     // CAPTURE_OFF/FILE/TCP/SERIAL
+
+    // Сканирование эфира
+    scan_enabled,     // Включение сканирования
+    scan_freqs,       // Частоты, MHz через ';' (пусто - каналы частотного плана)
+    scan_rate,        // Отсчётов в секунду
+
+    // Профилировщик CPU
+    prof_enabled,     // Таймеры отсчётов запущены
+    prof_rate,        // Отсчётов в секунду на ядро
+    prof_depth,       // Глубина стека в отсчёте
+    prof_samples,     // Отсчётов в кольце ядра
+    prof_overhead,    // Предел накладных расходов, % ядра
 
     // Настройки дисплея
     display_enabled,        // Включение/выключение дисплея
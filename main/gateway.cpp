@@ -0,0 +1,371 @@
+#include "gateway.h"
+#include <WiFi.h>
+#include "esp_timer.h"
+#include "tx-queue.h"
+
+// Глобальный экземпляр шлюза
+Gateway* gateway = nullptr;
+
+Gateway::Gateway(GyverDB* db) : _db(db), _mqtt(_wifiClient) {
+    _queue = xQueueCreate(GATEWAY_QUEUE_LENGTH, sizeof(GatewayFrame));
+    _configLock = xSemaphoreCreateMutex();
+    _reconfigure = false;
+    _pendingMode = GATEWAY_MODE_OFF;
+    _pendingPort = 0;
+    _mode = GATEWAY_MODE_OFF;
+    _port = 0;
+    _nodeId = String(getNodeId(), HEX);
+    _lastConnectAttempt = 0;
+    _connectBackoff = GATEWAY_RETRY_MS;
+    _connected = false;
+    _batchCount = 0;
+    _batchStarted = 0;
+    _retryAt = 0;
+    _batchBytes = 0;
+    _batchLimit = GATEWAY_UDP_PAYLOAD;
+    _batchFull = false;
+    _sendFailures = 0;
+    _dropped = 0;
+    memset(&_stats, 0, sizeof(_stats));
+    _rateWindowStart = 0;
+    _rateWindowCount = 0;
+}
+
+void Gateway::initDefaults() {
+    _db->init(DB_NAMESPACE::gw_mode, GATEWAY_MODE_OFF);
+    _db->init(DB_NAMESPACE::gw_host, "");
+    _db->init(DB_NAMESPACE::gw_port, GATEWAY_DEFAULT_PORT);
+    _db->init(DB_NAMESPACE::gw_topic, "lora");
+}
+
+// Настройки читаются здесь (задача интерфейса), а применяются в задаче шлюза
+void Gateway::applySettings() {
+    xSemaphoreTake(_configLock, portMAX_DELAY);
+    _pendingMode = _db->get(DB_NAMESPACE::gw_mode).toInt();
+    _pendingHost = _db->get(DB_NAMESPACE::gw_host).toString();
+    _pendingPort = _db->get(DB_NAMESPACE::gw_port).toInt();
+    _pendingTopic = _db->get(DB_NAMESPACE::gw_topic).toString();
+    _reconfigure = true;
+    xSemaphoreGive(_configLock);
+}
+
+void Gateway::reconfigure() {
+    xSemaphoreTake(_configLock, portMAX_DELAY);
+    _mode = _pendingMode;
+    _host = _pendingHost;
+    _port = _pendingPort;
+    _topic = _pendingTopic;
+    _reconfigure = false;
+    xSemaphoreGive(_configLock);
+
+    _udp.stop();
+    if (_mqtt.connected()) {
+        _mqtt.disconnect();
+    }
+    _connected = false;
+    _lastConnectAttempt = 0;
+    _connectBackoff = GATEWAY_RETRY_MS;
+    _retryAt = 0;
+
+    // MQTT: в буфере PubSubClient ещё заголовок (до 5 байт), длина топика и топик
+    _batchLimit = GATEWAY_UDP_PAYLOAD;
+    if (_mode == GATEWAY_MODE_MQTT) {
+        size_t mqttLimit = GATEWAY_MQTT_BUFFER - 5 - 2 - (_topic.length() + 3);
+        _batchLimit = min(_batchLimit, mqttLimit);
+    }
+
+    if (_mode != GATEWAY_MODE_OFF && (_host.length() == 0 || _port == 0)) {
+        logger.println(warn_() + "Шлюз: не задан сервер, пересылка выключена");
+        _mode = GATEWAY_MODE_OFF;
+    }
+
+    switch (_mode) {
+        case GATEWAY_MODE_UDP:
+            // Обратный канал принимается на тот же номер порта
+            _udp.begin(_port);
+            logger.println("Шлюз UDP: " + _host + ":" + String(_port));
+            break;
+        case GATEWAY_MODE_MQTT:
+            _mqtt.setServer(_host.c_str(), _port);
+            _mqtt.setBufferSize(GATEWAY_MQTT_BUFFER);
+            _mqtt.setCallback(onMqttMessage);
+            // Молчащий брокер не держит задачу шлюза дольше периода WDT: таймаут
+            // подключения и чтения сокета (в секундах) и ожидания CONNACK
+            _wifiClient.setTimeout(GATEWAY_SOCKET_TIMEOUT_S);
+            _mqtt.setSocketTimeout(GATEWAY_SOCKET_TIMEOUT_S);
+            logger.println("Шлюз MQTT: " + _host + ":" + String(_port) + ", топик " + _topic);
+            break;
+        default:
+            // Накопленное при выключенном шлюзе не отправляем
+            _batchCount = 0;
+            _batchBytes = 0;
+            _batchFull = false;
+            _sendFailures = 0;
+            xQueueReset(_queue);
+            break;
+    }
+}
+
+bool Gateway::submit(const GatewayFrame& frame) {
+    if (_mode == GATEWAY_MODE_OFF) {
+        return false;
+    }
+    if (xQueueSend(_queue, &frame, 0) != pdTRUE) {
+        _dropped++;
+        return false;
+    }
+    return true;
+}
+
+bool Gateway::ensureConnected(uint32_t now) {
+    wifi_mode_t wifiMode = WiFi.getMode();
+    bool wifiUp = wifiMode != WIFI_OFF && (wifiMode != WIFI_STA || WiFi.status() == WL_CONNECTED);
+    if (!wifiUp) {
+        _connected = false;
+        return false;
+    }
+
+    if (_mode == GATEWAY_MODE_UDP) {
+        _connected = true;
+        return true;
+    }
+
+    if (_mqtt.connected()) {
+        _connected = true;
+        return true;
+    }
+    _connected = false;
+    // Попытки из цикла задачи с растущей паузой: недоступный брокер не занимает задачу
+    if (_lastConnectAttempt != 0 && now - _lastConnectAttempt < _connectBackoff) {
+        return false;
+    }
+    _lastConnectAttempt = now;
+    if (_mqtt.connect(("lora-" + _nodeId).c_str())) {
+        _mqtt.subscribe((_topic + "/down").c_str());
+        logger.println("Шлюз MQTT подключен");
+        _connected = true;
+        _connectBackoff = GATEWAY_RETRY_MS;
+    } else {
+        logger.println(warn_() + "Шлюз MQTT: ошибка подключения " + String(_mqtt.state()) +
+                       ", повтор через " + String(_connectBackoff / 1000) + " с");
+        _connectBackoff = min(_connectBackoff * 2, (uint32_t)GATEWAY_RETRY_MAX_MS);
+    }
+    return _connected;
+}
+
+void Gateway::appendFrameJson(String& out, const GatewayFrame& frame) {
+    out += "{\"text\":\"";
+    for (const char* p = frame.text; *p; p++) {
+        char c = *p;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((uint8_t)c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (uint8_t)c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    char meta[160];
+    formatFrameMeta(meta, sizeof(meta), frame);
+    out += meta;
+}
+
+size_t Gateway::formatFrameMeta(char* out, size_t size, const GatewayFrame& frame) {
+    return snprintf(out, size, "\",\"rssi\":%d,\"snr\":%.1f,\"freq\":%ld,\"rx_us\":%lld,\"time_us\":%lld}",
+                    frame.rssi, frame.snr, frame.frequency, (long long)frame.rxDoneUs, (long long)frame.globalUs);
+}
+
+// Длина JSON кадра без построения строки - те же правила экранирования
+size_t Gateway::frameJsonLength(const GatewayFrame& frame) {
+    size_t length = strlen("{\"text\":\"");
+    for (const char* p = frame.text; *p; p++) {
+        char c = *p;
+        length += (c == '"' || c == '\\') ? 2 : ((uint8_t)c < 0x20 ? 6 : 1);
+    }
+    char meta[160];
+    return length + min(formatFrameMeta(meta, sizeof(meta), frame), sizeof(meta) - 1);
+}
+
+// {"node":"<id>","frames":[ ... ]}
+size_t Gateway::batchOverhead() const {
+    return strlen("{\"node\":\"\",\"frames\":[]}") + _nodeId.length();
+}
+
+void Gateway::discardBatch(const char* reason) {
+    _stats.discarded += _batchCount;
+    logger.println(warn_() + "Шлюз: отброшено кадров: " + String(_batchCount) + ", " + reason);
+    _batchCount = 0;
+    _batchBytes = 0;
+    _batchFull = false;
+    _sendFailures = 0;
+}
+
+bool Gateway::sendBatch() {
+    String json;
+    json.reserve(batchOverhead() + _batchBytes);
+    json += "{\"node\":\"" + _nodeId + "\",\"frames\":[";
+    for (uint8_t i = 0; i < _batchCount; i++) {
+        if (i > 0) json += ',';
+        appendFrameJson(json, _batch[i]);
+    }
+    json += "]}";
+
+    bool ok = false;
+    if (_mode == GATEWAY_MODE_UDP) {
+        ok = _udp.beginPacket(_host.c_str(), _port) &&
+             _udp.write((const uint8_t*)json.c_str(), json.length()) == json.length() &&
+             _udp.endPacket();
+    } else if (_mode == GATEWAY_MODE_MQTT) {
+        ok = _mqtt.publish((_topic + "/up").c_str(), (const uint8_t*)json.c_str(), json.length());
+    }
+    if (!ok) {
+        return false;
+    }
+
+    // Добавленная шлюзом задержка: от постановки в очередь до отправки
+    int64_t nowUs = esp_timer_get_time();
+    for (uint8_t i = 0; i < _batchCount; i++) {
+        uint32_t latency = (uint32_t)(nowUs - _batch[i].queuedUs);
+        _stats.latencyAvgUs = _stats.forwarded == 0 ? latency
+            : (uint32_t)((ALPHA * latency) + ((1 - ALPHA) * _stats.latencyAvgUs));
+        if (latency > _stats.latencyMaxUs) _stats.latencyMaxUs = latency;
+        _stats.forwarded++;
+    }
+    _stats.batches++;
+    _rateWindowCount += _batchCount;
+    return true;
+}
+
+void Gateway::pollDownlink() {
+    if (_mode == GATEWAY_MODE_MQTT) {
+        // Входящие публикации приходят в onMqttMessage
+        _mqtt.loop();
+        return;
+    }
+    if (_mode != GATEWAY_MODE_UDP) {
+        return;
+    }
+    // Не больше нескольких датаграмм за шаг, чтобы не задерживать отправку
+    for (uint8_t i = 0; i < 4 && _udp.parsePacket() > 0; i++) {
+        char buffer[TXQ_MAX_PAYLOAD + 1];
+        int length = _udp.read((uint8_t*)buffer, TXQ_MAX_PAYLOAD);
+        if (length <= 0) continue;
+        buffer[length] = '\0';
+        String text(buffer);
+        text.trim();
+        if (txQueue.enqueue(text, millis())) {
+            _stats.downlinks++;
+        }
+    }
+}
+
+void Gateway::onMqttMessage(char* topic, uint8_t* payload, unsigned int length) {
+    if (gateway == nullptr || length == 0 || length > TXQ_MAX_PAYLOAD) {
+        return;
+    }
+    char buffer[TXQ_MAX_PAYLOAD + 1];
+    memcpy(buffer, payload, length);
+    buffer[length] = '\0';
+    if (txQueue.enqueue(String(buffer), millis())) {
+        gateway->_stats.downlinks++;
+    }
+}
+
+void Gateway::process() {
+    if (_reconfigure) {
+        reconfigure();
+    }
+    if (_mode == GATEWAY_MODE_OFF) {
+        vTaskDelay(pdMS_TO_TICKS(500));
+        return;
+    }
+
+    // Ждём кадры, но не дольше срока отправки накопленного пакета
+    uint32_t now = millis();
+    uint32_t waitMs = GATEWAY_BATCH_MS;
+    if (_batchCount > 0) {
+        uint32_t age = now - _batchStarted;
+        waitMs = age >= GATEWAY_BATCH_MS ? 0 : GATEWAY_BATCH_MS - age;
+    }
+    if ((int32_t)(_retryAt - now) > 0 && (int32_t)(_retryAt - now) < (int32_t)waitMs) {
+        waitMs = _retryAt - now;
+    }
+    if (_batchCount < GATEWAY_BATCH_MAX && !_batchFull) {
+        // Кадр сначала смотрим: не поместившийся в пакет остаётся в очереди
+        // до следующего пакета. Читает очередь только эта задача
+        GatewayFrame& frame = _batch[_batchCount];
+        if (xQueuePeek(_queue, &frame, pdMS_TO_TICKS(waitMs)) == pdTRUE) {
+            size_t bytes = frameJsonLength(frame) + (_batchCount > 0 ? 1 : 0);
+            if (batchOverhead() + _batchBytes + bytes <= _batchLimit) {
+                xQueueReceive(_queue, &frame, 0);
+                if (_batchCount == 0) _batchStarted = millis();
+                _batchCount++;
+                _batchBytes += bytes;
+            } else if (_batchCount > 0) {
+                _batchFull = true;
+            } else {
+                // Один кадр больше предела не уйдёт ни в каком пакете
+                xQueueReceive(_queue, &frame, 0);
+                _stats.discarded++;
+                logger.println(warn_() + "Шлюз: кадр больше пакета (" + String(batchOverhead() + bytes) + " байт), отброшен");
+            }
+        }
+    } else {
+        // Пакет полон и не отправлен: новые кадры копятся в очереди,
+        // при её переполнении отбрасываются в submit()
+        vTaskDelay(pdMS_TO_TICKS(max(waitMs, (uint32_t)50)));
+    }
+
+    now = millis();
+    bool connected = ensureConnected(now);
+    if (connected) {
+        pollDownlink();
+    }
+
+    bool due = _batchCount >= GATEWAY_BATCH_MAX || _batchFull ||
+               (_batchCount > 0 && now - _batchStarted >= GATEWAY_BATCH_MS);
+    if (due && (int32_t)(now - _retryAt) >= 0) {
+        if (connected && sendBatch()) {
+            _batchCount = 0;
+            _batchBytes = 0;
+            _batchFull = false;
+            _sendFailures = 0;
+            _retryAt = 0;
+        } else {
+            _stats.sendErrors++;
+            _retryAt = now + GATEWAY_RETRY_MS;
+            // Без связи пакет ждёт; при связи повторяющийся отказ - не в сети, а в пакете
+            if (connected && ++_sendFailures >= GATEWAY_SEND_ATTEMPTS) {
+                discardBatch("отправка не удалась");
+                _retryAt = 0;
+            }
+        }
+    }
+
+    // Пропускная способность по окнам в 10 секунд
+    if (now - _rateWindowStart >= 10000) {
+        float rate = _rateWindowCount * 1000.0f / (now - _rateWindowStart);
+        _stats.throughput = (ALPHA * rate) + ((1 - ALPHA) * _stats.throughput);
+        _rateWindowStart = now;
+        _rateWindowCount = 0;
+    }
+}
+
+bool Gateway::isEnabled() const {
+    return _mode != GATEWAY_MODE_OFF;
+}
+
+int Gateway::getMode() const {
+    return _mode;
+}
+
+GatewayStats Gateway::getStats() const {
+    GatewayStats stats = _stats;
+    stats.dropped = _dropped;
+    stats.queued = uxQueueMessagesWaiting(_queue) + _batchCount;
+    stats.connected = _connected;
+    return stats;
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <Arduino.h>
+#include <GyverDB.h>
+#include <WiFiUdp.h>
+#include <PubSubClient.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "config.h"
+#include "esp32-config.h"
+#include "logging.h"
+
+// Режимы шлюза
+#define GATEWAY_MODE_OFF  0
+#define GATEWAY_MODE_UDP  1
+#define GATEWAY_MODE_MQTT 2
+
+// Максимальная длина текста принятого кадра
+#define GATEWAY_FRAME_TEXT 224
+
+// Принятый кадр с метаданными для передачи на сервер
+struct GatewayFrame {
+    char text[GATEWAY_FRAME_TEXT];
+    int64_t rxDoneUs;     // Локальная метка RxDone
+    int64_t globalUs;     // То же в синхронизированном времени сети
+    int64_t queuedUs;     // Постановка в очередь шлюза (для оценки задержки)
+    int16_t rssi;
+    float snr;
+    long frequency;
+};
+
+// Метрики шлюза
+struct GatewayStats {
+    uint32_t forwarded;      // Кадров отправлено на сервер
+    uint32_t batches;        // Пакетов (датаграмм/публикаций)
+    uint32_t dropped;        // Отброшено при переполнении очереди
+    uint32_t discarded;      // Отброшено: пакет не отправился за GATEWAY_SEND_ATTEMPTS или кадр больше пакета
+    uint32_t sendErrors;     // Ошибок отправки
+    uint32_t downlinks;      // Сообщений с сервера в очередь LoRa
+    uint32_t queued;         // Сейчас в очереди
+    float throughput;        // Кадров в секунду (сглаженно)
+    uint32_t latencyAvgUs;   // Задержка от приёма до отправки (сглаженно)
+    uint32_t latencyMaxUs;
+    bool connected;
+};
+
+// Мост LoRa -> UDP/MQTT.
+//
+// taskReceive только кладёт кадр в очередь FreeRTOS (без ожидания): при проблемах
+// с WiFi очередь заполняется и новые кадры отбрасываются со счётчиком, приём не
+// блокируется. Отдельная задача собирает кадры в пакеты до GATEWAY_BATCH_MAX штук,
+// GATEWAY_BATCH_MS или предела размера JSON и отправляет одним JSON:
+//   {"node":"<id>","frames":[{"text":..,"rssi":..,"snr":..,"freq":..,"rx_us":..,"time_us":..},...]}
+// UDP - датаграммой на host:port, MQTT - публикацией в <topic>/up. Предел
+// размера - GATEWAY_UDP_PAYLOAD (датаграмма без фрагментации), для MQTT ещё и
+// буфер PubSubClient за вычетом заголовка и топика: пакет, который не
+// поместился бы, не отправится никогда. Пакет, не ушедший за
+// GATEWAY_SEND_ATTEMPTS попыток при живом подключении, отбрасывается со
+// счётчиком, иначе очередь встала бы на нём.
+// Обратный канал: текст датаграммы на локальный порт или публикация в <topic>/down
+// ставится в очередь сообщений LoRa (TxQueue).
+class Gateway {
+public:
+    Gateway(GyverDB* db);
+
+    void initDefaults();
+    // Перечитать настройки из базы; применяются задачей шлюза
+    void applySettings();
+
+    // Вызывается из taskReceive, не блокируется
+    bool submit(const GatewayFrame& frame);
+
+    // Один шаг задачи шлюза: ожидание кадров, отправка пакета, приём обратного канала
+    void process();
+
+    bool isEnabled() const;
+    int getMode() const;
+    GatewayStats getStats() const;
+
+private:
+    void reconfigure();
+    bool ensureConnected(uint32_t now);
+    bool sendBatch();
+    void pollDownlink();
+    void appendFrameJson(String& out, const GatewayFrame& frame);
+    static size_t formatFrameMeta(char* out, size_t size, const GatewayFrame& frame);
+    static size_t frameJsonLength(const GatewayFrame& frame);
+    size_t batchOverhead() const;
+    void discardBatch(const char* reason);
+    static void onMqttMessage(char* topic, uint8_t* payload, unsigned int length);
+
+    GyverDB* _db;
+    QueueHandle_t _queue;
+
+    // Настройки из интерфейса, ожидающие применения задачей шлюза
+    SemaphoreHandle_t _configLock;
+    volatile bool _reconfigure;
+    int _pendingMode;
+    String _pendingHost;
+    uint16_t _pendingPort;
+    String _pendingTopic;
+
+    // Текущая конфигурация (меняется только в задаче шлюза)
+    int _mode;
+    String _host;
+    uint16_t _port;
+    String _topic;
+    String _nodeId;
+
+    WiFiUDP _udp;
+    WiFiClient _wifiClient;
+    PubSubClient _mqtt;
+    uint32_t _lastConnectAttempt;
+    uint32_t _connectBackoff;   // Пауза до следующей попытки подключения
+    bool _connected;
+
+    // Накопленный пакет
+    GatewayFrame _batch[GATEWAY_BATCH_MAX];
+    uint8_t _batchCount;
+    uint32_t _batchStarted;
+    uint32_t _retryAt;
+    size_t _batchBytes;       // JSON кадров пакета с запятыми
+    size_t _batchLimit;       // Предел JSON пакета для текущего режима
+    bool _batchFull;          // Следующий кадр в пакет не помещается
+    uint8_t _sendFailures;    // Неудачных отправок пакета при связи
+
+    // Метрики
+    volatile uint32_t _dropped;
+    GatewayStats _stats;
+    uint32_t _rateWindowStart;
+    uint32_t _rateWindowCount;
+};
+
+// Глобальный экземпляр шлюза
+extern Gateway* gateway;
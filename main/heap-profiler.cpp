@@ -0,0 +1,493 @@
+#include "heap-profiler.h"
+#include "metrics.h"
+#include "profiler.h"
+#include <esp_heap_caps.h>
+#include <esp_debug_helpers.h>
+#include <atomic>
+#include <algorithm>
+
+struct HeapCapsEntry {
+    const char* name;
+    uint32_t caps;
+};
+
+static const HeapCapsEntry HEAP_CAPS[] = {
+    {"internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT},
+    {"dma", MALLOC_CAP_DMA},
+    {"spiram", MALLOC_CAP_SPIRAM},
+};
+
+// Место вызова в выборке; счётчики - без умножения на период выборки
+struct HeapSite {
+    uint32_t task;
+    uint32_t depth;
+    uint32_t stack[HEAP_PROFILER_DEPTH];
+    uint32_t allocs;
+    uint32_t bytes;
+    uint32_t liveBytes;
+};
+
+// Живое выделение из выборки; ptr == nullptr - свободная ячейка
+struct HeapLive {
+    void* ptr;
+    uint32_t size;
+    uint16_t site;
+    uint16_t generation;   // Номер интервала между снимками, в котором выделено
+};
+
+static Counter heapAllocFailed("heap_alloc_failed", "Failed heap allocations");
+static volatile uint32_t heapLastFailedSize = 0;
+
+// Таблицы выборки: статические (нули до любых конструкторов), выделения
+// из конструкторов других единиц трансляции учитываются с самого старта
+static HeapSite heapSites[HEAP_PROFILER_SITES];
+static uint16_t heapSiteCount = 0;
+static HeapLive heapLive[HEAP_PROFILER_LIVE];
+static uint32_t heapLiveCount = 0;
+static uint32_t heapDropped = 0;
+static uint16_t heapGeneration = 0;
+static portMUX_TYPE heapLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Наблюдаемая задача; счётчики пишет только она сама
+static volatile uint32_t heapWatchTask = 0;
+static volatile uint32_t heapWatchAllocs = 0;
+static volatile uint32_t heapWatchBytes = 0;
+
+// Снимки для поиска утечек
+static HeapLeakReport heapLeaks;
+static uint32_t heapSnapshotMs = 0;
+static uint32_t heapSnapshotFree = 0;
+static uint32_t heapSnapshotBlocks = 0;
+
+#if HEAP_PROFILER_WRAP
+
+static Counter heapAllocs("heap_allocs", "Heap allocations (malloc, calloc, realloc)");
+static Counter heapFrees("heap_frees", "Heap frees (free, realloc)");
+static Counter heapAllocBytes("heap_alloc_bytes", "Bytes requested from the heap");
+static Gauge heapAllocRate("heap_alloc_rate", "Heap allocations per second");
+static Gauge heapAllocBytesRate("heap_alloc_bytes_rate", "Bytes requested from the heap per second");
+static std::atomic<uint32_t> heapSampleTick(0);
+
+static inline uint32_t heapLiveSlot(const void* ptr) {
+    return (((uint32_t)(uintptr_t)ptr >> 3) * 2654435761u) % HEAP_PROFILER_LIVE;
+}
+
+// Стек места вызова; свои кадры (heapBacktrace, heapRecordAlloc, __wrap_*) пропускаются
+static uint32_t __attribute__((noinline)) heapBacktrace(uint32_t* stack) {
+    esp_backtrace_frame_t frame;
+    esp_backtrace_get_start(&frame.pc, &frame.sp, &frame.next_pc);
+    uint32_t skip = 2;
+    uint32_t depth = 0;
+    while (depth < HEAP_PROFILER_DEPTH && frame.next_pc != 0 && esp_backtrace_get_next_frame(&frame)) {
+        if (skip > 0) {
+            skip--;
+            continue;
+        }
+        stack[depth++] = backtraceReturnPc(frame.pc);
+    }
+    for (uint32_t i = depth; i < HEAP_PROFILER_DEPTH; i++) {
+        stack[i] = 0;
+    }
+    return depth;
+}
+
+// Место вызова по задаче и стеку; вызывается под heapLock
+static int heapFindSite(uint32_t task, const uint32_t* stack, uint32_t depth) {
+    for (uint16_t i = 0; i < heapSiteCount; i++) {
+        const HeapSite& site = heapSites[i];
+        if (site.task == task && site.depth == depth && memcmp(site.stack, stack, sizeof(site.stack)) == 0) {
+            return i;
+        }
+    }
+    if (heapSiteCount == HEAP_PROFILER_SITES) {
+        return -1;
+    }
+    HeapSite& site = heapSites[heapSiteCount];
+    site.task = task;
+    site.depth = depth;
+    memcpy(site.stack, stack, sizeof(site.stack));
+    site.allocs = 0;
+    site.bytes = 0;
+    site.liveBytes = 0;
+    return heapSiteCount++;
+}
+
+static void __attribute__((noinline)) heapRecordAlloc(void* ptr, size_t size) {
+    heapAllocs.inc();
+    heapAllocBytes.inc(size);
+    if (heapWatchTask != 0 && (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle() == heapWatchTask) {
+        heapWatchAllocs = heapWatchAllocs + 1;
+        heapWatchBytes = heapWatchBytes + size;
+    }
+    if (heapSampleTick.fetch_add(1, std::memory_order_relaxed) % HEAP_PROFILER_SAMPLE_EVERY != 0) {
+        return;
+    }
+
+    uint32_t stack[HEAP_PROFILER_DEPTH];
+    uint32_t depth = heapBacktrace(stack);
+    uint32_t task = (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+
+    portENTER_CRITICAL(&heapLock);
+    int index = heapFindSite(task, stack, depth);
+    // Заполнение таблицы живых не выше 3/4 - короткие цепочки проб
+    if (index < 0 || heapLiveCount >= HEAP_PROFILER_LIVE * 3 / 4) {
+        heapDropped++;
+    } else {
+        HeapSite& site = heapSites[index];
+        site.allocs++;
+        site.bytes += size;
+        site.liveBytes += size;
+        uint32_t slot = heapLiveSlot(ptr);
+        while (heapLive[slot].ptr) {
+            slot = (slot + 1) % HEAP_PROFILER_LIVE;
+        }
+        heapLive[slot] = {ptr, (uint32_t)size, (uint16_t)index, heapGeneration};
+        heapLiveCount++;
+    }
+    portEXIT_CRITICAL(&heapLock);
+}
+
+static void heapRecordFree(void* ptr) {
+    heapFrees.inc();
+    portENTER_CRITICAL(&heapLock);
+    uint32_t slot = heapLiveSlot(ptr);
+    while (heapLive[slot].ptr && heapLive[slot].ptr != ptr) {
+        slot = (slot + 1) % HEAP_PROFILER_LIVE;
+    }
+    if (heapLive[slot].ptr) {
+        heapSites[heapLive[slot].site].liveBytes -= heapLive[slot].size;
+        heapLiveCount--;
+        // Удаление со сдвигом: записи за дырой, чья цепочка через неё проходит, сдвигаются назад
+        uint32_t hole = slot;
+        for (uint32_t next = (hole + 1) % HEAP_PROFILER_LIVE; heapLive[next].ptr; next = (next + 1) % HEAP_PROFILER_LIVE) {
+            uint32_t home = heapLiveSlot(heapLive[next].ptr);
+            bool reachable = hole <= next ? (home > hole && home <= next) : (home > hole || home <= next);
+            if (!reachable) {
+                heapLive[hole] = heapLive[next];
+                hole = next;
+            }
+        }
+        heapLive[hole].ptr = nullptr;
+    }
+    portEXIT_CRITICAL(&heapLock);
+}
+
+// Обёртки для -Wl,--wrap: ссылки на malloc/free/... во всех объектах прошивки,
+// включая String, new и библиотеки, приходят сюда
+extern "C" {
+void* __real_malloc(size_t size);
+void __real_free(void* ptr);
+void* __real_realloc(void* ptr, size_t size);
+void* __real_calloc(size_t count, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    void* ptr = __real_malloc(size);
+    if (ptr) {
+        heapRecordAlloc(ptr, size);
+    }
+    return ptr;
+}
+
+void __wrap_free(void* ptr) {
+    if (ptr) {
+        heapRecordFree(ptr);
+    }
+    __real_free(ptr);
+}
+
+// realloc учитывается как освобождение и новое выделение: для String это и есть
+// перенос буфера. Освобождение отмечается до вызова, пока адрес не занят другой задачей
+void* __wrap_realloc(void* ptr, size_t size) {
+    if (ptr) {
+        heapRecordFree(ptr);
+    }
+    void* result = __real_realloc(ptr, size);
+    if (result && size > 0) {
+        heapRecordAlloc(result, size);
+    }
+    return result;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    void* ptr = __real_calloc(count, size);
+    if (ptr) {
+        heapRecordAlloc(ptr, count * size);
+    }
+    return ptr;
+}
+}
+
+#endif
+
+static void heapAllocFailedHook(size_t size, uint32_t caps, const char* function) {
+    heapAllocFailed.inc();
+    heapLastFailedSize = size;
+}
+
+void heapProfileBegin() {
+    heap_caps_register_failed_alloc_callback(heapAllocFailedHook);
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    heapSnapshotMs = millis();
+    heapSnapshotFree = info.total_free_bytes;
+    heapSnapshotBlocks = info.allocated_blocks;
+    memset(&heapLeaks, 0, sizeof(heapLeaks));
+}
+
+void heapProfileTick() {
+#if HEAP_PROFILER_WRAP
+    static uint32_t lastAllocs = 0;
+    static uint32_t lastBytes = 0;
+    static uint32_t lastMs = 0;
+    uint32_t now = millis();
+    uint32_t allocs = heapAllocs.value();
+    uint32_t bytes = heapAllocBytes.value();
+    if (lastMs != 0 && now != lastMs) {
+        float seconds = (now - lastMs) / 1000.0f;
+        heapAllocRate.set((allocs - lastAllocs) / seconds);
+        heapAllocBytesRate.set((bytes - lastBytes) / seconds);
+    }
+    lastAllocs = allocs;
+    lastBytes = bytes;
+    lastMs = now;
+#endif
+}
+
+uint8_t heapCapsCount() {
+    return sizeof(HEAP_CAPS) / sizeof(HEAP_CAPS[0]);
+}
+
+HeapCapsInfo heapCapsInfo(uint8_t index) {
+    HeapCapsInfo result = {};
+    if (index >= heapCapsCount()) {
+        return result;
+    }
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, HEAP_CAPS[index].caps);
+    result.name = HEAP_CAPS[index].name;
+    result.total = heap_caps_get_total_size(HEAP_CAPS[index].caps);
+    result.free = info.total_free_bytes;
+    result.minFree = info.minimum_free_bytes;
+    result.largest = info.largest_free_block;
+    result.freeBlocks = info.free_blocks;
+    result.allocatedBlocks = info.allocated_blocks;
+    result.fragmentation = info.total_free_bytes > 0
+        ? 100.0f * (1.0f - (float)info.largest_free_block / info.total_free_bytes) : 0.0f;
+    return result;
+}
+
+HeapProfileStats heapProfileStats() {
+    HeapProfileStats stats = {};
+    stats.failed = heapAllocFailed.value();
+    stats.lastFailedSize = heapLastFailedSize;
+#if HEAP_PROFILER_WRAP
+    stats.wrapped = true;
+    stats.allocs = heapAllocs.value();
+    stats.frees = heapFrees.value();
+    stats.allocBytes = heapAllocBytes.value();
+    stats.allocRate = heapAllocRate.value();
+    stats.allocBytesRate = heapAllocBytesRate.value();
+#endif
+    portENTER_CRITICAL(&heapLock);
+    stats.sites = heapSiteCount;
+    stats.live = heapLiveCount;
+    stats.dropped = heapDropped;
+    portEXIT_CRITICAL(&heapLock);
+    return stats;
+}
+
+bool heapProfileSite(uint16_t index, HeapSiteInfo& info) {
+    portENTER_CRITICAL(&heapLock);
+    bool found = index < heapSiteCount;
+    if (found) {
+        const HeapSite& site = heapSites[index];
+        info.task = site.task;
+        info.depth = site.depth;
+        memcpy(info.stack, site.stack, sizeof(info.stack));
+        info.allocs = site.allocs * HEAP_PROFILER_SAMPLE_EVERY;
+        info.bytes = site.bytes * HEAP_PROFILER_SAMPLE_EVERY;
+        info.liveBytes = site.liveBytes * HEAP_PROFILER_SAMPLE_EVERY;
+    }
+    portEXIT_CRITICAL(&heapLock);
+    return found;
+}
+
+uint8_t heapProfileTasks(HeapTaskInfo* out, uint8_t maxTasks) {
+    uint8_t count = 0;
+    HeapSiteInfo site;
+    for (uint16_t i = 0; heapProfileSite(i, site); i++) {
+        uint8_t t = 0;
+        while (t < count && out[t].task != site.task) {
+            t++;
+        }
+        if (t == count) {
+            if (count == maxTasks) {
+                continue;
+            }
+            out[count++] = {site.task, 0, 0, 0};
+        }
+        out[t].allocs += site.allocs;
+        out[t].bytes += site.bytes;
+        out[t].liveBytes += site.liveBytes;
+    }
+    std::sort(out, out + count, [](const HeapTaskInfo& a, const HeapTaskInfo& b) { return a.bytes > b.bytes; });
+    return count;
+}
+
+void heapProfileWatch(TaskHandle_t task) {
+    heapWatchTask = (uint32_t)(uintptr_t)task;
+}
+
+HeapTaskInfo heapProfileWatched() {
+    return {heapWatchTask, heapWatchAllocs, heapWatchBytes, 0};
+}
+
+void heapProfileSnapshot() {
+    // Утечки - выделено между двумя предыдущими снимками и живо сейчас:
+    // у выделения был целый интервал, чтобы освободиться
+    static uint32_t counts[HEAP_PROFILER_SITES];
+    static uint32_t bytes[HEAP_PROFILER_SITES];
+    memset(counts, 0, sizeof(counts));
+    memset(bytes, 0, sizeof(bytes));
+    portENTER_CRITICAL(&heapLock);
+    uint16_t previous = heapGeneration - 1;
+    for (uint32_t i = 0; i < HEAP_PROFILER_LIVE; i++) {
+        if (heapLive[i].ptr && heapLive[i].generation == previous) {
+            counts[heapLive[i].site]++;
+            bytes[heapLive[i].site] += heapLive[i].size;
+        }
+    }
+    heapGeneration++;
+    portEXIT_CRITICAL(&heapLock);
+
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    uint32_t now = millis();
+    HeapLeakReport report = {};
+    report.snapshots = heapLeaks.snapshots + 1;
+    report.intervalMs = now - heapSnapshotMs;
+    report.freeDelta = (int32_t)info.total_free_bytes - (int32_t)heapSnapshotFree;
+    report.blocksDelta = (int32_t)info.allocated_blocks - (int32_t)heapSnapshotBlocks;
+    heapSnapshotMs = now;
+    heapSnapshotFree = info.total_free_bytes;
+    heapSnapshotBlocks = info.allocated_blocks;
+
+    // Первые HEAP_PROFILER_LEAK_TOP мест по байтам
+    for (uint16_t site = 0; site < HEAP_PROFILER_SITES; site++) {
+        if (bytes[site] == 0) {
+            continue;
+        }
+        uint8_t pos = report.count;
+        while (pos > 0 && report.sites[pos - 1].bytes < bytes[site] * HEAP_PROFILER_SAMPLE_EVERY) {
+            if (pos < HEAP_PROFILER_LEAK_TOP) {
+                report.sites[pos] = report.sites[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < HEAP_PROFILER_LEAK_TOP) {
+            report.sites[pos] = {site, counts[site] * HEAP_PROFILER_SAMPLE_EVERY, bytes[site] * HEAP_PROFILER_SAMPLE_EVERY};
+            if (report.count < HEAP_PROFILER_LEAK_TOP) {
+                report.count++;
+            }
+        }
+    }
+    portENTER_CRITICAL(&heapLock);
+    heapLeaks = report;
+    portEXIT_CRITICAL(&heapLock);
+}
+
+HeapLeakReport heapLeakReport() {
+    portENTER_CRITICAL(&heapLock);
+    HeapLeakReport report = heapLeaks;
+    portEXIT_CRITICAL(&heapLock);
+    return report;
+}
+
+static void writeStack(JsonWriter& json, const uint32_t* stack, uint32_t depth) {
+    char address[12];
+    json.key("stack");
+    json.beginArray();
+    for (uint32_t d = 0; d < depth; d++) {
+        snprintf(address, sizeof(address), "0x%08lx", (unsigned long)stack[d]);
+        json.value((const char*)address);
+    }
+    json.endArray();
+}
+
+void heapProfileWriteJson(JsonWriter& json) {
+    HeapProfileStats stats = heapProfileStats();
+    char name[20];
+    json.beginObject();
+    json.field("wrapped", stats.wrapped);
+    json.field("sample_every", (uint32_t)HEAP_PROFILER_SAMPLE_EVERY);
+    json.field("allocs", stats.allocs);
+    json.field("frees", stats.frees);
+    json.field("alloc_bytes", stats.allocBytes);
+    json.field("alloc_rate", stats.allocRate, 1);
+    json.field("alloc_bytes_rate", stats.allocBytesRate, 1);
+    json.field("failed", stats.failed);
+    json.field("last_failed_size", stats.lastFailedSize);
+    json.field("dropped", stats.dropped);
+
+    json.key("caps");
+    json.beginArray();
+    for (uint8_t i = 0; i < heapCapsCount(); i++) {
+        HeapCapsInfo caps = heapCapsInfo(i);
+        json.beginObject();
+        json.field("name", caps.name);
+        json.field("total", caps.total);
+        json.field("free", caps.free);
+        json.field("min_free", caps.minFree);
+        json.field("largest_free_block", caps.largest);
+        json.field("free_blocks", caps.freeBlocks);
+        json.field("allocated_blocks", caps.allocatedBlocks);
+        json.field("fragmentation", caps.fragmentation, 1);
+        json.endObject();
+    }
+    json.endArray();
+
+    json.key("sites");
+    json.beginArray();
+    HeapSiteInfo site;
+    for (uint16_t i = 0; heapProfileSite(i, site); i++) {
+        profileTaskName(site.task, name, sizeof(name));
+        json.beginObject();
+        json.field("task", (const char*)name);
+        writeStack(json, site.stack, site.depth);
+        json.field("allocs", site.allocs);
+        json.field("bytes", site.bytes);
+        json.field("live_bytes", site.liveBytes);
+        json.endObject();
+    }
+    json.endArray();
+
+    HeapLeakReport leaks = heapLeakReport();
+    json.key("leaks");
+    json.beginObject();
+    json.field("snapshots", leaks.snapshots);
+    json.field("interval_ms", leaks.intervalMs);
+    json.field("free_delta", leaks.freeDelta);
+    json.field("blocks_delta", leaks.blocksDelta);
+    json.key("sites");
+    json.beginArray();
+    for (uint8_t i = 0; i < leaks.count; i++) {
+        json.beginObject();
+        json.field("site", (uint32_t)leaks.sites[i].site);
+        json.field("count", leaks.sites[i].count);
+        json.field("bytes", leaks.sites[i].bytes);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+
+    json.endObject();
+}
+
+size_t heapProfileWriteFolded(Print& out) {
+    size_t written = 0;
+    HeapSiteInfo site;
+    for (uint16_t i = 0; heapProfileSite(i, site); i++) {
+        written += writeFoldedStack(out, site.task, site.stack, site.depth, site.bytes);
+    }
+    return written;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "json-writer.h"
+
+// Состояние кучи одной возможности (MALLOC_CAP_*)
+struct HeapCapsInfo {
+    const char* name;
+    uint32_t total;
+    uint32_t free;
+    uint32_t minFree;
+    uint32_t largest;          // Наибольший свободный блок
+    uint32_t freeBlocks;
+    uint32_t allocatedBlocks;
+    float fragmentation;       // 100 * (1 - largest / free), %
+};
+
+// Подозрение на утечку: выделено между двумя предыдущими снимками и живо к последнему
+struct HeapLeakSite {
+    uint16_t site;             // Индекс места вызова (heapProfileSite)
+    uint32_t count;            // Выделений в выборке, умножено на HEAP_PROFILER_SAMPLE_EVERY
+    uint32_t bytes;
+};
+
+struct HeapLeakReport {
+    uint32_t snapshots;        // Снимков сделано
+    uint32_t intervalMs;       // Последний интервал между снимками
+    int32_t freeDelta;         // Изменение свободной памяти за последний интервал, байт
+    int32_t blocksDelta;       // Изменение числа занятых блоков за последний интервал
+    uint8_t count;
+    HeapLeakSite sites[HEAP_PROFILER_LEAK_TOP];
+};
+
+// Место вызова в выборке выделений
+struct HeapSiteInfo {
+    uint32_t task;
+    uint32_t depth;
+    uint32_t stack[HEAP_PROFILER_DEPTH];   // От места вызова malloc к внешним вызовам
+    uint32_t allocs;           // Оценка (выборка * HEAP_PROFILER_SAMPLE_EVERY)
+    uint32_t bytes;
+    uint32_t liveBytes;        // Ещё не освобождено
+};
+
+// Сумма мест вызова одной задачи
+struct HeapTaskInfo {
+    uint32_t task;
+    uint32_t allocs;
+    uint32_t bytes;
+    uint32_t liveBytes;
+};
+
+struct HeapProfileStats {
+    bool wrapped;              // Выделения перехватываются (HEAP_PROFILER_WRAP)
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t allocBytes;
+    float allocRate;           // Выделений в секунду
+    float allocBytesRate;      // Байт в секунду
+    uint32_t failed;           // Неудачных выделений
+    uint32_t lastFailedSize;
+    uint32_t sites;            // Мест вызова в таблице
+    uint32_t live;             // Живых выделений из выборки
+    uint32_t dropped;          // Отсчётов выборки, не поместившихся в таблицы
+};
+
+// Профиль кучи и фрагментация.
+//
+// Всегда доступны: свободная память, наибольший свободный блок и
+// фрагментация по каждой возможности кучи (heap_caps_get_info) и счётчик
+// неудачных выделений.
+//
+// С HEAP_PROFILER_WRAP 1 (и флагами компоновщика -Wl,--wrap=malloc,--wrap=free,
+// --wrap=realloc,--wrap=calloc) malloc/free/realloc/calloc всей прошивки идут
+// через обёртки: счётчики выделений в реестре метрик и выборка - каждое
+// HEAP_PROFILER_SAMPLE_EVERY-е выделение со стеком вызова. Выборка копится по
+// местам вызова (задача + стек) и в таблице живых выделений. Снимок находит
+// утечки: выделенное между двумя предыдущими снимками и не освобождённое к
+// последнему - у каждого выделения был целый интервал, чтобы освободиться.
+// Таблицы фиксированного размера, обёртки сами память не выделяют.
+void heapProfileBegin();
+// Скорость выделений; вызывается раз в секунду
+void heapProfileTick();
+
+uint8_t heapCapsCount();
+HeapCapsInfo heapCapsInfo(uint8_t index);
+
+HeapProfileStats heapProfileStats();
+bool heapProfileSite(uint16_t index, HeapSiteInfo& info);
+// Задачи по убыванию выделенных байт; возвращает число записей
+uint8_t heapProfileTasks(HeapTaskInfo* out, uint8_t maxTasks);
+// Точный счёт выделений одной задачи, без выборки: разность двух чтений -
+// выделения участка кода. Без HEAP_PROFILER_WRAP счётчики нулевые
+void heapProfileWatch(TaskHandle_t task);
+HeapTaskInfo heapProfileWatched();
+
+// Снимок для поиска утечек; отчёт осмыслен с третьего снимка (первый интервал - старт)
+void heapProfileSnapshot();
+HeapLeakReport heapLeakReport();
+
+// Всё вместе в JSON и места вызова в свёрнутых стеках (вес - выделенные байты)
+void heapProfileWriteJson(JsonWriter& json);
+size_t heapProfileWriteFolded(Print& out);
@@ -0,0 +1,160 @@
+#include "json-writer.h"
+
+JsonWriter::JsonWriter(Print& out) : _out(out) {
+    _used = 0;
+    _written = 0;
+    _hasItems = 0;
+    _depth = 0;
+    _afterKey = false;
+}
+
+void JsonWriter::put(char c) {
+    if (_used == sizeof(_buffer)) {
+        flush();
+    }
+    _buffer[_used++] = c;
+}
+
+void JsonWriter::put(const char* text) {
+    while (*text) {
+        put(*text++);
+    }
+}
+
+void JsonWriter::putEscaped(const char* text) {
+    put('"');
+    for (; *text; text++) {
+        char c = *text;
+        switch (c) {
+            case '"':  put("\\\""); break;
+            case '\\': put("\\\\"); break;
+            case '\n': put("\\n"); break;
+            case '\r': put("\\r"); break;
+            case '\t': put("\\t"); break;
+            default:
+                if ((uint8_t)c < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    put(escaped);
+                } else {
+                    put(c);
+                }
+        }
+    }
+    put('"');
+}
+
+// Запятая перед элементом, если на уровне уже что-то есть (значение после ключа - без неё)
+void JsonWriter::separator() {
+    if (_afterKey) {
+        _afterKey = false;
+        return;
+    }
+    uint32_t bit = 1UL << (_depth & 31);
+    if (_hasItems & bit) {
+        put(',');
+    }
+    _hasItems |= bit;
+}
+
+void JsonWriter::beginObject() {
+    separator();
+    put('{');
+    _depth++;
+    _hasItems &= ~(1UL << (_depth & 31));
+}
+
+void JsonWriter::endObject() {
+    _depth--;
+    put('}');
+}
+
+void JsonWriter::beginArray() {
+    separator();
+    put('[');
+    _depth++;
+    _hasItems &= ~(1UL << (_depth & 31));
+}
+
+void JsonWriter::endArray() {
+    _depth--;
+    put(']');
+}
+
+void JsonWriter::key(const char* name) {
+    separator();
+    putEscaped(name);
+    put(':');
+    _afterKey = true;
+}
+
+void JsonWriter::value(const char* text) {
+    separator();
+    putEscaped(text);
+}
+
+void JsonWriter::value(int32_t number) {
+    char text[12];
+    snprintf(text, sizeof(text), "%ld", (long)number);
+    separator();
+    put(text);
+}
+
+void JsonWriter::value(uint32_t number) {
+    char text[12];
+    snprintf(text, sizeof(text), "%lu", (unsigned long)number);
+    separator();
+    put(text);
+}
+
+void JsonWriter::value(int64_t number) {
+    char text[24];
+    snprintf(text, sizeof(text), "%lld", (long long)number);
+    separator();
+    put(text);
+}
+
+void JsonWriter::value(float number, uint8_t decimals) {
+    separator();
+    // NaN и бесконечность в JSON не представимы
+    if (isnan(number) || isinf(number)) {
+        put("null");
+        return;
+    }
+    char text[24];
+    snprintf(text, sizeof(text), "%.*f", decimals, number);
+    put(text);
+}
+
+void JsonWriter::value(double number, uint8_t decimals) {
+    separator();
+    if (isnan(number) || isinf(number)) {
+        put("null");
+        return;
+    }
+    char text[32];
+    snprintf(text, sizeof(text), "%.*f", decimals, number);
+    put(text);
+}
+
+void JsonWriter::value(bool flag) {
+    separator();
+    put(flag ? "true" : "false");
+}
+
+void JsonWriter::null() {
+    separator();
+    put("null");
+}
+
+size_t JsonWriter::flush() {
+    if (_used > 0) {
+        _written += _out.write((const uint8_t*)_buffer, _used);
+        _used = 0;
+    }
+    return _written;
+}
+
+size_t JsonWriter::written() const {
+    return _written + _used;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <Arduino.h>
+
+// Размер буфера писателя: вывод уходит в Print порциями такого размера
+#define JSON_WRITER_CHUNK 256
+
+// Потоковая запись JSON без выделения памяти.
+//
+// Текст копится во внутреннем буфере фиксированного размера и уходит в out
+// порциями по JSON_WRITER_CHUNK байт (в сокет, Serial, файл), документ целиком
+// в памяти не собирается. Запятые расставляются сами по стеку вложенности
+// (до 32 уровней, по биту на уровень). Строки экранируются.
+//
+//   JsonWriter json(client);
+//   json.beginObject();
+//   json.key("rssi"); json.value(-97);
+//   json.endObject();
+//   json.flush();
+class JsonWriter {
+public:
+    explicit JsonWriter(Print& out);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    void key(const char* name);
+
+    void value(const char* text);
+    void value(int32_t number);
+    void value(uint32_t number);
+    void value(int64_t number);
+    void value(float number, uint8_t decimals = 2);
+    void value(double number, uint8_t decimals);   // Метки времени в мкс: точности float не хватает
+    void value(bool flag);
+    void null();
+
+    // Пара ключ-значение внутри объекта
+    template <typename T>
+    void field(const char* name, T v) {
+        key(name);
+        value(v);
+    }
+    void field(const char* name, float v, uint8_t decimals) {
+        key(name);
+        value(v, decimals);
+    }
+    void field(const char* name, double v, uint8_t decimals) {
+        key(name);
+        value(v, decimals);
+    }
+
+    // Отправка остатка буфера; возвращает всего записанных байт
+    size_t flush();
+    size_t written() const;
+
+private:
+    void separator();
+    void put(char c);
+    void put(const char* text);
+    void putEscaped(const char* text);
+
+    Print& _out;
+    char _buffer[JSON_WRITER_CHUNK];
+    size_t _used;
+    size_t _written;
+    uint32_t _hasItems;   // Бит уровня: на уровне уже есть элемент
+    uint8_t _depth;
+    bool _afterKey;
+};
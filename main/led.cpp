@@ -1,29 +1,120 @@
 #include "led.h"
+#include "esp_timer.h"
 
-void setupLed() {
+struct LedEffect {
+    uint8_t times;
+    uint16_t onMs;
+    uint16_t offMs;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+};
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_timer = nullptr;
+static LedEffect s_current;
+static LedEffect s_pending;
+static bool s_hasPending = false;
+static bool s_running = false;
+static bool s_lit = false;
+static uint8_t s_remaining = 0;
+static uint32_t s_coalesced = 0;
+
+static void writeLed(bool lit, const LedEffect& effect) {
     #if defined(CONFIG_IDF_TARGET_ESP32S3)
-        strip.begin();
-        strip.setBrightness(50);
+        strip.setPixelColor(0, lit ? strip.Color(effect.red, effect.green, effect.blue) : 0);
         strip.show();
     #else
-        pinMode(LED_BUILTIN, OUTPUT);
+        digitalWrite(LED_BUILTIN, lit ? HIGH : LOW);
     #endif
 }
 
-void blinkLED(int times, int delayTime, uint8_t red, uint8_t green, uint8_t blue) {
+// Шаг автомата: каждый вызов - один фронт, следующий шаг планируется на длительность фазы
+static void ledStep(void* arg) {
+    bool finished = false;
+    uint16_t phaseMs = 0;
+    LedEffect effect;
+
+    portENTER_CRITICAL(&s_mux);
+    if (s_lit) {
+        s_lit = false;
+        phaseMs = s_current.offMs;
+    } else {
+        // Эффект доигран (бесконечный - уступает любому новому): следующий из слота
+        bool forever = s_current.times == LED_REPEAT_FOREVER;
+        if ((forever && s_hasPending) || (!forever && s_remaining == 0)) {
+            if (s_hasPending) {
+                s_current = s_pending;
+                s_remaining = s_pending.times;
+                s_hasPending = false;
+            } else {
+                s_running = false;
+                finished = true;
+            }
+        }
+        if (!finished) {
+            s_lit = true;
+            if (s_current.times != LED_REPEAT_FOREVER) s_remaining--;
+            phaseMs = s_current.onMs;
+        }
+    }
+    effect = s_current;
+    bool lit = s_lit;
+    portEXIT_CRITICAL(&s_mux);
+
+    writeLed(lit, effect);
+    if (!finished) {
+        esp_timer_start_once(s_timer, (uint64_t)phaseMs * 1000);
+    }
+}
+
+void setupLed() {
     #if defined(CONFIG_IDF_TARGET_ESP32S3)
+        strip.begin();
         strip.setBrightness(50);
-        strip.setPixelColor(0, strip.Color(red, green, blue));
-        strip.show();
-        vTaskDelay(pdMS_TO_TICKS(delayTime));
-        strip.clear();
         strip.show();
     #else
-        for (int i = 0; i < times; i++) {
-            digitalWrite(LED_BUILTIN, HIGH);
-            vTaskDelay(pdMS_TO_TICKS(delayTime));
-            digitalWrite(LED_BUILTIN, LOW);
-            vTaskDelay(pdMS_TO_TICKS(delayTime));
-        }
+        pinMode(LED_BUILTIN, OUTPUT);
     #endif
-}
\ No newline at end of file
+
+    esp_timer_create_args_t args = {};
+    args.callback = ledStep;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "led";
+    esp_timer_create(&args, &s_timer);
+}
+
+void postLedEffect(uint8_t times, uint16_t onMs, uint16_t offMs, uint8_t red, uint8_t green, uint8_t blue) {
+    if (s_timer == nullptr) {
+        return;
+    }
+    LedEffect effect = {times, onMs, offMs, red, green, blue};
+    bool start = false;
+
+    portENTER_CRITICAL(&s_mux);
+    if (s_running) {
+        if (s_hasPending) s_coalesced++;
+        s_pending = effect;
+        s_hasPending = true;
+    } else {
+        s_current = effect;
+        s_remaining = times;
+        s_lit = false;
+        s_running = true;
+        start = true;
+    }
+    portEXIT_CRITICAL(&s_mux);
+
+    // Таймер запускается только из простоя, пока автомат не владеет им
+    if (start) {
+        esp_timer_start_once(s_timer, 0);
+    }
+}
+
+void blinkLED(int times, int delayTime, uint8_t red, uint8_t green, uint8_t blue) {
+    postLedEffect(constrain(times, 1, 255), delayTime, delayTime, red, green, blue);
+}
+
+uint32_t ledCoalescedCount() {
+    return s_coalesced;
+}
@@ -3,10 +3,28 @@
 
 #include "config.h"
 
+// Светодиод статуса: эффекты без блокировки вызывающей задачи.
+//
+// Эффект проигрывает esp_timer (задача esp_timer, один шаг на фронт), вызывающий
+// только кладёт эффект в слот - O(1), без ожидания. Пока идёт эффект, новые
+// эффекты сливаются: в слоте остаётся последний, промежуточные отбрасываются,
+// поэтому под нагрузкой очередь вспышек не растёт.
+// На ESP32-S3 - NeoPixel (вывод через RMT в Adafruit_NeoPixel), на ESP32 - GPIO.
+
+// Повторять до следующего эффекта
+#define LED_REPEAT_FOREVER 0
+
 // Инициализация светодиода/NeoPixel
 void setupLed();
 
-// Функция мигания светодиодом с указанным цветом
+// Эффект: times вспышек (onMs горит, offMs погашен) цветом red/green/blue
+void postLedEffect(uint8_t times, uint16_t onMs, uint16_t offMs,
+                   uint8_t red = 255, uint8_t green = 255, uint8_t blue = 255);
+
+// Мигание с равными фазами; не блокирует, см. postLedEffect
 void blinkLED(int times, int delayTime, uint8_t red = 255, uint8_t green = 255, uint8_t blue = 255);
 
-#endif // LED_H
\ No newline at end of file
+// Эффектов, вытесненных более новыми до начала проигрывания
+uint32_t ledCoalescedCount();
+
+#endif // LED_H
@@ -0,0 +1,155 @@
+#include "log-history.h"
+#include "esp_heap_caps.h"
+
+static_assert((LOG_HISTORY_SIZE & (LOG_HISTORY_SIZE - 1)) == 0, "LOG_HISTORY_SIZE must be a power of two");
+static_assert((LOG_HISTORY_PSRAM_SIZE & (LOG_HISTORY_PSRAM_SIZE - 1)) == 0,
+              "LOG_HISTORY_PSRAM_SIZE must be a power of two");
+
+LogHistory logHistory;
+
+LogHistory::LogHistory() {
+    _buffer = nullptr;
+    _size = 0;
+    _head = 0;
+    _start = 0;
+    _psram = false;
+    _lock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+void LogHistory::begin() {
+    if (_buffer) {
+        return;
+    }
+    uint8_t* buffer = (uint8_t*)heap_caps_malloc(LOG_HISTORY_PSRAM_SIZE, MALLOC_CAP_SPIRAM);
+    uint32_t size = LOG_HISTORY_PSRAM_SIZE;
+    bool psram = buffer != nullptr;
+    if (!buffer) {
+        buffer = (uint8_t*)malloc(LOG_HISTORY_SIZE);
+        size = LOG_HISTORY_SIZE;
+    }
+    if (!buffer) {
+        return;
+    }
+    portENTER_CRITICAL(&_lock);
+    _buffer = buffer;
+    _size = size;
+    _psram = psram;
+    _start = _head;
+    portEXIT_CRITICAL(&_lock);
+}
+
+void LogHistory::append(const uint8_t* data, size_t size) {
+    portENTER_CRITICAL(&_lock);
+    if (_buffer) {
+        // Больше кольца - остаётся только хвост
+        if (size > _size) {
+            _head += size - _size;
+            data += size - _size;
+            size = _size;
+        }
+        uint32_t index = _head & (_size - 1);
+        uint32_t first = min((uint32_t)size, _size - index);
+        memcpy(_buffer + index, data, first);
+        memcpy(_buffer, data + first, size - first);
+    }
+    _head += size;
+    portEXIT_CRITICAL(&_lock);
+}
+
+uint32_t LogHistory::head() const {
+    portENTER_CRITICAL(&_lock);
+    uint32_t head = _head;
+    portEXIT_CRITICAL(&_lock);
+    return head;
+}
+
+uint32_t LogHistory::tail() const {
+    portENTER_CRITICAL(&_lock);
+    uint32_t tail = oldest();
+    portEXIT_CRITICAL(&_lock);
+    return tail;
+}
+
+// Байты копируются из кольца под _lock кусками по LOG_HISTORY_READ_CHUNK,
+// строка разбирается уже вне критического участка. Если между кусками
+// кольцо обогнало курсор, начатая строка отбрасывается и учитывается в lost
+bool LogHistory::readLine(uint32_t& cursor, char* line, size_t size, uint32_t& lost) {
+    lost = 0;
+    line[0] = '\0';
+    uint8_t chunk[LOG_HISTORY_READ_CHUNK];
+    uint32_t lineStart = cursor;
+    uint32_t pos = cursor;
+    size_t length = 0;
+    bool align = false;
+    for (;;) {
+        portENTER_CRITICAL(&_lock);
+        if (!_buffer) {
+            portEXIT_CRITICAL(&_lock);
+            return false;
+        }
+        uint32_t tail = oldest();
+        if (pos > _head) {
+            // Курсор из прошлой загрузки устройства - с начала истории
+            pos = tail;
+            lineStart = tail;
+            length = 0;
+            align = true;
+        } else if (pos < tail) {
+            lost += tail - lineStart;
+            pos = tail;
+            lineStart = tail;
+            length = 0;
+            align = true;
+        }
+        // Начало кольца посреди строки (текст затёрт) - с первой целой строки
+        if (tail == _start) {
+            align = false;
+        }
+        uint32_t count = min(_head - pos, (uint32_t)sizeof(chunk));
+        uint32_t index = pos & (_size - 1);
+        uint32_t first = min(count, _size - index);
+        memcpy(chunk, _buffer + index, first);
+        memcpy(chunk + first, _buffer, count - first);
+        portEXIT_CRITICAL(&_lock);
+
+        uint32_t i = 0;
+        if (align) {
+            while (i < count && chunk[i] != '\n') {
+                i++;
+            }
+            if (i < count) {
+                i++;
+                align = false;
+            }
+            lost += i;
+            lineStart = pos + i;
+        }
+        bool found = false;
+        while (i < count && !found) {
+            char c = chunk[i++];
+            if (c == '\n') {
+                found = true;
+                break;
+            }
+            if (c != '\r') {
+                line[length++] = c;
+            }
+            if (length + 1 >= size) {
+                found = true;
+            }
+        }
+        pos += i;
+        if (found) {
+            line[length] = '\0';
+            cursor = pos;
+            return true;
+        }
+        if (count < sizeof(chunk)) {
+            break;
+        }
+    }
+    // Целой строки нет: курсор - на её начале
+    line[0] = '\0';
+    cursor = lineStart;
+    return false;
+}
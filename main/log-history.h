@@ -0,0 +1,46 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// История веб-журнала с монотонными смещениями.
+//
+// Весь текст журнала (logger) копится в кольце: в PSRAM, если она есть
+// (LOG_HISTORY_PSRAM_SIZE), иначе во внутренней памяти (LOG_HISTORY_SIZE).
+// Позиция в тексте - монотонное смещение от старта: клиент хранит свой
+// курсор и забирает только строки после него, поэтому клиентов сколько
+// угодно и сервер о них ничего не помнит. Курсор, отставший больше чем на
+// кольцо, переносится на начало первой целой строки - потерянные байты
+// возвращаются вызывающему.
+class LogHistory {
+public:
+    LogHistory();
+
+    // Выделение кольца; до вызова текст только считается в смещении
+    void begin();
+    void append(const uint8_t* data, size_t size);
+
+    // Смещение конца текста (всего байт записано)
+    uint32_t head() const;
+    // Смещение самого старого байта в кольце
+    uint32_t tail() const;
+    uint32_t capacity() const { return _size; }
+    bool inPsram() const { return _psram; }
+
+    // Следующая целая строка от cursor без перевода строки; длинная строка
+    // режется по size. false - новых целых строк нет. lost - байт пропущено
+    // из-за отставания курсора
+    bool readLine(uint32_t& cursor, char* line, size_t size, uint32_t& lost);
+
+private:
+    // Самый старый байт; под _lock
+    uint32_t oldest() const { return _head - _start > _size ? _head - _size : _start; }
+
+    uint8_t* _buffer;
+    uint32_t _size;       // Степень двойки
+    uint32_t _head;
+    uint32_t _start;      // Смещение на момент begin(): раньше текст не хранился
+    bool _psram;
+    mutable portMUX_TYPE _lock;
+};
+
+extern LogHistory logHistory;
@@ -0,0 +1,309 @@
+#include "log-ring.h"
+#include "logging.h"
+#include "metrics.h"
+
+// Размер кольца - степень двойки: позиции растут без ограничения, индекс - по маске
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+static Counter logRecords("log_records", "Deferred log records accepted");
+static Counter logDropped("log_dropped", "Deferred log records dropped, ring full");
+static Counter logSuppressed("log_suppressed", "Log calls skipped below the runtime log level");
+static Counter logBytes("log_bytes", "Deferred log record bytes accepted");
+static Counter logLineBytes("log_line_bytes", "Formatted log text bytes written");
+
+std::atomic<uint8_t> logMinRank(LOG_RANK_INFO);
+static std::atomic<uint32_t> logWrittenByRank[LOG_RANKS];
+static std::atomic<uint32_t> logSuppressedByRank[LOG_RANKS];
+
+static uint8_t logRing[LOG_RING_SIZE];
+static uint32_t logHead = 0;    // Под logRingLock
+static uint32_t logTail = 0;    // Пишет только задача журнала
+static uint32_t logPeak = 0;
+static uint32_t logCostCycles = 0;
+static uint32_t logFormatCycles = 0;
+static portMUX_TYPE logRingLock = portMUX_INITIALIZER_UNLOCKED;
+
+void logSetLevel(uint8_t level) {
+    logMinRank.store(logRank(level & LOG_LEVEL_MASK), std::memory_order_relaxed);
+}
+
+void logSuppress(uint8_t rank) {
+    logSuppressedByRank[rank].fetch_add(1, std::memory_order_relaxed);
+    logSuppressed.inc();
+}
+
+static uint32_t logFinishRecord(uint8_t* record, const LogEncoder& e, uint8_t flags, const char* format) {
+    LogRecordHeader header = {format, (uint32_t)millis(), (uint16_t)(e.pos - record), flags, e.argc};
+    memcpy(record, &header, sizeof(header));
+    return header.size;
+}
+
+// Копия записи в кольцо без учёта в счётчиках
+static bool logRingCopy(const uint8_t* record, uint32_t size) {
+    portENTER_CRITICAL(&logRingLock);
+    uint32_t used = logHead - logTail;
+    if (LOG_RING_SIZE - used < size) {
+        portEXIT_CRITICAL(&logRingLock);
+        return false;
+    }
+    uint32_t index = logHead & (LOG_RING_SIZE - 1);
+    uint32_t first = min(size, (uint32_t)LOG_RING_SIZE - index);
+    memcpy(logRing + index, record, first);
+    memcpy(logRing, record + first, size - first);
+    logHead += size;
+    if (used + size > logPeak) {
+        logPeak = used + size;
+    }
+    portEXIT_CRITICAL(&logRingLock);
+    return true;
+}
+
+bool logRingCommit(uint8_t* record, const LogEncoder& e, uint8_t flags, const char* format) {
+    uint32_t size = logFinishRecord(record, e, flags, format);
+    if (!logRingCopy(record, size)) {
+        logDropped.inc();
+        return false;
+    }
+    logRecords.inc();
+    logBytes.inc(size);
+    logWrittenByRank[logRank(flags & LOG_LEVEL_MASK)].fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void logRingBegin() {
+    // Кодирование и копия в кольцо, как в logDefer, но мимо счётчиков /metrics;
+    // кольцо после замера очищается
+    const uint32_t rounds = 16;
+    uint8_t record[LOG_RING_MAX_RECORD];
+    uint32_t start = ESP.getCycleCount();
+    for (uint32_t i = 0; i < rounds; i++) {
+        LogEncoder e = {record + sizeof(LogRecordHeader), record + sizeof(record), 0};
+        logEncodeAll(e, i, "abc", 1.5f);
+        logRingCopy(record, logFinishRecord(record, e, LOG_DEBUG, "self test %d %s %.1f"));
+    }
+    logCostCycles = (ESP.getCycleCount() - start) / rounds;
+    portENTER_CRITICAL(&logRingLock);
+    logTail = logHead;
+    logPeak = 0;
+    portEXIT_CRITICAL(&logRingLock);
+
+    // Форматирование той же записи - то, что задача журнала тратит на каждую
+    char line[LOG_RING_LINE];
+    start = ESP.getCycleCount();
+    for (uint32_t i = 0; i < rounds; i++) {
+        logFormatRecord(record, line, sizeof(line));
+    }
+    logFormatCycles = (ESP.getCycleCount() - start) / rounds;
+    logger.println("Журнал: кольцо " + String(LOG_RING_SIZE) + " байт, запись ~" + String(logCostCycles) +
+                   " тактов, форматирование ~" + String(logFormatCycles) + " тактов");
+}
+
+LogRingStats logRingStats() {
+    LogRingStats stats;
+    portENTER_CRITICAL(&logRingLock);
+    stats.used = logHead - logTail;
+    stats.peak = logPeak;
+    portEXIT_CRITICAL(&logRingLock);
+    stats.records = logRecords.value();
+    stats.dropped = logDropped.value();
+    stats.capacity = LOG_RING_SIZE;
+    stats.costCycles = logCostCycles;
+    stats.formatCycles = logFormatCycles;
+    stats.bytes = logBytes.value();
+    stats.lineBytes = logLineBytes.value();
+    uint32_t suppressed = 0;
+    for (int i = 0; i < LOG_RANKS; i++) {
+        stats.written[i] = logWrittenByRank[i].load(std::memory_order_relaxed);
+        stats.suppressed[i] = logSuppressedByRank[i].load(std::memory_order_relaxed);
+        suppressed += stats.suppressed[i];
+    }
+    stats.savedCycles = (uint64_t)suppressed * (logCostCycles + logFormatCycles);
+    return stats;
+}
+
+// Аргумент записи, приведённый к виду для snprintf
+struct LogArg {
+    LogArgType type;
+    int32_t i32;
+    int64_t i64;
+    double d;
+    const char* s;
+};
+
+static bool logNextArg(const uint8_t*& pos, const uint8_t* end, uint8_t& argc, LogArg& arg) {
+    if (argc == 0 || pos >= end) {
+        return false;
+    }
+    argc--;
+    arg.type = (LogArgType)*pos++;
+    switch (arg.type) {
+        case LOG_ARG_INT32:
+            memcpy(&arg.i32, pos, sizeof(arg.i32));
+            pos += sizeof(arg.i32);
+            break;
+        case LOG_ARG_INT64:
+            memcpy(&arg.i64, pos, sizeof(arg.i64));
+            pos += sizeof(arg.i64);
+            break;
+        case LOG_ARG_DOUBLE:
+            memcpy(&arg.d, pos, sizeof(arg.d));
+            pos += sizeof(arg.d);
+            break;
+        default:
+            arg.s = (const char*)pos;
+            pos += strlen(arg.s) + 1;
+            break;
+    }
+    return true;
+}
+
+static size_t logAppend(char* out, size_t size, size_t length, int written) {
+    if (written <= 0) {
+        return length;
+    }
+    return min(length + written, size - 1);
+}
+
+size_t logFormatRecord(const uint8_t* record, char* out, size_t size) {
+    LogRecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    const uint8_t* pos = record + sizeof(header);
+    const uint8_t* end = record + header.size;
+    uint8_t argc = header.argc;
+
+    size_t length = 0;
+    const char* p = header.format;
+    while (*p && length + 1 < size) {
+        if (*p != '%') {
+            out[length++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[length++] = '%';
+            p += 2;
+            continue;
+        }
+        // Флаги, ширина и точность переносятся в спецификацию как есть
+        char spec[16] = "%";
+        size_t specLength = 1;
+        p++;
+        while (*p && strchr("-+ #0123456789.", *p) && specLength < sizeof(spec) - 4) {
+            spec[specLength++] = *p++;
+        }
+        // Длина аргумента известна из записи, модификаторы пропускаются
+        while (*p && strchr("hlLqjzt", *p)) {
+            p++;
+        }
+        char conversion = *p;
+        if (!conversion) {
+            break;
+        }
+        p++;
+
+        LogArg arg;
+        size_t room = size - length;
+        if (!logNextArg(pos, end, argc, arg)) {
+            length = logAppend(out, size, length, snprintf(out + length, room, "?"));
+            continue;
+        }
+        int64_t integer = arg.type == LOG_ARG_INT64 ? arg.i64 : arg.type == LOG_ARG_DOUBLE ? (int64_t)arg.d : arg.i32;
+        switch (conversion) {
+            case 'd':
+            case 'i':
+                strcpy(spec + specLength, "lld");
+                length = logAppend(out, size, length, snprintf(out + length, room, spec, (long long)integer));
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X': {
+                // 32-битный аргумент - без расширения знака
+                unsigned long long value = arg.type == LOG_ARG_INT32 ? (uint32_t)arg.i32 : (unsigned long long)integer;
+                spec[specLength++] = 'l';
+                spec[specLength++] = 'l';
+                spec[specLength++] = conversion;
+                spec[specLength] = '\0';
+                length = logAppend(out, size, length, snprintf(out + length, room, spec, value));
+                break;
+            }
+            case 'c':
+                strcpy(spec + specLength, "c");
+                length = logAppend(out, size, length, snprintf(out + length, room, spec, (int)integer));
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                double value = arg.type == LOG_ARG_DOUBLE ? arg.d : (double)integer;
+                spec[specLength++] = conversion;
+                spec[specLength] = '\0';
+                length = logAppend(out, size, length, snprintf(out + length, room, spec, value));
+                break;
+            }
+            case 's':
+                strcpy(spec + specLength, "s");
+                length = logAppend(out, size, length,
+                                   snprintf(out + length, room, spec, arg.type == LOG_ARG_STRING ? arg.s : "?"));
+                break;
+            case 'p':
+                length = logAppend(out, size, length, snprintf(out + length, room, "0x%08lx", (unsigned long)(uint32_t)integer));
+                break;
+            default:
+                // Неизвестное преобразование выводится как есть
+                length = logAppend(out, size, length, snprintf(out + length, room, "%%%c", conversion));
+                break;
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
+
+uint32_t logRingFlush() {
+    uint8_t record[LOG_RING_MAX_RECORD];
+    char line[LOG_RING_LINE];
+    uint32_t count = 0;
+    for (;;) {
+        portENTER_CRITICAL(&logRingLock);
+        uint32_t used = logHead - logTail;
+        portEXIT_CRITICAL(&logRingLock);
+        if (used < sizeof(LogRecordHeader)) {
+            break;
+        }
+        // Запись может переходить через конец кольца - копия в линейный буфер
+        uint32_t index = logTail & (LOG_RING_SIZE - 1);
+        uint32_t first = min((uint32_t)sizeof(LogRecordHeader), (uint32_t)LOG_RING_SIZE - index);
+        memcpy(record, logRing + index, first);
+        memcpy(record + first, logRing, sizeof(LogRecordHeader) - first);
+        LogRecordHeader header;
+        memcpy(&header, record, sizeof(header));
+        first = min((uint32_t)header.size, (uint32_t)LOG_RING_SIZE - index);
+        memcpy(record, logRing + index, first);
+        memcpy(record + first, logRing, header.size - first);
+
+        // Место освобождается до вывода: запись уже скопирована
+        portENTER_CRITICAL(&logRingLock);
+        logTail += header.size;
+        portEXIT_CRITICAL(&logRingLock);
+
+        size_t length = logFormatRecord(record, line, sizeof(line));
+        logLineBytes.inc(length + 1);
+        uint8_t level = header.flags & LOG_LEVEL_MASK;
+        if (header.flags & LOG_SINK_SERIAL) {
+            serialLog.println(line);
+        }
+        if (header.flags & LOG_SINK_WEB) {
+            if (level == LOG_ERROR) {
+                logger.print(sets::Logger::error());
+            } else if (level == LOG_WARN) {
+                logger.print(sets::Logger::warn());
+            }
+            logger.println(line);
+        }
+        count++;
+    }
+    return count;
+}
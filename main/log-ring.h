@@ -0,0 +1,210 @@
+#pragma once
+#include <Arduino.h>
+#include <type_traits>
+#include <atomic>
+#include "config.h"
+#include "esp32-config.h"
+
+// Отложенный журнал.
+//
+// Запись - адрес строки формата (строка во flash, её адрес и есть
+// идентификатор) и аргументы в сыром виде: целое - 5 байт, double - 9,
+// строка - копия с нулём в конце. Аргументы кодируются шаблоном на стеке
+// вызывающего, в кольцо запись попадает одним memcpy под коротким
+// критическим участком. Форматирует и выводит задача журнала с низким
+// приоритетом (logRingFlush): в Serial (serialLog) и в веб-журнал
+// (sets::Logger). Полное кольцо запись отбрасывает - вызывающий не ждёт.
+//
+// Строка формата обязана жить всё время работы (литерал): в кольце
+// хранится только её адрес. Поддерживаются преобразования printf
+// d i u o x X c f F e E g G a A s p с флагами, шириной и точностью;
+// модификаторы длины (l, ll, z...) не нужны - размер берётся из записи.
+// Из прерываний не вызывается.
+//
+// Обычно журнал пишется макросами уровня LOGD/LOGI/LOGW/LOGE. Вызовы
+// строгостью ниже LOG_BUILD_LEVEL не компилируются вовсе, ниже уровня из
+// настроек (log_level, logSetLevel) - пропускаются до вычисления аргументов:
+// остаётся сравнение и счётчик пропусков.
+
+// Куда выводится запись; флаги складываются с уровнем (LogLevel из esp32-config.h)
+#define LOG_SINK_SERIAL 0x10
+#define LOG_SINK_WEB    0x20
+#define LOG_SINK_ALL    (LOG_SINK_SERIAL | LOG_SINK_WEB)
+#define LOG_LEVEL_MASK  0x03
+
+enum LogArgType : uint8_t {
+    LOG_ARG_INT32 = 0,
+    LOG_ARG_INT64,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STRING
+};
+
+struct LogRecordHeader {
+    const char* format;
+    uint32_t timeMs;
+    uint16_t size;        // Запись целиком, с заголовком
+    uint8_t flags;        // Уровень | LOG_SINK_*
+    uint8_t argc;
+};
+
+// Запись на стеке вызывающего
+struct LogEncoder {
+    uint8_t* pos;
+    uint8_t* end;
+    uint8_t argc;
+};
+
+inline void logPut(LogEncoder& e, LogArgType type, const void* data, size_t size) {
+    if (e.pos + 1 + size > e.end) {
+        return;   // Не поместился - при выводе вместо аргумента "?"
+    }
+    *e.pos++ = type;
+    memcpy(e.pos, data, size);
+    e.pos += size;
+    e.argc++;
+}
+
+inline void logPutString(LogEncoder& e, const char* s, size_t length) {
+    if (e.pos + 2 > e.end) {
+        return;
+    }
+    // Длинная строка обрезается по месту в записи
+    size_t room = e.end - e.pos - 2;
+    if (length > room) {
+        length = room;
+    }
+    *e.pos++ = LOG_ARG_STRING;
+    memcpy(e.pos, s, length);
+    e.pos[length] = '\0';
+    e.pos += length + 1;
+    e.argc++;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+logEncode(LogEncoder& e, T value) {
+    if (sizeof(T) > sizeof(int32_t)) {
+        int64_t v = (int64_t)value;
+        logPut(e, LOG_ARG_INT64, &v, sizeof(v));
+    } else {
+        // Беззнаковые 32 бита восстанавливает преобразование (u, x...)
+        int32_t v = (int32_t)value;
+        logPut(e, LOG_ARG_INT32, &v, sizeof(v));
+    }
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value>::type
+logEncode(LogEncoder& e, T value) {
+    double v = value;
+    logPut(e, LOG_ARG_DOUBLE, &v, sizeof(v));
+}
+
+inline void logEncode(LogEncoder& e, const char* s) {
+    if (!s) {
+        s = "(null)";
+    }
+    logPutString(e, s, strlen(s));
+}
+
+inline void logEncode(LogEncoder& e, const String& s) {
+    logPutString(e, s.c_str(), s.length());
+}
+
+inline void logEncode(LogEncoder& e, const void* p) {
+    int32_t v = (int32_t)(uintptr_t)p;
+    logPut(e, LOG_ARG_INT32, &v, sizeof(v));
+}
+
+inline void logEncodeAll(LogEncoder&) {}
+
+template <typename T, typename... Rest>
+inline void logEncodeAll(LogEncoder& e, const T& first, const Rest&... rest) {
+    logEncode(e, first);
+    logEncodeAll(e, rest...);
+}
+
+// Заголовок и копия в кольцо; false - кольцо заполнено, запись отброшена
+bool logRingCommit(uint8_t* record, const LogEncoder& e, uint8_t flags, const char* format);
+
+template <typename... Args>
+inline bool logDefer(uint8_t flags, const char* format, const Args&... args) {
+    uint8_t record[LOG_RING_MAX_RECORD];
+    LogEncoder e = {record + sizeof(LogRecordHeader), record + sizeof(record), 0};
+    logEncodeAll(e, args...);
+    return logRingCommit(record, e, flags, format);
+}
+
+// Запись в журнал: LOG_DEFER(LOG_WARN | LOG_SINK_ALL, "TxDone не получен за %u мс", timeoutMs)
+#define LOG_DEFER(flags, format, ...) logDefer((flags), format, ##__VA_ARGS__)
+
+// Строгость уровня. Значения LogLevel хранятся в базе настроек и идут не по
+// строгости (отладка - последняя), поэтому сравнения - через ранг
+#define LOG_RANK_DEBUG 0
+#define LOG_RANK_INFO  1
+#define LOG_RANK_WARN  2
+#define LOG_RANK_ERROR 3
+#define LOG_RANKS      4
+
+inline uint8_t logRank(uint8_t level) {
+    return level == LOG_DEBUG ? LOG_RANK_DEBUG : level + 1;
+}
+
+// Наименьший выводимый ранг; меняется logSetLevel
+extern std::atomic<uint8_t> logMinRank;
+
+// Уровень из настроек, действует сразу
+void logSetLevel(uint8_t level);
+// Вызов ниже уровня: учёт пропуска
+void logSuppress(uint8_t rank);
+
+#define LOG_AT_(rank, level, sinks, format, ...)                              \
+    do {                                                                      \
+        if (logMinRank.load(std::memory_order_relaxed) <= (rank)) {           \
+            LOG_DEFER((level) | (sinks), format, ##__VA_ARGS__);              \
+        } else {                                                              \
+            logSuppress(rank);                                                \
+        }                                                                     \
+    } while (0)
+
+// Запись уровня: LOGW(LOG_SINK_WEB, "TxDone не получен за %u мс", timeoutMs)
+#if LOG_BUILD_LEVEL <= LOG_RANK_DEBUG
+#define LOGD(sinks, format, ...) LOG_AT_(LOG_RANK_DEBUG, LOG_DEBUG, sinks, format, ##__VA_ARGS__)
+#else
+#define LOGD(sinks, format, ...) ((void)0)
+#endif
+#if LOG_BUILD_LEVEL <= LOG_RANK_INFO
+#define LOGI(sinks, format, ...) LOG_AT_(LOG_RANK_INFO, LOG_INFO, sinks, format, ##__VA_ARGS__)
+#else
+#define LOGI(sinks, format, ...) ((void)0)
+#endif
+#if LOG_BUILD_LEVEL <= LOG_RANK_WARN
+#define LOGW(sinks, format, ...) LOG_AT_(LOG_RANK_WARN, LOG_WARN, sinks, format, ##__VA_ARGS__)
+#else
+#define LOGW(sinks, format, ...) ((void)0)
+#endif
+#define LOGE(sinks, format, ...) LOG_AT_(LOG_RANK_ERROR, LOG_ERROR, sinks, format, ##__VA_ARGS__)
+
+struct LogRingStats {
+    uint32_t records;       // Записей принято
+    uint32_t dropped;       // Отброшено: кольцо заполнено
+    uint32_t used;          // Байт в кольце сейчас
+    uint32_t peak;          // Наибольшее заполнение, байт
+    uint32_t capacity;
+    uint32_t costCycles;    // Стоимость записи в кольцо (замер при старте)
+    uint32_t formatCycles;  // Стоимость форматирования записи (замер при старте)
+    uint32_t bytes;         // Байт записей принято
+    uint32_t lineBytes;     // Байт текста выведено
+    uint32_t written[LOG_RANKS];      // Записей по рангу
+    uint32_t suppressed[LOG_RANKS];   // Пропущено ниже уровня настроек
+    uint64_t savedCycles;   // Оценка сэкономленного: пропуски * (запись + форматирование)
+};
+
+// Замер стоимости записи; вызывается до запуска задач
+void logRingBegin();
+// Форматирование и вывод накопленного; возвращает число выведенных записей
+uint32_t logRingFlush();
+LogRingStats logRingStats();
+
+// Текст записи без перевода строки; возвращает длину
+size_t logFormatRecord(const uint8_t* record, char* out, size_t size);
@@ -1,4 +1,64 @@
 #include "logging.h"
+#include "config.h"
+#include "log-history.h"
 
 // Определяем и инициализируем объект логгера
-sets::Logger logger(1500);
\ No newline at end of file
+WebLog logger(1500);
+
+size_t WebLog::write(uint8_t c) {
+    logHistory.append(&c, 1);
+    return sets::Logger::write(c);
+}
+
+size_t WebLog::write(const uint8_t* buffer, size_t size) {
+    logHistory.append(buffer, size);
+    for (size_t i = 0; i < size; i++) {
+        sets::Logger::write(buffer[i]);
+    }
+    return size;
+}
+
+bool WebLog::takeUpdate() {
+    if (_startMs == 0) {
+        _startMs = millis();
+    }
+    // Виджет всегда уходит целиком, весь заполненный буфер - столько стоила бы каждая отправка
+    uint32_t offset = logHistory.head();
+    uint32_t length = min(offset, (uint32_t)_capacity);
+    _fullBytes += length;
+    if (offset == _sentOffset && !LOG_WEB_RESEND_ALL) {
+        return false;
+    }
+    _sentOffset = offset;
+    _sentBytes += length;
+    return true;
+}
+
+float WebLog::sentBytesPerMinute() const {
+    uint32_t elapsed = millis() - _startMs;
+    return _startMs && elapsed ? _sentBytes * 60000.0f / elapsed : 0.0f;
+}
+
+float WebLog::fullBytesPerMinute() const {
+    uint32_t elapsed = millis() - _startMs;
+    return _startMs && elapsed ? _fullBytes * 60000.0f / elapsed : 0.0f;
+}
+
+// Отладочный вывод в Serial
+SerialLog serialLog;
+
+size_t SerialLog::write(uint8_t c) {
+    return _muted ? 1 : Serial.write(c);
+}
+
+size_t SerialLog::write(const uint8_t* buffer, size_t size) {
+    return _muted ? size : Serial.write(buffer, size);
+}
+
+void SerialLog::setMuted(bool muted) {
+    _muted = muted;
+}
+
+bool SerialLog::isMuted() const {
+    return _muted;
+}
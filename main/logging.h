@@ -5,8 +5,46 @@
 
 #include <SettingsESPWS.h>
 
+// Веб-журнал: буфер виджета Log и копия всего текста в историю (log-history.h).
+// Монотонное смещение истории показывает, менялся ли журнал: виджет уходит
+// клиентам по WebSocket, только если появился новый текст
+class WebLog : public sets::Logger {
+public:
+    explicit WebLog(size_t size) : sets::Logger(size), _capacity(size) {}
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+    // true - пора отправить виджет (есть новый текст); учитывает трафик
+    bool takeUpdate();
+    // Байт в минуту: отправлено и ушло бы при отправке каждую секунду
+    float sentBytesPerMinute() const;
+    float fullBytesPerMinute() const;
+
+private:
+    size_t _capacity;
+    uint32_t _sentOffset = 0;
+    uint32_t _sentBytes = 0;
+    uint32_t _fullBytes = 0;
+    uint32_t _startMs = 0;
+};
+
 // Объявляем внешний объект логгера
-extern sets::Logger logger;
+extern WebLog logger;
+
+// Отладочный вывод в Serial. В режиме модема (serial-modem.h) порт занят
+// двоичным протоколом, и вывод отключается
+class SerialLog : public Print {
+public:
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    void setMuted(bool muted);
+    bool isMuted() const;
+private:
+    volatile bool _muted = false;
+};
+
+extern SerialLog serialLog;
 
 // Короткие шаблоны для префиксов логов
 inline String info_() { return sets::Logger::info(); }
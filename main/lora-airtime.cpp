@@ -0,0 +1,29 @@
+#include "lora-airtime.h"
+
+uint32_t loraAirtimeUs(const LoRaParams& params, uint16_t payloadLen,
+                       bool crc, bool implicitHeader, uint16_t preamble) {
+    int sf = params.spreading;
+    double symbolUs = (double)(1UL << sf) * 1000.0 / params.bandwidth;
+    // Оптимизация для низкой скорости обязательна при длительности символа больше 16 мс
+    int de = symbolUs > 16000.0 ? 1 : 0;
+
+    double preambleUs = (preamble + 4.25) * symbolUs;
+
+    int numerator = 8 * payloadLen - 4 * sf + 28 + (crc ? 16 : 0) - (implicitHeader ? 20 : 0);
+    int denominator = 4 * (sf - 2 * de);
+    int blocks = numerator > 0 ? (numerator + denominator - 1) / denominator : 0;
+    int payloadSymbols = 8 + blocks * params.codingRate;
+
+    return (uint32_t)(preambleUs + payloadSymbols * symbolUs);
+}
+
+uint32_t loraFrameAirtimeUs(const LoRaParams& params, uint16_t frameLen) {
+    if (params.implicitLength <= 0) {
+        return loraAirtimeUs(params, frameLen, params.crc, false);
+    }
+    uint32_t implicitUs = loraAirtimeUs(params, params.implicitLength, params.crc, true);
+    if (frameLen <= params.implicitLength) {
+        return implicitUs;
+    }
+    return implicitUs + loraAirtimeUs(params, frameLen, params.crc, false);
+}
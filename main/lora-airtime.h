@@ -0,0 +1,14 @@
+#pragma once
+#include <Arduino.h>
+#include "param-switch.h"
+
+// Время передачи кадра в эфире по формуле Semtech (SX1276/77/78/79 datasheet, 4.1.1.7).
+// payloadLen - длина полезной нагрузки в байтах, преамбула - 8 символов (умолчание
+// драйвера sx127x.h), CRC по умолчанию выключен
+uint32_t loraAirtimeUs(const LoRaParams& params, uint16_t payloadLen,
+                       bool crc = false, bool implicitHeader = false, uint16_t preamble = 8);
+
+// Время кадра frameLen байт с режимом заголовка и CRC из params. В неявном
+// режиме кадр дополняется до implicitLength; длинный кадр уходит с явным
+// заголовком, к нему добавляется эфир объявления EXP
+uint32_t loraFrameAirtimeUs(const LoRaParams& params, uint16_t frameLen);
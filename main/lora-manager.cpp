@@ -1,42 +1,145 @@
 #include "lora-manager.h"
 #include "statistics.h"
-#include <LoRa.h>
+#include "sx127x.h"
+#include "radio-tx.h"
+#include "lora-airtime.h"
+#include "log-ring.h"
 
 LoRaManager* loraManager = nullptr;
 
-LoRaManager::LoRaManager(GyverDB* db) : _db(db) {
+LoRaManager::LoRaManager(GyverDB* db) : _db(db), _paramLock(xSemaphoreCreateMutex()), _paramSwitch(*this) {
     _packetsTotal = 0;
     _packetsSuccess = 0;
     _lastRssi = -120.0;
     _isDataUpdated = false;
+    _frequency = LORA_FREQUENCY;
+    _implicitLength = 0;
+    _explicitUntil = 0;
+    _crc = LORA_CRC_DEFAULT;
 }
 
 void LoRaManager::applySettings() {
-    _spreading = _db->get(DB_NAMESPACE::lora_spreading).toInt();
-    _bandwidth = _db->get(DB_NAMESPACE::lora_bandwidth).toFloat();
-    _codingRate = _db->get(DB_NAMESPACE::lora_coding_rate).toInt();
+    LoRaParams params;
+    params.spreading = _db->get(DB_NAMESPACE::lora_spreading).toInt();
+    params.bandwidth = _db->get(DB_NAMESPACE::lora_bandwidth).toFloat();
+    params.codingRate = _db->get(DB_NAMESPACE::lora_coding_rate).toInt();
+    params.txPower = _db->get(DB_NAMESPACE::lora_tx_power).toInt();
+    params.implicitLength = _db->get(DB_NAMESPACE::lora_implicit_len).toInt();
+    params.crc = _db->get(DB_NAMESPACE::lora_crc).toBool();
     _maxAttempts = _db->get(DB_NAMESPACE::lora_max_attempts).toInt();
-    _txPower = _db->get(DB_NAMESPACE::lora_tx_power).toInt();
     
-    Serial.println("Применение настроек LoRa...");
+    applyChannelPlan();
+    applyParams(params);
+}
+
+void LoRaManager::applyParams(const LoRaParams& params) {
+    _spreading = params.spreading;
+    _bandwidth = params.bandwidth;
+    _codingRate = params.codingRate;
+    _txPower = params.txPower;
+    _implicitLength = params.implicitLength;
+    _crc = params.crc;
+    
+    serialLog.println("Применение настроек LoRa...");
     
-    if (xSemaphoreTake(spi_lock_mutex, pdMS_TO_TICKS(5000))) {
-        Serial.println(String("Spreading:") + _spreading);
-        Serial.println(String("Bandwidth:") + _bandwidth);
-        Serial.println(String("CodingRate:") + _codingRate);
-        Serial.println(String("TxPower:") + _txPower);
-        LoRa.setSpreadingFactor(_spreading);
-        LoRa.setSignalBandwidth(_bandwidth * 1000);
-        LoRa.setCodingRate4(_codingRate);
-        LoRa.setTxPower(_txPower);
-        xSemaphoreGive(spi_lock_mutex);
-        Serial.println("Настройки LoRa применены");
+    if (spiLock(pdMS_TO_TICKS(5000))) {
+        // Кадр в эфире не прерывается: ждём TxDone, отпуская мьютекс задаче передачи
+        while (radioTx.isInFlight()) {
+            spiUnlock();
+            vTaskDelay(pdMS_TO_TICKS(10));
+            spiLock(portMAX_DELAY);
+        }
+        serialLog.println(String("Spreading:") + _spreading);
+        serialLog.println(String("Bandwidth:") + _bandwidth);
+        serialLog.println(String("CodingRate:") + _codingRate);
+        serialLog.println(String("TxPower:") + _txPower);
+        serialLog.println(String("Header:") + (_implicitLength > 0 ? "implicit " + String(_implicitLength) : "explicit"));
+        serialLog.println(String("CRC:") + (_crc ? "on" : "off"));
+        radio.setSpreadingFactor(_spreading);
+        radio.setSignalBandwidth(_bandwidth * 1000);
+        radio.setCodingRate4(_codingRate);
+        radio.setTxPower(_txPower);
+        // Режим заголовка задаётся на каждый кадр (startTransmit/parsePacket), CRC - здесь
+        if (_crc) {
+            radio.enableCrc();
+        } else {
+            radio.disableCrc();
+        }
+        tuneLocked(_channelPlan.getCurrentChannel());
+        spiUnlock();
+        serialLog.println("Настройки LoRa применены");
     } else {
         logger.println(error_() + "Не удалось захватить мьютекс");
     }
     
 }
 
+void LoRaManager::saveParams(const LoRaParams& params) {
+    _db->update(DB_NAMESPACE::lora_spreading, params.spreading);
+    _db->update(DB_NAMESPACE::lora_bandwidth, params.bandwidth);
+    _db->update(DB_NAMESPACE::lora_coding_rate, params.codingRate);
+    _db->update(DB_NAMESPACE::lora_tx_power, params.txPower);
+    _db->update(DB_NAMESPACE::lora_implicit_len, params.implicitLength);
+    _db->update(DB_NAMESPACE::lora_crc, params.crc);
+}
+
+// Запуск согласованной смены параметров: пир переключается вместе с нами
+bool LoRaManager::proposeSettings(const LoRaParams& params) {
+    _maxAttempts = _db->get(DB_NAMESPACE::lora_max_attempts).toInt();
+    return _paramSwitch.propose(getParams(), params, _maxAttempts, millis());
+}
+
+ParamSwitch& LoRaManager::paramSwitch() {
+    return _paramSwitch;
+}
+
+void LoRaManager::lockParamSwitch() {
+    xSemaphoreTake(_paramLock, portMAX_DELAY);
+}
+
+void LoRaManager::unlockParamSwitch() {
+    xSemaphoreGive(_paramLock);
+}
+
+uint16_t LoRaManager::randomSequence() {
+    return random(1, 65535);
+}
+
+void LoRaManager::logParamSwitch(bool warning, const char* text) {
+    if (warning) {
+        LOGW(LOG_SINK_WEB, "%s", text);
+    } else {
+        LOGI(LOG_SINK_WEB, "%s", text);
+    }
+}
+
+// Настройка частотного плана из базы; узел начинает с домашнего канала
+void LoRaManager::applyChannelPlan() {
+    uint8_t channels = _db->get(DB_NAMESPACE::lora_hop_channels).toInt();
+    uint32_t seed = _db->get(DB_NAMESPACE::lora_hop_seed).toInt();
+    _channelPlan.configure(channels, seed);
+    logger.println("Частотный план: каналов " + String(_channelPlan.getChannelCount()));
+}
+
+ChannelPlan& LoRaManager::channelPlan() {
+    return _channelPlan;
+}
+
+void LoRaManager::tuneLocked(uint8_t channel) {
+    _frequency = _channelPlan.getFrequency(channel);
+    // Во время эфира частота не меняется: задача передачи вернёт модем на _frequency по TxDone
+    if (radioTx.isInFlight() || radio.getFrequency() == _frequency) {
+        return;
+    }
+    // Переход в standby, чтобы следующий parsePacket заново запустил приём на новой частоте
+    radio.idle();
+    radio.setFrequency(_frequency);
+}
+
+long LoRaManager::getFrequency() const {
+    return _frequency;
+}
+
 
 // Инициализация значений LoRa по умолчанию
 void LoRaManager::initDefaults() {
@@ -48,18 +151,24 @@ void LoRaManager::initDefaults() {
     _db->init(DB_NAMESPACE::lora_spreading_selected, 0);  
     _db->init(DB_NAMESPACE::lora_bandwidth_selected, 0); 
     _db->init(DB_NAMESPACE::lora_coding_rate_selected, 0); 
+    _db->init(DB_NAMESPACE::lora_hop_channels, LORA_CHANNEL_COUNT);
+    _db->init(DB_NAMESPACE::lora_hop_seed, 0);
+    _db->init(DB_NAMESPACE::lora_implicit_len, 0);
+    _db->init(DB_NAMESPACE::lora_crc, LORA_CRC_DEFAULT);
 
     _spreading = _db->get(DB_NAMESPACE::lora_spreading).toInt();
     _bandwidth = _db->get(DB_NAMESPACE::lora_bandwidth).toFloat();
     _codingRate = _db->get(DB_NAMESPACE::lora_coding_rate).toInt();
     _maxAttempts = _db->get(DB_NAMESPACE::lora_max_attempts).toInt();
     _txPower = _db->get(DB_NAMESPACE::lora_tx_power).toInt();
+    _implicitLength = _db->get(DB_NAMESPACE::lora_implicit_len).toInt();
+    _crc = _db->get(DB_NAMESPACE::lora_crc).toBool();
 }
 
 // Обновление статистических данных из глобальных переменных статистики
 void LoRaManager::updateStats() {
-    _packetsTotal = totalSent;
-    _packetsSuccess = totalReceived;
+    _packetsTotal = totalSent.value();
+    _packetsSuccess = totalReceived.value();
     _lastRssi = -100; // Здесь можно использовать реальные данные RSSI из последнего пакета
     _isDataUpdated = true;
 }
@@ -92,6 +201,47 @@ int LoRaManager::getTxPower() const {
     return _txPower; 
 }
 
+int LoRaManager::getImplicitLength() const {
+    return _implicitLength;
+}
+
+int LoRaManager::getRxImplicitLength(uint32_t now) const {
+    if (_explicitUntil != 0 && (int32_t)(now - _explicitUntil) < 0) {
+        return 0;
+    }
+    return _implicitLength;
+}
+
+void LoRaManager::expectExplicit(uint16_t length, uint32_t now) {
+    LoRaParams params = getParams();
+    params.implicitLength = 0;
+    // Пауза передатчика, эфир самого кадра и запас на задержку опроса
+    _explicitUntil = now + LORA_EXPLICIT_GAP_MS + loraFrameAirtimeUs(params, length) / 1000 +
+                     LORA_EXPLICIT_MARGIN_MS;
+    if (_explicitUntil == 0) {
+        _explicitUntil = 1;
+    }
+}
+
+void LoRaManager::endExplicit() {
+    _explicitUntil = 0;
+}
+
+bool LoRaManager::isCrcEnabled() const {
+    return _crc;
+}
+
+LoRaParams LoRaManager::getParams() const {
+    LoRaParams params;
+    params.spreading = _spreading;
+    params.bandwidth = _bandwidth;
+    params.codingRate = _codingRate;
+    params.txPower = _txPower;
+    params.implicitLength = _implicitLength;
+    params.crc = _crc;
+    return params;
+}
+
 uint32_t LoRaManager::getPacketsTotal() const { 
     return _packetsTotal; 
 }
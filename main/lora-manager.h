@@ -3,8 +3,12 @@
 #include <GyverDB.h>
 #include "esp32-config.h"
 #include "logging.h"
+#include "param-switch.h"
+#include "channel-plan.h"
 
-class LoRaManager {
+// Менеджер радио; для согласованной смены параметров он же - окружение
+// ParamSwitch (радио, мьютекс состояния, журнал)
+class LoRaManager : public ParamSwitchPort {
 public:
     LoRaManager(GyverDB* db);
     
@@ -14,6 +18,24 @@ public:
     // Инициализация значений LoRa по умолчанию
     void initDefaults();
     
+    // Применение параметров к радиомодулю без сохранения в базу
+    void applyParams(const LoRaParams& params) override;
+    
+    // Сохранение подтверждённых параметров в базу
+    void saveParams(const LoRaParams& params) override;
+    
+    // Согласованная смена параметров на обоих узлах
+    bool proposeSettings(const LoRaParams& params);
+    ParamSwitch& paramSwitch();
+    
+    // Частотный план: настройка из базы и перестройка радио
+    void applyChannelPlan();
+    ChannelPlan& channelPlan();
+    // Перестройка на канал; мьютекс SPI должен быть захвачен вызывающей задачей
+    void tuneLocked(uint8_t channel);
+    // Частота приёма (во время передачи модем может стоять на другой)
+    long getFrequency() const;
+    
     // Обновление статистических данных
     void updateStats();
     
@@ -26,6 +48,17 @@ public:
     int getCodingRate() const;
     int getMaxAttempts() const;
     int getTxPower() const;
+    // Длина кадра неявного заголовка (0 - явный)
+    int getImplicitLength() const;
+    // Режим приёма (задача приёма): длина неявного кадра или 0, если после
+    // объявления EXP ждём кадр с явным заголовком
+    int getRxImplicitLength(uint32_t now) const;
+    // Принят EXP: следующий кадр length байт идёт с явным заголовком
+    void expectExplicit(uint16_t length, uint32_t now);
+    // Кадр с явным заголовком принят - снова неявный режим
+    void endExplicit();
+    bool isCrcEnabled() const;
+    LoRaParams getParams() const;
     
     uint32_t getPacketsTotal() const;
     uint32_t getPacketsSuccess() const;
@@ -34,6 +67,12 @@ public:
     // Получение процента успешной доставки
     int getSuccessRate() const;
 
+    // Окружение ParamSwitch
+    void lockParamSwitch() override;
+    void unlockParamSwitch() override;
+    uint16_t randomSequence() override;
+    void logParamSwitch(bool warning, const char* text) override;
+
 private:
     GyverDB* _db;
     
@@ -43,12 +82,20 @@ private:
     int _codingRate;
     int _maxAttempts;
     int _txPower;
+    volatile int _implicitLength;
+    uint32_t _explicitUntil;   // До какого millis() ждём явный кадр после EXP (0 - не ждём)
+    bool _crc;
     
     // Статистика
     uint32_t _packetsTotal;
     uint32_t _packetsSuccess;
     float _lastRssi;
     bool _isDataUpdated;
+    
+    SemaphoreHandle_t _paramLock;
+    ParamSwitch _paramSwitch;
+    ChannelPlan _channelPlan;
+    long _frequency;
 };
 
 // Глобальный экземпляр менеджера LoRa
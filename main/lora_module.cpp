@@ -1,18 +1,21 @@
 #include "lora_module.h"
 #include "led.h"
+#include "radio-events.h"
+#include "sx127x.h"
+
+LoRaRadio radio;
 
 bool setupLoRa() {
-    LoRa.setPins(LORA_SS, LORA_RST, LORA_DIO0);
     logger.println("Initializing LoRa...");
     int attempts = 0;
-    if (xSemaphoreTake(spi_lock_mutex, pdMS_TO_TICKS(10000))) {
-        while (!LoRa.begin(LORA_FREQUENCY) && attempts < LORA_MAX_ATTEMPTS) {
+    if (spiLock(pdMS_TO_TICKS(10000))) {
+        while (!radio.begin(LORA_FREQUENCY) && attempts < LORA_MAX_ATTEMPTS) {
             logger.println("LoRa init failed, retrying...");
             blinkLED(2, 200);
             vTaskDelay(pdMS_TO_TICKS(10000));
             attempts++;
         }
-        xSemaphoreGive(spi_lock_mutex);
+        spiUnlock();
     }
     
     if (attempts == LORA_MAX_ATTEMPTS) {
@@ -20,10 +23,13 @@ bool setupLoRa() {
     }
     
     // Настройка параметров LoRa
-    LoRa.setSpreadingFactor(LORA_SPREADING);
-    LoRa.setSignalBandwidth(LORA_BANDWIDTH);
-    LoRa.setCodingRate4(LORA_CODING_RATE);
-    LoRa.setTxPower(LORA_TX_POWER);
+    radio.setSpreadingFactor(LORA_SPREADING);
+    radio.setSignalBandwidth(LORA_BANDWIDTH);
+    radio.setCodingRate4(LORA_CODING_RATE);
+    radio.setTxPower(LORA_TX_POWER);
+    
+    // Метки времени RxDone из прерывания DIO0
+    setupRadioEvents();
     
     return true;
 } 
\ No newline at end of file
@@ -2,7 +2,6 @@
 #define LORA_MODULE_H
 
 #include "config.h"
-#include <LoRa.h>
 #include "logging.h"
 
 // Инициализация LoRa модуля
@@ -1,6 +1,5 @@
 #include <Arduino.h>
 #include <SPI.h>
-#include <LoRa.h>
 #include <WiFi.h>
 #include <Adafruit_NeoPixel.h>
 #include <Adafruit_GFX.h>
@@ -20,6 +19,19 @@
 #include "tasks.h"
 #include "display-manager.h"
 #include "system-monitor.h"
+#include "time-sync.h"
+#include "tx-queue.h"
+#include "gateway.h"
+#include "serial-modem.h"
+#include "packet-capture.h"
+#include "spectrum-scan.h"
+#include "radio-tx.h"
+#include "metrics.h"
+#include "trace.h"
+#include "log-ring.h"
+#include "log-history.h"
+#include "profiler.h"
+#include "heap-profiler.h"
 
 
 // Модули веб-интерфейса
@@ -27,7 +39,7 @@
 
 #include "wifi-manager.h"    // В этом файле объявлен extern WiFiManager* wifiManager;
 #include "lora-manager.h"    // В этом файле объявлен extern LoRaManager* loraManager;
-#include "plot-manager.h"
+#include "metrics-history.h"
 #include "ui-builder.h"
 
 // Объявляем глобальный указатель на UIBuilder
@@ -47,7 +59,12 @@ void buildInterface(sets::Builder& b) {
 }
 
 void setup() {
+    // Буферы UART под режим модема задаются до begin()
+    Serial.setRxBufferSize(1024);
+    Serial.setTxBufferSize(1024);
     Serial.begin(115200);
+    // История журнала - до первой строки в logger
+    logHistory.begin();
     logger.println();
 
     // Инициализация watchdog таймера для задач
@@ -66,6 +83,10 @@ void setup() {
     
     // Инициализация базы данных
     db.begin();
+
+    // Очередь исходящих сообщений переживает перезагрузку
+    txQueue.begin(LittleFS);
+    radioTx.begin();
     
     // Создание и инициализация менеджеров
     wifiManager = new WiFiManager(&db);
@@ -73,12 +94,28 @@ void setup() {
     uiBuilder = new UIBuilder(&db);
     systemMonitor = new SystemMonitor(); // Создаем системный монитор
     displayManager = new DisplayManager(&db); // Создаем менеджер дисплея
+    gateway = new Gateway(&db);
+    serialModem = new SerialModem(&db);
+    packetCapture = new PacketCapture(&db);
+    spectrumScanner = new SpectrumScanner(&db);
+    profiler = new Profiler(&db);
     
     // Инициализация значений по умолчанию
     wifiManager->initDefaults();
     loraManager->initDefaults();
     displayManager->initDefaults(); // Инициализация настроек дисплея
+    gateway->initDefaults();
+    gateway->applySettings();
+    serialModem->initDefaults();
+    serialModem->applySettings();
+    packetCapture->initDefaults();
+    packetCapture->applySettings();
+    spectrumScanner->initDefaults();
+    spectrumScanner->applySettings();
+    profiler->initDefaults();
     db.init(DB_NAMESPACE::log_level, LOG_INFO);
+    logSetLevel(db.get(DB_NAMESPACE::log_level).toInt());
+    timeSync.setNodeId(getNodeId());
 
     #if DISPLAY_ENABLED
     displayManager = new DisplayManager(&db); // Создаем менеджер дисплея только для ESP32
@@ -103,8 +140,10 @@ void setup() {
             displayManager->showError("LoRa initialization failed!");
         }
         #endif
+        // Мигание идёт по таймеру, задача setup просто спит
+        postLedEffect(LED_REPEAT_FOREVER, 200, 200);
         while (true) {
-            blinkLED(1, 200);
+            vTaskDelay(portMAX_DELAY);
         }
     } else {
       loraManager->applySettings();
@@ -119,6 +158,13 @@ void setup() {
     sett.onBuild(buildInterface);
     
     
+    // Замер стоимости обновления метрик - до запуска задач, без конкуренции
+    measureMetricsUpdateCost();
+    traceBegin();
+    logRingBegin();
+    heapProfileBegin();
+    profiler->applySettings();
+
     // Создание задач
     createTasks();
     
@@ -140,7 +186,7 @@ void loop() {
     }
 
     static GTimer<millis> tmr(1000, true);
-    if (tmr) {
+    if (tmr && logger.takeUpdate()) {
         sett.updater()
             .update(H("logger"), logger);
             //.update(H(lbl2), random(100));
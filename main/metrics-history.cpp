@@ -0,0 +1,113 @@
+#include "metrics-history.h"
+#include "statistics.h"
+#include "system-monitor.h"
+
+MetricsHistory metricsHistory;
+
+MetricsHistory::MetricsHistory() {
+    memset(_secondsRing, 0, sizeof(_secondsRing));
+    memset(_minutesRing, 0, sizeof(_minutesRing));
+    memset(_hoursRing, 0, sizeof(_hoursRing));
+    memset(_current, 0, sizeof(_current));
+    memset(_heads, 0, sizeof(_heads));
+    memset(_closed, 0, sizeof(_closed));
+    for (uint8_t s = 0; s < HISTORY_SERIES_COUNT; s++) {
+        _rings[s][HISTORY_SECONDS] = _secondsRing[s];
+        _rings[s][HISTORY_MINUTES] = _minutesRing[s];
+        _rings[s][HISTORY_HOURS] = _hoursRing[s];
+    }
+    _seconds = 0;
+    _lastWake = 0;
+    _lock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+uint16_t MetricsHistory::capacity(HistoryTier tier) {
+    switch (tier) {
+        case HISTORY_SECONDS: return HISTORY_SECOND_BUCKETS;
+        case HISTORY_MINUTES: return HISTORY_MINUTE_BUCKETS;
+        default:              return HISTORY_HOUR_BUCKETS;
+    }
+}
+
+uint32_t MetricsHistory::bucketSeconds(HistoryTier tier) {
+    switch (tier) {
+        case HISTORY_SECONDS: return 1;
+        case HISTORY_MINUTES: return 60;
+        default:              return 3600;
+    }
+}
+
+uint16_t MetricsHistory::size(HistoryTier tier) const {
+    return min(_closed[tier], (uint32_t)capacity(tier));
+}
+
+void MetricsHistory::merge(HistoryBucket& into, const HistoryBucket& from) {
+    if (from.count == 0) {
+        return;
+    }
+    if (into.count == 0) {
+        into = from;
+        return;
+    }
+    into.min = min(into.min, from.min);
+    into.max = max(into.max, from.max);
+    into.sum += from.sum;
+    into.count += from.count;
+}
+
+void MetricsHistory::record(HistorySeries series, float value) {
+    HistoryBucket sample = {value, value, value, 1};
+    portENTER_CRITICAL(&_lock);
+    merge(_current[HISTORY_SECONDS][series], sample);
+    portEXIT_CRITICAL(&_lock);
+}
+
+// Интервалы всех рядов уходят в кольцо уровня; вызывается под _lock
+void MetricsHistory::push(HistoryTier tier, HistoryBucket* buckets) {
+    uint16_t head = _heads[tier];
+    for (uint8_t s = 0; s < HISTORY_SERIES_COUNT; s++) {
+        _rings[s][tier][head] = buckets[s];
+        if (tier + 1 < HISTORY_TIER_COUNT) {
+            merge(_current[tier + 1][s], buckets[s]);
+        }
+        memset(&buckets[s], 0, sizeof(HistoryBucket));
+    }
+    _heads[tier] = (head + 1) % capacity(tier);
+    _closed[tier]++;
+}
+
+void MetricsHistory::closeSecond() {
+    portENTER_CRITICAL(&_lock);
+    push(HISTORY_SECONDS, _current[HISTORY_SECONDS]);
+    _seconds++;
+    if (_seconds % 60 == 0) {
+        push(HISTORY_MINUTES, _current[HISTORY_MINUTES]);
+    }
+    if (_seconds % 3600 == 0) {
+        push(HISTORY_HOURS, _current[HISTORY_HOURS]);
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+void MetricsHistory::process() {
+    // Ровно раз в секунду, без накопления сдвига от времени обработки
+    if (_lastWake == 0) {
+        _lastWake = xTaskGetTickCount();
+    }
+    vTaskDelayUntil(&_lastWake, pdMS_TO_TICKS(1000));
+
+    record(HISTORY_PDR, successRateSmoothed.value());
+    record(HISTORY_HEAP, ESP.getFreeHeap() / 1024.0f);
+    if (systemMonitor) {
+        record(HISTORY_CPU, systemMonitor->getTotalCpuUsage(CPU_WINDOW_1S));
+    }
+    closeSecond();
+}
+
+HistoryBucket MetricsHistory::summary(HistorySeries series, HistoryTier tier, uint16_t count) const {
+    HistoryBucket total = {0, 0, 0, 0};
+    visit(series, tier, count, [&total](const HistoryBucket& bucket) {
+        merge(total, bucket);
+    });
+    return total;
+}
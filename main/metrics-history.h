@@ -0,0 +1,105 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Ряды истории
+enum HistorySeries : uint8_t {
+    HISTORY_PDR = 0,   // Сглаженная успешность доставки, %
+    HISTORY_RTT,       // RTT HLO/ACK, ms
+    HISTORY_RSSI,      // RSSI принятых кадров, dBm
+    HISTORY_SNR,       // SNR принятых кадров, dB
+    HISTORY_HEAP,      // Свободная куча, KB
+    HISTORY_CPU,       // Общая загрузка CPU, %
+    HISTORY_SERIES_COUNT
+};
+
+// Уровни разрешения
+enum HistoryTier : uint8_t {
+    HISTORY_SECONDS = 0,
+    HISTORY_MINUTES,
+    HISTORY_HOURS,
+    HISTORY_TIER_COUNT
+};
+
+// Интервал истории: агрегат всех значений ряда за секунду, минуту или час
+struct HistoryBucket {
+    float min;
+    float max;
+    float sum;
+    uint32_t count;   // 0 - значений не было
+
+    float avg() const { return count ? sum / count : 0.0f; }
+};
+
+// История метрик с несколькими разрешениями.
+//
+// На каждый ряд три кольца: HISTORY_SECOND_BUCKETS секундных интервалов,
+// HISTORY_MINUTE_BUCKETS минутных и HISTORY_HOUR_BUCKETS часовых. Значения
+// копятся в аккумуляторе текущей секунды; при закрытии секунды интервал
+// уходит в секундное кольцо и одновременно сливается (min/max/sum/count)
+// в аккумуляторы текущей минуты и часа, которые закрываются на своих границах.
+// Память фиксирована: HISTORY_SERIES_COUNT * (сумма колец + 3) * sizeof(HistoryBucket).
+//
+// Ряды-события (RTT, RSSI, SNR) пишутся через record() в момент события,
+// ряды-состояния (PDR, куча, CPU) задача истории снимает сама раз в секунду.
+//
+// Чтение без копирования: visit() проходит по кольцу на месте, от старых
+// интервалов к новым. Читатель не блокирует запись, поэтому интервал,
+// закрываемый во время обхода, может попасть в обход уже обновлённым -
+// для графиков это безразлично.
+class MetricsHistory {
+public:
+    MetricsHistory();
+
+    // Значение ряда-события (из любой задачи)
+    void record(HistorySeries series, float value);
+
+    // Один шаг задачи истории: ожидание границы секунды, отсчёт состояний, закрытие секунды
+    void process();
+
+    // Число интервалов в кольце уровня и сколько из них уже заполнено временем
+    static uint16_t capacity(HistoryTier tier);
+    uint16_t size(HistoryTier tier) const;
+    // Длительность интервала уровня, с
+    static uint32_t bucketSeconds(HistoryTier tier);
+
+    // fn(const HistoryBucket&) для последних count интервалов, от старых к новым
+    template <typename F>
+    void visit(HistorySeries series, HistoryTier tier, uint16_t count, F fn) const {
+        const HistoryBucket* ring = _rings[series][tier];
+        uint16_t cap = capacity(tier);
+        uint16_t available = size(tier);
+        if (count > available) count = available;
+        uint16_t head = _heads[tier];
+        for (uint16_t i = 0; i < count; i++) {
+            fn(ring[(head + cap - count + i) % cap]);
+        }
+    }
+
+    // Сводка по последним count интервалам уровня
+    HistoryBucket summary(HistorySeries series, HistoryTier tier, uint16_t count) const;
+
+private:
+    void closeSecond();
+    void push(HistoryTier tier, HistoryBucket* buckets);
+
+    static void merge(HistoryBucket& into, const HistoryBucket& from);
+
+    HistoryBucket _secondsRing[HISTORY_SERIES_COUNT][HISTORY_SECOND_BUCKETS];
+    HistoryBucket _minutesRing[HISTORY_SERIES_COUNT][HISTORY_MINUTE_BUCKETS];
+    HistoryBucket _hoursRing[HISTORY_SERIES_COUNT][HISTORY_HOUR_BUCKETS];
+    HistoryBucket* _rings[HISTORY_SERIES_COUNT][HISTORY_TIER_COUNT];
+
+    // Аккумуляторы текущего интервала каждого уровня
+    HistoryBucket _current[HISTORY_TIER_COUNT][HISTORY_SERIES_COUNT];
+
+    uint16_t _heads[HISTORY_TIER_COUNT];     // Следующий слот кольца
+    uint32_t _closed[HISTORY_TIER_COUNT];    // Закрыто интервалов всего
+    uint32_t _seconds;                       // Секунд с начала
+    TickType_t _lastWake;
+
+    mutable portMUX_TYPE _lock;
+};
+
+// Глобальный экземпляр истории метрик
+extern MetricsHistory metricsHistory;
@@ -0,0 +1,130 @@
+#include "metrics.h"
+#include "logging.h"
+#include "esp_timer.h"
+
+// Нулевая инициализация - до конструкторов метрик
+Metric* Metric::_first = nullptr;
+Metric* Metric::_last = nullptr;
+
+static MetricsUpdateCost updateCost = {};
+
+Metric::Metric(const char* name, const char* help, MetricType type)
+    : _name(name), _help(help), _type(type), _next(nullptr) {
+    // Безымянная метрика в реестр не попадает (замеры, временные объекты)
+    if (name == nullptr) {
+        return;
+    }
+    if (_last) {
+        _last->_next = this;
+    } else {
+        _first = this;
+    }
+    _last = this;
+}
+
+Counter::Counter(const char* name, const char* help) : Metric(name, help, METRIC_COUNTER) {
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        _shards[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+uint32_t Counter::value() const {
+    uint32_t total = 0;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        total += _shards[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Gauge::Gauge(const char* name, const char* help, float initial)
+    : Metric(name, help, METRIC_GAUGE), _value(initial) {
+}
+
+void Gauge::smooth(float sample, float alpha) {
+    float current = _value.load(std::memory_order_relaxed);
+    while (!_value.compare_exchange_weak(current, alpha * sample + (1 - alpha) * current,
+                                         std::memory_order_relaxed)) {
+    }
+}
+
+Histogram::Histogram(const char* name, const char* help, uint32_t base, uint8_t buckets)
+    : Metric(name, help, METRIC_HISTOGRAM), _base(base) {
+    _bucketCount = constrain(buckets, 1, METRIC_HISTOGRAM_MAX_BUCKETS);
+}
+
+uint32_t Histogram::upperBound(uint8_t bucket) const {
+    if (bucket + 1 >= _bucketCount) {
+        return UINT32_MAX;
+    }
+    return _base << bucket;
+}
+
+void Histogram::observe(uint32_t v) {
+    uint8_t bucket = 0;
+    while (bucket + 1 < _bucketCount && v >= (_base << bucket)) {
+        bucket++;
+    }
+    // Копия своего ядра: критический участок не ждёт другое ядро
+    _shards[xPortGetCoreID()].write([v, bucket](HistogramSnapshot& h) {
+        h.buckets[bucket]++;
+        if (h.count == 0 || v < h.min) h.min = v;
+        if (v > h.max) h.max = v;
+        h.count++;
+        h.sum += v;
+    });
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot total = {};
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        HistogramSnapshot shard = _shards[i].read();
+        if (shard.count == 0) {
+            continue;
+        }
+        for (uint8_t b = 0; b < _bucketCount; b++) {
+            total.buckets[b] += shard.buckets[b];
+        }
+        total.min = total.count == 0 ? shard.min : min(total.min, shard.min);
+        total.max = max(total.max, shard.max);
+        total.count += shard.count;
+        total.sum += shard.sum;
+    }
+    return total;
+}
+
+// Среднее время одного вызова за n повторов, нс
+template <typename F>
+static uint32_t measureNs(uint32_t n, F fn) {
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < n; i++) {
+        fn(i);
+    }
+    return (uint32_t)((esp_timer_get_time() - start) * 1000 / n);
+}
+
+void measureMetricsUpdateCost() {
+    const uint32_t rounds = 10000;
+    static Counter counter(nullptr, nullptr);
+    static Gauge gauge(nullptr, nullptr);
+    static Histogram histogram(nullptr, nullptr, 64, 8);
+    static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    static volatile uint32_t plain = 0;
+
+    updateCost.counterNs = measureNs(rounds, [](uint32_t) { counter.inc(); });
+    updateCost.gaugeNs = measureNs(rounds, [](uint32_t i) { gauge.smooth(i, 0.2f); });
+    updateCost.histogramNs = measureNs(rounds, [](uint32_t i) { histogram.observe(i); });
+    updateCost.criticalNs = measureNs(rounds, [](uint32_t) {
+        portENTER_CRITICAL(&lock);
+        plain = plain + 1;
+        portEXIT_CRITICAL(&lock);
+    });
+
+    logger.println("Стоимость обновления метрик, нс: счётчик " + String(updateCost.counterNs) +
+                   ", gauge " + String(updateCost.gaugeNs) +
+                   ", гистограмма " + String(updateCost.histogramNs) +
+                   ", ++ под критическим участком " + String(updateCost.criticalNs));
+}
+
+MetricsUpdateCost metricsUpdateCost() {
+    return updateCost;
+}
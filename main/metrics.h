@@ -0,0 +1,157 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+
+// Корзин гистограммы не больше этого числа (последняя - "и выше")
+#define METRIC_HISTOGRAM_MAX_BUCKETS 12
+
+enum MetricType : uint8_t {
+    METRIC_COUNTER = 0,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+};
+
+// Именованная метрика реестра.
+//
+// Метрики - глобальные объекты: конструктор добавляет метрику в список
+// реестра, обход - Metric::first()/next() в порядке объявления. Голова
+// списка инициализируется нулём до любых конструкторов, поэтому порядок
+// инициализации единиц трансляции не важен. Метрика без имени (nullptr)
+// в реестр не попадает.
+class Metric {
+public:
+    const char* name() const { return _name; }
+    const char* help() const { return _help; }
+    MetricType type() const { return _type; }
+
+    static const Metric* first() { return _first; }
+    const Metric* next() const { return _next; }
+
+protected:
+    Metric(const char* name, const char* help, MetricType type);
+
+private:
+    const char* _name;
+    const char* _help;
+    MetricType _type;
+    const Metric* _next;
+
+    static Metric* _first;
+    static Metric* _last;
+};
+
+// Счётчик: только растёт. Своя ячейка на каждое ядро - задачи разных ядер
+// не делят одно слово памяти, запись - атомарное сложение без блокировок
+class Counter : public Metric {
+public:
+    Counter(const char* name, const char* help);
+
+    void inc(uint32_t n = 1) {
+        _shards[xPortGetCoreID()].fetch_add(n, std::memory_order_relaxed);
+    }
+    uint32_t value() const;
+
+private:
+    std::atomic<uint32_t> _shards[portNUM_PROCESSORS];
+};
+
+// Текущее значение. Одно слово, запись и чтение атомарны
+class Gauge : public Metric {
+public:
+    Gauge(const char* name, const char* help, float initial = 0.0f);
+
+    void set(float v) { _value.store(v, std::memory_order_relaxed); }
+    float value() const { return _value.load(std::memory_order_relaxed); }
+
+    // Экспоненциальное сглаживание: value = alpha * sample + (1 - alpha) * value.
+    // Цикл compare-exchange - несколько писателей не теряют обновлений
+    void smooth(float sample, float alpha);
+
+private:
+    std::atomic<float> _value;
+};
+
+// Значение под seqlock: писатели сериализуются коротким критическим
+// участком, читатели не блокируются и не блокируют запись - копируют
+// значение и повторяют, если счётчик версий изменился или был нечётным
+// (запись шла в это время). Читатель всегда видит согласованную копию.
+template <typename T>
+class SeqLocked {
+public:
+    SeqLocked() : _sequence(0), _lock(portMUX_INITIALIZER_UNLOCKED) {
+        memset(&_value, 0, sizeof(_value));
+    }
+
+    // fn(T&) изменяет значение; вызывается в критическом участке - коротко и без блокировок
+    template <typename F>
+    void write(F fn) {
+        portENTER_CRITICAL(&_lock);
+        _sequence.store(_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        fn(_value);
+        std::atomic_thread_fence(std::memory_order_release);
+        _sequence.store(_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        portEXIT_CRITICAL(&_lock);
+    }
+
+    T read() const {
+        T copy;
+        uint32_t before;
+        uint32_t after;
+        do {
+            before = _sequence.load(std::memory_order_acquire);
+            memcpy(&copy, &_value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = _sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return copy;
+    }
+
+private:
+    std::atomic<uint32_t> _sequence;
+    T _value;
+    portMUX_TYPE _lock;
+};
+
+// Снимок гистограммы
+struct HistogramSnapshot {
+    uint32_t buckets[METRIC_HISTOGRAM_MAX_BUCKETS];
+    uint32_t count;
+    uint64_t sum;
+    uint32_t min;   // 0, если count == 0
+    uint32_t max;
+
+    float avg() const { return count ? (float)sum / count : 0.0f; }
+};
+
+// Гистограмма целых значений с корзинами [0, base), [base, 2*base), ...,
+// удвоение до последней корзины "и выше". Значения, сумма, min и max
+// одного наблюдения меняются вместе - под seqlock, по копии на ядро
+class Histogram : public Metric {
+public:
+    Histogram(const char* name, const char* help, uint32_t base, uint8_t buckets);
+
+    void observe(uint32_t v);
+    HistogramSnapshot snapshot() const;
+
+    uint8_t bucketCount() const { return _bucketCount; }
+    // Верхняя граница корзины (не включительно); для последней - UINT32_MAX
+    uint32_t upperBound(uint8_t bucket) const;
+
+private:
+    uint32_t _base;
+    uint8_t _bucketCount;
+    SeqLocked<HistogramSnapshot> _shards[portNUM_PROCESSORS];
+};
+
+// Стоимость одного обновления, нс (замер на устройстве при старте)
+struct MetricsUpdateCost {
+    uint32_t counterNs;     // Counter::inc
+    uint32_t gaugeNs;       // Gauge::smooth
+    uint32_t histogramNs;   // Histogram::observe
+    uint32_t criticalNs;    // Для сравнения: ++ под portENTER_CRITICAL
+};
+
+void measureMetricsUpdateCost();
+MetricsUpdateCost metricsUpdateCost();
@@ -0,0 +1,121 @@
+#include "openmetrics-writer.h"
+
+OpenMetricsWriter::OpenMetricsWriter(Print& out) : _out(out) {
+    _used = 0;
+    _written = 0;
+}
+
+size_t OpenMetricsWriter::write(uint8_t c) {
+    if (_used == sizeof(_buffer)) {
+        send();
+    }
+    _buffer[_used++] = c;
+    return 1;
+}
+
+size_t OpenMetricsWriter::write(const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        write(data[i]);
+    }
+    return size;
+}
+
+void OpenMetricsWriter::send() {
+    if (_used > 0) {
+        _written += _out.write((const uint8_t*)_buffer, _used);
+        _used = 0;
+    }
+}
+
+void OpenMetricsWriter::family(const char* name, const char* type, const char* help) {
+    // print по частям: printf длиннее 64 байт выделил бы временный буфер в куче
+    print("# TYPE ");
+    print(name);
+    write(' ');
+    print(type);
+    print("\n# HELP ");
+    print(name);
+    write(' ');
+    print(help);
+    write('\n');
+}
+
+// Имя отсчёта и метка; значение метки экранируется
+void OpenMetricsWriter::begin(const char* name, const char* suffix, const char* label, const char* labelValue) {
+    print(name);
+    if (suffix) {
+        print(suffix);
+    }
+    if (label) {
+        printf("{%s=\"", label);
+        for (const char* c = labelValue; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                write('\\');
+                write(*c);
+            } else if (*c == '\n') {
+                print("\\n");
+            } else {
+                write(*c);
+            }
+        }
+        print("\"}");
+    }
+    write(' ');
+}
+
+void OpenMetricsWriter::sample(const char* name, const char* suffix, uint32_t value,
+                               const char* label, const char* labelValue) {
+    begin(name, suffix, label, labelValue);
+    printf("%lu\n", (unsigned long)value);
+}
+
+void OpenMetricsWriter::sample(const char* name, const char* suffix, float value, uint8_t decimals,
+                               const char* label, const char* labelValue) {
+    begin(name, suffix, label, labelValue);
+    if (isnan(value)) {
+        print("NaN\n");
+    } else {
+        printf("%.*f\n", decimals, value);
+    }
+}
+
+void OpenMetricsWriter::metric(const Metric& m) {
+    switch (m.type()) {
+        case METRIC_COUNTER:
+            family(m.name(), "counter", m.help());
+            sample(m.name(), "_total", static_cast<const Counter&>(m).value());
+            break;
+        case METRIC_GAUGE:
+            family(m.name(), "gauge", m.help());
+            sample(m.name(), nullptr, static_cast<const Gauge&>(m).value(), 2);
+            break;
+        case METRIC_HISTOGRAM: {
+            const Histogram& histogram = static_cast<const Histogram&>(m);
+            HistogramSnapshot h = histogram.snapshot();
+            family(m.name(), "histogram", m.help());
+            // Корзины OpenMetrics накопительные: le - "не больше"
+            uint32_t cumulative = 0;
+            char le[12];
+            for (uint8_t i = 0; i < histogram.bucketCount(); i++) {
+                cumulative += h.buckets[i];
+                uint32_t upper = histogram.upperBound(i);
+                if (upper == UINT32_MAX) {
+                    strcpy(le, "+Inf");
+                } else {
+                    snprintf(le, sizeof(le), "%lu", (unsigned long)(upper - 1));
+                }
+                sample(m.name(), "_bucket", cumulative, "le", le);
+            }
+            sample(m.name(), "_count", h.count);
+            begin(m.name(), "_sum", nullptr, nullptr);
+            printf("%llu\n", (unsigned long long)h.sum);
+            break;
+        }
+    }
+}
+
+size_t OpenMetricsWriter::finish() {
+    print("# EOF\n");
+    send();
+    return _written;
+}
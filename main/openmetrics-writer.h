@@ -0,0 +1,50 @@
+#pragma once
+#include <Arduino.h>
+#include "metrics.h"
+
+// Размер буфера: вывод уходит в Print порциями такого размера
+#define OPENMETRICS_CHUNK 256
+
+// Потоковая запись в текстовом формате OpenMetrics (Prometheus).
+//
+// Как и JsonWriter, копит текст в буфере фиксированного размера и отдаёт
+// его в out порциями - тело ответа целиком в памяти не собирается.
+// Семейство начинается с family(), затем идут его отсчёты; документ
+// заканчивается finish() ("# EOF").
+//
+//   OpenMetricsWriter out(client);
+//   out.family("system_free_heap_bytes", "gauge", "Free heap");
+//   out.sample("system_free_heap_bytes", nullptr, ESP.getFreeHeap());
+//   out.finish();
+class OpenMetricsWriter : public Print {
+public:
+    explicit OpenMetricsWriter(Print& out);
+
+    // Строки # TYPE и # HELP семейства
+    void family(const char* name, const char* type, const char* help);
+
+    // Отсчёт name<suffix>{label="labelValue"} value; suffix и метка необязательны
+    void sample(const char* name, const char* suffix, uint32_t value,
+                const char* label = nullptr, const char* labelValue = nullptr);
+    void sample(const char* name, const char* suffix, float value, uint8_t decimals,
+                const char* label = nullptr, const char* labelValue = nullptr);
+
+    // Семейство и отсчёты метрики реестра (у гистограммы - корзины, _count и _sum)
+    void metric(const Metric& m);
+
+    // "# EOF" и отправка остатка буфера; возвращает всего записанных байт
+    size_t finish();
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t size) override;
+    using Print::write;
+
+private:
+    void begin(const char* name, const char* suffix, const char* label, const char* labelValue);
+    void send();
+
+    Print& _out;
+    char _buffer[OPENMETRICS_CHUNK];
+    size_t _used;
+    size_t _written;
+};
@@ -0,0 +1,299 @@
+#include "packet-capture.h"
+#include "config.h"
+#include "logging.h"
+#include "lora-manager.h"
+#include "time-sync.h"
+#include "serial-modem.h"
+#include <LittleFS.h>
+
+#define LINKTYPE_LORATAP   270
+#define LORATAP_HEADER_LEN 35
+
+// Флаги LoRaTap v1
+#define LORATAP_FLAG_IMPLICIT_HDR 0x04
+#define LORATAP_FLAG_CRC_OK       0x08
+#define LORATAP_FLAG_CRC_BAD      0x10
+#define LORATAP_FLAG_CRC_NONE     0x20
+
+// Слово синхронизации после сброса SX127x (драйвер его не меняет)
+#define LORA_SYNC_WORD 0x12
+
+PacketCapture* packetCapture = nullptr;
+
+static void putBE16(uint8_t* p, uint16_t value) {
+    p[0] = value >> 8;
+    p[1] = value;
+}
+
+static void putBE32(uint8_t* p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+PacketCapture::PacketCapture(GyverDB* db) : _db(db), _server(CAPTURE_TCP_PORT) {
+    _mode = CAPTURE_OFF;
+    _reconfigure = false;
+    _activeMode = CAPTURE_OFF;
+    _head = 0;
+    _tail = 0;
+    _fileIndex = 0;
+    _fileBytes = 0;
+    _lastFlush = 0;
+    _droppedRing = 0;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void PacketCapture::initDefaults() {
+    _db->init(DB_NAMESPACE::capture_mode, CAPTURE_OFF);
+}
+
+void PacketCapture::applySettings() {
+    _mode = _db->get(DB_NAMESPACE::capture_mode).toInt();
+    _reconfigure = true;
+}
+
+bool PacketCapture::isEnabled() const {
+    return _mode != CAPTURE_OFF;
+}
+
+void PacketCapture::capture(bool tx, const uint8_t* data, size_t len, const PacketMeta& meta) {
+    if (_mode == CAPTURE_OFF) {
+        return;
+    }
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= CAPTURE_RING_SLOTS) {
+        _droppedRing.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    CaptureRecord& record = _ring[head % CAPTURE_RING_SLOTS];
+    LoRaParams params = loraManager->getParams();
+    record.timestampUs = timeSync.localToGlobal(tx ? meta.txDoneUs : meta.rxDoneUs);
+    record.frequency = loraManager->getFrequency();
+    record.bandwidth = params.bandwidth;
+    record.sf = params.spreading;
+    record.cr = params.codingRate;
+    record.rssi = tx ? 0 : meta.rssi;
+    record.snrQuarter = tx ? 0 : (int8_t)constrain(lroundf(meta.snr * 4.0f), -128L, 127L);
+    // Кадры с ошибкой CRC драйвер отбрасывает сам (parsePacket)
+    record.flags = params.crc ? LORATAP_FLAG_CRC_OK : LORATAP_FLAG_CRC_NONE;
+    // В неявном режиме длинные кадры идут с явным заголовком (после EXP), неявные - ровно implicitLength
+    if (params.implicitLength > 0 && len == (size_t)params.implicitLength) record.flags |= LORATAP_FLAG_IMPLICIT_HDR;
+    record.tx = tx;
+    record.len = min(len, sizeof(record.data));
+    memcpy(record.data, data, record.len);
+
+    _head.store(head + 1, std::memory_order_release);
+}
+
+void PacketCapture::writeGlobalHeader(Print& out) {
+    uint32_t header[6] = {
+        0xA1B2C3D4,               // Метки времени в микросекундах
+        (4 << 16) | 2,            // Версия 2.4 (младшим словом - major)
+        0,                        // thiszone
+        0,                        // sigfigs
+        65535,                    // snaplen
+        LINKTYPE_LORATAP
+    };
+    out.write((const uint8_t*)header, sizeof(header));
+}
+
+String PacketCapture::filePath(uint32_t index) const {
+    return String(CAPTURE_DIR) + "/" + String(index) + ".pcap";
+}
+
+// Новый файл кольца; самые старые файлы сверх CAPTURE_FILES удаляются
+void PacketCapture::rotateFile() {
+    if (_file) {
+        _file.close();
+    }
+    _fileIndex++;
+    if (_fileIndex > CAPTURE_FILES) {
+        LittleFS.remove(filePath(_fileIndex - CAPTURE_FILES));
+    }
+    _file = LittleFS.open(filePath(_fileIndex), FILE_WRITE);
+    _fileBytes = 0;
+    if (_file) {
+        writeGlobalHeader(_file);
+        _fileBytes = 24;
+    }
+    _stats.files = min(_fileIndex, (uint32_t)CAPTURE_FILES);
+}
+
+bool PacketCapture::openSink() {
+    switch (_activeMode) {
+        case CAPTURE_FILE: {
+            if (!LittleFS.exists(CAPTURE_DIR)) {
+                LittleFS.mkdir(CAPTURE_DIR);
+            }
+            // Продолжаем нумерацию после существующих файлов
+            _fileIndex = 0;
+            File dir = LittleFS.open(CAPTURE_DIR);
+            if (dir && dir.isDirectory()) {
+                File file = dir.openNextFile();
+                while (file) {
+                    String name = file.name();
+                    name = name.substring(name.lastIndexOf('/') + 1);
+                    uint32_t index = name.toInt();
+                    if (index > _fileIndex) _fileIndex = index;
+                    file.close();
+                    file = dir.openNextFile();
+                }
+            }
+            rotateFile();
+            logger.println("Захват пакетов: " + filePath(_fileIndex));
+            return (bool)_file;
+        }
+        case CAPTURE_TCP:
+            _server.begin();
+            _server.setNoDelay(true);
+            logger.println("Захват пакетов: TCP порт " + String(CAPTURE_TCP_PORT));
+            return true;
+        case CAPTURE_SERIAL:
+            if (serialModem && serialModem->isActive()) {
+                logger.println(warn_() + "Захват в Serial недоступен в режиме модема");
+                return false;
+            }
+            Serial.flush();
+            serialLog.setMuted(true);
+            writeGlobalHeader(Serial);
+            return true;
+        default:
+            return true;
+    }
+}
+
+void PacketCapture::closeSink() {
+    switch (_activeMode) {
+        case CAPTURE_FILE:
+            if (_file) _file.close();
+            break;
+        case CAPTURE_TCP:
+            if (_client) _client.stop();
+            _server.end();
+            break;
+        case CAPTURE_SERIAL:
+            Serial.flush();
+            serialLog.setMuted(false);
+            break;
+    }
+    _activeMode = CAPTURE_OFF;
+}
+
+bool PacketCapture::writeRecord(const CaptureRecord& record) {
+    Print* out = nullptr;
+    switch (_activeMode) {
+        case CAPTURE_FILE:
+            if (_fileBytes >= CAPTURE_FILE_BYTES) {
+                rotateFile();
+            }
+            if (_file) out = &_file;
+            break;
+        case CAPTURE_TCP:
+            if (_client && _client.connected()) out = &_client;
+            break;
+        case CAPTURE_SERIAL:
+            out = &Serial;
+            break;
+    }
+    if (out == nullptr) {
+        return false;
+    }
+
+    uint8_t header[16 + LORATAP_HEADER_LEN] = {0};
+    uint32_t captured = LORATAP_HEADER_LEN + record.len;
+    uint32_t seconds = record.timestampUs / 1000000;
+    uint32_t micros = record.timestampUs % 1000000;
+    memcpy(header, &seconds, 4);
+    memcpy(header + 4, &micros, 4);
+    memcpy(header + 8, &captured, 4);
+    memcpy(header + 12, &captured, 4);
+
+    // LoRaTap v1, многобайтовые поля big-endian
+    uint8_t* tap = header + 16;
+    uint8_t rssi = (uint8_t)constrain(record.rssi + 139, 0, 255);
+    tap[0] = 1;
+    putBE16(tap + 2, LORATAP_HEADER_LEN);
+    putBE32(tap + 4, record.frequency);
+    tap[8] = (uint8_t)lroundf(record.bandwidth / 125.0f);
+    tap[9] = record.sf;
+    tap[10] = rssi;                    // packet_rssi
+    tap[11] = rssi;                    // max_rssi
+    tap[12] = rssi;                    // current_rssi
+    tap[13] = (uint8_t)record.snrQuarter;
+    tap[14] = LORA_SYNC_WORD;
+    putBE32(tap + 19, getNodeId());    // source_gw (8 байт)
+    putBE32(tap + 23, (uint32_t)record.timestampUs);
+    tap[27] = record.flags;
+    tap[28] = record.cr;
+    putBE16(tap + 33, record.tx ? 1 : 0);
+
+    size_t total = sizeof(header) + record.len;
+    size_t written = out->write(header, sizeof(header));
+    written += out->write(record.data, record.len);
+    if (written != total) {
+        return false;
+    }
+    _fileBytes += total;
+    _stats.bytesWritten += total;
+    return true;
+}
+
+void PacketCapture::process() {
+    if (_reconfigure) {
+        _reconfigure = false;
+        closeSink();
+        _activeMode = _mode;
+        if (!openSink()) {
+            closeSink();
+            _mode = CAPTURE_OFF;
+        }
+    }
+
+    if (_activeMode == CAPTURE_TCP) {
+        WiFiClient client = _server.available();
+        if (client) {
+            // Новый клиент заменяет старого и получает свой заголовок pcap
+            if (_client) _client.stop();
+            _client = client;
+            _client.setNoDelay(true);
+            writeGlobalHeader(_client);
+            logger.println("Захват пакетов: клиент подключен");
+        }
+        _stats.clientConnected = _client && _client.connected();
+    }
+
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    uint32_t head = _head.load(std::memory_order_acquire);
+    uint8_t processed = 0;
+    while (tail != head && processed < 8) {
+        const CaptureRecord& record = _ring[tail % CAPTURE_RING_SLOTS];
+        if (_activeMode != CAPTURE_OFF) {
+            if (writeRecord(record)) {
+                _stats.captured++;
+            } else {
+                _stats.droppedSink++;
+            }
+        }
+        tail++;
+        _tail.store(tail, std::memory_order_release);
+        processed++;
+    }
+
+    if (_activeMode == CAPTURE_FILE && _file && millis() - _lastFlush >= 1000) {
+        _file.flush();
+        _lastFlush = millis();
+    }
+
+    if (processed == 0) {
+        vTaskDelay(pdMS_TO_TICKS(_activeMode == CAPTURE_OFF ? 200 : 20));
+    }
+}
+
+CaptureStats PacketCapture::getStats() const {
+    CaptureStats stats = _stats;
+    stats.droppedRing = _droppedRing.load(std::memory_order_relaxed);
+    return stats;
+}
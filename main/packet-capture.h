@@ -0,0 +1,99 @@
+#pragma once
+#include <Arduino.h>
+#include <GyverDB.h>
+#include <FS.h>
+#include <WiFi.h>
+#include <atomic>
+#include "esp32-config.h"
+#include "radio-events.h"
+
+// Режимы захвата
+#define CAPTURE_OFF    0
+#define CAPTURE_FILE   1  // Кольцо файлов CAPTURE_DIR/<n>.pcap на LittleFS
+#define CAPTURE_TCP    2  // Поток pcap клиенту TCP (nc <ip> 19000 | wireshark -k -i -)
+#define CAPTURE_SERIAL 3  // Поток pcap в Serial вместо текстового вывода
+
+// Число слотов кольца (степень двойки)
+#define CAPTURE_RING_SLOTS 32
+
+// Захваченный кадр
+struct CaptureRecord {
+    int64_t timestampUs;   // Время сети (time-sync), мкс
+    uint32_t frequency;
+    float bandwidth;       // kHz
+    int16_t rssi;
+    int8_t snrQuarter;     // SNR в шагах 0.25 dB
+    uint8_t sf;
+    uint8_t cr;
+    uint8_t flags;         // Флаги LoRaTap
+    bool tx;
+    uint8_t len;
+    uint8_t data[255];
+};
+
+// Метрики захвата
+struct CaptureStats {
+    uint32_t captured;      // Кадров записано
+    uint32_t droppedRing;   // Кольцо переполнено - кадр не попал в захват
+    uint32_t droppedSink;   // Не записано: ошибка файла или нет клиента TCP
+    uint32_t bytesWritten;
+    uint8_t files;
+    bool clientConnected;
+};
+
+// Захват RX/TX кадров в формате pcap (LINKTYPE_LORATAP = 270, заголовок LoRaTap v1).
+//
+// Источники (задачи радио) вызывают capture() под spi_lock_mutex, поэтому
+// производитель у кольца всегда один, потребитель - задача захвата. Кольцо
+// без блокировок: слоты фиксированного размера, индексы std::atomic
+// с порядком acquire/release. При заполнении кадр отбрасывается со счётчиком,
+// радио не ждёт запись на флеш или в сеть.
+//
+// Поле LoRaTap bandwidth задаётся в шагах 125 kHz, полосы уже 125 kHz
+// записываются как 0. Исходящие кадры помечаются tag = 1.
+class PacketCapture {
+public:
+    PacketCapture(GyverDB* db);
+
+    void initDefaults();
+    void applySettings();
+    bool isEnabled() const;
+
+    // Кадр радио; вызывается под spi_lock_mutex
+    void capture(bool tx, const uint8_t* data, size_t len, const PacketMeta& meta);
+
+    // Один шаг задачи захвата
+    void process();
+
+    CaptureStats getStats() const;
+
+private:
+    bool openSink();
+    void closeSink();
+    bool writeRecord(const CaptureRecord& record);
+    void writeGlobalHeader(Print& out);
+    void rotateFile();
+    String filePath(uint32_t index) const;
+
+    GyverDB* _db;
+    volatile int _mode;
+    volatile bool _reconfigure;
+    int _activeMode;
+
+    CaptureRecord _ring[CAPTURE_RING_SLOTS];
+    std::atomic<uint32_t> _head;   // Пишет производитель
+    std::atomic<uint32_t> _tail;   // Пишет потребитель
+
+    File _file;
+    uint32_t _fileIndex;
+    uint32_t _fileBytes;
+    uint32_t _lastFlush;
+    WiFiServer _server;
+    WiFiClient _client;
+
+    std::atomic<uint32_t> _droppedRing;
+    CaptureStats _stats;
+};
+
+// Глобальный экземпляр захвата
+extern PacketCapture* packetCapture;
@@ -0,0 +1,274 @@
+#include "param-switch.h"
+#include "config.h"
+#include <stdarg.h>
+
+ParamSwitch::ParamSwitch(ParamSwitchPort& port) : _port(port) {
+    _deferred = DEFER_NONE;
+    _state = IDLE;
+    _replySent = false;
+    _initiator = false;
+    _seq = 0;
+    _committedSeq = 0;
+    _attemptsLeft = 0;
+    _nextTxTime = 0;
+    _verifyStart = 0;
+    _rollbackCount = 0;
+}
+
+// Проверка допустимости параметров, пришедших от пира или из интерфейса
+bool ParamSwitch::isValid(const LoRaParams& params) {
+    return params.spreading >= 6 && params.spreading <= 12 &&
+           params.bandwidth >= 7.8f && params.bandwidth <= 500.0f &&
+           params.codingRate >= 5 && params.codingRate <= 8 &&
+           params.txPower >= 2 && params.txPower <= 20 &&
+           (params.implicitLength == 0 ||
+            (params.implicitLength >= LORA_IMPLICIT_MIN_LENGTH && params.implicitLength <= 255));
+}
+
+void ParamSwitch::lock() const {
+    _port.lockParamSwitch();
+}
+
+void ParamSwitch::unlock() {
+    Deferred deferred = _deferred;
+    LoRaParams params = _deferredParams;
+    _deferred = DEFER_NONE;
+    _port.unlockParamSwitch();
+    if (deferred == DEFER_APPLY) {
+        _port.applyParams(params);
+    } else if (deferred == DEFER_SAVE) {
+        _port.saveParams(params);
+    }
+}
+
+void ParamSwitch::log(bool warning, const char* format, ...) {
+    char text[96];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    _port.logParamSwitch(warning, text);
+}
+
+bool ParamSwitch::propose(const LoRaParams& current, const LoRaParams& next, uint8_t attempts, uint32_t now) {
+    lock();
+    if (_state != IDLE || !isValid(next)) {
+        unlock();
+        return false;
+    }
+
+    _old = current;
+    _next = next;
+    _seq = _port.randomSequence();
+    _initiator = true;
+    _attemptsLeft = attempts > 0 ? attempts : 1;
+    _nextTxTime = now;
+    _state = PROPOSING;
+
+    log(false, "Предложение новых параметров LoRa, seq %u", _seq);
+    unlock();
+    return true;
+}
+
+bool ParamSwitch::handleMessage(const char* msg, const LoRaParams& current, uint32_t now, char* reply, size_t size) {
+    reply[0] = '\0';
+    lock();
+    bool handled = handleLocked(msg, current, now, reply, size);
+    unlock();
+    return handled;
+}
+
+bool ParamSwitch::handleLocked(const char* msg, const LoRaParams& current, uint32_t now, char* reply, size_t size) {
+    if (strncmp(msg, "CFG:", 4) == 0) {
+        unsigned int seq = 0;
+        int crc = 0;
+        LoRaParams proposed;
+        proposed.implicitLength = 0;
+        // Старый формат без длины и CRC - явный заголовок без CRC
+        int fields = sscanf(msg + 4, "%u:%d:%f:%d:%d:%d:%d", &seq, &proposed.spreading,
+                            &proposed.bandwidth, &proposed.codingRate, &proposed.txPower,
+                            &proposed.implicitLength, &crc);
+        if (fields != 5 && fields != 7) {
+            return true;
+        }
+        proposed.crc = crc != 0;
+        if (!isValid(proposed) || seq == _committedSeq) {
+            return true;
+        }
+        // Встречное предложение: побеждает больший seq
+        if (_state == PROPOSING && seq <= _seq) {
+            return true;
+        }
+        if (_state != IDLE && _state != PROPOSING) {
+            return true;
+        }
+
+        _old = current;
+        _next = proposed;
+        _seq = seq;
+        _initiator = false;
+        _replySent = false;
+        _state = SWITCHING;
+        snprintf(reply, size, "CFA:%u", _seq);
+
+        log(false, "Пир предложил SF%d/%.2f kHz, seq %u", _next.spreading, _next.bandwidth, _seq);
+        return true;
+    }
+
+    if (strncmp(msg, "CFA:", 4) == 0) {
+        if (_state == PROPOSING && atoi(msg + 4) == _seq) {
+            switchToNext(now);
+        }
+        return true;
+    }
+
+    if (strncmp(msg, "CFC:", 4) == 0) {
+        // Ответчик подтверждает, что слышит инициатора на новых параметрах.
+        // Повторные CFC (если CFK потерялся) тоже получают ответ
+        int seq = atoi(msg + 4);
+        if (!_initiator && seq == _committedSeq && seq != 0) {
+            snprintf(reply, size, "CFK:%d", seq);
+        }
+        return true;
+    }
+
+    if (strncmp(msg, "CFK:", 4) == 0) {
+        if (_state == VERIFYING && _initiator && atoi(msg + 4) == _seq) {
+            finish(true);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void ParamSwitch::onTraffic(uint32_t now) {
+    lock();
+    // Инициатор ждёт явного CFK, ответчику достаточно любого кадра от пира
+    if (_state == VERIFYING && !_initiator) {
+        finish(true);
+    }
+    unlock();
+}
+
+bool ParamSwitch::poll(uint32_t now, char* out, size_t size) {
+    lock();
+    bool send = pollLocked(now, out, size);
+    unlock();
+    return send;
+}
+
+bool ParamSwitch::pollLocked(uint32_t now, char* out, size_t size) {
+    switch (_state) {
+        case SWITCHING:
+            // CFA ушёл в эфир - только теперь можно менять параметры радио
+            if (_replySent) {
+                switchToNext(now);
+            }
+            return false;
+
+        case PROPOSING:
+            if ((int32_t)(now - _nextTxTime) < 0) {
+                return false;
+            }
+            if (_attemptsLeft == 0) {
+                log(true, "Пир не ответил на предложение параметров, seq %u", _seq);
+                finish(false);
+                return false;
+            }
+            _attemptsLeft--;
+            _nextTxTime = now + PARAM_SWITCH_RETRY_MS;
+            snprintf(out, size, "CFG:%u:%d:%.2f:%d:%d:%d:%d", _seq, _next.spreading, _next.bandwidth,
+                     _next.codingRate, _next.txPower, _next.implicitLength, _next.crc ? 1 : 0);
+            return true;
+
+        case VERIFYING:
+            if (now - _verifyStart >= PARAM_SWITCH_ROLLBACK_MS) {
+                log(true, "Нет связи на новых параметрах, откат, seq %u", _seq);
+                finish(false);
+                return false;
+            }
+            if (_initiator && (int32_t)(now - _nextTxTime) >= 0) {
+                _nextTxTime = now + PARAM_SWITCH_RETRY_MS;
+                snprintf(out, size, "CFC:%u", _seq);
+                return true;
+            }
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+void ParamSwitch::onSent(bool ok) {
+    lock();
+    if (_state == SWITCHING) {
+        if (ok) {
+            _replySent = true;
+        } else {
+            // Без переключения: пир не получил CFA и останется на старых параметрах
+            _state = IDLE;
+        }
+    }
+    unlock();
+}
+
+// Применение и сохранение под блокировкой только назначаются, выполняет их unlock()
+void ParamSwitch::switchToNext(uint32_t now) {
+    _deferred = DEFER_APPLY;
+    _deferredParams = _next;
+    _state = VERIFYING;
+    _verifyStart = now;
+    _nextTxTime = now;
+}
+
+void ParamSwitch::finish(bool commit) {
+    if (commit) {
+        _deferred = DEFER_SAVE;
+        _deferredParams = _next;
+        _committedSeq = _seq;
+        log(false, "Новые параметры LoRa подтверждены, seq %u", _seq);
+    } else if (_state == VERIFYING) {
+        _deferred = DEFER_APPLY;
+        _deferredParams = _old;
+        _rollbackCount++;
+    }
+    _state = IDLE;
+}
+
+ParamSwitch::State ParamSwitch::getState() const {
+    lock();
+    State state = _state;
+    _port.unlockParamSwitch();
+    return state;
+}
+
+const char* ParamSwitch::getStateText() const {
+    switch (getState()) {
+        case PROPOSING: return "Ожидание согласия пира";
+        case SWITCHING: return "Переключение";
+        case VERIFYING: return "Проверка связи";
+        default:        return "Нет";
+    }
+}
+
+uint16_t ParamSwitch::getSequence() const {
+    lock();
+    uint16_t seq = _seq;
+    _port.unlockParamSwitch();
+    return seq;
+}
+
+LoRaParams ParamSwitch::getPendingParams() const {
+    lock();
+    LoRaParams params = _next;
+    _port.unlockParamSwitch();
+    return params;
+}
+
+uint32_t ParamSwitch::getRollbackCount() const {
+    lock();
+    uint32_t count = _rollbackCount;
+    _port.unlockParamSwitch();
+    return count;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Набор радиопараметров, которые должны совпадать на обоих концах линка
+struct LoRaParams {
+    int spreading;    // SF7..SF12
+    float bandwidth;  // kHz
+    int codingRate;   // 4/5..4/8
+    int txPower;      // dBm
+    int implicitLength; // 0 - явный заголовок, иначе неявный с фиксированной длиной кадра
+    bool crc;         // CRC полезной нагрузки
+};
+
+// Окружение протокола смены параметров: радио, блокировка, источник seq и
+// журнал. На устройстве его реализует LoRaManager, в тестах на хосте -
+// имитация радио (test/param-switch-test.cpp)
+class ParamSwitchPort {
+public:
+    // Применение параметров к радио без сохранения и сохранение подтверждённых.
+    // Вызываются после отпускания блокировки: применение ждёт spi_lock_mutex
+    // и окончания передачи
+    virtual void applyParams(const LoRaParams& params) = 0;
+    virtual void saveParams(const LoRaParams& params) = 0;
+
+    // Блокировка состояния ParamSwitch
+    virtual void lockParamSwitch() = 0;
+    virtual void unlockParamSwitch() = 0;
+
+    // Номер нового предложения, 1..65534
+    virtual uint16_t randomSequence() = 0;
+    virtual void logParamSwitch(bool warning, const char* text) = 0;
+};
+
+// Согласованная смена параметров LoRa на обоих узлах.
+//
+// Протокол (текстовые кадры, как HLO/ACK):
+//   CFG:<seq>:<sf>:<bw>:<cr>:<pwr>:<len>:<crc> - предложение, передаётся на старых параметрах
+//   CFA:<seq>                       - согласие; после его отправки пир переключается
+//   CFC:<seq>                       - проверка связи инициатором на новых параметрах
+//   CFK:<seq>                       - ответ на CFC, подтверждает переход
+// Если на новых параметрах за PARAM_SWITCH_ROLLBACK_MS не слышно трафика,
+// узел автоматически возвращается к старым параметрам.
+//
+// Класс не обращается к радио, часам и RTOS напрямую: время передаётся
+// параметром now, применение и сохранение параметров, блокировка и журнал -
+// через ParamSwitchPort, а отправку кадров выполняет вызывающая задача.
+//
+// Состояние под блокировкой порта: propose() и геттеры вызывает веб-интерфейс,
+// handleMessage()/poll() - задача приёма, onSent() - колбэк передачи.
+class ParamSwitch {
+public:
+    enum State : uint8_t {
+        IDLE = 0,   // Переключение не выполняется
+        PROPOSING,  // Инициатор ждёт CFA
+        SWITCHING,  // Ответчик отправляет CFA и переключится после передачи
+        VERIFYING   // Новые параметры применены, ждём трафик
+    };
+
+    // Размер буфера кадра для handleMessage()/poll()
+    static const size_t FRAME_SIZE = 64;
+
+    explicit ParamSwitch(ParamSwitchPort& port);
+
+    // Начать переключение (инициатор). attempts - число отправок CFG
+    bool propose(const LoRaParams& current, const LoRaParams& next, uint8_t attempts, uint32_t now);
+
+    // Обработка принятого кадра. Возвращает true, если кадр относится к протоколу;
+    // reply (size байт) заполняется, если нужно отправить ответ, иначе пустой
+    bool handleMessage(const char* msg, const LoRaParams& current, uint32_t now, char* reply, size_t size);
+
+    // Любой принятый кадр: на новых параметрах это признак рабочей связи
+    void onTraffic(uint32_t now);
+
+    // Периодическая обработка: повторы и таймауты. true - нужно отправить out
+    bool poll(uint32_t now, char* out, size_t size);
+
+    // Окончание передачи ответа из handleMessage (колбэк RadioTx). После CFA
+    // ответчик переключается в следующем poll(); кадр не ушёл - предложение
+    // отклоняется, повтор CFG от инициатора начнёт его заново
+    void onSent(bool ok);
+
+    State getState() const;
+    const char* getStateText() const;
+    uint16_t getSequence() const;
+    LoRaParams getPendingParams() const;
+    uint32_t getRollbackCount() const;
+
+    static bool isValid(const LoRaParams& params);
+
+private:
+    enum Deferred : uint8_t {
+        DEFER_NONE = 0,
+        DEFER_APPLY,
+        DEFER_SAVE
+    };
+
+    void lock() const;
+    // Отпускание блокировки и вызов отложенного применения или сохранения
+    void unlock();
+    bool handleLocked(const char* msg, const LoRaParams& current, uint32_t now, char* reply, size_t size);
+    bool pollLocked(uint32_t now, char* out, size_t size);
+    void switchToNext(uint32_t now);
+    void finish(bool commit);
+    void log(bool warning, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+    ParamSwitchPort& _port;
+    Deferred _deferred;           // Действие до unlock(), с параметрами _deferredParams
+    LoRaParams _deferredParams;
+
+    State _state;
+    bool _replySent;              // CFA передан, ответчик может переключаться
+    bool _initiator;
+    uint16_t _seq;
+    uint16_t _committedSeq;
+    LoRaParams _old;
+    LoRaParams _next;
+    uint8_t _attemptsLeft;
+    uint32_t _nextTxTime;
+    uint32_t _verifyStart;
+    uint32_t _rollbackCount;
+};
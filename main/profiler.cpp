@@ -0,0 +1,291 @@
+#include "profiler.h"
+#include "system-monitor.h"
+#include "logging.h"
+#include <esp_ipc.h>
+#include <esp_debug_helpers.h>
+#include <soc/soc_memory_layout.h>
+#include <freertos/xtensa_context.h>
+#include <algorithm>
+
+Profiler* profiler = nullptr;
+
+// Отсчёт в кольце - слова: задача, глубина, стек[глубина] (PC и адреса возврата)
+#define PROFILER_HEADER_WORDS 2
+// Прореживание не больше чем до каждого 64-го тика
+#define PROFILER_MAX_SKIP     64
+
+struct ProfilerCore {
+    hw_timer_t* timer;
+    uint32_t* ring;
+    uint16_t* order;            // Индексы для сортировки при выгрузке
+    volatile uint32_t head;     // Отсчётов в кольце с последней выгрузки (пишет только прерывание ядра)
+    volatile uint32_t total;    // Отсчётов с запуска
+    uint32_t ticks;             // Тиков таймера в текущей секунде
+    uint32_t skip;              // Отсчёт на каждый skip-й тик
+    uint32_t windowCycles;      // Тактов на отсчёты в текущей секунде
+    uint32_t windowSamples;
+    uint32_t costCycles;        // Итоги прошлой секунды
+    uint32_t overheadPermille;
+};
+
+static ProfilerCore profilerCores[portNUM_PROCESSORS];
+static volatile bool profilerPaused = false;
+// Параметры запуска; прерывания читают их только между start() и stop()
+static uint32_t profilerRate = 0;
+static uint32_t profilerStride = 0;
+static uint32_t profilerCapacity = 0;
+static uint8_t profilerDepth = 0;
+static uint32_t profilerBudgetPermille = 0;
+static uint32_t profilerCyclesPerMs = 0;
+
+static void IRAM_ATTR profilerTick() {
+    uint32_t startCycles = ESP.getCycleCount();
+    int coreId = xPortGetCoreID();
+    ProfilerCore& core = profilerCores[coreId];
+
+    if (!profilerPaused && ++core.ticks % core.skip == 0) {
+        // При входе в прерывание порт сохраняет кадр прерванной задачи
+        // и пишет указатель на него в pxTopOfStack - первое поле TCB
+        TaskHandle_t task = xTaskGetCurrentTaskHandleForCPU(coreId);
+        const XtExcFrame* frame = task ? *(const XtExcFrame* const*)task : nullptr;
+        if (frame && esp_stack_ptr_is_sane((uint32_t)(uintptr_t)frame)) {
+            uint32_t* slot = core.ring + (core.head % profilerCapacity) * profilerStride;
+            uint32_t* stack = slot + PROFILER_HEADER_WORDS;
+            uint32_t depth = 0;
+            stack[depth++] = (uint32_t)frame->pc;
+
+            esp_backtrace_frame_t bt;
+            bt.pc = (uint32_t)frame->pc;
+            bt.sp = (uint32_t)frame->a1;
+            bt.next_pc = (uint32_t)frame->a0;
+            while (depth < profilerDepth && bt.next_pc != 0 && esp_backtrace_get_next_frame(&bt)) {
+                stack[depth++] = backtraceReturnPc(bt.pc);
+            }
+            // Хвост обнуляется: при выгрузке отсчёты сравниваются целиком
+            for (uint32_t i = depth; i < profilerDepth; i++) {
+                stack[i] = 0;
+            }
+            slot[0] = (uint32_t)(uintptr_t)task;
+            slot[1] = depth;
+            core.head = core.head + 1;
+            core.total = core.total + 1;
+        }
+        core.windowSamples++;
+        core.windowCycles += ESP.getCycleCount() - startCycles;
+    }
+
+    // Раз в секунду: накладные расходы и прореживание (без float - FPU в прерывании недоступен)
+    if (core.ticks >= profilerRate) {
+        uint32_t permille = core.windowCycles / profilerCyclesPerMs;
+        core.overheadPermille = permille;
+        core.costCycles = core.windowSamples ? core.windowCycles / core.windowSamples : 0;
+        if (permille > profilerBudgetPermille && core.skip < PROFILER_MAX_SKIP) {
+            core.skip *= 2;
+        } else if (permille * 4 < profilerBudgetPermille && core.skip > 1) {
+            core.skip /= 2;
+        }
+        core.ticks = 0;
+        core.windowCycles = 0;
+        core.windowSamples = 0;
+    }
+}
+
+// Прерывание таймера выделяется на ядре, где вызван timerAttachInterrupt
+static void profilerAttach(void* arg) {
+    int coreId = xPortGetCoreID();
+    ProfilerCore& core = profilerCores[coreId];
+    core.timer = timerBegin(PROFILER_TIMER_FIRST + coreId, 80, true);  // 1 MHz от APB
+    timerAttachInterrupt(core.timer, profilerTick, true);
+    timerAlarmWrite(core.timer, 1000000 / profilerRate, true);
+    timerAlarmEnable(core.timer);
+}
+
+// Освобождать прерывание нужно на том же ядре
+static void profilerDetach(void* arg) {
+    ProfilerCore& core = profilerCores[xPortGetCoreID()];
+    if (core.timer) {
+        timerEnd(core.timer);
+        core.timer = nullptr;
+    }
+}
+
+Profiler::Profiler(GyverDB* db) : _db(db) {
+    _running = false;
+    _lock = xSemaphoreCreateMutex();
+    memset(profilerCores, 0, sizeof(profilerCores));
+}
+
+void Profiler::initDefaults() {
+    _db->init(DB_NAMESPACE::prof_enabled, false);
+    _db->init(DB_NAMESPACE::prof_rate, PROFILER_DEFAULT_RATE_HZ);
+    _db->init(DB_NAMESPACE::prof_depth, PROFILER_DEFAULT_DEPTH);
+    _db->init(DB_NAMESPACE::prof_samples, PROFILER_DEFAULT_SAMPLES);
+    _db->init(DB_NAMESPACE::prof_overhead, PROFILER_DEFAULT_OVERHEAD);
+}
+
+void Profiler::applySettings() {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    stop();
+    if (_db->get(DB_NAMESPACE::prof_enabled).toBool()) {
+        start(constrain(_db->get(DB_NAMESPACE::prof_rate).toInt(), 1, PROFILER_MAX_RATE_HZ),
+              constrain(_db->get(DB_NAMESPACE::prof_depth).toInt(), 1, PROFILER_MAX_DEPTH),
+              constrain(_db->get(DB_NAMESPACE::prof_samples).toInt(), 16, PROFILER_MAX_SAMPLES),
+              constrain(_db->get(DB_NAMESPACE::prof_overhead).toInt(), 1, 50));
+    }
+    xSemaphoreGive(_lock);
+}
+
+bool Profiler::isRunning() const {
+    return _running;
+}
+
+void Profiler::start(uint32_t rate, uint8_t depth, uint32_t capacity, uint8_t overhead) {
+    profilerRate = rate;
+    profilerDepth = depth;
+    profilerStride = PROFILER_HEADER_WORDS + depth;
+    profilerCapacity = capacity;
+    profilerBudgetPermille = overhead * 10;
+    profilerCyclesPerMs = getCpuFrequencyMhz() * 1000;
+
+    // Кольца выделяются на время работы: размер задаётся в настройках
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        ProfilerCore& core = profilerCores[i];
+        core.ring = (uint32_t*)malloc(capacity * profilerStride * sizeof(uint32_t));
+        core.order = (uint16_t*)malloc(capacity * sizeof(uint16_t));
+        core.head = 0;
+        core.total = 0;
+        core.ticks = 0;
+        core.skip = 1;
+        core.windowCycles = 0;
+        core.windowSamples = 0;
+        core.costCycles = 0;
+        core.overheadPermille = 0;
+        if (!core.ring || !core.order) {
+            logger.println(error_() + "Профилировщик: нет памяти на кольца (" +
+                           String(capacity * (profilerStride * 4 + 2) / 1024) + " kB на ядро)");
+            _running = true;  // stop() освободит выделенное
+            stop();
+            return;
+        }
+    }
+
+    profilerPaused = false;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        esp_ipc_call_blocking(i, profilerAttach, nullptr);
+    }
+    _running = true;
+    logger.println("Профилировщик: " + String(rate) + " Hz, глубина " + String(depth) + ", " +
+                   String(capacity) + " отсчётов на ядро");
+}
+
+void Profiler::stop() {
+    if (!_running) {
+        return;
+    }
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        esp_ipc_call_blocking(i, profilerDetach, nullptr);
+        free(profilerCores[i].ring);
+        free(profilerCores[i].order);
+        profilerCores[i].ring = nullptr;
+        profilerCores[i].order = nullptr;
+    }
+    _running = false;
+}
+
+ProfilerStats Profiler::getStats() const {
+    ProfilerStats stats = {_running, 0, 0, 0, 0, 0, 0.0f};
+    if (!_running) {
+        return stats;
+    }
+    uint32_t skip = 1;
+    uint32_t permille = 0;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        const ProfilerCore& core = profilerCores[i];
+        stats.samples += core.total;
+        stats.buffered += min((uint32_t)core.head, profilerCapacity);
+        stats.costCycles = max(stats.costCycles, core.costCycles);
+        skip = max(skip, core.skip);
+        permille = max(permille, core.overheadPermille);
+    }
+    stats.capacity = profilerCapacity * portNUM_PROCESSORS;
+    stats.rateHz = profilerRate / skip;
+    stats.overhead = permille / 10.0f;
+    return stats;
+}
+
+void profileTaskName(uint32_t task, char* name, size_t size) {
+    SystemMonitor::TaskInfo info;
+    bool found = false;
+    if (systemMonitor) {
+        found = systemMonitor->getTaskInfoByHandle((TaskHandle_t)(uintptr_t)task, info);
+    }
+    if (found) {
+        strncpy(name, info.name, size - 1);
+        name[size - 1] = '\0';
+        for (char* c = name; *c; c++) {
+            if (*c == ';' || *c == ' ') {
+                *c = '_';
+            }
+        }
+    } else {
+        snprintf(name, size, "task_%08lx", (unsigned long)task);
+    }
+}
+
+size_t writeFoldedStack(Print& out, uint32_t task, const uint32_t* stack, uint32_t depth, uint32_t value) {
+    // Строка: имя задачи и до PROFILER_MAX_DEPTH адресов по 11 символов
+    char line[24 + PROFILER_MAX_DEPTH * 11 + 12];
+    profileTaskName(task, line, 20);
+    size_t len = strlen(line);
+    // От внешнего вызова к листу
+    for (uint32_t d = min(depth, (uint32_t)PROFILER_MAX_DEPTH); d > 0; d--) {
+        len += snprintf(line + len, sizeof(line) - len, ";0x%08lx", (unsigned long)stack[d - 1]);
+    }
+    len += snprintf(line + len, sizeof(line) - len, " %lu\n", (unsigned long)value);
+    return out.write((const uint8_t*)line, len);
+}
+
+size_t Profiler::writeFolded(Print& out) {
+    // Кольца не перевыделяются, пока идёт выгрузка
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (!_running) {
+        xSemaphoreGive(_lock);
+        return 0;
+    }
+    // Пауза: прерывания не пишут в кольца, пока они сортируются и выводятся
+    profilerPaused = true;
+    vTaskDelay(pdMS_TO_TICKS(2));
+
+    size_t written = 0;
+    const uint32_t stride = profilerStride;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        ProfilerCore& core = profilerCores[i];
+        uint32_t count = min((uint32_t)core.head, profilerCapacity);
+        const uint32_t* ring = core.ring;
+        for (uint32_t n = 0; n < count; n++) {
+            core.order[n] = n;
+        }
+        // Одинаковые отсчёты становятся соседними и сворачиваются в одну строку со счётчиком
+        std::sort(core.order, core.order + count, [ring, stride](uint16_t a, uint16_t b) {
+            return memcmp(ring + a * stride, ring + b * stride, stride * sizeof(uint32_t)) < 0;
+        });
+
+        uint32_t n = 0;
+        while (n < count) {
+            const uint32_t* slot = ring + core.order[n] * stride;
+            uint32_t same = 1;
+            while (n + same < count &&
+                   memcmp(slot, ring + core.order[n + same] * stride, stride * sizeof(uint32_t)) == 0) {
+                same++;
+            }
+            n += same;
+
+            written += writeFoldedStack(out, slot[0], slot + PROFILER_HEADER_WORDS, slot[1], same);
+        }
+        core.head = 0;
+    }
+
+    profilerPaused = false;
+    xSemaphoreGive(_lock);
+    return written;
+}
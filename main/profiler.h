@@ -0,0 +1,71 @@
+#pragma once
+#include <Arduino.h>
+#include <GyverDB.h>
+#include <freertos/semphr.h>
+#include "config.h"
+#include "esp32-config.h"
+
+// Метрики профилировщика (по всем ядрам)
+struct ProfilerStats {
+    bool running;
+    uint32_t samples;       // Отсчётов снято с запуска
+    uint32_t buffered;      // Отсчётов в кольцах сейчас
+    uint32_t capacity;      // Отсчётов в кольцах всех ядер
+    uint32_t rateHz;        // Действующая частота отсчётов ядра (после прореживания)
+    uint32_t costCycles;    // Стоимость отсчёта в прерывании, такты
+    float overhead;         // Доля ядра на отсчёты за последнюю секунду, %
+};
+
+// Сэмплирующий профилировщик CPU.
+//
+// Аппаратный таймер на каждом ядре (PROFILER_TIMER_FIRST + ядро, прерывание
+// выделяется на своём ядре через esp_ipc) снимает PC прерванного кода и
+// несколько адресов возврата - кадр прерванной задачи порт FreeRTOS сохраняет
+// в pxTopOfStack её TCB. Отсчёт - задача и стек - пишется в кольцо своего ядра,
+// старые затираются. Код в критических секциях виден с опозданием: прерывание
+// придёт после выхода из секции.
+//
+// Если отсчёты занимают больше заданной доли ядра, прерывание прореживает их
+// (берёт каждый 2-й, 4-й, ...) и возвращает частоту, когда нагрузка спадает.
+//
+// Выгрузка - свёрнутые стеки (folded stacks) с адресами: "задача;вызывающий;...;PC N".
+// Адреса переводятся в имена функций по ELF на хосте: tools/profile_fold.py,
+// затем flamegraph.pl или speedscope. Выгрузка очищает кольца.
+class Profiler {
+public:
+    Profiler(GyverDB* db);
+
+    void initDefaults();
+    // Частота, глубина стека, размер кольца и предел накладных расходов из базы;
+    // перезапускает таймеры и заново выделяет кольца
+    void applySettings();
+    bool isRunning() const;
+
+    ProfilerStats getStats() const;
+
+    // Свёрнутые стеки всех ядер; на время выгрузки отсчёты не снимаются
+    size_t writeFolded(Print& out);
+
+private:
+    void start(uint32_t rate, uint8_t depth, uint32_t capacity, uint8_t overhead);
+    void stop();
+
+    GyverDB* _db;
+    SemaphoreHandle_t _lock;   // Перезапуск и выгрузка
+    bool _running;
+};
+
+extern Profiler* profiler;
+
+// Адрес возврата оконного ABI: в старших битах - размер окна вызова;
+// минус 3 - адрес самой инструкции call
+inline uint32_t backtraceReturnPc(uint32_t pc) {
+    return ((pc & 0x3fffffff) | 0x40000000) - 3;
+}
+
+// Имя задачи по дескриптору для профилей; ';' и пробел заменены на '_'
+void profileTaskName(uint32_t task, char* name, size_t size);
+
+// Строка свёрнутого стека "задача;внешний;...;лист value"; stack - от листа
+// (stack[0] - PC или место вызова). Общая для профилей CPU и кучи
+size_t writeFoldedStack(Print& out, uint32_t task, const uint32_t* stack, uint32_t depth, uint32_t value);
@@ -0,0 +1,106 @@
+#include "radio-events.h"
+#include "config.h"
+#include "sx127x.h"
+#include "esp_timer.h"
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_txArmed = false;
+static volatile int64_t s_rxDoneUs = 0;
+static volatile int64_t s_txStartUs = 0;
+static volatile int64_t s_txDoneUs = 0;
+static uint32_t s_fallbackCount = 0;
+// Отдаётся прерыванием TxDone; задача передачи ждёт на нём вместо опроса регистра
+static SemaphoreHandle_t s_txDone = nullptr;
+
+// Прерывание DIO0: только метка времени. SPI здесь не трогаем -
+// шина принадлежит задачам под spi_lock_mutex
+static void IRAM_ATTR onDio0Rise() {
+    int64_t now = esp_timer_get_time();
+    bool txDone = false;
+    portENTER_CRITICAL_ISR(&s_mux);
+    if (s_txArmed) {
+        s_txDoneUs = now;
+        s_txArmed = false;
+        txDone = true;
+    } else {
+        s_rxDoneUs = now;
+    }
+    portEXIT_CRITICAL_ISR(&s_mux);
+
+    if (txDone && s_txDone) {
+        BaseType_t woken = pdFALSE;
+        xSemaphoreGiveFromISR(s_txDone, &woken);
+        if (woken) portYIELD_FROM_ISR();
+    }
+}
+
+void setupRadioEvents() {
+    s_txDone = xSemaphoreCreateBinary();
+    pinMode(LoRaBoardPins::dio0, INPUT);
+    attachInterrupt(digitalPinToInterrupt(LoRaBoardPins::dio0), onDio0Rise, RISING);
+}
+
+int64_t radioTakeRxDoneUs() {
+    portENTER_CRITICAL(&s_mux);
+    int64_t stamp = s_rxDoneUs;
+    s_rxDoneUs = 0;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (stamp == 0) {
+        s_fallbackCount++;
+        return esp_timer_get_time();
+    }
+    return stamp;
+}
+
+void radioBeginTx() {
+    radio.writeRegister(sx127x::REG_DIO_MAPPING_1, sx127x::DIO0_TX_DONE);
+    // Отдача от прошлой передачи, если её уже дождались опросом
+    if (s_txDone) xSemaphoreTake(s_txDone, 0);
+    portENTER_CRITICAL(&s_mux);
+    s_txArmed = true;
+    s_txStartUs = esp_timer_get_time();
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool radioWaitTxDone(uint32_t timeoutMs) {
+    return s_txDone && xSemaphoreTake(s_txDone, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+int64_t radioEndTx() {
+    radio.writeRegister(sx127x::REG_DIO_MAPPING_1, sx127x::DIO0_RX_DONE);
+    portENTER_CRITICAL(&s_mux);
+    bool missed = s_txArmed;
+    s_txArmed = false;
+    if (missed) {
+        // Фронт не пойман - берём момент, когда TxDone увидели опросом регистра
+        s_txDoneUs = esp_timer_get_time();
+    }
+    int64_t stamp = s_txDoneUs;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (missed) s_fallbackCount++;
+    return stamp;
+}
+
+int64_t radioLastTxStartUs() {
+    portENTER_CRITICAL(&s_mux);
+    int64_t stamp = s_txStartUs;
+    portEXIT_CRITICAL(&s_mux);
+    return stamp;
+}
+
+int64_t radioLastTxDoneUs() {
+    portENTER_CRITICAL(&s_mux);
+    int64_t stamp = s_txDoneUs;
+    portEXIT_CRITICAL(&s_mux);
+    return stamp;
+}
+
+uint32_t radioFallbackCount() {
+    return s_fallbackCount;
+}
+
+bool radioSignalDetected() {
+    return (radio.readRegister(sx127x::REG_MODEM_STAT) & sx127x::MODEM_STAT_SIGNAL) != 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <Arduino.h>
+
+// Метки времени событий радиомодуля (мкс, esp_timer), снятые в прерывании DIO0.
+//
+// После сброса SX127x DIO0 отображается на RxDone. На время передачи radioBeginTx()
+// переключает DIO0 на TxDone (регистр RegDioMapping1), radioEndTx() возвращает
+// RxDone. Прерывание TxDone к тому же будит задачу передачи (radioWaitTxDone),
+// так что на время эфира ядро свободно.
+
+// Метаданные принятого или переданного кадра
+struct PacketMeta {
+    int64_t rxDoneUs;   // RxDone (0 для исходящих)
+    int64_t txStartUs;  // Запуск передачи (0 для входящих)
+    int64_t txDoneUs;   // TxDone (0 для входящих)
+    int rssi;
+    float snr;
+};
+
+// Подключение прерывания DIO0; вызывается после radio.begin()
+void setupRadioEvents();
+
+// Метка RxDone принятого кадра. Если прерывание не пришло (кадр был в FIFO
+// до подключения или метку уже забрали), возвращается текущее время
+int64_t radioTakeRxDoneUs();
+
+// Обрамление передачи вокруг radio.startTransmit(); мьютекс SPI захвачен вызывающей задачей.
+// radioWaitTxDone() блокирует задачу до прерывания TxDone (false - таймаут) и SPI
+// не трогает, ждать можно без мьютекса. Флаг TxDone в модеме сбрасывает вызывающий
+// (radio.isTxDone()). radioEndTx() возвращает метку TxDone из прерывания
+void radioBeginTx();
+bool radioWaitTxDone(uint32_t timeoutMs);
+int64_t radioEndTx();
+
+int64_t radioLastTxStartUs();
+int64_t radioLastTxDoneUs();
+
+// Модем сейчас принимает кадр (преамбула или заголовок); мьютекс SPI захвачен
+bool radioSignalDetected();
+
+// Сколько меток пришлось взять опросом вместо прерывания
+uint32_t radioFallbackCount();
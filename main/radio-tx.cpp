@@ -0,0 +1,185 @@
+#include "radio-tx.h"
+#include "config.h"
+#include "logging.h"
+#include "sx127x.h"
+#include "radio-events.h"
+#include "lora-manager.h"
+#include "lora-airtime.h"
+#include "packet-capture.h"
+#include "esp_timer.h"
+#include "trace.h"
+#include "log-ring.h"
+#include "metrics.h"
+
+RadioTx radioTx;
+
+// Метрики реестра: счётчики пишут submit() (из любой задачи) и задача передачи
+static Counter txSubmitted("lora_tx_submitted", "Frames queued for transmission");
+static Counter txRejected("lora_tx_rejected", "Frames rejected, TX queue full");
+static Counter txAnnounced("lora_tx_announced", "Long explicit-header frames announced with EXP");
+static Counter txFailed("lora_tx_failed", "Transmissions failed: SPI mutex or TxDone timeout");
+static Counter txCompleted("lora_tx_completed", "Frames transmitted");
+
+RadioTx::RadioTx() {
+    _queue = nullptr;
+    _inFlight = false;
+    _inFlightSinceUs = 0;
+    _latencySumUs = 0;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void RadioTx::begin() {
+    _queue = xQueueCreate(RADIO_TX_QUEUE_LEN, sizeof(Job));
+}
+
+bool RadioTx::submit(const uint8_t* data, size_t len, RadioTxCallback callback, uint32_t tag, int64_t refUs) {
+    Job job;
+    job.len = min(len, sizeof(job.data));
+    memcpy(job.data, data, job.len);
+    job.frequency = loraManager->getFrequency();
+    job.callback = callback;
+    job.tag = tag;
+    job.refUs = refUs;
+    job.submitUs = esp_timer_get_time();
+
+    if (_queue == nullptr || xQueueSend(_queue, &job, 0) != pdTRUE) {
+        txRejected.inc();
+        LOGW(LOG_SINK_WEB, "Очередь передачи заполнена, кадр отброшен");
+        RadioTxResult result = {false, tag, refUs, 0, 0, 0};
+        if (callback) callback(result);
+        return false;
+    }
+    txSubmitted.inc();
+    return true;
+}
+
+bool RadioTx::submit(const String& frame, RadioTxCallback callback, uint32_t tag, int64_t refUs) {
+    return submit((const uint8_t*)frame.c_str(), frame.length(), callback, tag, refUs);
+}
+
+void RadioTx::process() {
+    Job job;
+    if (_queue == nullptr || xQueueReceive(_queue, &job, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return;
+    }
+
+    RadioTxResult result = {false, job.tag, job.refUs, 0, 0, 0};
+    // Кадр длиннее кадра неявного заголовка уходит с явным; перед ним - неявный
+    // EXP с его длиной, по которому приёмник переходит в явный режим
+    int implicitLength = loraManager->getImplicitLength();
+    uint32_t announceUs = 0;
+    if (implicitLength > 0 && job.len > implicitLength) {
+        char announce[16];
+        int length = snprintf(announce, sizeof(announce), "EXP:%u", (unsigned int)job.len);
+        if (!transmit(job, (const uint8_t*)announce, length, implicitLength, result)) {
+            complete(job, result);
+            return;
+        }
+        txAnnounced.inc();
+        announceUs = result.airtimeUs;
+        vTaskDelay(pdMS_TO_TICKS(LORA_EXPLICIT_GAP_MS));
+        implicitLength = 0;
+    }
+    // Эфир кадра вместе с EXP: на него расходуется бюджет занятости
+    if (transmit(job, job.data, job.len, implicitLength, result)) {
+        result.airtimeUs += announceUs;
+    }
+    complete(job, result);
+}
+
+bool RadioTx::transmit(const Job& job, const uint8_t* data, size_t len, int implicitLength, RadioTxResult& result) {
+    result.ok = false;
+    if (!spiLock(pdMS_TO_TICKS(5000))) {
+        LOGE(LOG_SINK_WEB, "Передача: не удалось захватить мьютекс");
+        txFailed.inc();
+        return false;
+    }
+
+    // Кадр неявного заголовка дополняется нулями до фиксированной длины
+    uint8_t frame[255];
+    memcpy(frame, data, len);
+    if (implicitLength > 0) {
+        memset(frame + len, 0, sizeof(frame) - len);
+        len = implicitLength;
+    }
+
+    if (radio.getFrequency() != job.frequency) {
+        radio.idle();
+        radio.setFrequency(job.frequency);
+    }
+    SpiStats spiStart = radio.getSpiStats();
+    TRACE_INSTANT(TRACE_RADIO_TX, len);
+    radioBeginTx();
+    radio.startTransmit(frame, len, implicitLength > 0);
+    _inFlightSinceUs = esp_timer_get_time();
+    _inFlight = true;
+    _stats.lastWaitUs = (uint32_t)(_inFlightSinceUs - job.submitUs);
+    LoRaParams params = loraManager->getParams();
+    params.implicitLength = implicitLength;
+    uint32_t timeoutMs = loraFrameAirtimeUs(params, len) / 1000 + LORA_TX_TIMEOUT_MARGIN_MS;
+    spiUnlock();
+
+    // Эфир идёт без мьютекса, задача спит до прерывания TxDone
+    bool interrupt = radioWaitTxDone(timeoutMs);
+
+    // Завершение обязательно: без него модем остался бы в передаче
+    spiLock(portMAX_DELAY);
+    bool done = radio.isTxDone() || interrupt;
+    TRACE_INSTANT(TRACE_RADIO_TX_DONE, done);
+    if (!done) {
+        radio.idle();
+    }
+    radio.notePacket(true, spiStart, len);
+    PacketMeta meta = {0, radioLastTxStartUs(), radioEndTx(), 0, 0.0f};
+    _inFlight = false;
+    // Перестройка во время эфира была отложена - возврат на частоту приёма
+    long home = loraManager->getFrequency();
+    if (radio.getFrequency() != home) {
+        radio.idle();
+        radio.setFrequency(home);
+    }
+    packetCapture->capture(true, frame, len, meta);
+    spiUnlock();
+
+    if (!done) {
+        LOGW(LOG_SINK_WEB, "TxDone не получен за %u мс", timeoutMs);
+        txFailed.inc();
+    }
+    result.ok = done;
+    result.txStartUs = meta.txStartUs;
+    result.txDoneUs = done ? meta.txDoneUs : 0;
+    result.airtimeUs = (uint32_t)(meta.txDoneUs - meta.txStartUs);
+    return done;
+}
+
+void RadioTx::complete(const Job& job, RadioTxResult& result) {
+    if (result.ok) {
+        // Задержка завершения: от прерывания TxDone до вызова колбэка
+        uint32_t latency = (uint32_t)(esp_timer_get_time() - result.txDoneUs);
+        txCompleted.inc();
+        _stats.lastLatencyUs = latency;
+        _stats.maxLatencyUs = max(_stats.maxLatencyUs, latency);
+        _latencySumUs += latency;
+        _stats.avgLatencyUs = _latencySumUs / txCompleted.value();
+    }
+    if (job.callback) {
+        job.callback(result);
+    }
+}
+
+bool RadioTx::isInFlight() const {
+    return _inFlight;
+}
+
+RadioTxStats RadioTx::getStats() const {
+    RadioTxStats stats = _stats;
+    stats.submitted = txSubmitted.value();
+    stats.completed = txCompleted.value();
+    stats.rejected = txRejected.value();
+    stats.announced = txAnnounced.value();
+    stats.failed = txFailed.value();
+    stats.queued = _queue ? uxQueueMessagesWaiting(_queue) : 0;
+    stats.inFlight = _inFlight;
+    stats.inFlightUs = _inFlight ? (uint32_t)(esp_timer_get_time() - _inFlightSinceUs) : 0;
+    return stats;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+// Результат передачи кадра
+struct RadioTxResult {
+    bool ok;             // false - очередь заполнена, мьютекс не получен или TxDone не пришёл
+    uint32_t tag;        // Значение вызывающего (ID пакета, seq запроса)
+    int64_t refUs;       // Метка вызывающего (например, RxDone запроса для оборота ACK)
+    int64_t txStartUs;
+    int64_t txDoneUs;    // 0, если кадр не передан
+    uint32_t airtimeUs;
+};
+
+// Завершение передачи. Вызывается без spi_lock_mutex из задачи передачи, а при
+// отказе в постановке - сразу из submit(), где мьютекс может быть захвачен
+// вызывающим. Поэтому колбэк не захватывает spi_lock_mutex и не блокирует
+typedef void (*RadioTxCallback)(const RadioTxResult& result);
+
+// Метрики передачи. Счётчики - из реестра метрик (lora_tx_*), остальное -
+// задержки и состояние задачи передачи
+struct RadioTxStats {
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t rejected;       // Очередь заполнена
+    uint32_t announced;      // Длинных кадров с явным заголовком после EXP (неявный режим)
+    uint32_t failed;         // Мьютекс не получен или TxDone не пришёл
+    uint8_t queued;          // Кадров ждёт в очереди
+    bool inFlight;           // Радио сейчас в эфире
+    uint32_t inFlightUs;     // Сколько длится текущая передача
+    uint32_t lastWaitUs;     // Постановка в очередь -> запуск TX
+    uint32_t lastLatencyUs;  // Прерывание TxDone -> вызов колбэка
+    uint32_t avgLatencyUs;
+    uint32_t maxLatencyUs;
+};
+
+// Асинхронная передача кадров.
+//
+// submit() кладёт кадр в очередь и сразу возвращается. Задача передачи под
+// spi_lock_mutex пишет FIFO и запускает TX, после чего отпускает мьютекс: на время
+// эфира шина свободна для дисплея и сканера. Окончание приходит прерыванием
+// TxDone (radio-events), задача на короткое время снова берёт мьютекс, возвращает
+// модем на частоту приёма и вызывает колбэк.
+//
+// Пока кадр в эфире (isInFlight()), остальные задачи не трогают модем, хотя
+// мьютекс им доступен: приём и сканирование пропускают шаг, перестройка частоты
+// откладывается до TxDone. Кадр уходит на частоте приёма на момент submit(),
+// поэтому перестройка сразу после постановки ответа его не задевает.
+class RadioTx {
+public:
+    RadioTx();
+
+    void begin();
+
+    // Постановка кадра; false - очередь заполнена (колбэк уже вызван с ok = false)
+    bool submit(const uint8_t* data, size_t len, RadioTxCallback callback = nullptr,
+                uint32_t tag = 0, int64_t refUs = 0);
+    bool submit(const String& frame, RadioTxCallback callback = nullptr,
+                uint32_t tag = 0, int64_t refUs = 0);
+
+    // Один шаг задачи передачи: ожидание кадра, передача, завершение
+    void process();
+
+    bool isInFlight() const;
+    RadioTxStats getStats() const;
+
+private:
+    struct Job {
+        uint8_t data[255];
+        uint8_t len;
+        long frequency;
+        RadioTxCallback callback;
+        uint32_t tag;
+        int64_t refUs;
+        int64_t submitUs;
+    };
+
+    // Одна передача с ожиданием TxDone; implicitLength > 0 - неявный заголовок
+    bool transmit(const Job& job, const uint8_t* data, size_t len, int implicitLength, RadioTxResult& result);
+    void complete(const Job& job, RadioTxResult& result);
+
+    QueueHandle_t _queue;
+    volatile bool _inFlight;
+    volatile int64_t _inFlightSinceUs;
+    RadioTxStats _stats;
+    uint64_t _latencySumUs;
+};
+
+// Глобальный экземпляр передачи
+extern RadioTx radioTx;
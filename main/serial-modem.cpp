@@ -0,0 +1,303 @@
+#include "serial-modem.h"
+#include "config.h"
+#include "logging.h"
+#include "lora-manager.h"
+#include "time-sync.h"
+#include "tx-queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+// Служебная часть кадра: тип, seq и CRC
+#define MODEM_FRAME_OVERHEAD 5
+// Худший случай COBS: +1 байт на каждые 254 и разделитель
+#define MODEM_ENCODED_MAX(n) ((n) + (n) / 254 + 2)
+
+SerialModem* serialModem = nullptr;
+
+static uint16_t crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// COBS: убирает нули из кадра, 0x00 остаётся разделителем
+static size_t cobsEncode(const uint8_t* in, size_t len, uint8_t* out) {
+    size_t write = 1;
+    size_t codeIndex = 0;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[codeIndex] = code;
+            codeIndex = write++;
+            code = 1;
+        } else {
+            out[write++] = in[i];
+            if (++code == 0xFF) {
+                out[codeIndex] = code;
+                codeIndex = write++;
+                code = 1;
+            }
+        }
+    }
+    out[codeIndex] = code;
+    out[write++] = 0x00;
+    return write;
+}
+
+static size_t cobsDecode(const uint8_t* in, size_t len, uint8_t* out) {
+    size_t read = 0;
+    size_t write = 0;
+    while (read < len) {
+        uint8_t code = in[read++];
+        if (code == 0 || read + code - 1 > len) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            out[write++] = in[read++];
+        }
+        if (code != 0xFF && read < len) {
+            out[write++] = 0;
+        }
+    }
+    return write;
+}
+
+template <typename T>
+static void put(uint8_t*& p, T value) {
+    memcpy(p, &value, sizeof(T));
+    p += sizeof(T);
+}
+
+SerialModem::SerialModem(GyverDB* db) : _db(db) {
+    _active = false;
+    _baud = MODEM_DEFAULT_BAUD;
+    _out = xRingbufferCreate(MODEM_RING_BYTES, RINGBUF_TYPE_NOSPLIT);
+    _txRequests = xQueueCreate(MODEM_TX_QUEUE_LENGTH, sizeof(ModemTxRequest));
+    _inLength = 0;
+    _inOverflow = false;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void SerialModem::initDefaults() {
+    _db->init(DB_NAMESPACE::modem_enabled, false);
+    _db->init(DB_NAMESPACE::modem_baud, MODEM_DEFAULT_BAUD);
+}
+
+void SerialModem::applySettings() {
+    bool enabled = _db->get(DB_NAMESPACE::modem_enabled).toBool();
+    uint32_t baud = _db->get(DB_NAMESPACE::modem_baud).toInt();
+    if (baud < 9600) baud = MODEM_DEFAULT_BAUD;
+
+    if (enabled == _active && baud == _baud) {
+        return;
+    }
+    logger.println(String("Режим модема: ") + (enabled ? "включен, " + String(baud) + " бод" : "выключен"));
+
+    Serial.flush();
+    if (enabled) {
+        // Порт только для двоичных кадров: текст и журнал IDF отключаются
+        serialLog.setMuted(true);
+        esp_log_level_set("*", ESP_LOG_NONE);
+        Serial.updateBaudRate(baud);
+    } else {
+        Serial.updateBaudRate(115200);
+        esp_log_level_set("*", ESP_LOG_ERROR);
+        serialLog.setMuted(false);
+    }
+    _baud = baud;
+    _inLength = 0;
+    _active = enabled;
+}
+
+bool SerialModem::isActive() const {
+    return _active;
+}
+
+// Кодирование в вызывающей задаче, в порт пишет задача модема
+bool SerialModem::sendFrame(uint8_t type, uint16_t seq, const uint8_t* body, size_t len) {
+    uint8_t raw[MODEM_MAX_PAYLOAD + 48];
+    uint8_t encoded[MODEM_ENCODED_MAX(sizeof(raw))];
+    if (len + MODEM_FRAME_OVERHEAD > sizeof(raw)) {
+        return false;
+    }
+    raw[0] = type;
+    memcpy(raw + 1, &seq, 2);
+    memcpy(raw + 3, body, len);
+    uint16_t crc = crc16(raw, len + 3);
+    memcpy(raw + 3 + len, &crc, 2);
+
+    size_t encodedLen = cobsEncode(raw, len + MODEM_FRAME_OVERHEAD, encoded);
+    if (xRingbufferSend(_out, encoded, encodedLen, 0) != pdTRUE) {
+        _stats.outDropped++;
+        return false;
+    }
+    return true;
+}
+
+void SerialModem::onRadioReceive(const uint8_t* data, size_t len, const PacketMeta& meta) {
+    if (!_active) {
+        return;
+    }
+    uint8_t body[MODEM_MAX_PAYLOAD + 32];
+    len = min(len, (size_t)MODEM_MAX_PAYLOAD);
+    LoRaParams params = loraManager->getParams();
+
+    uint8_t* p = body;
+    put<int64_t>(p, meta.rxDoneUs);
+    put<int64_t>(p, timeSync.localToGlobal(meta.rxDoneUs));
+    put<uint32_t>(p, (uint32_t)loraManager->getFrequency());
+    put<int16_t>(p, (int16_t)meta.rssi);
+    put<int16_t>(p, (int16_t)lroundf(meta.snr * 10.0f));
+    put<uint8_t>(p, (uint8_t)params.spreading);
+    put<uint8_t>(p, (uint8_t)params.codingRate);
+    put<uint32_t>(p, (uint32_t)(params.bandwidth * 1000.0f));
+    memcpy(p, data, len);
+    p += len;
+
+    sendFrame(MODEM_RX, 0, body, p - body);
+}
+
+bool SerialModem::takeTxRequest(ModemTxRequest& request) {
+    return _active && xQueueReceive(_txRequests, &request, 0) == pdTRUE;
+}
+
+void SerialModem::onTxDone(uint16_t seq, bool ok, int64_t txDoneUs, uint32_t airtimeUs) {
+    uint8_t body[13];
+    uint8_t* p = body;
+    // Кадр не ушёл (очередь передачи заполнена или нет TxDone) - хост может повторить
+    put<uint8_t>(p, ok ? MODEM_OK : MODEM_BUSY);
+    put<int64_t>(p, txDoneUs);
+    put<uint32_t>(p, airtimeUs);
+    if (ok) _stats.txSent++;
+    sendFrame(MODEM_TX_DONE, seq, body, sizeof(body));
+}
+
+void SerialModem::handleFrame(const uint8_t* frame, size_t len) {
+    if (len < MODEM_FRAME_OVERHEAD) {
+        _stats.badFrames++;
+        return;
+    }
+    uint16_t crc;
+    memcpy(&crc, frame + len - 2, 2);
+    if (crc != crc16(frame, len - 2)) {
+        _stats.badFrames++;
+        return;
+    }
+    _stats.framesIn++;
+
+    uint8_t type = frame[0];
+    uint16_t seq;
+    memcpy(&seq, frame + 1, 2);
+    const uint8_t* body = frame + 3;
+    size_t bodyLen = len - MODEM_FRAME_OVERHEAD;
+
+    switch (type) {
+        case MODEM_TX: {
+            uint8_t status = MODEM_OK;
+            if (bodyLen == 0 || bodyLen > MODEM_MAX_PAYLOAD) {
+                status = MODEM_INVALID;
+            } else {
+                ModemTxRequest request;
+                request.seq = seq;
+                request.len = bodyLen;
+                memcpy(request.data, body, bodyLen);
+                if (xQueueSend(_txRequests, &request, 0) != pdTRUE) {
+                    status = MODEM_BUSY;
+                }
+            }
+            // Принятый запрос подтверждается после передачи (onTxDone)
+            if (status != MODEM_OK) {
+                uint8_t reply[13] = {status};
+                sendFrame(MODEM_TX_DONE, seq, reply, sizeof(reply));
+            }
+            break;
+        }
+        case MODEM_PING: {
+            // Эхо тела + время узла: хост измеряет задержку и скорость порта
+            uint8_t reply[MODEM_MAX_PAYLOAD + 8];
+            bodyLen = min(bodyLen, (size_t)MODEM_MAX_PAYLOAD);
+            int64_t now = esp_timer_get_time();
+            memcpy(reply, &now, 8);
+            memcpy(reply + 8, body, bodyLen);
+            sendFrame(MODEM_PONG, seq, reply, bodyLen + 8);
+            break;
+        }
+        case MODEM_STATS: {
+            uint32_t reply[7] = {_stats.framesIn, _stats.framesOut, _stats.bytesIn, _stats.bytesOut,
+                                 _stats.badFrames, _stats.outDropped, _stats.txSent};
+            sendFrame(MODEM_STATS_RE, seq, (const uint8_t*)reply, sizeof(reply));
+            break;
+        }
+        case MODEM_ENQUEUE: {
+            uint8_t status = MODEM_INVALID;
+            if (bodyLen > 0 && bodyLen <= TXQ_MAX_PAYLOAD) {
+                String text;
+                text.reserve(bodyLen);
+                for (size_t i = 0; i < bodyLen; i++) text += (char)body[i];
+                status = txQueue.enqueue(text, millis()) ? MODEM_OK : MODEM_BUSY;
+            }
+            sendFrame(MODEM_ENQ_DONE, seq, &status, 1);
+            break;
+        }
+        default:
+            _stats.badFrames++;
+            break;
+    }
+}
+
+void SerialModem::process() {
+    if (!_active) {
+        vTaskDelay(pdMS_TO_TICKS(200));
+        return;
+    }
+
+    // Вывод: ждём кадр не дольше MODEM_POLL_MS, затем забираем всё накопленное
+    size_t size = 0;
+    TickType_t wait = pdMS_TO_TICKS(MODEM_POLL_MS);
+    uint8_t* item;
+    while ((item = (uint8_t*)xRingbufferReceive(_out, &size, wait)) != nullptr) {
+        Serial.write(item, size);
+        vRingbufferReturnItem(_out, item);
+        _stats.framesOut++;
+        _stats.bytesOut += size;
+        wait = 0;
+    }
+
+    // Ввод: накапливаем до разделителя
+    int available = Serial.available();
+    while (available-- > 0) {
+        int c = Serial.read();
+        if (c < 0) break;
+        _stats.bytesIn++;
+        if (c != 0) {
+            if (_inLength < sizeof(_inBuffer)) {
+                _inBuffer[_inLength++] = c;
+            } else {
+                _inOverflow = true;
+            }
+            continue;
+        }
+        if (_inOverflow) {
+            _stats.badFrames++;
+        } else if (_inLength > 0) {
+            uint8_t decoded[sizeof(_inBuffer)];
+            size_t len = cobsDecode(_inBuffer, _inLength, decoded);
+            if (len > 0) {
+                handleFrame(decoded, len);
+            } else {
+                _stats.badFrames++;
+            }
+        }
+        _inLength = 0;
+        _inOverflow = false;
+    }
+}
+
+ModemStats SerialModem::getStats() const {
+    return _stats;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <Arduino.h>
+#include <GyverDB.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/ringbuf.h"
+#include "esp32-config.h"
+#include "radio-events.h"
+
+// Максимальный размер кадра LoRa
+#define MODEM_MAX_PAYLOAD 255
+
+// Типы кадров протокола модема
+enum ModemFrameType : uint8_t {
+    MODEM_TX       = 0x01,  // Хост -> узел: передать кадр в эфир
+    MODEM_PING     = 0x02,  // Хост -> узел: эхо (проверка канала и замер скорости)
+    MODEM_STATS    = 0x03,  // Хост -> узел: запрос счётчиков
+    MODEM_ENQUEUE  = 0x04,  // Хост -> узел: сообщение в очередь store-and-forward
+    MODEM_TX_DONE  = 0x81,  // Результат MODEM_TX
+    MODEM_PONG     = 0x82,
+    MODEM_STATS_RE = 0x83,
+    MODEM_ENQ_DONE = 0x84,
+    MODEM_RX       = 0x90   // Узел -> хост: принятый кадр с метаданными
+};
+
+// Статус выполнения запроса хоста
+enum ModemStatus : uint8_t {
+    MODEM_OK = 0,
+    MODEM_BUSY = 1,     // Очередь передачи заполнена
+    MODEM_INVALID = 2   // Неверная длина
+};
+
+// Запрос на передачу от хоста
+struct ModemTxRequest {
+    uint16_t seq;
+    uint8_t len;
+    uint8_t data[MODEM_MAX_PAYLOAD];
+};
+
+// Метрики модема
+struct ModemStats {
+    uint32_t framesIn;      // Кадров от хоста
+    uint32_t framesOut;     // Кадров хосту
+    uint32_t bytesIn;
+    uint32_t bytesOut;
+    uint32_t badFrames;     // Ошибки COBS/CRC
+    uint32_t outDropped;    // Не поместилось в кольцевой буфер
+    uint32_t txSent;        // Передано в эфир по запросу хоста
+};
+
+// Двоичный режим модема для работы с хостом по последовательному порту.
+//
+// Кадр: COBS(<type:1><seq:2><body><crc16:2>) 0x00, числа little-endian,
+// CRC16-CCITT (0xFFFF) по type..body. Текстовый вывод serialLog в этом режиме
+// отключается. Исходящие кадры кодируются в задаче-источнике и кладутся в
+// кольцевой буфер без ожидания (при переполнении - счётчик outDropped);
+// в порт их пишет задача модема, поэтому радио никогда не ждёт UART.
+//
+// Тело MODEM_RX: rxDoneUs:8 globalUs:8 freq:4 rssi:2 snr*10:2 sf:1 cr:1 bwHz:4 data
+// Тело MODEM_TX_DONE: status:1 txDoneUs:8 airtimeUs:4
+class SerialModem {
+public:
+    SerialModem(GyverDB* db);
+
+    void initDefaults();
+    // Включение режима по настройкам из базы (вызывается в setup и из интерфейса)
+    void applySettings();
+    bool isActive() const;
+
+    // Принятый кадр радио -> хост (taskReceive, не блокируется)
+    void onRadioReceive(const uint8_t* data, size_t len, const PacketMeta& meta);
+
+    // Следующий кадр хоста для передачи в эфир (taskReceive, не блокируется)
+    bool takeTxRequest(ModemTxRequest& request);
+    void onTxDone(uint16_t seq, bool ok, int64_t txDoneUs, uint32_t airtimeUs);
+
+    // Один шаг задачи модема: вывод буфера в порт и разбор входящих байт
+    void process();
+
+    ModemStats getStats() const;
+
+private:
+    bool sendFrame(uint8_t type, uint16_t seq, const uint8_t* body, size_t len);
+    void handleFrame(const uint8_t* frame, size_t len);
+
+    GyverDB* _db;
+    volatile bool _active;
+    uint32_t _baud;
+    RingbufHandle_t _out;
+    QueueHandle_t _txRequests;
+
+    // Приём от хоста: байты до разделителя 0x00
+    uint8_t _inBuffer[MODEM_MAX_PAYLOAD + 32];
+    size_t _inLength;
+    bool _inOverflow;
+
+    ModemStats _stats;
+};
+
+// Глобальный экземпляр модема
+extern SerialModem* serialModem;
@@ -0,0 +1,298 @@
+#include "spectrum-scan.h"
+#include "lora-manager.h"
+#include "radio-events.h"
+#include "sx127x.h"
+#include "radio-tx.h"
+
+// Отсчётов до того, как уровень шума считается известным
+#define SCAN_MIN_SAMPLES 16
+
+SpectrumScanner* spectrumScanner = nullptr;
+
+SpectrumScanner::SpectrumScanner(GyverDB* db) : _db(db) {
+    _enabled = false;
+    _reconfigure = false;
+    _periodMs = 1000 / SCAN_DEFAULT_RATE_HZ;
+    _lastSample = 0;
+    _rowStarted = 0;
+    _skipped = 0;
+    _count = 0;
+    _next = 0;
+    _rowHead = 0;
+    _rowCount = 0;
+    _lock = portMUX_INITIALIZER_UNLOCKED;
+    memset(_stats, 0, sizeof(_stats));
+    memset(_histogram, 0, sizeof(_histogram));
+    memset(_histogramTotal, 0, sizeof(_histogramTotal));
+    memset(_rows, 0, sizeof(_rows));
+}
+
+void SpectrumScanner::initDefaults() {
+    _db->init(DB_NAMESPACE::scan_enabled, false);
+    _db->init(DB_NAMESPACE::scan_freqs, "");
+    _db->init(DB_NAMESPACE::scan_rate, SCAN_DEFAULT_RATE_HZ);
+}
+
+void SpectrumScanner::applySettings() {
+    _enabled = _db->get(DB_NAMESPACE::scan_enabled).toBool();
+    _reconfigure = true;
+}
+
+bool SpectrumScanner::isEnabled() const {
+    return _enabled;
+}
+
+void SpectrumScanner::process() {
+    if (_reconfigure) {
+        _reconfigure = false;
+        uint32_t rate = constrain(_db->get(DB_NAMESPACE::scan_rate).toInt(), 1, 200);
+
+        // Список частот: "433.175;433.375" (MHz), пусто - каналы частотного плана
+        long frequencies[SCAN_MAX_CHANNELS];
+        uint8_t count = 0;
+        String list = _db->get(DB_NAMESPACE::scan_freqs).toString();
+        list.replace(',', ';');
+        int start = 0;
+        while (start < (int)list.length() && count < SCAN_MAX_CHANNELS) {
+            int end = list.indexOf(';', start);
+            if (end < 0) end = list.length();
+            float mhz = list.substring(start, end).toFloat();
+            if (mhz > 100.0f) {
+                frequencies[count++] = lroundf(mhz * 1000.0f) * 1000L;
+            }
+            start = end + 1;
+        }
+        if (count == 0) {
+            const ChannelPlan& plan = loraManager->channelPlan();
+            for (uint8_t ch = 0; ch < plan.getChannelCount(); ch++) {
+                frequencies[count++] = plan.getFrequency(ch);
+            }
+        }
+
+        portENTER_CRITICAL(&_lock);
+        _periodMs = 1000 / rate;
+        _count = count;
+        _next = 0;
+        memset(_stats, 0, sizeof(_stats));
+        memset(_histogram, 0, sizeof(_histogram));
+        memset(_histogramTotal, 0, sizeof(_histogramTotal));
+        memset(_rows, 0, sizeof(_rows));
+        for (uint8_t i = 0; i < count; i++) {
+            _stats[i].frequency = frequencies[i];
+            _stats[i].occupancy = -1.0f;
+            _stats[i].noiseFloor = SCAN_HIST_MIN_DBM;
+            _stats[i].avgRssi = SCAN_HIST_MIN_DBM;
+        }
+        _rowHead = 0;
+        _rowCount = 0;
+        portEXIT_CRITICAL(&_lock);
+
+        _rowStarted = millis();
+        _lastSample = millis();
+        if (_enabled) {
+            logger.println("Сканирование эфира: частот " + String(count) + ", " + String(rate) + " отсч./с");
+        }
+    }
+
+    if (!_enabled || _count == 0) {
+        vTaskDelay(pdMS_TO_TICKS(200));
+        return;
+    }
+
+    // Постоянный темп отсчётов: следующий отсчёт от момента предыдущего, а не от конца обработки
+    uint32_t now = millis();
+    uint32_t elapsed = now - _lastSample;
+    if (elapsed < _periodMs) {
+        vTaskDelay(pdMS_TO_TICKS(_periodMs - elapsed));
+        return;
+    }
+    _lastSample = elapsed >= 2 * _periodMs ? now : _lastSample + _periodMs;
+
+    uint8_t index = _next;
+    _next = (_next + 1) % _count;
+    bool sampled = false;
+    int rssi = 0;
+    if (spiLock(pdMS_TO_TICKS(_periodMs))) {
+        // Идёт передача или приём кадра - не мешаем, отсчёт пропускается
+        if (!radioTx.isInFlight() && !radioSignalDetected()) {
+            long home = loraManager->getFrequency();
+            radio.idle();
+            radio.setFrequency(_stats[index].frequency);
+            radio.receive();
+            delayMicroseconds(SCAN_SETTLE_US);
+            rssi = radio.rssi();
+            // Standby на рабочей частоте: следующий parsePacket снова запустит приём
+            radio.idle();
+            radio.setFrequency(home);
+            sampled = true;
+        }
+        spiUnlock();
+    }
+
+    if (sampled) {
+        sample(index, rssi);
+    } else {
+        _skipped++;
+    }
+
+    if (now - _rowStarted >= SCAN_HEATMAP_PERIOD_MS) {
+        _rowStarted = now;
+        closeRow();
+    }
+}
+
+// Уровень шума - 10-й процентиль гистограммы RSSI
+float SpectrumScanner::noiseFloorLocked(uint8_t index) const {
+    uint32_t target = _histogramTotal[index] / 10;
+    uint32_t sum = 0;
+    for (int bin = 0; bin < SCAN_HIST_BINS; bin++) {
+        sum += _histogram[index][bin];
+        if (sum > target) {
+            return SCAN_HIST_MIN_DBM + bin;
+        }
+    }
+    return SCAN_HIST_MIN_DBM + SCAN_HIST_BINS - 1;
+}
+
+void SpectrumScanner::sample(uint8_t index, int rssi) {
+    portENTER_CRITICAL(&_lock);
+    ScanChannelStats& stats = _stats[index];
+    if (stats.samples == 0) {
+        stats.minRssi = rssi;
+        stats.maxRssi = rssi;
+        stats.avgRssi = rssi;
+    } else {
+        stats.minRssi = min((int)stats.minRssi, rssi);
+        stats.maxRssi = max((int)stats.maxRssi, rssi);
+        stats.avgRssi = (ALPHA * rssi) + ((1 - ALPHA) * stats.avgRssi);
+    }
+    stats.samples++;
+
+    // Гистограмма "стареет" делением пополам, уровень шума следует за изменениями
+    int bin = constrain(rssi - SCAN_HIST_MIN_DBM, 0, SCAN_HIST_BINS - 1);
+    _histogram[index][bin]++;
+    if (++_histogramTotal[index] >= SCAN_HIST_WINDOW) {
+        _histogramTotal[index] = 0;
+        for (int i = 0; i < SCAN_HIST_BINS; i++) {
+            _histogram[index][i] /= 2;
+            _histogramTotal[index] += _histogram[index][i];
+        }
+    }
+    stats.noiseFloor = noiseFloorLocked(index);
+
+    bool busy = stats.samples >= SCAN_MIN_SAMPLES && rssi > stats.noiseFloor + SCAN_BUSY_MARGIN_DB;
+    ScanHeatmapRow& row = _rows[_rowHead];
+    row.samples[index]++;
+    if (busy) row.busy[index]++;
+
+    // Занятость по окну: текущая строка и закрытые
+    uint32_t samples = 0;
+    uint32_t busyCount = 0;
+    for (uint8_t i = 0; i <= _rowCount; i++) {
+        const ScanHeatmapRow& r = _rows[(_rowHead + SCAN_HEATMAP_ROWS - i) % SCAN_HEATMAP_ROWS];
+        samples += r.samples[index];
+        busyCount += r.busy[index];
+    }
+    stats.occupancy = samples ? busyCount * 100.0f / samples : -1.0f;
+    portEXIT_CRITICAL(&_lock);
+}
+
+void SpectrumScanner::closeRow() {
+    portENTER_CRITICAL(&_lock);
+    _rowHead = (_rowHead + 1) % SCAN_HEATMAP_ROWS;
+    memset(&_rows[_rowHead], 0, sizeof(ScanHeatmapRow));
+    if (_rowCount < SCAN_HEATMAP_ROWS - 1) _rowCount++;
+    portEXIT_CRITICAL(&_lock);
+}
+
+uint8_t SpectrumScanner::getChannelCount() const {
+    return _count;
+}
+
+ScanChannelStats SpectrumScanner::getChannelStats(uint8_t index) const {
+    portENTER_CRITICAL(&_lock);
+    ScanChannelStats stats = _stats[index < SCAN_MAX_CHANNELS ? index : 0];
+    portEXIT_CRITICAL(&_lock);
+    return stats;
+}
+
+// 0xFF - в строке нет отсчётов для частоты
+uint8_t SpectrumScanner::getHeatmap(uint8_t out[][SCAN_MAX_CHANNELS], uint8_t maxRows) const {
+    portENTER_CRITICAL(&_lock);
+    uint8_t rows = min((uint8_t)(_rowCount + 1), maxRows);
+    for (uint8_t r = 0; r < rows; r++) {
+        const ScanHeatmapRow& row = _rows[(_rowHead + SCAN_HEATMAP_ROWS - (rows - 1 - r)) % SCAN_HEATMAP_ROWS];
+        for (uint8_t ch = 0; ch < SCAN_MAX_CHANNELS; ch++) {
+            out[r][ch] = row.samples[ch] ? row.busy[ch] * 100 / row.samples[ch] : 0xFF;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+    return rows;
+}
+
+uint32_t SpectrumScanner::getSkipped() const {
+    return _skipped;
+}
+
+int SpectrumScanner::findChannel(long frequency) const {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_stats[i].frequency == frequency) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+float SpectrumScanner::getOccupancy(long frequency) const {
+    if (!_enabled) {
+        return -1.0f;
+    }
+    portENTER_CRITICAL(&_lock);
+    int index = findChannel(frequency);
+    float occupancy = index >= 0 && _stats[index].samples >= SCAN_MIN_SAMPLES ? _stats[index].occupancy : -1.0f;
+    portEXIT_CRITICAL(&_lock);
+    return occupancy;
+}
+
+int SpectrumScanner::getQuietestChannel(const ChannelPlan& plan) const {
+    int best = -1;
+    float bestOccupancy = 0;
+    for (uint8_t ch = 0; ch < plan.getChannelCount(); ch++) {
+        float occupancy = getOccupancy(plan.getFrequency(ch));
+        if (occupancy >= 0 && (best < 0 || occupancy < bestOccupancy)) {
+            best = ch;
+            bestOccupancy = occupancy;
+        }
+    }
+    return best;
+}
+
+uint32_t SpectrumScanner::getBusyMask(const ChannelPlan& plan, uint32_t excluded) const {
+    if (!_enabled || !plan.isEnabled()) {
+        return 0;
+    }
+    float occupancy[CHANNEL_PLAN_MAX];
+    uint8_t working = plan.getChannelCount();
+    for (uint8_t ch = 0; ch < plan.getChannelCount(); ch++) {
+        occupancy[ch] = (ch == 0 || (excluded & (1UL << ch))) ? -1.0f : getOccupancy(plan.getFrequency(ch));
+        if (excluded & (1UL << ch)) working--;
+    }
+
+    // Самые занятые каналы исключаются первыми
+    uint32_t mask = 0;
+    while (working > 2) {
+        int busiest = -1;
+        for (uint8_t ch = 1; ch < plan.getChannelCount(); ch++) {
+            if (occupancy[ch] >= SCAN_BUSY_OCCUPANCY && (busiest < 0 || occupancy[ch] > occupancy[busiest])) {
+                busiest = ch;
+            }
+        }
+        if (busiest < 0) {
+            break;
+        }
+        mask |= 1UL << busiest;
+        occupancy[busiest] = -1.0f;
+        working--;
+    }
+    return mask;
+}
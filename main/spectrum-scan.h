@@ -0,0 +1,94 @@
+#pragma once
+#include <Arduino.h>
+#include <GyverDB.h>
+#include "config.h"
+#include "esp32-config.h"
+#include "channel-plan.h"
+
+// Максимум частот в списке сканирования
+#define SCAN_MAX_CHANNELS CHANNEL_PLAN_MAX
+// Гистограмма RSSI для оценки уровня шума: 1 dB на корзину от SCAN_HIST_MIN_DBM
+#define SCAN_HIST_BINS    64
+#define SCAN_HIST_MIN_DBM -140
+
+// Статистика канала по отсчётам RSSI
+struct ScanChannelStats {
+    long frequency;
+    uint32_t samples;     // Отсчётов за всё время
+    float occupancy;      // Доля занятых отсчётов за окно тепловой карты, %
+    float noiseFloor;     // 10-й процентиль RSSI, dBm
+    float avgRssi;        // Сглаженный RSSI, dBm
+    int16_t minRssi;
+    int16_t maxRssi;
+};
+
+// Строка тепловой карты: отсчёты за период SCAN_HEATMAP_PERIOD_MS
+struct ScanHeatmapRow {
+    uint16_t samples[SCAN_MAX_CHANNELS];
+    uint16_t busy[SCAN_MAX_CHANNELS];
+};
+
+// Режим сканирования эфира: мгновенный RSSI по списку частот с постоянной частотой отсчётов.
+//
+// Каждый отсчёт - короткий уход с рабочего канала под spi_lock_mutex: standby,
+// перестройка, непрерывный приём, SCAN_SETTLE_US на установление RSSI, чтение
+// RegRssiValue и возврат. Если модем в этот момент передаёт или принимает кадр,
+// отсчёт пропускается.
+// Отсчёт считается занятым, если RSSI выше уровня шума канала на SCAN_BUSY_MARGIN_DB.
+// Занятость считается по скользящему окну из SCAN_HEATMAP_ROWS строк тепловой карты.
+class SpectrumScanner {
+public:
+    SpectrumScanner(GyverDB* db);
+
+    void initDefaults();
+    // Список частот и частота отсчётов из базы; пустой список - каналы частотного плана
+    void applySettings();
+    bool isEnabled() const;
+
+    // Один шаг задачи сканирования (задаёт темп отсчётов сам)
+    void process();
+
+    uint8_t getChannelCount() const;
+    ScanChannelStats getChannelStats(uint8_t index) const;
+    // Строки тепловой карты от старой к новой, значения - занятость в %
+    uint8_t getHeatmap(uint8_t out[][SCAN_MAX_CHANNELS], uint8_t maxRows) const;
+    uint32_t getSkipped() const;
+
+    // API для планировщика передачи
+    // Занятость частоты, % (-1 - частота не сканируется или ещё нет отсчётов)
+    float getOccupancy(long frequency) const;
+    // Самый тихий канал частотного плана (-1 - данных нет)
+    int getQuietestChannel(const ChannelPlan& plan) const;
+    // Маска каналов плана с занятостью выше SCAN_BUSY_OCCUPANCY сверх уже исключённых;
+    // домашний канал не исключается, хотя бы два канала остаются рабочими
+    uint32_t getBusyMask(const ChannelPlan& plan, uint32_t excluded) const;
+
+private:
+    void sample(uint8_t index, int rssi);
+    void closeRow();
+    float noiseFloorLocked(uint8_t index) const;
+    int findChannel(long frequency) const;
+
+    GyverDB* _db;
+    volatile bool _enabled;
+    volatile bool _reconfigure;
+    uint32_t _periodMs;
+    uint32_t _lastSample;
+    uint32_t _rowStarted;
+    uint32_t _skipped;
+
+    uint8_t _count;
+    uint8_t _next;
+    ScanChannelStats _stats[SCAN_MAX_CHANNELS];
+    uint16_t _histogram[SCAN_MAX_CHANNELS][SCAN_HIST_BINS];
+    uint32_t _histogramTotal[SCAN_MAX_CHANNELS];
+
+    ScanHeatmapRow _rows[SCAN_HEATMAP_ROWS];
+    uint8_t _rowHead;   // Текущая (незакрытая) строка
+    uint8_t _rowCount;  // Закрытых строк
+
+    mutable portMUX_TYPE _lock;
+};
+
+// Глобальный экземпляр сканера
+extern SpectrumScanner* spectrumScanner;
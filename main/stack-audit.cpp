@@ -0,0 +1,168 @@
+#include "stack-audit.h"
+#include "system-monitor.h"
+#include "tasks.h"
+#include "task-stacks.h"
+#include "logging.h"
+
+StackAuditor stackAuditor;
+
+static const char* const STACK_ALERT_NAMES[] = {"ok", "warn", "critical"};
+
+StackAuditor::StackAuditor() {
+    _count.store(0, std::memory_order_relaxed);
+    memset(_entries, 0, sizeof(_entries));
+}
+
+// Запись только из задачи мониторинга. Новая строка заполняется целиком и
+// лишь затем публикуется увеличением _count (release): читатель, увидевший
+// счётчик (acquire), видит и имя, и размер задачи
+StackAuditEntry* StackAuditor::findEntry(TaskHandle_t handle, const char* name) {
+    uint8_t count = _count.load(std::memory_order_relaxed);
+    for (uint8_t i = 0; i < count; i++) {
+        if (_entries[i].handle == handle) {
+            return &_entries[i];
+        }
+    }
+    if (count == SYSTEM_MONITOR_MAX_TASKS) {
+        return nullptr;
+    }
+    StackAuditEntry& entry = _entries[count];
+    strncpy(entry.name, name, sizeof(entry.name) - 1);
+    entry.name[sizeof(entry.name) - 1] = '\0';
+    entry.handle = handle;
+    entry.minFree = UINT32_MAX;
+    entry.alert = STACK_OK;
+
+    // Размер стека FreeRTOS не сообщает - известен только для задач из таблицы
+    uint8_t specCount = 0;
+    const TaskSpec* specs = getTaskSpecs(specCount);
+    for (uint8_t i = 0; i < specCount; i++) {
+        if (strcmp(specs[i].name, name) == 0) {
+            entry.size = specs[i].stackSize;
+            entry.stackDefine = specs[i].stackDefine;
+        }
+    }
+    _count.store(count + 1, std::memory_order_release);
+    return &entry;
+}
+
+void StackAuditor::update() {
+    if (!systemMonitor) {
+        return;
+    }
+    SystemMonitor::TaskInfo tasks[SYSTEM_MONITOR_COPY_ROWS];
+    uint16_t first = 0;
+    uint16_t count;
+    while ((count = systemMonitor->getTasksInfo(tasks, SYSTEM_MONITOR_COPY_ROWS, first)) > 0) {
+        first += count;
+        for (uint16_t i = 0; i < count; i++) {
+            auditTask(tasks[i]);
+        }
+    }
+}
+
+void StackAuditor::auditTask(const SystemMonitor::TaskInfo& task) {
+    StackAuditEntry* entry = findEntry(task.handle, task.name);
+    if (!entry) {
+        return;
+    }
+    // В ESP-IDF остаток стека - в байтах
+    uint32_t free = task.stackHighWater;
+    if (free >= entry->minFree) {
+        return;
+    }
+    entry->minFree = free;
+
+    StackAlert alert = STACK_OK;
+    uint32_t usedPct = 0;
+    if (entry->size > 0) {
+        uint32_t used = entry->size > free ? entry->size - free : 0;
+        usedPct = used * 100 / entry->size;
+        uint32_t size = used * (100 + STACK_AUDIT_MARGIN_PCT) / 100;
+        entry->recommended = max((uint32_t)STACK_AUDIT_MIN_SIZE, (size + 255) & ~255u);
+        if (usedPct >= STACK_AUDIT_CRIT_PCT) {
+            alert = STACK_CRITICAL;
+        } else if (usedPct >= STACK_AUDIT_WARN_PCT) {
+            alert = STACK_WARN;
+        }
+    }
+    if (free < STACK_AUDIT_MIN_FREE) {
+        alert = STACK_CRITICAL;
+    }
+    if (alert > entry->alert) {
+        entry->alert = alert;
+        String message = "Стек " + String(entry->name) + ": свободно " + String(free) + " байт";
+        if (entry->size > 0) {
+            message += " из " + String(entry->size) + " (занято " + String(usedPct) + "%)";
+        }
+        logger.println((alert == STACK_CRITICAL ? error_() : warn_()) + message);
+    }
+}
+
+const StackAuditEntry* StackAuditor::getEntries(uint8_t& count) const {
+    count = _count.load(std::memory_order_acquire);
+    return _entries;
+}
+
+int32_t StackAuditor::getReclaimable() const {
+    int32_t total = 0;
+    uint8_t count = _count.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < count; i++) {
+        if (_entries[i].size > 0) {
+            total += (int32_t)_entries[i].size - (int32_t)_entries[i].recommended;
+        }
+    }
+    return total;
+}
+
+void StackAuditor::writeJson(JsonWriter& json) const {
+    json.beginObject();
+    json.field("margin_pct", (uint32_t)STACK_AUDIT_MARGIN_PCT);
+    json.field("reclaimable", getReclaimable());
+    json.key("tasks");
+    json.beginArray();
+    uint8_t count = _count.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < count; i++) {
+        const StackAuditEntry& entry = _entries[i];
+        json.beginObject();
+        json.field("name", (const char*)entry.name);
+        json.field("min_free", entry.minFree);
+        json.field("alert", STACK_ALERT_NAMES[entry.alert]);
+        if (entry.size > 0) {
+            json.field("size", entry.size);
+            json.field("recommended", entry.recommended);
+            json.field("define", entry.stackDefine);
+        }
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+}
+
+size_t StackAuditor::writeHeader(Print& out) const {
+    size_t written = out.print("#pragma once\n\n"
+                               "// Размеры стеков задач приложения, байт. Сгенерировано аудитом стеков:\n");
+    written += out.printf("// использование + %d%%, вверх до 256 байт; работа %lu s.\n",
+                          STACK_AUDIT_MARGIN_PCT, (unsigned long)(millis() / 1000));
+    uint8_t specCount = 0;
+    const TaskSpec* specs = getTaskSpecs(specCount);
+    uint8_t count = _count.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < specCount; i++) {
+        uint32_t size = specs[i].stackSize;
+        uint32_t used = 0;
+        for (uint8_t j = 0; j < count; j++) {
+            if (_entries[j].stackDefine == specs[i].stackDefine && _entries[j].recommended > 0) {
+                size = _entries[j].recommended;
+                used = _entries[j].size - _entries[j].minFree;
+            }
+        }
+        written += out.printf("#define %-25s %-6lu // было %lu, занято %lu\n", specs[i].stackDefine,
+                              (unsigned long)size, (unsigned long)specs[i].stackSize, (unsigned long)used);
+    }
+#if !DISPLAY_ENABLED
+    // Задачи нет в этой сборке - размер остаётся прежним
+    written += out.printf("#define %-25s %-6lu // задачи нет в сборке\n", "TASK_STACK_DISPLAY_UPDATE",
+                          (unsigned long)TASK_STACK_DISPLAY_UPDATE);
+#endif
+    return written;
+}
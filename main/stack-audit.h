@@ -0,0 +1,57 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "json-writer.h"
+#include "system-monitor.h"
+
+enum StackAlert : uint8_t {
+    STACK_OK = 0,
+    STACK_WARN,       // Использовано STACK_AUDIT_WARN_PCT и больше
+    STACK_CRITICAL    // STACK_AUDIT_CRIT_PCT и больше или свободно меньше STACK_AUDIT_MIN_FREE
+};
+
+// Стек задачи по наблюдениям аудита
+struct StackAuditEntry {
+    char name[16];
+    TaskHandle_t handle;
+    uint32_t size;              // Байт; 0 - задача не из таблицы приложения, размер неизвестен
+    uint32_t minFree;           // Наименьший свободный остаток за всё время
+    uint32_t recommended;       // Рекомендуемый размер (0 - размер неизвестен)
+    const char* stackDefine;    // Константа в task-stacks.h (nullptr - системная задача)
+    StackAlert alert;           // Наибольший уровень тревоги за всё время
+};
+
+// Аудит стеков задач.
+//
+// Раз в секунду (задача мониторинга) берёт минимальный свободный остаток
+// стека каждой задачи из таблицы SystemMonitor и запоминает наименьший.
+// Переход задачи на более высокий уровень тревоги пишется в лог один раз.
+// Для задач приложения (getTaskSpecs) известен размер стека, поэтому есть
+// доля использования и рекомендуемый размер: использование плюс
+// STACK_AUDIT_MARGIN_PCT, вверх до 256 байт, не меньше STACK_AUDIT_MIN_SIZE.
+// Отчёт выгружается готовым task-stacks.h.
+class StackAuditor {
+public:
+    StackAuditor();
+
+    void update();
+
+    // Таблица в порядке обнаружения задач
+    const StackAuditEntry* getEntries(uint8_t& count) const;
+    // Сумма (размер - рекомендация) по задачам приложения; отрицательная - стеков не хватает
+    int32_t getReclaimable() const;
+
+    void writeJson(JsonWriter& json) const;
+    // Содержимое task-stacks.h с рекомендованными размерами
+    size_t writeHeader(Print& out) const;
+
+private:
+    StackAuditEntry* findEntry(TaskHandle_t handle, const char* name);
+    void auditTask(const SystemMonitor::TaskInfo& task);
+
+    StackAuditEntry _entries[SYSTEM_MONITOR_MAX_TASKS];
+    std::atomic<uint8_t> _count;   // Опубликованных строк; пишет задача мониторинга
+};
+
+extern StackAuditor stackAuditor;
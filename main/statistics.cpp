@@ -1,46 +1,156 @@
 #include "statistics.h"
+#include "logging.h"
+#include "log-ring.h"
 
-// Инициализация глобальных переменных
-int totalSent = 0;
-int totalReceived = 0;
-float successRateSmoothed = 0.0;
+// Метрики реестра
+Counter totalSent("lora_hello_sent", "HLO packets sent");
+Counter totalReceived("lora_hello_acked", "HLO packets acknowledged");
+Gauge successRateSmoothed("lora_delivery_smoothed_percent", "Smoothed HLO delivery rate, %");
+Histogram rttHistogram("lora_rtt_us", "HLO/ACK round trip time, us", RTT_HISTOGRAM_BASE_US, RTT_HISTOGRAM_BUCKETS);
+Gauge rttLastUs("lora_rtt_last_us", "Last HLO/ACK round trip time, us");
+Gauge rttAvgUs("lora_rtt_avg_us", "Smoothed HLO/ACK round trip time, us");
+Gauge rxAvailability("lora_rx_availability_percent", "Share of time without receive poll stalls, %", 100.0f);
 
-// Инициализация переменных для отслеживания пакетов
-int packetId = 0;
-bool packetStatus[100] = {false}; // Для хранения статуса пакетов
+std::atomic<int> packetId(0);
 
-void updateStats(bool success) {
-    totalSent++;
-    if (success) totalReceived++;
+// Метки TxDone последних HLO (кольцо по ID пакета): пишет задача передачи,
+// читает и гасит задача приёма - слот меняется целиком под packetLock
+struct PacketTxRecord {
+    int id;
+    int64_t txUs;
+    uint8_t mode;    // Режим заголовка и SF, на которых ушёл HLO (0xFF - не учитывается)
+    int ackedId;     // ID + 1 последнего учтённого ACK (0 - не было): повторный ACK не считается
+};
+static PacketTxRecord packetTx[100] = {};
+static portMUX_TYPE packetLock = portMUX_INITIALIZER_UNLOCKED;
 
-    // Вычисляем текущую успешность доставки в процентах
-    float currentSuccessRate = (totalReceived * 100.0) / totalSent;
-    
-    // Применяем сглаживание с использованием EWMA
-    successRateSmoothed = (ALPHA * currentSuccessRate) + ((1 - ALPHA) * successRateSmoothed);
+SeqLocked<HeaderModeStats> headerModeStats[2][HEADER_STATS_SF_COUNT];
+static SeqLocked<ReceivePollStats> receivePollStats;
 
-    Serial.printf("Smoothed success rate: %.2f%% | Overall success rate: %.2f%% (%d/%d)\n", 
-                  successRateSmoothed, currentSuccessRate, totalReceived, totalSent);
+static void logSuccessRate(const char* title) {
+    uint32_t sent = totalSent.value();
+    uint32_t received = totalReceived.value();
+    float currentSuccessRate = sent ? (received * 100.0) / sent : 0.0;
+    LOGI(LOG_SINK_SERIAL, "%s: %.2f%% | Overall success rate: %.2f%% (%u/%u)", title,
+         successRateSmoothed.value(), currentSuccessRate, received, sent);
+}
+
+void updateStats(bool success) {
+    totalSent.inc();
+    if (success) totalReceived.inc();
+
+    // Текущая успешность доставки в процентах, сглаживание EWMA
+    uint32_t sent = totalSent.value();
+    successRateSmoothed.smooth((totalReceived.value() * 100.0f) / sent, ALPHA);
+    logSuccessRate("Smoothed success rate");
 }
 
 void updatePacketStatus(int id, bool success) {
-    if (id < 100) { // Проверка границ массива
-        packetStatus[id] = success;
-        
-        // Пересчитываем общую статистику
-        int received = 0;
-        for (int i = 0; i < packetId; i++) {
-            if (packetStatus[i]) received++;
+    if (id < 0 || !success) return;
+    PacketTxRecord& record = packetTx[id % 100];
+    portENTER_CRITICAL(&packetLock);
+    // ACK на пакет, которого нет в слоте (слот занят более новым HLO после
+    // оборота кольца или HLO не уходил), и повторный ACK не считаются -
+    // иначе доставка превысит 100%
+    bool counted = record.id == id && record.ackedId != id + 1;
+    if (counted) {
+        record.ackedId = id + 1;
+    }
+    portEXIT_CRITICAL(&packetLock);
+    if (!counted) return;
+
+    totalReceived.inc();
+    uint32_t sent = totalSent.value();
+    if (sent > 0) {
+        successRateSmoothed.smooth((totalReceived.value() * 100.0f) / sent, ALPHA);
+    }
+    logSuccessRate("Updated success rate");
+}
+
+void recordPacketTx(int id, int64_t txDoneUs) {
+    if (id < 0) return;
+    PacketTxRecord& record = packetTx[id % 100];
+    portENTER_CRITICAL(&packetLock);
+    record.txUs = txDoneUs;
+    record.id = id;
+    portEXIT_CRITICAL(&packetLock);
+}
+
+int64_t recordPacketRtt(int id, int64_t rxDoneUs) {
+    if (id < 0) return -1;
+    PacketTxRecord& record = packetTx[id % 100];
+    portENTER_CRITICAL(&packetLock);
+    // Слот уже занят более новым пакетом или ACK пришёл повторно
+    if (record.id != id || record.txUs == 0 || rxDoneUs <= record.txUs) {
+        portEXIT_CRITICAL(&packetLock);
+        return -1;
+    }
+    int64_t rtt = rxDoneUs - record.txUs;
+    record.txUs = 0;
+    uint8_t mode = record.mode;
+    record.mode = 0xFF;
+    portEXIT_CRITICAL(&packetLock);
+
+    if (mode != 0xFF) {
+        headerModeStats[mode >> 4][mode & 0x0F].write([](HeaderModeStats& stats) {
+            stats.successes++;
+        });
+    }
+
+    uint32_t rttUs = rtt > UINT32_MAX ? UINT32_MAX : (uint32_t)rtt;
+    rttHistogram.observe(rttUs);
+    rttLastUs.set(rttUs);
+    if (rttAvgUs.value() == 0) {
+        rttAvgUs.set(rttUs);
+    } else {
+        rttAvgUs.smooth(rttUs, ALPHA);
+    }
+    return rtt;
+}
+
+void recordHeaderModeTx(int id, int spreading, bool implicitHeader, uint32_t airtimeUs) {
+    if (id < 0) return;
+    int index = spreading - HEADER_STATS_SF_MIN;
+    uint8_t mode = 0xFF;
+    if (index >= 0 && index < HEADER_STATS_SF_COUNT) {
+        headerModeStats[implicitHeader ? 1 : 0][index].write([airtimeUs](HeaderModeStats& stats) {
+            stats.attempts++;
+            stats.airtimeSumUs += airtimeUs;
+        });
+        mode = (implicitHeader ? 0x10 : 0x00) | index;
+    }
+    portENTER_CRITICAL(&packetLock);
+    packetTx[id % 100].mode = mode;
+    portEXIT_CRITICAL(&packetLock);
+}
+
+void recordReceivePoll(int64_t nowUs) {
+    receivePollStats.write([nowUs](ReceivePollStats& stats) {
+        if (stats.polls++ == 0) {
+            stats.sinceUs = nowUs;
+            stats.lastUs = nowUs;
+            return;
+        }
+        uint32_t gap = (uint32_t)(nowUs - stats.lastUs);
+        stats.lastUs = nowUs;
+        if (gap > stats.maxGapUs) stats.maxGapUs = gap;
+        if (gap > RX_POLL_STALL_MS * 1000UL) {
+            stats.stalls++;
+            stats.stalledUs += gap;
         }
-        
-        totalReceived = received;
-        totalSent = packetId;
-        
-        // Обновляем сглаженную статистику после пересчета
-        float successRate = (totalReceived * 100.0) / totalSent;
-        successRateSmoothed = (ALPHA * successRate) + ((1 - ALPHA) * successRateSmoothed);
-        
-        Serial.printf("Updated overall success rate: %.2f%% (%d/%d)\n", 
-                      successRate, totalReceived, totalSent);
+    });
+    rxAvailability.set(receiveAvailability());
+}
+
+ReceivePollStats receivePollSnapshot() {
+    return receivePollStats.read();
+}
+
+float receiveAvailability() {
+    ReceivePollStats stats = receivePollStats.read();
+    int64_t elapsed = stats.lastUs - stats.sinceUs;
+    if (elapsed <= 0) {
+        return 100.0f;
     }
-}
\ No newline at end of file
+    return 100.0f * (1.0f - (float)stats.stalledUs / elapsed);
+}
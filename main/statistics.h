@@ -2,6 +2,7 @@
 #define STATISTICS_H
 
 #include "config.h"
+#include "metrics.h"
 
 // Функция обновления статистики
 void updateStats(bool success);
@@ -9,13 +10,60 @@ void updateStats(bool success);
 // Обновляем статус для конкретного пакета
 void updatePacketStatus(int id, bool success);
 
-// Глобальные переменные для отслеживания статистики
-extern int totalSent;
-extern int totalReceived;
-extern float successRateSmoothed;
+// Время кругового обхода HLO -> ACK по меткам прерывания DIO0:
+// от TxDone нашего HLO до RxDone ответного ACK
+#define RTT_HISTOGRAM_BUCKETS 8
+#define RTT_HISTOGRAM_BASE_US 50000  // Верхняя граница первой корзины, дальше удвоение
 
-// Глобальные переменные для отслеживания пакетов
-extern int packetId;
-extern bool packetStatus[100]; // Для хранения статуса пакетов
+void recordPacketTx(int id, int64_t txDoneUs);
+// Возвращает RTT в мкс или -1, если метка отправки не найдена
+int64_t recordPacketRtt(int id, int64_t rxDoneUs);
+
+// Сравнение явного и неявного заголовка по SF: измеренное эфирное время HLO
+// (TxStart -> TxDone) и доля HLO, получивших ACK, в каждом режиме
+#define HEADER_STATS_SF_MIN   7
+#define HEADER_STATS_SF_COUNT 6  // SF7..SF12
+
+struct HeaderModeStats {
+    uint32_t attempts;
+    uint32_t successes;
+    uint64_t airtimeSumUs;
+};
+
+void recordHeaderModeTx(int id, int spreading, bool implicitHeader, uint32_t airtimeUs);
+
+// [0] - явный, [1] - неявный; ячейка пишется из задач передачи и приёма
+extern SeqLocked<HeaderModeStats> headerModeStats[2][HEADER_STATS_SF_COUNT];
+
+// Доступность приёма: задача приёма опрашивает модем каждые ~10 мс. Промежуток
+// между опросами длиннее RX_POLL_STALL_MS считается простоем - кадр, закончившийся
+// в это время, мог быть перезаписан следующим
+struct ReceivePollStats {
+    uint32_t polls;
+    uint32_t stalls;
+    uint32_t maxGapUs;
+    uint64_t stalledUs;
+    int64_t sinceUs;
+    int64_t lastUs;
+};
+
+void recordReceivePoll(int64_t nowUs);
+// Согласованный снимок (поля одного опроса меняются вместе)
+ReceivePollStats receivePollSnapshot();
+// Доля времени без простоев, %
+float receiveAvailability();
+
+// Метрики реестра. Пишутся из задач передачи и приёма, читаются
+// интерфейсом, дисплеем и API без блокировок
+extern Counter totalSent;            // HLO отправлено
+extern Counter totalReceived;        // HLO подтверждено (ACK, без повторов)
+extern Gauge successRateSmoothed;    // Сглаженная успешность доставки, %
+extern Histogram rttHistogram;       // RTT HLO/ACK, мкс
+extern Gauge rttLastUs;
+extern Gauge rttAvgUs;               // Сглаженное среднее RTT, мкс
+extern Gauge rxAvailability;         // Доступность приёма, %
+
+// ID следующего HLO
+extern std::atomic<int> packetId;
 
 #endif // STATISTICS_H
\ No newline at end of file
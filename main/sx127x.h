@@ -0,0 +1,372 @@
+#pragma once
+#include <Arduino.h>
+#include <SPI.h>
+#include "esp_timer.h"
+#include "config.h"
+
+// Регистры SX127x в режиме LoRa
+namespace sx127x {
+    constexpr uint8_t REG_FIFO                 = 0x00;
+    constexpr uint8_t REG_OP_MODE              = 0x01;
+    constexpr uint8_t REG_FRF_MSB              = 0x06;
+    constexpr uint8_t REG_PA_CONFIG            = 0x09;
+    constexpr uint8_t REG_OCP                  = 0x0B;
+    constexpr uint8_t REG_LNA                  = 0x0C;
+    constexpr uint8_t REG_FIFO_ADDR_PTR        = 0x0D;
+    constexpr uint8_t REG_FIFO_TX_BASE_ADDR    = 0x0E;
+    constexpr uint8_t REG_FIFO_RX_BASE_ADDR    = 0x0F;
+    constexpr uint8_t REG_FIFO_RX_CURRENT_ADDR = 0x10;
+    constexpr uint8_t REG_IRQ_FLAGS            = 0x12;
+    constexpr uint8_t REG_RX_NB_BYTES          = 0x13;
+    constexpr uint8_t REG_MODEM_STAT           = 0x18;
+    constexpr uint8_t REG_PKT_SNR_VALUE        = 0x19;
+    constexpr uint8_t REG_PKT_RSSI_VALUE       = 0x1A;
+    constexpr uint8_t REG_RSSI_VALUE           = 0x1B;
+    constexpr uint8_t REG_MODEM_CONFIG_1       = 0x1D;
+    constexpr uint8_t REG_MODEM_CONFIG_2       = 0x1E;
+    constexpr uint8_t REG_PAYLOAD_LENGTH       = 0x22;
+    constexpr uint8_t REG_MODEM_CONFIG_3       = 0x26;
+    constexpr uint8_t REG_DETECTION_OPTIMIZE   = 0x31;
+    constexpr uint8_t REG_DETECTION_THRESHOLD  = 0x37;
+    constexpr uint8_t REG_DIO_MAPPING_1        = 0x40;
+    constexpr uint8_t REG_VERSION              = 0x42;
+    constexpr uint8_t REG_PA_DAC               = 0x4D;
+
+    constexpr uint8_t MODE_LONG_RANGE = 0x80;
+    constexpr uint8_t MODE_SLEEP      = 0x00;
+    constexpr uint8_t MODE_STDBY      = 0x01;
+    constexpr uint8_t MODE_TX         = 0x03;
+    constexpr uint8_t MODE_RX_CONT    = 0x05;
+    constexpr uint8_t MODE_RX_SINGLE  = 0x06;
+
+    // RegDioMapping1, биты 7..6: событие на выводе DIO0
+    constexpr uint8_t DIO0_RX_DONE = 0x00;
+    constexpr uint8_t DIO0_TX_DONE = 0x40;
+
+    // RegModemStat: обнаружена преамбула, синхронизация, заголовок принят
+    constexpr uint8_t MODEM_STAT_SIGNAL = 0x0B;
+
+    constexpr uint8_t IRQ_TX_DONE   = 0x08;
+    constexpr uint8_t IRQ_CRC_ERROR = 0x20;
+    constexpr uint8_t IRQ_RX_DONE   = 0x40;
+
+    constexpr uint32_t SPI_FREQUENCY = 8000000;
+}
+
+// Счётчики шины SPI: число транзакций (CS low..high) и время удержания шины
+struct SpiStats {
+    uint32_t transactions;
+    uint32_t busUs;
+};
+
+// Средние затраты шины на один кадр
+struct SpiPacketStats {
+    uint32_t packets;
+    uint32_t bytes;
+    uint32_t transactions;
+    uint32_t busUs;
+};
+
+// Драйвер SX127x (LoRa) на уровне регистров вместо библиотеки arduino-LoRa.
+//
+// Pins - структура с constexpr ss/rst/dio0 (см. LoRaBoardPins в config.h),
+// номера выводов известны при компиляции. FIFO читается и пишется одной
+// пакетной транзакцией SPI вместо транзакции на каждый байт. Передача не
+// блокирует: startTransmit() запускает TX и сразу возвращается, окончание
+// определяется по прерыванию DIO0 (radio-events) или опросом isTxDone().
+// Все методы вызываются под spi_lock_mutex.
+template <typename Pins>
+class SX127x {
+public:
+    bool begin(long frequency) {
+        pinMode(Pins::ss, OUTPUT);
+        digitalWrite(Pins::ss, HIGH);
+        pinMode(Pins::rst, OUTPUT);
+        digitalWrite(Pins::rst, LOW);
+        delay(10);
+        digitalWrite(Pins::rst, HIGH);
+        delay(10);
+        SPI.begin();
+
+        if (readRegister(sx127x::REG_VERSION) != 0x12) {
+            return false;
+        }
+        sleep();
+        setFrequency(frequency);
+        writeRegister(sx127x::REG_FIFO_TX_BASE_ADDR, 0);
+        writeRegister(sx127x::REG_FIFO_RX_BASE_ADDR, 0);
+        // Усиление LNA для HF, автоматическая АРУ
+        writeRegister(sx127x::REG_LNA, readRegister(sx127x::REG_LNA) | 0x03);
+        writeRegister(sx127x::REG_MODEM_CONFIG_3, 0x04);
+        setTxPower(17);
+        idle();
+        return true;
+    }
+
+    void idle() {
+        writeRegister(sx127x::REG_OP_MODE, sx127x::MODE_LONG_RANGE | sx127x::MODE_STDBY);
+    }
+
+    void sleep() {
+        writeRegister(sx127x::REG_OP_MODE, sx127x::MODE_LONG_RANGE | sx127x::MODE_SLEEP);
+    }
+
+    // Три регистра частоты подряд - одна транзакция
+    void setFrequency(long frequency) {
+        _frequency = frequency;
+        uint64_t frf = ((uint64_t)frequency << 19) / 32000000;
+        uint8_t value[3] = {(uint8_t)(frf >> 16), (uint8_t)(frf >> 8), (uint8_t)frf};
+        writeBurst(sx127x::REG_FRF_MSB, value, sizeof(value));
+    }
+
+    long getFrequency() const {
+        return _frequency;
+    }
+
+    void setSpreadingFactor(int sf) {
+        sf = constrain(sf, 6, 12);
+        writeRegister(sx127x::REG_DETECTION_OPTIMIZE, sf == 6 ? 0xC5 : 0xC3);
+        writeRegister(sx127x::REG_DETECTION_THRESHOLD, sf == 6 ? 0x0C : 0x0A);
+        _config2 = (_config2 & 0x0F) | ((sf << 4) & 0xF0);
+        writeRegister(sx127x::REG_MODEM_CONFIG_2, _config2);
+        _spreading = sf;
+        updateLowDataRateOptimize();
+    }
+
+    void setSignalBandwidth(long bandwidth) {
+        static const long limits[] = {7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000};
+        uint8_t index = 9;
+        for (uint8_t i = 0; i < 9; i++) {
+            if (bandwidth <= limits[i]) {
+                index = i;
+                break;
+            }
+        }
+        _config1 = (_config1 & 0x0F) | (index << 4);
+        writeRegister(sx127x::REG_MODEM_CONFIG_1, _config1);
+        _bandwidth = bandwidth;
+        updateLowDataRateOptimize();
+    }
+
+    void setCodingRate4(int denominator) {
+        denominator = constrain(denominator, 5, 8);
+        _config1 = (_config1 & 0xF1) | ((denominator - 4) << 1);
+        writeRegister(sx127x::REG_MODEM_CONFIG_1, _config1);
+    }
+
+    void enableCrc() {
+        _config2 |= 0x04;
+        writeRegister(sx127x::REG_MODEM_CONFIG_2, _config2);
+    }
+
+    void disableCrc() {
+        _config2 &= 0xFB;
+        writeRegister(sx127x::REG_MODEM_CONFIG_2, _config2);
+    }
+
+    // Выход PA_BOOST (модули SX1278), 2..20 dBm
+    void setTxPower(int level) {
+        if (level > 17) {
+            level = min(level, 20) - 3;
+            writeRegister(sx127x::REG_PA_DAC, 0x87);
+            setOcp(140);
+        } else {
+            level = max(level, 2);
+            writeRegister(sx127x::REG_PA_DAC, 0x84);
+            setOcp(100);
+        }
+        writeRegister(sx127x::REG_PA_CONFIG, 0x80 | (level - 2));
+    }
+
+    // Непрерывный приём (DIO0 -> RxDone), используется сканированием эфира
+    void receive() {
+        writeRegister(sx127x::REG_DIO_MAPPING_1, sx127x::DIO0_RX_DONE);
+        setHeaderMode(0);
+        writeRegister(sx127x::REG_OP_MODE, sx127x::MODE_LONG_RANGE | sx127x::MODE_RX_CONT);
+    }
+
+    // Опрос приёма: длина принятого кадра или 0. Если кадра нет, радио
+    // переводится в однократный приём. implicitLength > 0 - неявный заголовок
+    int parsePacket(int implicitLength = 0) {
+        uint8_t flags = readRegister(sx127x::REG_IRQ_FLAGS);
+        setHeaderMode(implicitLength);
+        if (flags) {
+            writeRegister(sx127x::REG_IRQ_FLAGS, flags);
+        }
+
+        if ((flags & sx127x::IRQ_RX_DONE) && !(flags & sx127x::IRQ_CRC_ERROR)) {
+            _rxLength = implicitLength > 0 ? implicitLength : readRegister(sx127x::REG_RX_NB_BYTES);
+            writeRegister(sx127x::REG_FIFO_ADDR_PTR, readRegister(sx127x::REG_FIFO_RX_CURRENT_ADDR));
+            idle();
+            return _rxLength;
+        }
+        if (readRegister(sx127x::REG_OP_MODE) != (sx127x::MODE_LONG_RANGE | sx127x::MODE_RX_SINGLE)) {
+            writeRegister(sx127x::REG_FIFO_ADDR_PTR, 0);
+            writeRegister(sx127x::REG_OP_MODE, sx127x::MODE_LONG_RANGE | sx127x::MODE_RX_SINGLE);
+        }
+        return 0;
+    }
+
+    // Принятый кадр целиком - одна транзакция
+    size_t readPacket(uint8_t* data, size_t maxLen) {
+        size_t len = min((size_t)_rxLength, maxLen);
+        readBurst(sx127x::REG_FIFO, data, len);
+        _rxLength = 0;
+        return len;
+    }
+
+    // Запуск передачи без ожидания TxDone
+    bool startTransmit(const uint8_t* data, size_t len, bool implicitHeader = false) {
+        if (len == 0 || len > 255) {
+            return false;
+        }
+        idle();
+        setHeaderMode(implicitHeader ? len : 0);
+        writeRegister(sx127x::REG_FIFO_ADDR_PTR, 0);
+        writeBurst(sx127x::REG_FIFO, data, len);
+        writeRegister(sx127x::REG_PAYLOAD_LENGTH, len);
+        _payloadLength = len;
+        writeRegister(sx127x::REG_OP_MODE, sx127x::MODE_LONG_RANGE | sx127x::MODE_TX);
+        return true;
+    }
+
+    // Передача завершена (флаг TxDone сбрасывается)
+    bool isTxDone() {
+        if (!(readRegister(sx127x::REG_IRQ_FLAGS) & sx127x::IRQ_TX_DONE)) {
+            return false;
+        }
+        writeRegister(sx127x::REG_IRQ_FLAGS, sx127x::IRQ_TX_DONE);
+        return true;
+    }
+
+    int rssi() {
+        return readRegister(sx127x::REG_RSSI_VALUE) - rssiOffset();
+    }
+
+    int packetRssi() {
+        return readRegister(sx127x::REG_PKT_RSSI_VALUE) - rssiOffset();
+    }
+
+    float packetSnr() {
+        return (int8_t)readRegister(sx127x::REG_PKT_SNR_VALUE) * 0.25f;
+    }
+
+    uint8_t readRegister(uint8_t address) {
+        uint8_t value;
+        readBurst(address, &value, 1);
+        return value;
+    }
+
+    void writeRegister(uint8_t address, uint8_t value) {
+        writeBurst(address, &value, 1);
+    }
+
+    // Счётчики шины; notePacket относит траты с момента start к кадру len байт
+    SpiStats getSpiStats() const {
+        return {_spi.transactions, _spi.busUs};
+    }
+
+    void notePacket(bool tx, const SpiStats& start, size_t len) {
+        SpiPacketStats& stats = tx ? _txPacket : _rxPacket;
+        stats.packets++;
+        stats.bytes += len;
+        stats.transactions += _spi.transactions - start.transactions;
+        stats.busUs += _spi.busUs - start.busUs;
+    }
+
+    SpiPacketStats getPacketStats(bool tx) const {
+        return tx ? _txPacket : _rxPacket;
+    }
+
+private:
+    void setOcp(uint8_t mA) {
+        uint8_t trim = 27;
+        if (mA <= 120) {
+            trim = (mA - 45) / 5;
+        } else if (mA <= 240) {
+            trim = (mA + 30) / 10;
+        }
+        writeRegister(sx127x::REG_OCP, 0x20 | (0x1F & trim));
+    }
+
+    // Режим заголовка кэшируется: регистры трогаются только при смене
+    void setHeaderMode(int implicitLength) {
+        bool implicitHeader = implicitLength > 0;
+        if (implicitHeader != ((_config1 & 0x01) != 0)) {
+            _config1 = implicitHeader ? (_config1 | 0x01) : (_config1 & 0xFE);
+            writeRegister(sx127x::REG_MODEM_CONFIG_1, _config1);
+        }
+        if (implicitHeader && implicitLength != _payloadLength) {
+            _payloadLength = implicitLength;
+            writeRegister(sx127x::REG_PAYLOAD_LENGTH, implicitLength);
+        }
+    }
+
+    // Оптимизация для низкой скорости обязательна при длительности символа больше 16 мс
+    void updateLowDataRateOptimize() {
+        long symbolMs = 1000 / (_bandwidth / (1L << _spreading));
+        uint8_t config3 = symbolMs > 16 ? 0x0C : 0x04;
+        writeRegister(sx127x::REG_MODEM_CONFIG_3, config3);
+    }
+
+    int rssiOffset() const {
+        return _frequency < 525000000 ? 164 : 157;
+    }
+
+    void readBurst(uint8_t address, uint8_t* data, size_t len) {
+        memset(data, 0, len);
+        int64_t start = esp_timer_get_time();
+        SPI.beginTransaction(SPISettings(sx127x::SPI_FREQUENCY, MSBFIRST, SPI_MODE0));
+        digitalWrite(Pins::ss, LOW);
+        SPI.transfer(address & 0x7F);
+        SPI.transfer(data, len);
+        digitalWrite(Pins::ss, HIGH);
+        SPI.endTransaction();
+        countTransaction(start);
+    }
+
+    void writeBurst(uint8_t address, const uint8_t* data, size_t len) {
+        int64_t start = esp_timer_get_time();
+        SPI.beginTransaction(SPISettings(sx127x::SPI_FREQUENCY, MSBFIRST, SPI_MODE0));
+        digitalWrite(Pins::ss, LOW);
+        SPI.transfer(address | 0x80);
+        SPI.writeBytes(data, len);
+        digitalWrite(Pins::ss, HIGH);
+        SPI.endTransaction();
+        countTransaction(start);
+    }
+
+    void countTransaction(int64_t start) {
+        _spi.transactions++;
+        _spi.busUs += (uint32_t)(esp_timer_get_time() - start);
+    }
+
+    // Копии регистров конфигурации модема (значения после сброса)
+    uint8_t _config1 = 0x72;
+    uint8_t _config2 = 0x70;
+    int _payloadLength = 1;
+    int _spreading = 7;
+    long _bandwidth = 125000;
+    long _frequency = 0;
+    int _rxLength = 0;
+
+    SpiStats _spi = {0, 0};
+    SpiPacketStats _txPacket = {0, 0, 0, 0};
+    SpiPacketStats _rxPacket = {0, 0, 0, 0};
+};
+
+// Оценка транзакций SPI библиотеки arduino-LoRa на кадр по её исходному коду:
+// приём - available() в цикле и read() (ещё available() и чтение FIFO) на каждый байт;
+// передача - запись FIFO по байту. Опрос TxDone в endPacket() сюда не входит: он
+// держит шину и ядро всё эфирное время кадра
+constexpr uint32_t libraryRxTransactions(uint32_t len) {
+    return 3 * len + 11;
+}
+
+constexpr uint32_t libraryTxTransactions(uint32_t len) {
+    return len + 11;
+}
+
+// Радиомодуль платы (определён в lora_module.cpp)
+using LoRaRadio = SX127x<LoRaBoardPins>;
+extern LoRaRadio radio;
@@ -6,20 +6,33 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_timer.h"
+#include "heap-profiler.h"
 #include <algorithm>
 
-// Функция для сравнения TaskInfo по cpuUsage (для сортировки)
+// Функция для сравнения TaskInfo по загрузке за 10 с (для сортировки)
 bool SystemMonitor::compareTasks(const SystemMonitor::TaskInfo& a, const SystemMonitor::TaskInfo& b) {
-    return a.cpuUsage > b.cpuUsage;
+    return a.cpu[CPU_WINDOW_10S] > b.cpu[CPU_WINDOW_10S];
 }
 
 extern SystemMonitor* systemMonitor;
 
+// Коэффициенты экспоненциального среднего при отсчёте раз в секунду: 1 - exp(-1/T)
+static const float CPU_ALPHA_10S = 0.0952f;
+static const float CPU_ALPHA_60S = 0.0165f;
+
 SystemMonitor::SystemMonitor() {
     _taskCount = 0;
+    _freeHeap = 0;
+    _minFreeHeap = 0;
     _lastUpdateTime = 0;
-    _cpuUsageIdle = 0;
-    _cpuUsageTotal = 0;
+    _counterCount = 0;
+    _counterIndex = 0;
+    _lastTotalRunTime = 0;
+    _overflowLogged = false;
+    _tableCounts[0] = 0;
+    _tableCounts[1] = 0;
+    _generation.store(0, std::memory_order_relaxed);
+    memset(_coreUsage, 0, sizeof(_coreUsage));
 }
 
 void SystemMonitor::update() {
@@ -30,148 +43,181 @@ void SystemMonitor::update() {
     // Получаем количество задач
     _taskCount = uxTaskGetNumberOfTasks();
 
-    // Обновляем метрику CPU, используя статистику FreeRTOS runtime stats
-    updateCpuUsage();
-
     _lastUpdateTime = millis();
 }
 
-void SystemMonitor::updateCpuUsage() {
+const SystemMonitor::TaskCounter* SystemMonitor::findCounter(TaskHandle_t handle) const {
+    const TaskCounter* counters = _counters[_counterIndex];
+    for (uint16_t i = 0; i < _counterCount; i++) {
+        if (counters[i].handle == handle) {
+            return &counters[i];
+        }
+    }
+    return nullptr;
+}
+
+void SystemMonitor::sample() {
 #if configGENERATE_RUN_TIME_STATS == 1
-    // Получаем количество задач
-    UBaseType_t taskCount = uxTaskGetNumberOfTasks();
+    uint32_t totalRunTime = 0;
+    UBaseType_t taskCount = uxTaskGetSystemState(_status, SYSTEM_MONITOR_MAX_TASKS, &totalRunTime);
     if (taskCount == 0) {
-        _cpuUsageTotal = 0;
+        // Задач больше, чем вмещает буфер: FreeRTOS не заполняет его вовсе
+        if (!_overflowLogged) {
+            logger.println(warn_() + "Монитор: задач " + String(uxTaskGetNumberOfTasks()) +
+                           ", буфер на " + String(SYSTEM_MONITOR_MAX_TASKS));
+            _overflowLogged = true;
+        }
         return;
     }
 
-    // Выделяем массив под статусы
-    TaskStatus_t* taskStatusArray = (TaskStatus_t*) pvPortMalloc(taskCount * sizeof(TaskStatus_t));
-    if (taskStatusArray == nullptr) {
-        _cpuUsageTotal = 0;
-        return;
+    // Счётчики и общее время - 32 бит, разность без знака переживает переполнение
+    uint32_t elapsed = totalRunTime - _lastTotalRunTime;
+    bool first = _lastTotalRunTime == 0;
+    _lastTotalRunTime = totalRunTime;
+
+    uint8_t next = _counterIndex ^ 1;
+    // Буфер, который не опубликован; читатели прошлой публикации из него уже
+    // ушли или заметят смену поколения. Барьер - их копия, задевшая запись,
+    // увидит и поколение, опубликованное до неё
+    uint32_t generation = _generation.load(std::memory_order_relaxed);
+    uint8_t back = (generation + 1) & 1;
+    std::atomic_thread_fence(std::memory_order_release);
+    TaskInfo* table = _tables[back];
+    TaskHandle_t idle[portNUM_PROCESSORS];
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        idle[core] = xTaskGetIdleTaskHandleForCPU(core);
     }
 
-    uint32_t totalRunTime = 0;
-    // Получаем состояние задач и суммарное время
-    taskCount = uxTaskGetSystemState(taskStatusArray, taskCount, &totalRunTime);
-
-    // Суммируем время для всех idle-задач (на ESP32 обычно их две: IDLE0 и IDLE1)
-    uint32_t idleRunTime = 0;
     for (UBaseType_t i = 0; i < taskCount; i++) {
-        if (taskStatusArray[i].pcTaskName != nullptr &&
-            strstr(taskStatusArray[i].pcTaskName, "IDLE") != nullptr) {
-            idleRunTime += taskStatusArray[i].ulRunTimeCounter;
+        const TaskStatus_t& src = _status[i];
+        TaskInfo& dst = table[i];
+        TaskCounter& counter = _counters[next][i];
+
+        // Задача новая или первый отсчёт - загрузка с нуля
+        const TaskCounter* previous = findCounter(src.xHandle);
+        float busy = 0.0f;
+        if (previous && !first && elapsed > 0) {
+            busy = min(100.0f, (src.ulRunTimeCounter - previous->runTime) * 100.0f / elapsed);
         }
-    }
-
-    vPortFree(taskStatusArray);
-
-    // Если totalRunTime == 0, статистика не успела накопиться
-    if (totalRunTime > 0) {
-        // Вычисляем процент времени в idle и вычитаем из 100
-        uint32_t idlePercentage = (idleRunTime * 100UL) / totalRunTime;
-        if (idlePercentage >= 100) {
-            // На случай, если из-за округлений idlePercentage может выйти >100
-            _cpuUsageTotal = 0;
-        } else {
-            _cpuUsageTotal = 100 - idlePercentage;
+        counter.handle = src.xHandle;
+        counter.runTime = src.ulRunTimeCounter;
+        counter.cpu10s = previous ? previous->cpu10s + CPU_ALPHA_10S * (busy - previous->cpu10s) : busy;
+        counter.cpu60s = previous ? previous->cpu60s + CPU_ALPHA_60S * (busy - previous->cpu60s) : busy;
+
+        strncpy(dst.name, src.pcTaskName, sizeof(dst.name) - 1);
+        dst.name[sizeof(dst.name) - 1] = '\0';
+        dst.handle = src.xHandle;
+        dst.priority = src.uxCurrentPriority;
+        dst.stackHighWater = src.usStackHighWaterMark;
+        dst.state = src.eCurrentState;
+        dst.core = src.xCoreID < portNUM_PROCESSORS ? src.xCoreID : -1;
+        dst.cpu[CPU_WINDOW_1S] = busy;
+        dst.cpu[CPU_WINDOW_10S] = counter.cpu10s;
+        dst.cpu[CPU_WINDOW_60S] = counter.cpu60s;
+
+        // Загрузка ядра - всё время, не занятое его IDLE
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            if (src.xHandle == idle[core]) {
+                _coreUsage[core][CPU_WINDOW_1S] = 100.0f - busy;
+                _coreUsage[core][CPU_WINDOW_10S] = 100.0f - counter.cpu10s;
+                _coreUsage[core][CPU_WINDOW_60S] = 100.0f - counter.cpu60s;
+            }
         }
-    } else {
-        _cpuUsageTotal = 0;
     }
-#else
-    // Если сбор статистики не включён в конфигурации FreeRTOS
-    _cpuUsageTotal = 0;
-#endif
-}
-
+    _counterCount = taskCount;
+    _counterIndex = next;
 
-String SystemMonitor::getFormattedTasksInfo() {
-    String result = "Tasks: " + String(_taskCount) + "\n";
-    result += "CPU: " + String(_cpuUsageTotal) + "%\n";
-    result += "Free Heap: " + String(_freeHeap / 1024) + " kB\n";
-    result += "Min Free: " + String(_minFreeHeap / 1024) + " kB\n";
-    
-    // // Дополнительно: информация о стеке текущей задачи
-    // UBaseType_t currentTaskStack = uxTaskGetStackHighWaterMark(NULL);
-    // result += "Current Task Stack: " + String(currentTaskStack) + " B\n";
-
-    return result;
+    std::sort(table, table + taskCount, compareTasks);
+    _tableCounts[back] = taskCount;
+    _generation.store(generation + 1, std::memory_order_release);
+#endif
 }
 
-SystemMonitor::TaskInfo* SystemMonitor::getTasksInfo(uint16_t& count) {
-    // Статический буфер для результатов (чтобы не возвращать указатель на локальный массив)
-    static SystemMonitor::TaskInfo s_taskInfo[configMAX_PRIORITIES];
-
-    // Сначала узнаём, сколько задач
-    UBaseType_t uxArraySize = uxTaskGetNumberOfTasks();
-    if (uxArraySize == 0) {
-        count = 0;
-        return s_taskInfo;
-    }
-
-    // Выделяем массив под TaskStatus_t
-    TaskStatus_t* pxTaskStatusArray = (TaskStatus_t*) pvPortMalloc(uxArraySize * sizeof(TaskStatus_t));
-    if (pxTaskStatusArray == nullptr) {
-        count = 0;
-        return s_taskInfo;
+// Сводка и таблица задач потоком в JSON, без сборки строки в куче
+void SystemMonitor::writeTasksJson(JsonWriter& json) {
+    json.beginObject();
+    json.field("tasks", (uint32_t)_taskCount);
+    json.field("cpu", getTotalCpuUsage());
+    json.key("cores");
+    json.beginArray();
+    for (uint8_t core = 0; core < portNUM_PROCESSORS; core++) {
+        json.beginArray();
+        for (uint8_t w = 0; w < CPU_WINDOW_COUNT; w++) {
+            json.value(_coreUsage[core][w], 1);
+        }
+        json.endArray();
     }
-
-    // Запросим у системы массив статусов задач и суммарное время
-    uint32_t totalRunTime = 0;
-    uxArraySize = uxTaskGetSystemState(pxTaskStatusArray, uxArraySize, &totalRunTime);
-
-    // Заполняем наш массив s_taskInfo
-    uint16_t taskCount = 0;
-    for (UBaseType_t i = 0; i < uxArraySize; i++) {
-        if (taskCount < configMAX_PRIORITIES) {
-            const TaskStatus_t& src = pxTaskStatusArray[i];
-            SystemMonitor::TaskInfo& dst = s_taskInfo[taskCount];
-
-            // Имя задачи
-            strncpy(dst.name, pcTaskGetName(src.xHandle), sizeof(dst.name) - 1);
-            dst.name[sizeof(dst.name) - 1] = '\0';
-
-            dst.handle = src.xHandle;
-            dst.priority = uxTaskPriorityGet(src.xHandle);
-            dst.stackHighWater = uxTaskGetStackHighWaterMark(src.xHandle);
-            dst.state = src.eCurrentState;
-
-            // Вычисляем процент CPU, если totalRunTime > 0
-            if (totalRunTime > 0) {
-                dst.cpuUsage = (static_cast<float>(src.ulRunTimeCounter) * 100.0f) 
-                               / static_cast<float>(totalRunTime);
-            } else {
-                dst.cpuUsage = 0.0f;
-            }
-
-            taskCount++;
+    json.endArray();
+    json.field("free_heap", (uint32_t)_freeHeap);
+    json.field("min_free_heap", (uint32_t)_minFreeHeap);
+    json.key("list");
+    json.beginArray();
+    TaskInfo tasks[SYSTEM_MONITOR_COPY_ROWS];
+    uint16_t first = 0;
+    uint16_t count;
+    while ((count = getTasksInfo(tasks, SYSTEM_MONITOR_COPY_ROWS, first)) > 0) {
+        first += count;
+        for (uint16_t i = 0; i < count; i++) {
+            json.beginObject();
+            json.field("name", (const char*)tasks[i].name);
+            json.field("priority", (uint32_t)tasks[i].priority);
+            json.field("core", (int32_t)tasks[i].core);
+            json.field("stack_free", (uint32_t)tasks[i].stackHighWater);
+            json.field("state", taskStateToString(tasks[i].state));
+            json.field("cpu_1s", tasks[i].cpu[CPU_WINDOW_1S], 1);
+            json.field("cpu_10s", tasks[i].cpu[CPU_WINDOW_10S], 1);
+            json.field("cpu_60s", tasks[i].cpu[CPU_WINDOW_60S], 1);
+            json.endObject();
         }
     }
+    json.endArray();
+    json.endObject();
+}
 
-    // Освобождаем временный массив
-    vPortFree(pxTaskStatusArray);
+uint16_t SystemMonitor::getTasksInfo(TaskInfo* out, uint16_t maxTasks, uint16_t first) {
+    uint32_t generation;
+    uint16_t count;
+    do {
+        generation = _generation.load(std::memory_order_acquire);
+        uint8_t published = generation & 1;
+        uint16_t total = _tableCounts[published];
+        count = first < total ? min((uint16_t)(total - first), maxTasks) : 0;
+        memcpy(out, _tables[published] + first, count * sizeof(TaskInfo));
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while (_generation.load(std::memory_order_relaxed) != generation);
+    return count;
+}
 
-    // Сортируем задачи по убыванию cpuUsage (пузырьковая сортировка для простоты)
-    for (int i = 0; i < taskCount - 1; i++) {
-        for (int j = 0; j < taskCount - i - 1; j++) {
-            if (s_taskInfo[j].cpuUsage < s_taskInfo[j + 1].cpuUsage) {
-                SystemMonitor::TaskInfo temp = s_taskInfo[j];
-                s_taskInfo[j] = s_taskInfo[j + 1];
-                s_taskInfo[j + 1] = temp;
+template <typename F>
+bool SystemMonitor::findTask(F match, TaskInfo& taskInfo) {
+    uint32_t generation;
+    bool found;
+    do {
+        generation = _generation.load(std::memory_order_acquire);
+        uint8_t published = generation & 1;
+        found = false;
+        for (uint16_t i = 0; i < _tableCounts[published] && !found; i++) {
+            const TaskInfo& row = _tables[published][i];
+            if (match(row)) {
+                memcpy(&taskInfo, &row, sizeof(TaskInfo));
+                found = true;
             }
         }
-    }
-
-    // Возвращаем не более 20 задач
-    count = std::min<uint16_t>(20, taskCount);
-    return s_taskInfo;
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while (_generation.load(std::memory_order_relaxed) != generation);
+    return found;
 }
 
+uint32_t SystemMonitor::getTotalCpuUsage(CpuWindow window) {
+    float total = 0.0f;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        total += _coreUsage[core][window];
+    }
+    return (uint32_t)(total / portNUM_PROCESSORS + 0.5f);
+}
 
-uint32_t SystemMonitor::getTotalCpuUsage() {
-    return _cpuUsageTotal;
+float SystemMonitor::getCoreUsage(uint8_t core, CpuWindow window) {
+    return core < portNUM_PROCESSORS ? _coreUsage[core][window] : 0.0f;
 }
 
 uint32_t SystemMonitor::getFreeHeap() {
@@ -183,14 +229,19 @@ uint32_t SystemMonitor::getMinFreeHeap() {
 }
 
 bool SystemMonitor::getTaskInfoByName(const char* taskName, TaskInfo& taskInfo) {
-    // В данной реализации не реализовано получение информации по имени
-    return false;
+    return findTask([taskName](const TaskInfo& row) { return strncmp(row.name, taskName, sizeof(row.name)) == 0; },
+                    taskInfo);
+}
+
+bool SystemMonitor::getTaskInfoByHandle(TaskHandle_t handle, TaskInfo& taskInfo) {
+    return findTask([handle](const TaskInfo& row) { return row.handle == handle; }, taskInfo);
 }
 
 void SystemMonitor::logTasksStatistics() {
     logger.println("---- System Statistics ----");
     logger.println("Tasks: " + String(_taskCount));
-    logger.println("CPU Usage: " + String(_cpuUsageTotal) + "%");
+    logger.println("CPU Usage 1s/10s/60s: " + String(getTotalCpuUsage(CPU_WINDOW_1S)) + "/" +
+                   String(getTotalCpuUsage(CPU_WINDOW_10S)) + "/" + String(getTotalCpuUsage(CPU_WINDOW_60S)) + "%");
     logger.println("Free Heap: " + String(_freeHeap / 1024) + " kB");
     logger.println("Min Free Heap: " + String(_minFreeHeap / 1024) + " kB");
 
@@ -208,6 +259,18 @@ void SystemMonitor::logMemoryStatistics() {
     logger.println("---- Memory Statistics ----");
     logger.println("Free Heap: " + String(_freeHeap / 1024) + " kB");
     logger.println("Min Free Heap: " + String(_minFreeHeap / 1024) + " kB");
+    for (uint8_t i = 0; i < heapCapsCount(); i++) {
+        HeapCapsInfo caps = heapCapsInfo(i);
+        if (caps.total == 0) {
+            continue;
+        }
+        logger.println(String(caps.name) + ": free " + String(caps.free / 1024) + " kB, largest block " +
+                       String(caps.largest / 1024) + " kB, fragmentation " + String(caps.fragmentation, 1) + "%");
+    }
+    HeapProfileStats heap = heapProfileStats();
+    if (heap.failed > 0) {
+        logger.println("Failed allocations: " + String(heap.failed) + ", last " + String(heap.lastFailedSize) + " bytes");
+    }
 
 #if defined(CONFIG_SPIRAM_SUPPORT)
     logger.println("PSRAM Size: " + String(esp_spiram_get_size() / 1024) + " kB");
@@ -217,7 +280,7 @@ void SystemMonitor::logMemoryStatistics() {
     logger.println("--------------------------");
 }
 
-String SystemMonitor::taskStateToString(eTaskState state) {
+const char* SystemMonitor::taskStateToString(eTaskState state) {
     switch (state) {
         case eRunning:    return "RUN";
         case eReady:      return "READY";
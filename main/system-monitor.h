@@ -1,10 +1,34 @@
 #pragma once
 #include <Arduino.h>
+#include <atomic>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include "config.h"
 #include "logging.h"
+#include "json-writer.h"
 
+// Окна загрузки CPU
+enum CpuWindow : uint8_t {
+    CPU_WINDOW_1S = 0,   // Разность двух последних отсчётов
+    CPU_WINDOW_10S,      // Экспоненциальное среднее с постоянной 10 с
+    CPU_WINDOW_60S,      // То же, 60 с
+    CPU_WINDOW_COUNT
+};
 
+// Мониторинг задач и памяти.
+//
+// Загрузка считается по разности счётчиков времени выполнения FreeRTOS между
+// отсчётами sample() (раз в секунду из задачи мониторинга), а не от запуска:
+// задача, нагрузившая CPU только что, видна сразу. Окно 1 с - точная разность,
+// окна 10 и 60 с - экспоненциальные средние секундных значений (как loadavg).
+// Загрузка ядра - 100% минус доля его задачи IDLE.
+//
+// Буферы отсчёта выделены заранее, на SYSTEM_MONITOR_MAX_TASKS задач. Таблица
+// задач строится в одном из двух буферов и публикуется увеличением поколения,
+// младший бит которого - номер опубликованного буфера. Читатели копируют строки
+// (getTasksInfo, getTaskInfoBy...) и повторяют копию, если поколение за это
+// время сменилось: следующий отсчёт пишет в буфер, который они читали.
+// sample() и update() вызывает только задача мониторинга.
 class SystemMonitor {
 public:
     SystemMonitor();
@@ -15,41 +39,72 @@ public:
         UBaseType_t priority;   // Приоритет
         size_t stackHighWater; // Минимальный свободный стек
         eTaskState state;       // Состояние задачи
-        float cpuUsage;         // Использование CPU в процентах
+        int8_t core;            // Закреплена за ядром, -1 - без привязки
+        float cpu[CPU_WINDOW_COUNT];  // Загрузка одного ядра этой задачей, %
     };
 
     // Основные функции мониторинга
-    void update();                                     // Сбор данных о системе
-    String getFormattedTasksInfo();                   // Получение форматированной статистики задач
-    TaskInfo* getTasksInfo(uint16_t& count);          // Получение массива с информацией о задачах
+    void update();                                     // Сбор данных о памяти и числе задач (раз в секунду)
+    void sample();                                     // Отсчёт загрузки CPU (раз в секунду)
+    void writeTasksJson(JsonWriter& json);            // Сводка и таблица задач в JSON
+
+    // Таблица задач по убыванию загрузки за 10 с: копия не больше maxTasks строк,
+    // начиная с first; возвращает число скопированных. Строки одной копии - из
+    // одного отсчёта, копии по порциям могут попасть на соседние отсчёты
+    uint16_t getTasksInfo(TaskInfo* out, uint16_t maxTasks, uint16_t first = 0);
 
     // Получение системной информации
-    uint32_t getTotalCpuUsage();                      // Общее использование CPU
+    uint32_t getTotalCpuUsage(CpuWindow window = CPU_WINDOW_10S);  // Средняя загрузка ядер
+    float getCoreUsage(uint8_t core, CpuWindow window);            // Загрузка ядра
     uint32_t getFreeHeap();                            // Свободная память кучи
     uint32_t getMinFreeHeap();                        // Минимальная свободная память за время работы
 
     // Получение информации о конкретной задаче по имени
     bool getTaskInfoByName(const char* taskName, TaskInfo& taskInfo);
+    bool getTaskInfoByHandle(TaskHandle_t handle, TaskInfo& taskInfo);
 
     // Вывод статистики в лог
     void logTasksStatistics();
     void logMemoryStatistics();
 
 private:
+    // Счётчик задачи в прошлом отсчёте
+    struct TaskCounter {
+        TaskHandle_t handle;
+        uint32_t runTime;
+        float cpu10s;
+        float cpu60s;
+    };
+
     uint32_t _taskCount;       // Количество задач
     uint32_t _freeHeap;         // Свободная память
     uint32_t _minFreeHeap;     // Минимальная свободная память
-    uint32_t _cpuUsageTotal;   // Общее использование CPU
-    uint32_t _cpuUsageIdle;    // Использование CPU idle task
     uint32_t _lastUpdateTime;  // Время последнего обновления
 
+    // Буферы отсчёта
+    TaskStatus_t _status[SYSTEM_MONITOR_MAX_TASKS];
+    TaskCounter _counters[2][SYSTEM_MONITOR_MAX_TASKS];
+    uint16_t _counterCount;
+    uint8_t _counterIndex;       // Буфер счётчиков прошлого отсчёта
+    uint32_t _lastTotalRunTime;
+    bool _overflowLogged;
+
+    // Опубликованная таблица задач: буфер _tables[_generation & 1]
+    TaskInfo _tables[2][SYSTEM_MONITOR_MAX_TASKS];
+    uint16_t _tableCounts[2];
+    std::atomic<uint32_t> _generation;
+
+    float _coreUsage[portNUM_PROCESSORS][CPU_WINDOW_COUNT];
+
     // Вспомогательные методы
-    void updateCpuUsage();                            // Расчет загрузки CPU
-    String taskStateToString(eTaskState state);       // Преобразование состояния задачи в строку
+    const TaskCounter* findCounter(TaskHandle_t handle) const;
+    template <typename F>
+    bool findTask(F match, TaskInfo& taskInfo);       // Копия первой строки, для которой match истинно
+    const char* taskStateToString(eTaskState state);  // Преобразование состояния задачи в строку
 
-    // Функция для сравнения TaskInfo по cpuUsage (для сортировки)
+    // Функция для сравнения TaskInfo по загрузке (для сортировки)
     static bool compareTasks(const TaskInfo& a, const TaskInfo& b);
 };
 
 // Глобальный экземпляр класса мониторинга
-extern SystemMonitor* systemMonitor;
\ No newline at end of file
+extern SystemMonitor* systemMonitor;
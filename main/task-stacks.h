@@ -0,0 +1,24 @@
+#pragma once
+
+// Размеры стеков задач приложения, байт.
+//
+// Файл заменяется отчётом аудита стеков (stack-audit.h): вкладка системы,
+// "Размеры стеков в Serial", или GET /stacks.h. Рекомендация - наибольшее
+// замеченное использование плюс STACK_AUDIT_MARGIN_PCT, округлённое вверх
+// до 256 байт. Снимайте отчёт после того, как отработали все режимы: веб-
+// интерфейс, API, модем, шлюз, дисплей.
+//
+// Исходные значения (отчёта ещё не было).
+#define TASK_STACK_RADIO_TX       4096
+#define TASK_STACK_SEND_HELLO     4096
+#define TASK_STACK_RECEIVE        4096
+#define TASK_STACK_SPECTRUM_SCAN  4096
+#define TASK_STACK_MONITOR        4096
+#define TASK_STACK_WEB_INTERFACE  16384
+#define TASK_STACK_GATEWAY        6144
+#define TASK_STACK_SERIAL_MODEM   4096
+#define TASK_STACK_PACKET_CAPTURE 4096
+#define TASK_STACK_HISTORY        3072
+#define TASK_STACK_API_SERVER     4096
+#define TASK_STACK_LOG_FORMAT     3072
+#define TASK_STACK_DISPLAY_UPDATE 4096
@@ -1,49 +1,188 @@
 #include "tasks.h"
 #include "led.h"
 #include "statistics.h"
-#include "plot-manager.h"
+#include "metrics-history.h"
 #include "lora-manager.h" 
 #include "system-monitor.h"
 #include "display-manager.h"
+#include "radio-events.h"
+#include "time-sync.h"
+#include "tx-queue.h"
+#include "gateway.h"
+#include "serial-modem.h"
+#include "packet-capture.h"
+#include "spectrum-scan.h"
+#include "sx127x.h"
+#include "radio-tx.h"
+#include "lora-airtime.h"
+#include "api-server.h"
+#include "trace.h"
+#include "heap-profiler.h"
+#include "task-stacks.h"
+#include "stack-audit.h"
+#include "log-ring.h"
 #include <WiFi.h>
 #include <SettingsESPWS.h>
 #include "esp_task_wdt.h"
+#include "esp_timer.h"
 
 // Объявление внешних переменных, используемых в задаче веб-интерфейса
 extern SettingsESPWS sett;
 
-void createTasks() {
-    // LoRa-related tasks on Core 1
-    xTaskCreatePinnedToCore(taskSendHello, "SendHello", 4096, NULL, 2, NULL, 1);
-    xTaskCreatePinnedToCore(taskReceive, "Receive", 4096, NULL, 3, NULL, 1);
-    
-    // Lower priority for monitoring tasks
-    xTaskCreatePinnedToCore(taskMonitorStack, "StackMonitor", 4096, NULL, 1, NULL, 1);
-    
-    // UI and display tasks on Core 0 with appropriate priorities
-    xTaskCreatePinnedToCore(taskWebInterface, "WebInterface", 16384, NULL, 2, NULL, 0);
-    #if DISPLAY_ENABLED
+// Завершение передач (задача передачи, без мьютекса SPI)
+
+static void onHelloSent(const RadioTxResult& result) {
+    if (!result.ok) {
+        LOGW(LOG_SINK_WEB, "Hello packet %u не передан", result.tag);
+        return;
+    }
+    // Метка уходит в статистику по TxDone, раньше чем может прийти ACK
+    recordPacketTx(result.tag, result.txDoneUs);
+    recordHeaderModeTx(result.tag, loraManager->getSpreadingFactor(),
+                       loraManager->getImplicitLength() > 0, result.airtimeUs);
+    serialLog.printf("Hello packet %u sent, airtime: %u us, TxDone: %lld us\n",
+                     (unsigned int)result.tag, (unsigned int)result.airtimeUs, (long long)result.txDoneUs);
+}
+
+static void onAckSent(const RadioTxResult& result) {
+    if (!result.ok) {
+        return;
+    }
+    // Оборот узла: от RxDone HLO до TxDone ACK (обработка, очередь и эфир ACK)
+    serialLog.printf("ACK packet sent, airtime: %u us, turnaround: %lld us\n",
+                     (unsigned int)result.airtimeUs, (long long)(result.txDoneUs - result.refUs));
+}
+
+static void onQueueFrameSent(const RadioTxResult& result) {
+    txQueue.onSent(result.ok ? result.airtimeUs : 0, millis());
+}
+
+static void onModemFrameSent(const RadioTxResult& result) {
+    serialModem->onTxDone(result.tag, result.ok, result.txDoneUs, result.airtimeUs);
+}
+
+static void onParamReplySent(const RadioTxResult& result) {
+    loraManager->paramSwitch().onSent(result.ok);
+}
+
+static void onBeaconSent(const RadioTxResult& result) {
+    timeSync.onBeaconSent(result.ok ? result.txDoneUs : 0, millis());
+}
+
+// Передача принятого кадра шлюзу; не блокирует приём
+static void forwardToGateway(const String& incoming, const PacketMeta& meta) {
+    if (gateway == nullptr || !gateway->isEnabled()) {
+        return;
+    }
+    GatewayFrame frame;
+    strlcpy(frame.text, incoming.c_str(), sizeof(frame.text));
+    frame.rxDoneUs = meta.rxDoneUs;
+    frame.globalUs = timeSync.localToGlobal(meta.rxDoneUs);
+    frame.queuedUs = esp_timer_get_time();
+    frame.rssi = meta.rssi;
+    frame.snr = meta.snr;
+    frame.frequency = loraManager->getFrequency();
+    gateway->submit(frame);
+}
+
+// LoRa-задачи на ядре 1, интерфейс и сеть - на ядре 0.
+// Передача выше приёма: завершение по TxDone не ждёт разбора кадров
+static const TaskSpec TASK_SPECS[] = {
+    {taskRadioTx,       "RadioTx",       "TASK_STACK_RADIO_TX",       TASK_STACK_RADIO_TX,       4, 1},
+    {taskSendHello,     "SendHello",     "TASK_STACK_SEND_HELLO",     TASK_STACK_SEND_HELLO,     2, 1},
+    {taskReceive,       "Receive",       "TASK_STACK_RECEIVE",        TASK_STACK_RECEIVE,        3, 1},
+    {taskSpectrumScan,  "SpectrumScan",  "TASK_STACK_SPECTRUM_SCAN",  TASK_STACK_SPECTRUM_SCAN,  2, 1},
+    {taskMonitorStack,  "StackMonitor",  "TASK_STACK_MONITOR",        TASK_STACK_MONITOR,        1, 1},
+    {taskWebInterface,  "WebInterface",  "TASK_STACK_WEB_INTERFACE",  TASK_STACK_WEB_INTERFACE,  2, 0},
+    {taskGateway,       "Gateway",       "TASK_STACK_GATEWAY",        TASK_STACK_GATEWAY,        1, 0},
+    {taskSerialModem,   "SerialModem",   "TASK_STACK_SERIAL_MODEM",   TASK_STACK_SERIAL_MODEM,   2, 0},
+    {taskPacketCapture, "PacketCapture", "TASK_STACK_PACKET_CAPTURE", TASK_STACK_PACKET_CAPTURE, 1, 0},
+    {taskMetricsHistory, "History",      "TASK_STACK_HISTORY",        TASK_STACK_HISTORY,        1, 0},
+    {taskApiServer,     "ApiServer",     "TASK_STACK_API_SERVER",     TASK_STACK_API_SERVER,     1, 0},
+    {taskLogFormat,     "LogFormat",     "TASK_STACK_LOG_FORMAT",     TASK_STACK_LOG_FORMAT,     1, 0},
+#if DISPLAY_ENABLED
     // Задача обновления дисплея только для ESP32
-    xTaskCreatePinnedToCore(taskDisplayUpdate, "DisplayUpdate", 4096, NULL, 1, NULL, 0);
-    #endif
+    {taskDisplayUpdate, "DisplayUpdate", "TASK_STACK_DISPLAY_UPDATE", TASK_STACK_DISPLAY_UPDATE, 1, 0},
+#endif
+};
+
+#define TASK_COUNT (sizeof(TASK_SPECS) / sizeof(TASK_SPECS[0]))
+
+#if TASK_STATIC_STACKS
+// Стеки в .bss: размер известен при сборке, куча не дробится стеками задач
+#if DISPLAY_ENABLED
+#define TASK_STACK_DISPLAY_USED TASK_STACK_DISPLAY_UPDATE
+#else
+#define TASK_STACK_DISPLAY_USED 0
+#endif
+#define TASK_STACK_TOTAL (TASK_STACK_RADIO_TX + TASK_STACK_SEND_HELLO + TASK_STACK_RECEIVE + \
+                          TASK_STACK_SPECTRUM_SCAN + TASK_STACK_MONITOR + TASK_STACK_WEB_INTERFACE + \
+                          TASK_STACK_GATEWAY + TASK_STACK_SERIAL_MODEM + TASK_STACK_PACKET_CAPTURE + \
+                          TASK_STACK_HISTORY + TASK_STACK_API_SERVER + TASK_STACK_LOG_FORMAT + \
+                          TASK_STACK_DISPLAY_USED)
+
+static StackType_t taskStackArena[TASK_STACK_TOTAL] __attribute__((aligned(16)));
+static StaticTask_t taskBuffers[TASK_COUNT];
+#endif
+
+const TaskSpec* getTaskSpecs(uint8_t& count) {
+    count = TASK_COUNT;
+    return TASK_SPECS;
+}
+
+void createTasks() {
+#if TASK_STATIC_STACKS
+    uint32_t offset = 0;
+#endif
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        const TaskSpec& spec = TASK_SPECS[i];
+#if TASK_STATIC_STACKS
+        // В ESP-IDF StackType_t - байт, размер стека тоже в байтах
+        if (offset + spec.stackSize <= TASK_STACK_TOTAL) {
+            xTaskCreateStaticPinnedToCore(spec.function, spec.name, spec.stackSize, NULL, spec.priority,
+                                          taskStackArena + offset, &taskBuffers[i], spec.core);
+            offset += (spec.stackSize + 15) & ~15u;
+            continue;
+        }
+        logger.println(error_() + "Нет места для статического стека " + spec.name + ", стек в куче");
+#endif
+        xTaskCreatePinnedToCore(spec.function, spec.name, spec.stackSize, NULL, spec.priority, NULL, spec.core);
+    }
 }
 
 void taskSendHello(void *parameter) {
     esp_task_wdt_add(NULL);
     while (true) {
-        if (xSemaphoreTake(spi_lock_mutex, pdMS_TO_TICKS(4000))) {
+        if (spiLock(pdMS_TO_TICKS(4000))) {
             int currentPacketId = packetId++;
+            TRACE_SCOPE(TRACE_HELLO_SEND, currentPacketId);
+            ChannelPlan& plan = loraManager->channelPlan();
             
             uint32_t startTime = millis();
-            LoRa.beginPacket();
-            LoRa.print("HLO:");
-            LoRa.print(currentPacketId); // Отправляем ID пакета
-            LoRa.endPacket();
-            uint32_t duration = millis() - startTime;
-            Serial.printf("Hello packet %d sent, transmission time: %u ms\n", 
-                         currentPacketId, duration);
-
-            xSemaphoreGive(spi_lock_mutex);
+            uint32_t hop = 0;
+            uint32_t mask = 0;
+            if (plan.isEnabled()) {
+                // Прошлый HLO остался без ACK - на шаг пира или на домашний канал
+                plan.failPendingExchange(startTime);
+                loraManager->tuneLocked(plan.getCurrentChannel());
+                // Номер шага и маска исключённых каналов задают канал следующего обмена
+                hop = plan.getHopIndex();
+                plan.expireBlacklist(startTime);
+                mask = plan.getBlacklistMask(startTime);
+                // Каналы, занятые чужим трафиком по данным сканирования, тоже пропускаются
+                mask |= spectrumScanner->getBusyMask(plan, mask);
+            }
+            
+            String hello = "HLO:" + String(currentPacketId); // Отправляем ID пакета
+            if (plan.isEnabled()) {
+                hello += ":" + String(hop) + ":" + String(mask, HEX);
+                // ACK ждём эфир HLO и ответа (не длиннее HLO) с запасом на очередь и оборот пира
+                LoRaParams params = loraManager->getParams();
+                uint32_t ackTimeoutMs = 2 * loraFrameAirtimeUs(params, hello.length()) / 1000 + HOP_ACK_MARGIN_MS;
+                plan.beginExchange(currentPacketId, hop, mask, startTime, ackTimeoutMs);
+            }
+            radioTx.submit(hello, onHelloSent, currentPacketId);
+            spiUnlock();
             
             // Отмечаем, что пакет отправлен, но пока не подтвержден
             updateStats(false);
@@ -57,60 +196,238 @@ void taskSendHello(void *parameter) {
 void taskReceive(void *parameter) {
     esp_task_wdt_add(NULL);
     for (;;) {
-        if (xSemaphoreTake(spi_lock_mutex, pdMS_TO_TICKS(5000))) {
-            int packetSize = LoRa.parsePacket();
+        if (spiLock(pdMS_TO_TICKS(5000))) {
+            TRACE_SCOPE(TRACE_RECEIVE_POLL, 0);
+            // Неявный заголовок: длина кадра известна заранее; после EXP - один явный кадр
+            recordReceivePoll(esp_timer_get_time());
+            int rxImplicitLength = loraManager->getRxImplicitLength(millis());
+            // Модем в эфире - приёма нет до TxDone
+            SpiStats spiStart = radio.getSpiStats();
+            int packetSize = radioTx.isInFlight() ? 0 : radio.parsePacket(rxImplicitLength);
 
             if (packetSize) {
+                // Метка RxDone из прерывания DIO0 - до чтения FIFO, пока не пришёл следующий кадр
+                PacketMeta meta = {radioTakeRxDoneUs(), 0, 0, 0, 0.0f};
 
-                String incoming = "";
-                while (LoRa.available()) {
-                    //int Rssi = LoRa.packetRssi();
-                    //Serial.printf("RSSI: %s\n", Rssi);
-                    incoming += (char)LoRa.read();
+                // FIFO целиком одной транзакцией SPI
+                uint8_t buffer[255];
+                size_t length = radio.readPacket(buffer, sizeof(buffer));
+                TRACE_INSTANT(TRACE_RX_FRAME, length);
+                String incoming;
+                incoming.concat((const char*)buffer, length);
+                meta.rssi = radio.packetRssi();
+                meta.snr = radio.packetSnr();
+                radio.notePacket(false, spiStart, length);
+                metricsHistory.record(HISTORY_RSSI, meta.rssi);
+                metricsHistory.record(HISTORY_SNR, meta.snr);
+                // В захват - кадр как в эфире
+                packetCapture->capture(false, (const uint8_t*)incoming.c_str(), incoming.length(), meta);
+                // Нули в конце - дополнение кадра неявного заголовка
+                if (rxImplicitLength > 0) {
+                    while (incoming.length() > 0 && incoming[incoming.length() - 1] == '\0') {
+                        incoming.remove(incoming.length() - 1);
+                    }
+                } else {
+                    loraManager->endExplicit();
                 }
+                // Объявление длинного кадра: сразу к следующему опросу, уже в явном режиме
+                if (rxImplicitLength > 0 && strncmp(incoming.c_str(), "EXP:", 4) == 0) {
+                    loraManager->expectExplicit(incoming.substring(4).toInt(), millis());
+                    spiUnlock();
+                    continue;
+                }
+                // Хосту - кадр как есть, до обрезки пробелов
+                serialModem->onRadioReceive((const uint8_t*)incoming.c_str(), incoming.length(), meta);
                 incoming.trim();
 
-                Serial.printf("Received: %s\n", incoming.c_str());
+                LOGI(LOG_SINK_SERIAL, "Received: %s [RxDone: %lld us, RSSI: %d dBm, SNR: %.1f dB]",
+                     incoming, meta.rxDoneUs, meta.rssi, meta.snr);
+
+                // Любой принятый кадр подтверждает связь при смене параметров
+                ParamSwitch& paramSwitch = loraManager->paramSwitch();
+                paramSwitch.onTraffic(millis());
+                txQueue.onTraffic(millis());
+
+                ChannelPlan& plan = loraManager->channelPlan();
+                plan.onHeard(millis());
+                plan.recordRssi(plan.getCurrentChannel(), meta.rssi);
+                forwardToGateway(incoming, meta);
 
                 if (incoming.startsWith("HLO:")) {
                     // Извлекаем ID пакета
                     int receivedId = incoming.substring(4).toInt();
                     
-                    logger.println("Hello received! Sending ACK...");
-                    uint32_t startTime = millis();
-                    LoRa.beginPacket();
-                    LoRa.print("ACK:");
-                    LoRa.print(receivedId); // Отправляем ID пакета в ACK
-                    LoRa.endPacket();
-                    xSemaphoreGive(spi_lock_mutex);
-                    uint32_t duration = millis() - startTime;
-                    Serial.printf("ACK packet sent, transmission time: %u ms\n", duration);
+                    LOGI(LOG_SINK_WEB, "Hello received! Sending ACK...");
+                    radioTx.submit("ACK:" + String(receivedId), onAckSent, receivedId, meta.rxDoneUs); // Отправляем ID пакета в ACK
+
+                    // ACK уходит на текущем канале, следующий обмен - на канале из HLO.
+                    // Пока свой HLO ждёт ACK, канал определяет свой обмен
+                    unsigned int hop = 0;
+                    unsigned int mask = 0;
+                    if (plan.isEnabled() &&
+                        sscanf(incoming.c_str() + 4, "%*d:%u:%x", &hop, &mask) == 2 &&
+                        plan.advance(hop, mask, millis())) {
+                        loraManager->tuneLocked(plan.getCurrentChannel());
+                    }
+                    spiUnlock();
                     blinkLED(2, 1000, 0, 255, 0); // Зелёный
                 } else if (incoming.startsWith("ACK:")) {
-                    xSemaphoreGive(spi_lock_mutex);
                     // Получили подтверждение
                     int ackId = incoming.substring(4).toInt();
-                    Serial.printf("ACK received for packet %d!\n", ackId);
+                    if (plan.completeExchange(ackId, millis())) {
+                        loraManager->tuneLocked(plan.getCurrentChannel());
+                    }
+                    spiUnlock();
+                    int64_t rtt = recordPacketRtt(ackId, meta.rxDoneUs);
+                    if (rtt >= 0) {
+                        metricsHistory.record(HISTORY_RTT, rtt / 1000.0f);
+                        LOGI(LOG_SINK_SERIAL, "ACK received for packet %d! RTT: %lld us", ackId, rtt);
+                    } else {
+                        LOGI(LOG_SINK_SERIAL, "ACK received for packet %d!", ackId);
+                    }
 
                     // Обновляем статистику только для этого пакета
                     updatePacketStatus(ackId, true);
                     
                     blinkLED(2, 1000, 0, 0, 255); // Синий
+                } else if (incoming.startsWith("DAT:") || incoming.startsWith("DAK:")) {
+                    // Очередь сообщений: DAK ставится в передачу сразу
+                    String reply;
+                    String delivered;
+                    txQueue.handleMessage(incoming, millis(), reply, delivered);
+                    if (reply.length() > 0) {
+                        radioTx.submit(reply);
+                    }
+                    spiUnlock();
+                    if (delivered.length() > 0) {
+                        LOGI(LOG_SINK_WEB, "Сообщение от пира: %s", delivered);
+                    }
+                } else if (incoming.startsWith("TSB:")) {
+                    spiUnlock();
+                    // Маяк синхронизации времени
+                    timeSync.handleBeacon(incoming, meta.rxDoneUs, millis());
                 } else {
-                    xSemaphoreGive(spi_lock_mutex);
+                    spiUnlock();
+
+                    // Кадры смены параметров (CFG/CFA/CFC/CFK) обрабатываются без
+                    // мьютекса: переключение радио захватывает его само. Ответчик
+                    // переключается только после TxDone своего CFA (onParamReplySent)
+                    char reply[ParamSwitch::FRAME_SIZE];
+                    if (paramSwitch.handleMessage(incoming.c_str(), loraManager->getParams(), millis(),
+                                                  reply, sizeof(reply)) &&
+                        reply[0] != '\0') {
+                        radioTx.submit((const uint8_t*)reply, strlen(reply), onParamReplySent);
+                    }
                 }
             } else {
-                xSemaphoreGive(spi_lock_mutex);
+                // ACK своего обмена не пришёл - шаг пира или домашний канал;
+                // долгая тишина на канале перестройки - возврат на домашний канал
+                ChannelPlan& plan = loraManager->channelPlan();
+                bool retune = plan.expireExchange(millis());
+                if (plan.checkResync(millis())) {
+                    retune = true;
+                    LOGW(LOG_SINK_WEB, "Потеря синхронизации каналов, возврат на домашний канал");
+                }
+                if (retune) {
+                    loraManager->tuneLocked(plan.getCurrentChannel());
+                }
+                spiUnlock();
             }
         } else {
-          logger.println("Failed to acquire mutex for receive!");
+          LOGE(LOG_SINK_WEB, "Failed to acquire mutex for receive!");
+        }
+
+        // Повторы предложения, откат по таймауту и переключение ответчика после CFA
+        char paramFrame[ParamSwitch::FRAME_SIZE];
+        if (loraManager->paramSwitch().poll(millis(), paramFrame, sizeof(paramFrame))) {
+            radioTx.submit((const uint8_t*)paramFrame, strlen(paramFrame));
+        }
+
+        // Доставка сообщений из очереди, пока пир слышен и есть бюджет эфира
+        String frame;
+        if (txQueue.poll(loraManager->getParams(), millis(), frame)) {
+            radioTx.submit(frame, onQueueFrameSent);
+        }
+
+        // Кадры хоста в режиме модема
+        ModemTxRequest request;
+        if (serialModem->takeTxRequest(request)) {
+            radioTx.submit(request.data, request.len, onModemFrameSent, request.seq);
+        }
+
+        // Маяк синхронизации времени (передаёт только опорный узел)
+        if (timeSync.shouldBeacon(millis())) {
+            radioTx.submit(timeSync.buildBeacon(), onBeaconSent);
         }
         esp_task_wdt_reset();
         vTaskDelay(pdMS_TO_TICKS(10));
     }
 }
 
-// Заменяем существующую функцию taskMonitorStack
+// Асинхронная передача: запуск TX и завершение по прерыванию TxDone
+void taskRadioTx(void *parameter) {
+    esp_task_wdt_add(NULL);
+    for (;;) {
+        radioTx.process();
+        esp_task_wdt_reset();
+    }
+}
+
+// История метрик: отсчёт состояний и закрытие интервалов раз в секунду
+void taskMetricsHistory(void *parameter) {
+    esp_task_wdt_add(NULL);
+    for (;;) {
+        metricsHistory.process();
+        esp_task_wdt_reset();
+    }
+}
+
+// HTTP API: ответы JSON потоком в сокет
+void taskApiServer(void *parameter) {
+    esp_task_wdt_add(NULL);
+    for (;;) {
+        apiServer.process();
+        esp_task_wdt_reset();
+    }
+}
+
+// Шлюз: пакетная пересылка принятых кадров и обратный канал
+void taskGateway(void *parameter) {
+    esp_task_wdt_add(NULL);
+    for (;;) {
+        gateway->process();
+        esp_task_wdt_reset();
+    }
+}
+
+// Режим модема: вывод кадров хосту и разбор команд хоста
+void taskSerialModem(void *parameter) {
+    esp_task_wdt_add(NULL);
+    for (;;) {
+        serialModem->process();
+        esp_task_wdt_reset();
+    }
+}
+
+// Сканирование эфира: отсчёты RSSI по списку частот
+void taskSpectrumScan(void *parameter) {
+    esp_task_wdt_add(NULL);
+    for (;;) {
+        spectrumScanner->process();
+        esp_task_wdt_reset();
+    }
+}
+
+// Захват пакетов: запись кольца кадров в файл, TCP или Serial
+void taskPacketCapture(void *parameter) {
+    esp_task_wdt_add(NULL);
+    for (;;) {
+        packetCapture->process();
+        esp_task_wdt_reset();
+    }
+}
+
+// Мониторинг: загрузка CPU, куча и аудит стеков раз в секунду
 void taskMonitorStack(void *parameter) {
     esp_task_wdt_add(NULL);
     // Создаем экземпляр SystemMonitor, если он еще не создан
@@ -118,24 +435,24 @@ void taskMonitorStack(void *parameter) {
         systemMonitor = new SystemMonitor();
     }
     
+    TickType_t lastWake = xTaskGetTickCount();
     for (;;) {
-        // Обновляем данные мониторинга
+        // Отсчёт загрузки CPU строго раз в секунду: окна 1/10/60 с считаются в отсчётах
+        systemMonitor->sample();
         systemMonitor->update();
-        
-        // Логируем базовую информацию о стеке
-        // UBaseType_t freeStack = uxTaskGetStackHighWaterMark(NULL);
-        // Serial.printf("Free stack: %d bytes\n", freeStack);
+        heapProfileTick();
+        stackAuditor.update();
         
         // Периодически логируем полную статистику (раз в минуту)
         static uint8_t fullLogCounter = 0;
-        if (++fullLogCounter >= 6) {  // 6 * 10 секунд = 1 минута
+        if (++fullLogCounter >= 60) {
             systemMonitor->logTasksStatistics();
             systemMonitor->logMemoryStatistics();
             fullLogCounter = 0;
         }
         
         esp_task_wdt_reset();
-        vTaskDelay(pdMS_TO_TICKS(10000));  // Проверка каждые 10 секунд
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(1000));
     }
 }
 
@@ -143,14 +460,10 @@ void taskMonitorStack(void *parameter) {
 void taskWebInterface(void *parameter) {
     esp_task_wdt_add(NULL);
     for (;;) {
-        sett.tick();
-        
-        // Обновление данных для графика каждые 500 мс
-        // static uint32_t plotTimer = 0;
-        // if (millis() - plotTimer >= 500) {
-        //     plotTimer = millis();
-        //     plotManager.updateData();
-        // }
+        {
+            TRACE_SCOPE(TRACE_WEB_TICK, 0);
+            sett.tick();
+        }
         
         // Периодическое обновление данных LoRa каждые 5000 мс
         static uint32_t loraTimer = 0;
@@ -165,10 +478,10 @@ void taskWebInterface(void *parameter) {
             logTimer = millis();
             if (WiFi.getMode() == WIFI_STA || WiFi.getMode() == WIFI_AP_STA) {
                 if (WiFi.status() == WL_CONNECTED) {
-                    logger.println("WiFi подключен к " + WiFi.SSID() + ", сигнал: " + String(WiFi.RSSI()) + " dBm");
+                    LOGD(LOG_SINK_WEB, "WiFi подключен к %s, сигнал: %d dBm", WiFi.SSID(), WiFi.RSSI());
                 }
             }
-            logger.println("Свободная память: " + String(ESP.getFreeHeap()) + " байт");
+            LOGD(LOG_SINK_WEB, "Свободная память: %u байт", ESP.getFreeHeap());
         }
         
         esp_task_wdt_reset();
@@ -176,6 +489,14 @@ void taskWebInterface(void *parameter) {
     }
 }
 
+// Отложенный журнал: форматирование и вывод вне горячих путей
+void taskLogFormat(void *parameter) {
+    for (;;) {
+        logRingFlush();
+        vTaskDelay(pdMS_TO_TICKS(LOG_FLUSH_MS));
+    }
+}
+
 void taskDisplayUpdate(void *parameter) {
     esp_task_wdt_add(NULL);
     for (;;) {
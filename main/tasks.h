@@ -1,19 +1,36 @@
 #ifndef TASKS_H
 #define TASKS_H
 
+#include <Arduino.h>
 #include "config.h"
-#include <LoRa.h>  // Подключаем библиотеку LoRa
 #include "logging.h"
 
-// Создание всех задач
+// Задача приложения. Размер стека - константа из task-stacks.h,
+// которую генерирует аудит стеков (stack-audit.h)
+struct TaskSpec {
+    TaskFunction_t function;
+    const char* name;
+    const char* stackDefine;   // Имя константы размера стека в task-stacks.h
+    uint32_t stackSize;        // Байт
+    UBaseType_t priority;
+    BaseType_t core;
+};
+
+// Создание всех задач; с TASK_STATIC_STACKS 1 - на статических стеках
 void createTasks();
 
+// Таблица задач приложения
+const TaskSpec* getTaskSpecs(uint8_t& count);
+
 // Задача отправки "Hello" сообщений
 void taskSendHello(void *parameter);
 
 // Задача приема сообщений
 void taskReceive(void *parameter);
 
+// Задача асинхронной передачи кадров
+void taskRadioTx(void *parameter);
+
 // Задача мониторинга стека
 void taskMonitorStack(void *parameter);
 
@@ -23,4 +40,25 @@ void taskWebInterface(void *parameter);
 // Задача обновления дисплея
 void taskDisplayUpdate(void *parameter);
 
+// Задача шлюза LoRa -> UDP/MQTT
+void taskGateway(void *parameter);
+
+// Задача двоичного режима модема
+void taskSerialModem(void *parameter);
+
+// Задача сканирования эфира
+void taskSpectrumScan(void *parameter);
+
+// Задача захвата пакетов (pcap)
+void taskPacketCapture(void *parameter);
+
+// Задача истории метрик
+void taskMetricsHistory(void *parameter);
+
+// Задача HTTP API
+void taskApiServer(void *parameter);
+
+// Задача вывода отложенного журнала
+void taskLogFormat(void *parameter);
+
 #endif // TASKS_H
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "time-sync.h"
+#include "config.h"
+#include "logging.h"
+#include "esp_timer.h"
+
+// Глобальный экземпляр синхронизации времени
+TimeSync timeSync;
+
+TimeSync::TimeSync() {
+    _nodeId = 0;
+    _lastRootHeard = 0;
+    _beaconSeq = 0;
+    _lastBeaconTxUs = 0;
+    _lastBeaconMs = 0;
+    _beaconPending = false;
+    reset(0);
+}
+
+void TimeSync::reset(uint32_t rootId) {
+    _pendingSeq = 0;
+    _pendingRxUs = 0;
+    _sampleCount = 0;
+    _sampleIndex = 0;
+    _rejectedInRow = 0;
+    _fit.write([rootId](TimeSyncFit& fit) {
+        fit.rootId = rootId;
+        fit.refLocalUs = 0;
+        fit.offsetUs = 0;
+        fit.skew = 0.0;
+        fit.accuracyUs = UINT32_MAX;
+        fit.sampleCount = 0;
+    });
+}
+
+void TimeSync::setNodeId(uint32_t nodeId) {
+    _nodeId = nodeId;
+    reset(nodeId);
+}
+
+uint32_t TimeSync::getNodeId() const {
+    return _nodeId;
+}
+
+int64_t TimeSync::nowUs() const {
+    return localToGlobal(esp_timer_get_time());
+}
+
+int64_t TimeSync::offsetAt(const TimeSyncFit& fit, int64_t localUs) {
+    return fit.offsetUs + (int64_t)(fit.skew * (double)(localUs - fit.refLocalUs));
+}
+
+int64_t TimeSync::localToGlobal(int64_t localUs) const {
+    TimeSyncFit fit = _fit.read();
+    if (fit.rootId == _nodeId || fit.sampleCount == 0) {
+        return localUs;
+    }
+    return localUs + offsetAt(fit, localUs);
+}
+
+int64_t TimeSync::globalToLocal(int64_t globalUs) const {
+    TimeSyncFit fit = _fit.read();
+    if (fit.rootId == _nodeId || fit.sampleCount == 0) {
+        return globalUs;
+    }
+    // Дрейф мал, одной итерации достаточно
+    return globalUs - offsetAt(fit, globalUs - fit.offsetUs);
+}
+
+bool TimeSync::isRoot() const {
+    return _fit.read().rootId == _nodeId;
+}
+
+bool TimeSync::isSynced() const {
+    TimeSyncFit fit = _fit.read();
+    return fit.rootId == _nodeId || fit.sampleCount >= 2;
+}
+
+uint32_t TimeSync::getRootId() const {
+    return _fit.read().rootId;
+}
+
+int64_t TimeSync::getOffsetUs() const {
+    TimeSyncFit fit = _fit.read();
+    return fit.rootId == _nodeId ? 0 : fit.offsetUs;
+}
+
+float TimeSync::getDriftPpm() const {
+    TimeSyncFit fit = _fit.read();
+    return fit.rootId == _nodeId ? 0.0f : (float)(fit.skew * 1e6);
+}
+
+uint32_t TimeSync::getAccuracyUs() const {
+    TimeSyncFit fit = _fit.read();
+    return fit.rootId == _nodeId ? 0 : fit.accuracyUs;
+}
+
+uint32_t TimeSync::getSampleCount() const {
+    return _fit.read().sampleCount;
+}
+
+bool TimeSync::shouldBeacon(uint32_t nowMs) {
+    // Опорный узел пропал - снова считаем опорным себя
+    if (!isRoot() && nowMs - _lastRootHeard > TIME_SYNC_ROOT_TIMEOUT_MS) {
+        logger.println(warn_() + "Опорный узел времени не слышен, синхронизация сброшена");
+        reset(_nodeId);
+    }
+    return isRoot() && !_beaconPending && nowMs - _lastBeaconMs >= TIME_SYNC_BEACON_MS;
+}
+
+String TimeSync::buildBeacon() {
+    uint16_t prevSeq = _beaconSeq;
+    _beaconSeq++;
+    _beaconPending = true;
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "TSB:%08x:%u:%u:%lld", (unsigned int)_nodeId,
+             (unsigned int)_beaconSeq, (unsigned int)prevSeq, (long long)_lastBeaconTxUs);
+    return String(buffer);
+}
+
+void TimeSync::onBeaconSent(int64_t txDoneLocalUs, uint32_t nowMs) {
+    // Маяк не ушёл - следующий повторит прошлую метку
+    if (txDoneLocalUs != 0) {
+        _lastBeaconTxUs = localToGlobal(txDoneLocalUs);
+    }
+    _lastBeaconMs = nowMs;
+    _beaconPending = false;
+}
+
+bool TimeSync::handleBeacon(const String& msg, int64_t rxDoneLocalUs, uint32_t nowMs) {
+    unsigned int id = 0;
+    unsigned int seq = 0;
+    unsigned int prevSeq = 0;
+    long long prevTxUs = 0;
+    if (sscanf(msg.c_str() + 4, "%x:%u:%u:%lld", &id, &seq, &prevSeq, &prevTxUs) != 4) {
+        return false;
+    }
+    // Узлы с большим ID подстраиваются под нас
+    uint32_t rootId = getRootId();
+    if (id == _nodeId || id > rootId) {
+        return true;
+    }
+    if (id < rootId) {
+        logger.println("Опорный узел времени: " + String(id, HEX));
+        reset(id);
+    }
+    _lastRootHeard = nowMs;
+
+    // Метка TxDone предыдущего маяка + наша метка RxDone того же маяка = отсчёт смещения
+    if (prevTxUs != 0 && _pendingRxUs != 0 && _pendingSeq == prevSeq) {
+        addSample(_pendingRxUs, prevTxUs - _pendingRxUs);
+    }
+    _pendingSeq = seq;
+    _pendingRxUs = rxDoneLocalUs;
+    return true;
+}
+
+void TimeSync::addSample(int64_t localUs, int64_t offsetUs) {
+    // Отбрасываем выбросы (потерянный маяк, задержка прерывания), но после
+    // нескольких подряд считаем, что изменилось само смещение, и начинаем заново
+    if (_sampleCount >= 4) {
+        TimeSyncFit fit = _fit.read();
+        int64_t error = offsetUs - offsetAt(fit, localUs);
+        if (error > TIME_SYNC_OUTLIER_US || error < -TIME_SYNC_OUTLIER_US) {
+            if (++_rejectedInRow < 3) {
+                return;
+            }
+            reset(fit.rootId);
+        }
+    }
+    _rejectedInRow = 0;
+
+    _sampleLocal[_sampleIndex] = localUs;
+    _sampleOffset[_sampleIndex] = offsetUs;
+    _sampleIndex = (_sampleIndex + 1) % TIME_SYNC_SAMPLES;
+    if (_sampleCount < TIME_SYNC_SAMPLES) _sampleCount++;
+
+    recompute();
+}
+
+// Линейная регрессия offset = a + skew * (local - ref) по накопленным отсчётам.
+// Значения берутся относительно последнего отсчёта, чтобы не терять точность в double
+void TimeSync::recompute() {
+    uint8_t newest = (_sampleIndex + TIME_SYNC_SAMPLES - 1) % TIME_SYNC_SAMPLES;
+    int64_t refLocal = _sampleLocal[newest];
+    int64_t refOffset = _sampleOffset[newest];
+
+    double meanX = 0, meanY = 0;
+    for (uint8_t i = 0; i < _sampleCount; i++) {
+        meanX += (double)(_sampleLocal[i] - refLocal);
+        meanY += (double)(_sampleOffset[i] - refOffset);
+    }
+    meanX /= _sampleCount;
+    meanY /= _sampleCount;
+
+    double covXY = 0, varX = 0;
+    for (uint8_t i = 0; i < _sampleCount; i++) {
+        double dx = (double)(_sampleLocal[i] - refLocal) - meanX;
+        double dy = (double)(_sampleOffset[i] - refOffset) - meanY;
+        covXY += dx * dy;
+        varX += dx * dx;
+    }
+    double skew = (_sampleCount >= 2 && varX > 0) ? covXY / varX : 0.0;
+    double a = meanY - skew * meanX;
+
+    double sumSq = 0;
+    for (uint8_t i = 0; i < _sampleCount; i++) {
+        double x = (double)(_sampleLocal[i] - refLocal);
+        double residual = (double)(_sampleOffset[i] - refOffset) - (a + skew * x);
+        sumSq += residual * residual;
+    }
+
+    // Два отсчёта прямая проходит точно, оценка разброса появляется с третьего
+    uint32_t accuracyUs;
+    if (_sampleCount >= 3) {
+        accuracyUs = (uint32_t)sqrt(sumSq / (_sampleCount - 2));
+    } else {
+        accuracyUs = _sampleCount == 2 ? TIME_SYNC_OUTLIER_US : UINT32_MAX;
+    }
+    uint8_t count = _sampleCount;
+    int64_t offsetUs = refOffset + (int64_t)a;
+    _fit.write([refLocal, offsetUs, skew, accuracyUs, count](TimeSyncFit& fit) {
+        fit.refLocalUs = refLocal;
+        fit.offsetUs = offsetUs;
+        fit.skew = skew;
+        fit.accuracyUs = accuracyUs;
+        fit.sampleCount = count;
+    });
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <Arduino.h>
+#include "metrics.h"
+
+// Число пар (локальное время, смещение) в фильтре
+#define TIME_SYNC_SAMPLES 8
+
+// Результат фильтра: offset(t) = offsetUs + skew * (t - refLocalUs)
+struct TimeSyncFit {
+    uint32_t rootId;
+    int64_t refLocalUs;
+    int64_t offsetUs;
+    double skew;
+    uint32_t accuracyUs;
+    uint8_t sampleCount;
+};
+
+// Синхронизация времени между узлами по маякам.
+//
+// Опорным ("root") считается узел с наименьшим ID из слышимых. Он периодически
+// передаёт маяк
+//   TSB:<id>:<seq>:<prevSeq>:<prevTxUs>
+// где prevTxUs - метка TxDone предыдущего маяка (её нельзя вложить в сам маяк,
+// она известна только после передачи). Получатель сопоставляет её с меткой RxDone
+// того же маяка и получает отсчёт смещения. По последним TIME_SYNC_SAMPLES
+// отсчётам методом наименьших квадратов оцениваются смещение и дрейф часов.
+//
+// Маяки обрабатывает задача приёма; пересчёт времени (localToGlobal) и
+// геттеры вызываются из задач передачи, захвата и шлюза. Опорный узел и
+// коэффициенты фильтра публикуются одним снимком SeqLocked: читатель не
+// увидит смещение одного пересчёта с дрейфом другого.
+class TimeSync {
+public:
+    TimeSync();
+
+    void setNodeId(uint32_t nodeId);
+    uint32_t getNodeId() const;
+
+    // Синхронизированные часы: время опорного узла в микросекундах
+    int64_t nowUs() const;
+    int64_t localToGlobal(int64_t localUs) const;
+    int64_t globalToLocal(int64_t globalUs) const;
+
+    bool isRoot() const;
+    bool isSynced() const;
+    uint32_t getRootId() const;
+    int64_t getOffsetUs() const;
+    float getDriftPpm() const;
+    // Оценка точности: СКО остатков фильтра, мкс
+    uint32_t getAccuracyUs() const;
+    uint32_t getSampleCount() const;
+
+    // Протокол маяков. Передача асинхронная: пока построенный маяк не завершён
+    // (onBeaconSent, txDoneLocalUs = 0 - не передан), новый не строится
+    bool shouldBeacon(uint32_t nowMs);
+    String buildBeacon();
+    void onBeaconSent(int64_t txDoneLocalUs, uint32_t nowMs);
+    bool handleBeacon(const String& msg, int64_t rxDoneLocalUs, uint32_t nowMs);
+
+private:
+    void addSample(int64_t localUs, int64_t offsetUs);
+    void recompute();
+    // Сброс фильтра, опорный узел - rootId
+    void reset(uint32_t rootId);
+    static int64_t offsetAt(const TimeSyncFit& fit, int64_t localUs);
+
+    uint32_t _nodeId;
+    uint32_t _lastRootHeard;
+
+    // Собственные маяки
+    uint16_t _beaconSeq;
+    int64_t _lastBeaconTxUs;
+    uint32_t _lastBeaconMs;
+    volatile bool _beaconPending;
+
+    // Последний принятый маяк опорного узла, ожидающий метку TxDone
+    uint16_t _pendingSeq;
+    int64_t _pendingRxUs;
+
+    // Отсчёты фильтра (кольцевой буфер)
+    int64_t _sampleLocal[TIME_SYNC_SAMPLES];
+    int64_t _sampleOffset[TIME_SYNC_SAMPLES];
+    uint8_t _sampleCount;
+    uint8_t _sampleIndex;
+    uint8_t _rejectedInRow;
+
+    // Пишет только задача приёма
+    SeqLocked<TimeSyncFit> _fit;
+};
+
+// Глобальный экземпляр синхронизации времени
+extern TimeSync timeSync;
@@ -0,0 +1,214 @@
+#include "trace.h"
+#include "json-writer.h"
+#include "system-monitor.h"
+#include "esp_timer.h"
+#include "logging.h"
+#include <atomic>
+
+static const char* const TRACE_EVENT_NAMES[TRACE_EVENT_COUNT] = {
+    "hello_send", "receive_poll", "rx_frame", "radio_tx", "radio_tx_done",
+    "spi_wait", "spi_hold", "display_redraw", "web_tick", "self_test"
+};
+
+const char* traceEventName(TraceEvent event) {
+    return event < TRACE_EVENT_COUNT ? TRACE_EVENT_NAMES[event] : "unknown";
+}
+
+#if TRACE_ENABLED
+
+// Опорные пары ядра: запись ссылается на пару своей эпохи; записи старше
+// TRACE_ANCHORS эпох при выгрузке отбрасываются
+#define TRACE_ANCHORS       4
+#define TRACE_ANCHOR_CYCLES (1UL << 30)
+// Тот же период по esp_timer: 2^30 тактов - 4.47 с на 240 МГц. CCOUNT
+// переполняется за 17.9 с, и после долгой паузы разность тактов снова мала -
+// по одним тактам пауза не видна, метки уехали бы на период переполнения
+#define TRACE_ANCHOR_US     4000000
+
+struct TraceRecordSlot {
+    uint32_t cycles;
+    uint32_t task;
+    uint32_t arg;
+    uint16_t event;
+    char phase;
+    uint8_t epoch;
+};
+
+struct TraceAnchor {
+    int64_t us;       // 0 - пары ещё нет
+    uint32_t cycles;
+};
+
+struct TraceCore {
+    std::atomic<uint32_t> head;   // Событий записано всего
+    uint8_t epoch;
+    TraceAnchor anchors[TRACE_ANCHORS];
+    TraceRecordSlot ring[TRACE_RING_EVENTS];
+};
+
+static TraceCore traceCores[portNUM_PROCESSORS];
+// Только смена опорной пары; инициализированы до первой записи (мьютекс SPI в setup())
+static portMUX_TYPE traceLocks[portNUM_PROCESSORS] = {portMUX_INITIALIZER_UNLOCKED, portMUX_INITIALIZER_UNLOCKED};
+static std::atomic<bool> tracePaused(false);
+static uint32_t traceCostCycles = 0;
+
+// Новая опорная пара; редкий путь - раз в 2^30 тактов или TRACE_ANCHOR_US
+static uint8_t traceReanchor(TraceCore& core, portMUX_TYPE& lock) {
+    portENTER_CRITICAL(&lock);
+    uint8_t epoch = core.epoch + 1;
+    TraceAnchor& anchor = core.anchors[epoch % TRACE_ANCHORS];
+    anchor.us = esp_timer_get_time();
+    anchor.cycles = ESP.getCycleCount();
+    core.epoch = epoch;
+    portEXIT_CRITICAL(&lock);
+    return epoch;
+}
+
+void traceRecord(TraceEvent event, char phase, uint32_t arg) {
+    if (tracePaused.load(std::memory_order_relaxed)) {
+        return;
+    }
+    int coreId = xPortGetCoreID();
+    TraceCore& core = traceCores[coreId];
+    uint32_t cycles = ESP.getCycleCount();
+    uint8_t epoch = core.epoch;
+    const TraceAnchor& anchor = core.anchors[epoch % TRACE_ANCHORS];
+    if (anchor.us == 0 || cycles - anchor.cycles >= TRACE_ANCHOR_CYCLES ||
+        esp_timer_get_time() - anchor.us >= TRACE_ANCHOR_US) {
+        epoch = traceReanchor(core, traceLocks[coreId]);
+        cycles = ESP.getCycleCount();
+    }
+    uint32_t index = core.head.fetch_add(1, std::memory_order_relaxed);
+    TraceRecordSlot& slot = core.ring[index % TRACE_RING_EVENTS];
+    slot.cycles = cycles;
+    slot.task = (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+    slot.arg = arg;
+    slot.event = event;
+    slot.phase = phase;
+    slot.epoch = epoch;
+}
+
+void traceBegin() {
+    // Стоимость записи вместе с вызовом; кольцо после замера очищается
+    const uint32_t rounds = 1000;
+    TraceCore& core = traceCores[xPortGetCoreID()];
+    traceRecord(TRACE_SELF_TEST, TRACE_PHASE_INSTANT, 0);
+    uint32_t start = ESP.getCycleCount();
+    for (uint32_t i = 0; i < rounds; i++) {
+        traceRecord(TRACE_SELF_TEST, TRACE_PHASE_INSTANT, i);
+    }
+    traceCostCycles = (ESP.getCycleCount() - start) / rounds;
+    core.head.store(0, std::memory_order_relaxed);
+    logger.println("Трассировка: " + String(TRACE_RING_EVENTS) + " событий на ядро, запись ~" +
+                   String(traceCostCycles) + " тактов");
+}
+
+TraceStats traceStats() {
+    TraceStats stats = {0, TRACE_RING_EVENTS * portNUM_PROCESSORS, traceCostCycles};
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        stats.recorded += traceCores[i].head.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+static void writeMetadata(JsonWriter& json, const char* kind, uint32_t pid, uint32_t tid, const char* name) {
+    json.beginObject();
+    json.field("name", kind);
+    json.field("ph", "M");
+    json.field("pid", pid);
+    json.field("tid", tid);
+    json.key("args");
+    json.beginObject();
+    json.field("name", name);
+    json.endObject();
+    json.endObject();
+}
+
+size_t traceWriteChrome(Print& out) {
+    // Запись на паузе: слоты не меняются во время обхода
+    tracePaused.store(true, std::memory_order_relaxed);
+    vTaskDelay(pdMS_TO_TICKS(2));
+
+    double mhz = getCpuFrequencyMhz();
+    JsonWriter json(out);
+    json.beginObject();
+    json.field("displayTimeUnit", "ms");
+    json.key("traceEvents");
+    json.beginArray();
+
+    char name[16];
+    for (uint32_t pid = 0; pid < portNUM_PROCESSORS; pid++) {
+        snprintf(name, sizeof(name), "Core %lu", (unsigned long)pid);
+        writeMetadata(json, "process_name", pid, 0, name);
+        if (systemMonitor) {
+            SystemMonitor::TaskInfo tasks[SYSTEM_MONITOR_COPY_ROWS];
+            uint16_t first = 0;
+            uint16_t count;
+            while ((count = systemMonitor->getTasksInfo(tasks, SYSTEM_MONITOR_COPY_ROWS, first)) > 0) {
+                first += count;
+                for (uint16_t i = 0; i < count; i++) {
+                    writeMetadata(json, "thread_name", pid, (uint32_t)(uintptr_t)tasks[i].handle, tasks[i].name);
+                }
+            }
+        }
+    }
+
+    for (uint32_t pid = 0; pid < portNUM_PROCESSORS; pid++) {
+        TraceCore& core = traceCores[pid];
+        uint32_t head = core.head.load(std::memory_order_relaxed);
+        uint32_t count = min(head, (uint32_t)TRACE_RING_EVENTS);
+        for (uint32_t i = head - count; i != head; i++) {
+            const TraceRecordSlot& slot = core.ring[i % TRACE_RING_EVENTS];
+            if ((uint8_t)(core.epoch - slot.epoch) >= TRACE_ANCHORS) {
+                continue;
+            }
+            const TraceAnchor& anchor = core.anchors[slot.epoch % TRACE_ANCHORS];
+            double ts = anchor.us + (slot.cycles - anchor.cycles) / mhz;
+            char phase[2] = {slot.phase, '\0'};
+
+            json.beginObject();
+            json.field("name", traceEventName((TraceEvent)slot.event));
+            json.field("cat", slot.event == TRACE_SPI_HOLD ? "spi" : "lora");
+            json.field("ph", (const char*)phase);
+            json.field("ts", ts, 3);
+            json.field("pid", pid);
+            json.field("tid", slot.task);
+            if (slot.phase == TRACE_PHASE_ASYNC_BEGIN || slot.phase == TRACE_PHASE_ASYNC_END) {
+                json.field("id", (uint32_t)slot.event);
+            } else if (slot.phase == TRACE_PHASE_INSTANT) {
+                json.field("s", "t");
+            }
+            json.key("args");
+            json.beginObject();
+            json.field("arg", slot.arg);
+            json.endObject();
+            json.endObject();
+        }
+    }
+
+    json.endArray();
+    json.endObject();
+    size_t written = json.flush();
+    tracePaused.store(false, std::memory_order_relaxed);
+    return written;
+}
+
+#else
+
+void traceBegin() {}
+
+TraceStats traceStats() {
+    return {0, 0, 0};
+}
+
+size_t traceWriteChrome(Print& out) {
+    JsonWriter json(out);
+    json.beginObject();
+    json.key("traceEvents");
+    json.beginArray();
+    json.endArray();
+    json.endObject();
+    return json.flush();
+}
+
+#endif
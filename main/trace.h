@@ -0,0 +1,91 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// События трассировки. Имена для выгрузки - в traceEventName()
+enum TraceEvent : uint16_t {
+    TRACE_HELLO_SEND = 0,   // Подготовка и постановка HLO (arg - ID пакета)
+    TRACE_RECEIVE_POLL,     // Опрос приёма под мьютексом
+    TRACE_RX_FRAME,         // Принят кадр (arg - длина)
+    TRACE_RADIO_TX,         // Запуск передачи в задаче передачи (arg - длина)
+    TRACE_RADIO_TX_DONE,    // Завершение передачи (arg - 1 успех, 0 ошибка)
+    TRACE_SPI_WAIT,         // Ожидание spi_lock_mutex (arg в конце - 1 захвачен, 0 таймаут)
+    TRACE_SPI_HOLD,         // Мьютекс захвачен (асинхронный интервал)
+    TRACE_DISPLAY_REDRAW,   // Полная перерисовка страницы дисплея (arg - страница)
+    TRACE_WEB_TICK,         // sett.tick() веб-интерфейса
+    TRACE_SELF_TEST,        // Замер стоимости записи при старте
+    TRACE_EVENT_COUNT
+};
+
+// Фазы в терминах Chrome trace
+#define TRACE_PHASE_BEGIN       'B'
+#define TRACE_PHASE_END         'E'
+#define TRACE_PHASE_INSTANT     'i'
+#define TRACE_PHASE_ASYNC_BEGIN 'b'   // Интервалы, которые не вкладываются в B/E задачи
+#define TRACE_PHASE_ASYNC_END   'e'
+
+#if TRACE_ENABLED
+
+// Трассировщик событий.
+//
+// Запись - 16 байт фиксированного размера (такты CCOUNT, задача, аргумент,
+// событие, фаза) в кольцо своего ядра: слот резервируется атомарным
+// сложением индекса, блокировок нет, стоимость - десятки тактов. Старые
+// события затираются. Такты ядра переводятся во время esp_timer по опорной
+// паре (мкс, такты), которую запись обновляет раз в 2^30 тактов или 4 с по
+// esp_timer, если событий долго не было, - так время ядер сводится к общей
+// шкале и переживает переполнение CCOUNT.
+// Задачи закреплены за ядрами, поэтому такты и кольцо одной записи - одного ядра.
+//
+// Выгрузка (traceWriteChrome) ставит запись на паузу и выдаёт формат Chrome
+// trace JSON: chrome://tracing или ui.perfetto.dev, процессы - ядра,
+// потоки - задачи FreeRTOS.
+void traceRecord(TraceEvent event, char phase, uint32_t arg);
+
+// Интервал на время области видимости
+class TraceScope {
+public:
+    TraceScope(TraceEvent event, uint32_t arg) : _event(event) {
+        traceRecord(event, TRACE_PHASE_BEGIN, arg);
+    }
+    ~TraceScope() { traceRecord(_event, TRACE_PHASE_END, 0); }
+
+private:
+    TraceEvent _event;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#define TRACE_BEGIN(event, arg)       traceRecord(event, TRACE_PHASE_BEGIN, arg)
+#define TRACE_END(event, arg)         traceRecord(event, TRACE_PHASE_END, arg)
+#define TRACE_INSTANT(event, arg)     traceRecord(event, TRACE_PHASE_INSTANT, arg)
+#define TRACE_ASYNC_BEGIN(event, arg) traceRecord(event, TRACE_PHASE_ASYNC_BEGIN, arg)
+#define TRACE_ASYNC_END(event, arg)   traceRecord(event, TRACE_PHASE_ASYNC_END, arg)
+#define TRACE_SCOPE(event, arg)       TraceScope TRACE_CONCAT(_traceScope, __LINE__)(event, arg)
+
+#else
+
+#define TRACE_BEGIN(event, arg)       ((void)0)
+#define TRACE_END(event, arg)         ((void)0)
+#define TRACE_INSTANT(event, arg)     ((void)0)
+#define TRACE_ASYNC_BEGIN(event, arg) ((void)0)
+#define TRACE_ASYNC_END(event, arg)   ((void)0)
+#define TRACE_SCOPE(event, arg)       ((void)0)
+
+#endif
+
+// Метрики трассировщика
+struct TraceStats {
+    uint32_t recorded;      // Событий записано с начала
+    uint32_t capacity;      // Событий в кольцах всех ядер
+    uint32_t costCycles;    // Стоимость одной записи, такты (замер при старте)
+};
+
+// Опорное время ядер и замер стоимости записи; вызывается до запуска задач
+void traceBegin();
+TraceStats traceStats();
+const char* traceEventName(TraceEvent event);
+
+// Содержимое колец в формате Chrome trace JSON; без TRACE_ENABLED - пустой список
+size_t traceWriteChrome(Print& out);
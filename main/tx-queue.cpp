@@ -0,0 +1,468 @@
+#include "tx-queue.h"
+#include "config.h"
+#include "logging.h"
+#include "lora-airtime.h"
+
+// Маркер начала записи и размер заголовка записи
+#define TXQ_RECORD_MARKER 0xA5
+#define TXQ_RECORD_HEADER 10
+#define TXQ_HEAD_MAGIC    0x51585431  // "TXQ1"
+
+// Глобальная очередь исходящих сообщений
+TxQueue txQueue;
+
+TxQueue::TxQueue() {
+    _fs = nullptr;
+    _lock = nullptr;
+    _headSegment = 0;
+    _headOffset = 0;
+    _tailSegment = 0;
+    _tailSize = 0;
+    _bootSegment = 0;
+    _nextSeq = 1;
+    _depth = 0;
+    _bytes = 0;
+    _writeLength = 0;
+    _lastFlush = 0;
+    _headDirty = false;
+    _inFlight = false;
+    _inFlightSeq = 0;
+    _ackDeadline = 0;
+    _attempts = 0;
+    _ackWaitMs = 0;
+    _peerHeard = 0;
+    _headNextOffset = 0;
+    _headEnqueuedMs = 0;
+    _headCached = false;
+    _lastDeliveredSeq = 0;
+    _received = 0;
+    _budgetUs = 0;
+    _budgetUpdated = 0;
+    _enqueued = 0;
+    _delivered = 0;
+    _dropped = 0;
+    _retries = 0;
+    _rateWindowStart = 0;
+    _rateWindowCount = 0;
+    _drainRate = 0.0f;
+}
+
+bool TxQueue::begin(fs::FS& fs) {
+    _fs = &fs;
+    if (_lock == nullptr) {
+        _lock = xSemaphoreCreateMutex();
+    }
+    if (!_fs->exists(TXQ_DIR)) {
+        _fs->mkdir(TXQ_DIR);
+    }
+
+    // Позиция головы и следующий seq
+    File head = _fs->open(String(TXQ_DIR) + "/head", FILE_READ);
+    if (head) {
+        uint32_t state[4] = {0};
+        if (head.read((uint8_t*)state, sizeof(state)) == sizeof(state) && state[0] == TXQ_HEAD_MAGIC) {
+            _headSegment = state[1];
+            _headOffset = state[2];
+            _nextSeq = state[3];
+        }
+        head.close();
+    }
+
+    // Диапазон существующих сегментов
+    bool found = false;
+    uint32_t minSegment = 0;
+    uint32_t maxSegment = 0;
+    File dir = _fs->open(TXQ_DIR);
+    if (dir && dir.isDirectory()) {
+        File file = dir.openNextFile();
+        while (file) {
+            String name = file.name();
+            name = name.substring(name.lastIndexOf('/') + 1);
+            if (name.endsWith(".seg")) {
+                uint32_t segment = name.toInt();
+                if (!found || segment < minSegment) minSegment = segment;
+                if (!found || segment > maxSegment) maxSegment = segment;
+                found = true;
+                _bytes += file.size();
+            }
+            file.close();
+            file = dir.openNextFile();
+        }
+    }
+
+    if (!found) {
+        _headSegment = _headSegment + 1;
+        _headOffset = 0;
+        _tailSegment = _headSegment;
+        _bytes = 0;
+    } else {
+        if (_headSegment < minSegment || _headSegment > maxSegment) {
+            _headSegment = minSegment;
+            _headOffset = 0;
+        }
+        // Каждая загрузка пишет в новый сегмент: оборванная запись в хвосте прошлой не мешает
+        _tailSegment = maxSegment + 1;
+    }
+    _bootSegment = _tailSegment;
+    _tailSize = 0;
+
+    // Подсчёт сообщений и восстановление seq
+    Record record;
+    for (uint32_t segment = _headSegment; found && segment <= maxSegment; segment++) {
+        uint32_t offset = segment == _headSegment ? _headOffset : 0;
+        uint32_t next = 0;
+        while (readRecord(segment, offset, record, next)) {
+            _depth++;
+            if (record.seq >= _nextSeq) _nextSeq = record.seq + 1;
+            offset = next;
+        }
+    }
+    if (_nextSeq == 0) _nextSeq = 1;
+
+    logger.println("Очередь отправки: " + String(_depth) + " сообщений, " + String(_bytes) + " байт");
+    return true;
+}
+
+String TxQueue::segmentPath(uint32_t segment) const {
+    return String(TXQ_DIR) + "/" + String(segment) + ".seg";
+}
+
+bool TxQueue::readRecord(uint32_t segment, uint32_t offset, Record& record, uint32_t& next) {
+    File file = _fs->open(segmentPath(segment), FILE_READ);
+    if (!file) {
+        return false;
+    }
+    uint8_t header[TXQ_RECORD_HEADER];
+    bool ok = file.seek(offset) &&
+              file.read(header, sizeof(header)) == sizeof(header) &&
+              header[0] == TXQ_RECORD_MARKER &&
+              header[1] > 0 && header[1] <= TXQ_MAX_PAYLOAD;
+    if (ok) {
+        record.len = header[1];
+        memcpy(&record.seq, header + 2, 4);
+        memcpy(&record.enqueuedMs, header + 6, 4);
+        ok = file.read((uint8_t*)record.payload, record.len) == record.len;
+        record.payload[record.len] = '\0';
+        next = offset + TXQ_RECORD_HEADER + record.len;
+    }
+    file.close();
+    return ok;
+}
+
+// Чтение головы очереди. Сегменты, в которых больше нет записей
+// (всё подтверждено или хвост оборван), удаляются по пути
+bool TxQueue::readHead(Record& record) {
+    if (_depth == 0) {
+        return false;
+    }
+    // Голова в ещё не сброшенной части буфера
+    if (_headSegment == _tailSegment && _headOffset >= _tailSize - _writeLength) {
+        flushLocked(millis());
+    }
+    while (true) {
+        uint32_t next = 0;
+        if (readRecord(_headSegment, _headOffset, record, next)) {
+            _headNextOffset = next;
+            _headEnqueuedMs = _headSegment < _bootSegment ? 0 : record.enqueuedMs;
+            _headCached = true;
+            return true;
+        }
+        if (_headSegment >= _tailSegment) {
+            // Записей больше нет - счётчик разошёлся с файлами
+            _depth = 0;
+            return false;
+        }
+        File file = _fs->open(segmentPath(_headSegment), FILE_READ);
+        if (file) {
+            _bytes -= min((uint32_t)file.size(), _bytes);
+            file.close();
+        }
+        _fs->remove(segmentPath(_headSegment));
+        _headSegment++;
+        _headOffset = 0;
+        _headDirty = true;
+    }
+}
+
+void TxQueue::advanceHead(uint32_t now) {
+    _headOffset = _headNextOffset;
+    _headCached = false;
+    _headDirty = true;
+    if (_depth > 0) _depth--;
+
+    // Сегмент полностью подтверждён - удаляем
+    if (_headSegment < _tailSegment) {
+        File file = _fs->open(segmentPath(_headSegment), FILE_READ);
+        uint32_t size = file ? file.size() : 0;
+        if (file) file.close();
+        if (_headOffset >= size) {
+            _fs->remove(segmentPath(_headSegment));
+            _bytes -= min(size, _bytes);
+            _headSegment++;
+            _headOffset = 0;
+        }
+    }
+}
+
+void TxQueue::dropOldestSegment() {
+    uint32_t count = 0;
+    uint32_t offset = _headOffset;
+    uint32_t next = 0;
+    Record record;
+    while (readRecord(_headSegment, offset, record, next)) {
+        count++;
+        offset = next;
+    }
+
+    File file = _fs->open(segmentPath(_headSegment), FILE_READ);
+    if (file) {
+        _bytes -= min((uint32_t)file.size(), _bytes);
+        file.close();
+    }
+    _fs->remove(segmentPath(_headSegment));
+    _headSegment++;
+    _headOffset = 0;
+    _headCached = false;
+    _headDirty = true;
+    _inFlight = false;
+
+    _depth -= min(count, _depth);
+    _dropped += count;
+    logger.println(warn_() + "Очередь отправки переполнена, вытеснено " + String(count) + " сообщений");
+}
+
+void TxQueue::saveHead() {
+    uint32_t state[4] = {TXQ_HEAD_MAGIC, _headSegment, _headOffset, _nextSeq};
+    File head = _fs->open(String(TXQ_DIR) + "/head", FILE_WRITE);
+    if (head) {
+        head.write((const uint8_t*)state, sizeof(state));
+        head.close();
+    }
+    _headDirty = false;
+}
+
+void TxQueue::flushLocked(uint32_t now) {
+    if (_writeLength > 0) {
+        File file = _fs->open(segmentPath(_tailSegment), FILE_APPEND);
+        if (file) {
+            file.write(_writeBuffer, _writeLength);
+            file.close();
+        } else {
+            logger.println(error_() + "Очередь отправки: ошибка записи сегмента " + String(_tailSegment));
+        }
+        _writeLength = 0;
+    }
+    if (_headDirty) {
+        saveHead();
+    }
+    _lastFlush = now;
+}
+
+void TxQueue::flush(uint32_t now) {
+    if (_fs == nullptr) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    flushLocked(now);
+    xSemaphoreGive(_lock);
+}
+
+bool TxQueue::enqueue(const String& payload, uint32_t now) {
+    if (_fs == nullptr || payload.length() == 0 || payload.length() > TXQ_MAX_PAYLOAD) {
+        return false;
+    }
+    uint32_t recordSize = TXQ_RECORD_HEADER + payload.length();
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+
+    // Ограничение объёма: вытесняем самые старые сегменты
+    while (_bytes + recordSize > TXQ_MAX_BYTES && _headSegment < _tailSegment) {
+        dropOldestSegment();
+    }
+    if (_bytes + recordSize > TXQ_MAX_BYTES) {
+        xSemaphoreGive(_lock);
+        return false;
+    }
+
+    // Новый сегмент, когда текущий заполнен
+    if (_tailSize + recordSize > TXQ_SEGMENT_BYTES && _tailSize > 0) {
+        flushLocked(now);
+        _tailSegment++;
+        _tailSize = 0;
+    }
+    if (_writeLength + recordSize > TXQ_WRITE_BUFFER) {
+        flushLocked(now);
+    }
+
+    uint32_t seq = _nextSeq++;
+    if (_nextSeq == 0) _nextSeq = 1;
+    uint8_t* out = _writeBuffer + _writeLength;
+    out[0] = TXQ_RECORD_MARKER;
+    out[1] = payload.length();
+    memcpy(out + 2, &seq, 4);
+    memcpy(out + 6, &now, 4);
+    memcpy(out + TXQ_RECORD_HEADER, payload.c_str(), payload.length());
+    _writeLength += recordSize;
+    _tailSize += recordSize;
+    _bytes += recordSize;
+    _depth++;
+    _enqueued++;
+    _headDirty = true;
+
+    if (_writeLength >= TXQ_FLUSH_BYTES) {
+        flushLocked(now);
+    }
+    xSemaphoreGive(_lock);
+    return true;
+}
+
+bool TxQueue::handleMessage(const String& msg, uint32_t now, String& reply, String& delivered) {
+    reply = "";
+    delivered = "";
+    if (_fs == nullptr) {
+        return false;
+    }
+
+    if (msg.startsWith("DAT:")) {
+        int separator = msg.indexOf(':', 4);
+        if (separator < 0) {
+            return true;
+        }
+        uint32_t seq = strtoul(msg.c_str() + 4, nullptr, 10);
+        reply = "DAK:" + String(seq);
+
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        // Повтор (наш DAK потерялся) подтверждаем, но не доставляем второй раз.
+        // Большой откат seq - пир начал очередь заново
+        if (seq != _lastDeliveredSeq &&
+            (seq > _lastDeliveredSeq || _lastDeliveredSeq - seq > 1000)) {
+            _lastDeliveredSeq = seq;
+            _received++;
+            delivered = msg.substring(separator + 1);
+            _lastReceived = delivered;
+        }
+        xSemaphoreGive(_lock);
+        return true;
+    }
+
+    if (msg.startsWith("DAK:")) {
+        uint32_t seq = strtoul(msg.c_str() + 4, nullptr, 10);
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        if (_inFlight && seq == _inFlightSeq) {
+            _inFlight = false;
+            _attempts = 0;
+            advanceHead(now);
+            _delivered++;
+            _rateWindowCount++;
+        }
+        xSemaphoreGive(_lock);
+        return true;
+    }
+
+    return false;
+}
+
+void TxQueue::onTraffic(uint32_t now) {
+    _peerHeard = now ? now : 1;
+}
+
+bool TxQueue::peerPresent(uint32_t now) const {
+    return _peerHeard != 0 && now - _peerHeard < TXQ_PEER_TIMEOUT_MS;
+}
+
+void TxQueue::refillBudget(uint32_t now) {
+    uint32_t elapsed = now - _budgetUpdated;
+    _budgetUpdated = now;
+    _budgetUs += (int64_t)elapsed * 10 * LORA_DUTY_CYCLE_PERCENT;
+    int64_t capUs = (int64_t)DUTY_CYCLE_WINDOW_MS * 10 * LORA_DUTY_CYCLE_PERCENT;
+    if (_budgetUs > capUs) _budgetUs = capUs;
+}
+
+bool TxQueue::poll(const LoRaParams& params, uint32_t now, String& out) {
+    if (_fs == nullptr) {
+        return false;
+    }
+    xSemaphoreTake(_lock, portMAX_DELAY);
+
+    if (now - _lastFlush >= TXQ_FLUSH_MS && (_writeLength > 0 || _headDirty)) {
+        flushLocked(now);
+    }
+
+    // Скорость доставки по окнам в 10 секунд
+    if (now - _rateWindowStart >= 10000) {
+        float rate = _rateWindowCount * 1000.0f / (now - _rateWindowStart);
+        _drainRate = (ALPHA * rate) + ((1 - ALPHA) * _drainRate);
+        _rateWindowStart = now;
+        _rateWindowCount = 0;
+    }
+
+    refillBudget(now);
+
+    bool send = false;
+    if (_inFlight && (int32_t)(now - _ackDeadline) >= 0) {
+        // DAK не пришёл
+        _inFlight = false;
+        _retries++;
+        if (++_attempts >= TXQ_MAX_RETRIES) {
+            logger.println(warn_() + "Пир не подтверждает сообщения, доставка приостановлена");
+            _attempts = 0;
+            _peerHeard = 0;
+        }
+    }
+
+    Record record;
+    if (!_inFlight && _depth > 0 && peerPresent(now) && _budgetUs > 0 && readHead(record)) {
+        out = "DAT:" + String(record.seq) + ":" + String(record.payload);
+        _inFlight = true;
+        _inFlightSeq = record.seq;
+        // Ожидание DAK: эфир самого кадра, ответа и запас на обработку у пира
+        _ackWaitMs = loraFrameAirtimeUs(params, 4 + 10) / 1000 + TXQ_ACK_MARGIN_MS;
+        _ackDeadline = now + loraFrameAirtimeUs(params, out.length()) / 1000 + _ackWaitMs;
+        send = true;
+    }
+
+    xSemaphoreGive(_lock);
+    return send;
+}
+
+void TxQueue::onSent(uint32_t airtimeUs, uint32_t now) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _budgetUs -= airtimeUs;
+    if (_inFlight) {
+        _ackDeadline = now + _ackWaitMs;
+    }
+    xSemaphoreGive(_lock);
+}
+
+TxQueueStats TxQueue::getStats(uint32_t now) {
+    TxQueueStats stats = {};
+    if (_fs == nullptr) {
+        return stats;
+    }
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    Record record;
+    if (_depth > 0 && (_headCached || readHead(record))) {
+        stats.oldestAgeMs = now - _headEnqueuedMs;
+    }
+    refillBudget(now);
+    stats.depth = _depth;
+    stats.bytes = _bytes;
+    stats.drainRate = _drainRate;
+    stats.enqueued = _enqueued;
+    stats.delivered = _delivered;
+    stats.dropped = _dropped;
+    stats.retries = _retries;
+    stats.dutyWaitMs = _budgetUs < 0 ? (uint32_t)(-_budgetUs / (10 * LORA_DUTY_CYCLE_PERCENT)) : 0;
+    stats.peerPresent = peerPresent(now);
+    stats.received = _received;
+    xSemaphoreGive(_lock);
+    return stats;
+}
+
+String TxQueue::getLastReceived() {
+    if (_lock == nullptr) {
+        return "";
+    }
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    String last = _lastReceived;
+    xSemaphoreGive(_lock);
+    return last;
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "param-switch.h"
+
+// Размер буфера пакетной записи и максимальная длина сообщения
+#define TXQ_WRITE_BUFFER 1024
+#define TXQ_MAX_PAYLOAD  200
+
+// Метрики очереди для интерфейса
+struct TxQueueStats {
+    uint32_t depth;          // Сообщений в очереди
+    uint32_t bytes;          // Занято на файловой системе
+    uint32_t oldestAgeMs;    // Возраст самого старого сообщения
+    float drainRate;         // Доставлено сообщений в секунду (сглаженно)
+    uint32_t enqueued;       // Всего поставлено в очередь
+    uint32_t delivered;      // Подтверждено пиром
+    uint32_t dropped;        // Вытеснено при переполнении
+    uint32_t retries;        // Повторные передачи
+    uint32_t dutyWaitMs;     // Сколько осталось ждать бюджета эфира
+    bool peerPresent;
+    uint32_t received;       // Принято сообщений от пира
+};
+
+// Очередь исходящих сообщений с хранением на LittleFS (store-and-forward).
+//
+// Сообщения дописываются в сегменты TXQ_DIR/<n>.seg (только добавление в конец).
+// Запись <0xA5><len><seq:4><enqueuedMs:4><payload>. Новые записи копятся в RAM
+// и сбрасываются одним вызовом записи (пакетный fsync) раз в TXQ_FLUSH_MS или при
+// заполнении буфера. Позиция головы и следующий seq хранятся в TXQ_DIR/head и
+// сохраняются вместе со сбросом, поэтому после перезагрузки возможна повторная
+// отправка нескольких сообщений - получатель отбрасывает дубликаты по seq.
+// Полностью подтверждённые сегменты удаляются; при превышении TXQ_MAX_BYTES
+// вытесняется самый старый сегмент.
+//
+// Доставка (текстовые кадры, как HLO/ACK):
+//   DAT:<seq>:<payload>  - сообщение из головы очереди
+//   DAK:<seq>            - подтверждение получателя
+// Передача идёт только пока пир слышен, по одному кадру без ожидания сверх
+// эфирного времени ACK, в пределах бюджета занятости эфира LORA_DUTY_CYCLE_PERCENT.
+//
+// Класс работает с любой fs::FS, поэтому может быть собран и с файловой системой
+// поверх каталога.
+class TxQueue {
+public:
+    TxQueue();
+
+    // Загрузка состояния с файловой системы
+    bool begin(fs::FS& fs);
+
+    // Постановка сообщения в очередь (из любой задачи)
+    bool enqueue(const String& payload, uint32_t now);
+
+    // Обработка принятого кадра DAT/DAK. Возвращает true, если кадр относится к очереди;
+    // reply - подтверждение для отправки, delivered - новое принятое сообщение
+    bool handleMessage(const String& msg, uint32_t now, String& reply, String& delivered);
+
+    // Любой принятый кадр: пир в зоне связи
+    void onTraffic(uint32_t now);
+
+    // Периодическая обработка: сброс буфера и отправка. true - нужно отправить out
+    bool poll(const LoRaParams& params, uint32_t now, String& out);
+
+    // Фактическое эфирное время отправленного кадра
+    void onSent(uint32_t airtimeUs, uint32_t now);
+
+    // Принудительный сброс буфера записи
+    void flush(uint32_t now);
+
+    TxQueueStats getStats(uint32_t now);
+    String getLastReceived();
+
+private:
+    struct Record {
+        uint32_t seq;
+        uint32_t enqueuedMs;
+        uint8_t len;
+        char payload[TXQ_MAX_PAYLOAD + 1];
+    };
+
+    String segmentPath(uint32_t segment) const;
+    bool readRecord(uint32_t segment, uint32_t offset, Record& record, uint32_t& next);
+    bool readHead(Record& record);
+    void advanceHead(uint32_t now);
+    void dropOldestSegment();
+    void saveHead();
+    void flushLocked(uint32_t now);
+    void refillBudget(uint32_t now);
+    bool peerPresent(uint32_t now) const;
+
+    fs::FS* _fs;
+    SemaphoreHandle_t _lock;
+
+    // Голова (первое неподтверждённое сообщение) и хвост (сегмент для записи)
+    uint32_t _headSegment;
+    uint32_t _headOffset;
+    uint32_t _tailSegment;
+    uint32_t _tailSize;       // Записано в хвостовой сегмент, включая буфер
+    uint32_t _bootSegment;    // Первый сегмент этой загрузки
+    uint32_t _nextSeq;
+    uint32_t _depth;
+    uint32_t _bytes;
+
+    // Буфер пакетной записи
+    uint8_t _writeBuffer[TXQ_WRITE_BUFFER];
+    uint16_t _writeLength;
+    uint32_t _lastFlush;
+    bool _headDirty;
+
+    // Передача
+    bool _inFlight;
+    uint32_t _inFlightSeq;
+    uint32_t _ackDeadline;
+    uint8_t _attempts;
+    uint32_t _ackWaitMs;
+    uint32_t _peerHeard;
+    uint32_t _headNextOffset;    // Смещение записи после головы
+    uint32_t _headEnqueuedMs;
+    bool _headCached;
+
+    // Приём
+    uint32_t _lastDeliveredSeq;
+    uint32_t _received;
+    String _lastReceived;
+
+    // Бюджет эфира (token bucket, мкс эфирного времени)
+    int64_t _budgetUs;
+    uint32_t _budgetUpdated;
+
+    // Метрики
+    uint32_t _enqueued;
+    uint32_t _delivered;
+    uint32_t _dropped;
+    uint32_t _retries;
+    uint32_t _rateWindowStart;
+    uint32_t _rateWindowCount;
+    float _drainRate;
+};
+
+// Глобальная очередь исходящих сообщений
+extern TxQueue txQueue;
@@ -1,6 +1,24 @@
 #include "ui-builder.h"
 #include "statistics.h"
 #include "logging.h"
+#include "time-sync.h"
+#include "radio-events.h"
+#include "tx-queue.h"
+#include "gateway.h"
+#include "serial-modem.h"
+#include "packet-capture.h"
+#include "spectrum-scan.h"
+#include "lora-airtime.h"
+#include "sx127x.h"
+#include "radio-tx.h"
+#include "led.h"
+#include "api-server.h"
+#include "trace.h"
+#include "log-ring.h"
+#include "log-history.h"
+#include "profiler.h"
+#include "heap-profiler.h"
+#include "stack-audit.h"
 
 static String sfOptions = "7;8;9;10;11;12";
 static int sfOptionsValues[] = {7, 8, 9, 10, 11, 12};
@@ -9,6 +27,47 @@ static float bwOptionsValues[] = {7.8, 10.4, 15.6, 20.8, 31.25, 41.7, 62.5, 125,
 static String crOptions = "5;6;7;8";
 static int crOptionsValues[] = {5, 6, 7, 8};
 
+// Выделения кучи задачи веб-интерфейса при последнем построении каждой вкладки
+struct TabHeapCost {
+    uint32_t builds;
+    uint32_t allocs;
+    uint32_t bytes;
+};
+#if DISPLAY_ENABLED
+static const char* const tabNames[] = {"Dashboard", "LoRa Status", "Logs", "Settings", "Display", "System"};
+#else
+static const char* const tabNames[] = {"Dashboard", "LoRa Status", "Logs", "Settings", "System"};
+#endif
+static const uint8_t TAB_COUNT = sizeof(tabNames) / sizeof(tabNames[0]);
+static TabHeapCost tabHeapCost[TAB_COUNT];
+
+// Подпись из буфера на стеке: вкладки перестраиваются при каждом обновлении
+// страницы, сборка подписей из String выделяла бы память на каждую
+static void labelf(sets::Builder& b, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+static void labelf(sets::Builder& b, const char* format, ...) {
+    char text[UI_LABEL_SIZE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    b.Label(text);
+}
+
+// Дописывание в буфер подписи; возвращает новую длину (не больше size - 1)
+static size_t appendf(char* out, size_t size, size_t length, const char* format, ...) __attribute__((format(printf, 4, 5)));
+
+static size_t appendf(char* out, size_t size, size_t length, const char* format, ...) {
+    if (length + 1 >= size) {
+        return length;
+    }
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(out + length, size - length, format, args);
+    va_end(args);
+    return written > 0 ? min(length + written, size - 1) : length;
+}
+
 // Конструктор
 UIBuilder::UIBuilder(GyverDB* db) : _db(db), _needRestart(false) {
 }
@@ -35,6 +94,13 @@ void UIBuilder::buildInterface(sets::Builder& b) {
         return;
     }
 
+    static bool watching = false;
+    if (!watching) {
+        heapProfileWatch(xTaskGetCurrentTaskHandle());
+        watching = true;
+    }
+    HeapTaskInfo before = heapProfileWatched();
+
     switch (tab) {
         case Tabs::Dashboard:
             buildDashboardTab(b);
@@ -57,6 +123,14 @@ void UIBuilder::buildInterface(sets::Builder& b) {
             buildSystemMonitorTab(b);
             break;
     }
+
+    HeapTaskInfo after = heapProfileWatched();
+    if (tab < TAB_COUNT) {
+        TabHeapCost& cost = tabHeapCost[tab];
+        cost.builds++;
+        cost.allocs = after.allocs - before.allocs;
+        cost.bytes = after.bytes - before.bytes;
+    }
 }
 
 // Добавить реализацию метода buildDisplayTab:
@@ -144,28 +218,68 @@ void UIBuilder::buildDashboardTab(sets::Builder& b) {
     {
         sets::Group g(b, "Статус системы");
         b.Label(wifiManager->getStatusText());
-        b.Label("Время работы: " + String(millis() / 1000) + " сек");
-        b.Label("Свободная память: " + String(ESP.getFreeHeap()) + " байт");
+        labelf(b, "Время работы: %u сек", (unsigned int)(millis() / 1000));
+        labelf(b, "Свободная память: %u байт", (unsigned int)ESP.getFreeHeap());
     }
 
     // Статистика LoRa
     {
         sets::Group g(b, "Общая статистика LoRa");
-        b.Label("Отправлено пакетов: " + String(totalSent));
-        b.Label("Доставлено пакетов: " + String(totalReceived));
-        if (totalSent > 0) {
-            float successRate = (totalReceived / (float)totalSent) * 100.0;
-            b.Label("Успешность доставки: " + String(successRate, 1) + "%");
-            b.Label("Сглаженная успешность: " + String(successRateSmoothed, 1) + "%");
+        uint32_t sent = totalSent.value();
+        uint32_t received = totalReceived.value();
+        labelf(b, "Отправлено пакетов: %u", sent);
+        labelf(b, "Доставлено пакетов: %u", received);
+        if (sent > 0) {
+            float successRate = (received / (float)sent) * 100.0;
+            labelf(b, "Успешность доставки: %.1f%%", successRate);
+            labelf(b, "Сглаженная успешность: %.1f%%", successRateSmoothed.value());
         }
     }
 
-    // // График данных
-    // {
-    //     sets::Group g(b, "График успешности доставки");
-    //     // Вызываем Plot с тремя параметрами: идентификатор, JSON-данные и объединённая подпись осей.
-    //     b.Plot(H(plot), plotManager.getPlotJson(), "Время, Успешность (%)");
-    // }
+    // История метрик: строка-график по последним интервалам выбранного уровня
+    {
+        sets::Group g(b, "История");
+        static int historyTier = HISTORY_MINUTES;
+        b.Select("Разрешение", "Секунды;Минуты;Часы", &historyTier);
+        HistoryTier tier = (HistoryTier)constrain(historyTier, 0, HISTORY_TIER_COUNT - 1);
+        static const char* names[HISTORY_SERIES_COUNT] = {"PDR, %", "RTT, ms", "RSSI, dBm", "SNR, dB", "Куча, KB", "CPU, %"};
+        static const char* levels[] = {"▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+        const uint16_t points = 40;
+        for (uint8_t s = 0; s < HISTORY_SERIES_COUNT; s++) {
+            HistoryBucket range = metricsHistory.summary((HistorySeries)s, tier, points);
+            if (range.count == 0) {
+                labelf(b, "%s: нет данных", names[s]);
+                continue;
+            }
+            float span = max(range.max - range.min, 0.001f);
+            // Символ уровня - 3 байта UTF-8
+            char line[points * 3 + 1];
+            size_t length = 0;
+            metricsHistory.visit((HistorySeries)s, tier, points, [&](const HistoryBucket& bucket) {
+                const char* level = bucket.count ? levels[constrain((int)((bucket.avg() - range.min) / span * 7.99f), 0, 7)] : " ";
+                size_t size = strlen(level);
+                if (length + size < sizeof(line)) {
+                    memcpy(line + length, level, size);
+                    length += size;
+                }
+            });
+            line[length] = '\0';
+            labelf(b, "%s %.1f..%.1f, ср. %.1f: %s", names[s], range.min, range.max, range.avg(), line);
+        }
+        labelf(b, "Окно: %.1f мин", min(points, metricsHistory.size(tier)) * MetricsHistory::bucketSeconds(tier) / 60.0);
+    }
+}
+
+// Выгрузка отчёта в Serial кнопкой интерфейса. В режиме модема порт занят
+// двоичным протоколом - только предупреждение в журнал
+static void dumpToSerial(const char* what, size_t (*write)(Print&)) {
+    if (serialModem && serialModem->isActive()) {
+        logger.println(warn_() + "Выгрузка " + what + " в Serial недоступна в режиме модема");
+        return;
+    }
+    serialLog.println();
+    write(serialLog);
+    serialLog.println();
 }
 
 // Функция отображения вкладки с логами
@@ -174,6 +288,25 @@ void UIBuilder::buildLogsTab(sets::Builder& b) {
     {
         sets::Group g(b, "Логи системы");
         b.Log(H("logger"), logger);
+        // Виджет библиотеки шлёт свой буфер целиком и курсора не знает; дописывает
+        // только новые строки страница /log на порту API
+        IPAddress ip = WiFi.status() == WL_CONNECTED ? WiFi.localIP() : WiFi.softAPIP();
+        labelf(b, "Весь журнал: http://%s:%u/log", ip.toString().c_str(), (unsigned)API_HTTP_PORT);
+    }
+    {
+        // Виджет уходит по WebSocket только при новом тексте; страница /log - GET /api/log?cursor=N
+        sets::Group g(b, "Передача журнала");
+        labelf(b, "История: %u kB в %s, смещение %u", logHistory.capacity() / 1024,
+               logHistory.inPsram() ? "PSRAM" : "памяти", logHistory.head());
+        labelf(b, "WebSocket: %.0f байт/мин (каждую секунду: %.0f)", logger.sentBytesPerMinute(),
+               logger.fullBytesPerMinute());
+        SystemMonitor::TaskInfo task;
+        if (systemMonitor && systemMonitor->getTaskInfoByName("loopTask", task)) {
+            labelf(b, "CPU loopTask (60 с): %.2f%%", task.cpu[CPU_WINDOW_60S]);
+        }
+        if (systemMonitor && systemMonitor->getTaskInfoByName("WebInterface", task)) {
+            labelf(b, "CPU WebInterface (60 с): %.2f%%", task.cpu[CPU_WINDOW_60S]);
+        }
     }
     if (b.Button("Test Log")) {
         logger.println(millis());
@@ -188,22 +321,252 @@ void UIBuilder::buildLoRaStatusTab(sets::Builder& b) {
     loraManager->updateStats();
     {
         sets::Group g(b, "Текущие настройки LoRa");
-        b.Label("Spreading Factor: SF" + String(loraManager->getSpreadingFactor()));
-        b.Label("Bandwidth: " + String(loraManager->getBandwidth()) + " kHz");
-        b.Label("Coding Rate: 4/" + String(loraManager->getCodingRate()));
-        b.Label("Максимум попыток: " + String(loraManager->getMaxAttempts()));
-        b.Label("Мощность передачи: " + String(loraManager->getTxPower()) + " dBm");
+        labelf(b, "Spreading Factor: SF%d", loraManager->getSpreadingFactor());
+        labelf(b, "Bandwidth: %.2f kHz", loraManager->getBandwidth());
+        labelf(b, "Coding Rate: 4/%d", loraManager->getCodingRate());
+        labelf(b, "Максимум попыток: %d", loraManager->getMaxAttempts());
+        labelf(b, "Мощность передачи: %d dBm", loraManager->getTxPower());
+        int implicitLength = loraManager->getImplicitLength();
+        if (implicitLength > 0) {
+            labelf(b, "Заголовок: неявный, кадр %d байт, CRC %s", implicitLength,
+                   loraManager->isCrcEnabled() ? "вкл." : "выкл.");
+        } else {
+            labelf(b, "Заголовок: явный, CRC %s", loraManager->isCrcEnabled() ? "вкл." : "выкл.");
+        }
+    }
+    {
+        // Расчёт по формуле Semtech для HLO текущей длины и измерение по TxDone/ACK
+        sets::Group g(b, "Явный / неявный заголовок");
+        LoRaParams params = loraManager->getParams();
+        char hello[16];
+        uint16_t helloLength = snprintf(hello, sizeof(hello), "HLO:%d", packetId.load());
+        LoRaParams explicitParams = params;
+        explicitParams.implicitLength = 0;
+        LoRaParams implicitParams = params;
+        implicitParams.implicitLength = params.implicitLength > 0 ? params.implicitLength : LORA_IMPLICIT_MIN_LENGTH;
+        labelf(b, "HLO %u байт, неявный кадр %d байт; расчёт / измерено, ms, PDR", helloLength,
+               implicitParams.implicitLength);
+        for (uint8_t i = 0; i < HEADER_STATS_SF_COUNT; i++) {
+            explicitParams.spreading = HEADER_STATS_SF_MIN + i;
+            implicitParams.spreading = HEADER_STATS_SF_MIN + i;
+            char line[UI_LABEL_SIZE];
+            size_t length = appendf(line, sizeof(line), 0, "SF%d:", HEADER_STATS_SF_MIN + i);
+            for (uint8_t mode = 0; mode < 2; mode++) {
+                HeaderModeStats stats = headerModeStats[mode][i].read();
+                uint32_t computed = loraFrameAirtimeUs(mode ? implicitParams : explicitParams, helloLength);
+                length = appendf(line, sizeof(line), length, "%s%.1f / ", mode ? " | неявн. " : " явн. ", computed / 1000.0);
+                if (stats.attempts > 0) {
+                    length = appendf(line, sizeof(line), length, "%.1f, %u%% (%u)",
+                                     stats.airtimeSumUs / stats.attempts / 1000.0,
+                                     stats.successes * 100 / stats.attempts, stats.attempts);
+                } else {
+                    length = appendf(line, sizeof(line), length, "-");
+                }
+            }
+            b.Label(line);
+        }
+    }
+    {
+        sets::Group g(b, "Смена параметров");
+        const ParamSwitch& paramSwitch = loraManager->paramSwitch();
+        labelf(b, "Состояние: %s", paramSwitch.getStateText());
+        if (paramSwitch.getState() != ParamSwitch::IDLE) {
+            LoRaParams pending = paramSwitch.getPendingParams();
+            labelf(b, "Новые параметры: SF%d, %.2f kHz, 4/%d, %d dBm", pending.spreading, pending.bandwidth,
+                   pending.codingRate, pending.txPower);
+        }
+        labelf(b, "Откатов: %u", paramSwitch.getRollbackCount());
+    }
+    {
+        sets::Group g(b, "Синхронизация времени");
+        labelf(b, "ID узла: %x", timeSync.getNodeId());
+        if (timeSync.isRoot()) {
+            b.Label("Роль: опорный узел");
+        } else {
+            labelf(b, "Опорный узел: %x", timeSync.getRootId());
+            if (timeSync.isSynced()) {
+                labelf(b, "Смещение: %.3f ms", (double)timeSync.getOffsetUs() / 1000.0);
+                labelf(b, "Дрейф: %.2f ppm", timeSync.getDriftPpm());
+                labelf(b, "Точность: ±%u us (%u отсчётов)", timeSync.getAccuracyUs(), timeSync.getSampleCount());
+            } else {
+                b.Label("Ожидание маяков...");
+            }
+        }
+    }
+    {
+        sets::Group g(b, "Каналы");
+        const ChannelPlan& plan = loraManager->channelPlan();
+        labelf(b, "Частота: %.3f MHz", loraManager->getFrequency() / 1e6);
+        if (plan.isEnabled()) {
+            uint32_t mask = plan.getBlacklistMask(millis());
+            labelf(b, "Шаг: %u%s", plan.getHopIndex(), plan.isHome() ? " (домашний канал)" : "");
+            for (uint8_t ch = 0; ch < plan.getChannelCount(); ch++) {
+                const ChannelStats& stats = plan.getStats(ch);
+                labelf(b, "%u: %.3f MHz, %u/%u, PDR %.0f%%, RSSI %.0f%s", ch, plan.getFrequency(ch) / 1e6,
+                       stats.successes, stats.attempts, stats.pdr, stats.rssi,
+                       (mask & (1UL << ch)) ? " [исключён]" : "");
+            }
+        } else {
+            b.Label("Перестройка частоты выключена");
+        }
+    }
+    if (spectrumScanner->isEnabled()) {
+        sets::Group g(b, "Занятость эфира");
+        uint8_t count = spectrumScanner->getChannelCount();
+        for (uint8_t i = 0; i < count; i++) {
+            ScanChannelStats stats = spectrumScanner->getChannelStats(i);
+            char occupancy[24];
+            if (stats.occupancy < 0) {
+                strlcpy(occupancy, "нет данных", sizeof(occupancy));
+            } else {
+                snprintf(occupancy, sizeof(occupancy), "занят %.0f%%", stats.occupancy);
+            }
+            labelf(b, "%u: %.3f MHz, %s, шум %.0f, RSSI %d..%d dBm", i, stats.frequency / 1e6, occupancy,
+                   stats.noiseFloor, stats.minRssi, stats.maxRssi);
+        }
+
+        // Тепловая карта: строка - период SCAN_HEATMAP_PERIOD_MS, столбец - частота
+        static uint8_t heatmap[SCAN_HEATMAP_ROWS][SCAN_MAX_CHANNELS];
+        static const char* levels[] = {"·", "░", "▒", "▓", "█"};
+        uint8_t rows = spectrumScanner->getHeatmap(heatmap, SCAN_HEATMAP_ROWS);
+        for (int r = rows - 1; r >= 0 && r >= rows - 10; r--) {
+            // Символ уровня - до 3 байт UTF-8
+            char line[SCAN_MAX_CHANNELS * 3 + 1];
+            size_t length = 0;
+            for (uint8_t ch = 0; ch < count; ch++) {
+                uint8_t value = heatmap[r][ch];
+                const char* level = value == 0xFF ? " "
+                    : levels[value < 5 ? 0 : value < 15 ? 1 : value < 30 ? 2 : value < 60 ? 3 : 4];
+                length = appendf(line, sizeof(line), length, "%s", level);
+            }
+            line[length] = '\0';
+            labelf(b, "-%u с: %s", (unsigned int)((rows - 1 - r) * SCAN_HEATMAP_PERIOD_MS / 1000), line);
+        }
+
+        ChannelPlan& plan = loraManager->channelPlan();
+        int quietest = spectrumScanner->getQuietestChannel(plan);
+        if (quietest >= 0) {
+            labelf(b, "Самый тихий канал плана: %d", quietest);
+        }
+        labelf(b, "Пропущено отсчётов (приём кадра): %u", spectrumScanner->getSkipped());
     }
     {
         sets::Group g(b, "Статистика передачи");
-        b.Label("Всего пакетов: " + String(loraManager->getPacketsTotal()));
-        b.Label("Успешно доставлено: " + String(loraManager->getPacketsSuccess()));
+        labelf(b, "Всего пакетов: %u", loraManager->getPacketsTotal());
+        labelf(b, "Успешно доставлено: %u", loraManager->getPacketsSuccess());
         if (loraManager->getPacketsTotal() > 0) {
-            b.Label("Успешность доставки: " + String(loraManager->getSuccessRate()) + "%");
-            b.Label("Сглаженная успешность: " + String(successRateSmoothed, 1) + "%");
+            labelf(b, "Успешность доставки: %d%%", loraManager->getSuccessRate());
+            labelf(b, "Сглаженная успешность: %.1f%%", successRateSmoothed.value());
         }
         // b.Label("Последний RSSI: " + String(loraManager->getLastRssi(), 1) + " dBm");
     }
+    if (gateway->isEnabled()) {
+        sets::Group g(b, "Шлюз");
+        GatewayStats stats = gateway->getStats();
+        labelf(b, "Сервер: %s", stats.connected ? "доступен" : "недоступен");
+        labelf(b, "Переслано кадров: %u (%u пакетов)", stats.forwarded, stats.batches);
+        labelf(b, "В очереди: %u, отброшено: %u", stats.queued, stats.dropped);
+        labelf(b, "Ошибок отправки: %u, отброшено пакетами: %u", stats.sendErrors, stats.discarded);
+        labelf(b, "Пропускная способность: %.2f кадр/с", stats.throughput);
+        labelf(b, "Задержка шлюза: %.1f ms (макс. %.1f ms)", stats.latencyAvgUs / 1000.0, stats.latencyMaxUs / 1000.0);
+        labelf(b, "Сообщений с сервера: %u", stats.downlinks);
+    }
+    {
+        sets::Group g(b, "Очередь сообщений");
+        TxQueueStats stats = txQueue.getStats(millis());
+        labelf(b, "Пир: %s", stats.peerPresent ? "на связи" : "не слышен");
+        labelf(b, "В очереди: %u (%u байт)", stats.depth, stats.bytes);
+        if (stats.depth > 0) {
+            labelf(b, "Самое старое: %u сек", stats.oldestAgeMs / 1000);
+        }
+        labelf(b, "Скорость доставки: %.1f сообщ./мин", stats.drainRate * 60.0f);
+        labelf(b, "Поставлено/доставлено: %u / %u", stats.enqueued, stats.delivered);
+        labelf(b, "Повторов: %u, вытеснено: %u", stats.retries, stats.dropped);
+        if (stats.dutyWaitMs > 0) {
+            labelf(b, "Ожидание бюджета эфира: %u сек", stats.dutyWaitMs / 1000);
+        }
+        labelf(b, "Принято от пира: %u", stats.received);
+        if (stats.received > 0) {
+            labelf(b, "Последнее: %s", txQueue.getLastReceived().c_str());
+        }
+
+        static String message = "";
+        b.Input(H("txq_message"), "Сообщение", &message);
+        if (b.Button(H("txq_send"), "Отправить")) {
+            if (txQueue.enqueue(message, millis())) {
+                message = "";
+            } else {
+                logger.println(warn_() + "Сообщение не поставлено в очередь (пустое, длиннее " +
+                               String(TXQ_MAX_PAYLOAD) + " байт или очередь заполнена)");
+            }
+        }
+    }
+    {
+        sets::Group g(b, "Время обхода HLO/ACK");
+        HistogramSnapshot rtt = rttHistogram.snapshot();
+        if (rtt.count == 0) {
+            b.Label("Нет измерений");
+        } else {
+            labelf(b, "Последнее: %.2f ms", rttLastUs.value() / 1000.0);
+            labelf(b, "Мин/сред/макс: %.2f / %.2f / %.2f ms", rtt.min / 1000.0, rttAvgUs.value() / 1000.0,
+                   rtt.max / 1000.0);
+            uint32_t lower = 0;
+            for (uint8_t i = 0; i < rttHistogram.bucketCount(); i++) {
+                uint32_t upper = rttHistogram.upperBound(i);
+                if (upper == UINT32_MAX) {
+                    labelf(b, ">= %u ms: %u", lower / 1000, rtt.buckets[i]);
+                } else {
+                    labelf(b, "%u-%u ms: %u", lower / 1000, upper / 1000, rtt.buckets[i]);
+                }
+                lower = upper;
+            }
+        }
+        labelf(b, "Меток без прерывания: %u", radioFallbackCount());
+    }
+    {
+        sets::Group g(b, "Доступность приёма");
+        labelf(b, "Доступность: %.2f %%", rxAvailability.value());
+        ReceivePollStats poll = receivePollSnapshot();
+        labelf(b, "Простоев > %u ms: %u", (unsigned int)RX_POLL_STALL_MS, poll.stalls);
+        labelf(b, "Макс. промежуток опроса: %.1f ms", poll.maxGapUs / 1000.0);
+        labelf(b, "Эффектов LED слито: %u", ledCoalescedCount());
+    }
+    {
+        sets::Group g(b, "Передача");
+        RadioTxStats tx = radioTx.getStats();
+        if (tx.inFlight) {
+            labelf(b, "В эфире: %u ms", tx.inFlightUs / 1000);
+        } else {
+            b.Label("Радио свободно");
+        }
+        labelf(b, "В очереди: %u из %u", tx.queued, (unsigned int)RADIO_TX_QUEUE_LEN);
+        labelf(b, "Поставлено/передано: %u / %u", tx.submitted, tx.completed);
+        labelf(b, "Отклонено/ошибок: %u / %u", tx.rejected, tx.failed);
+        if (loraManager->getImplicitLength() > 0) {
+            labelf(b, "Длинных кадров с явным заголовком (EXP): %u", tx.announced);
+        }
+        labelf(b, "Ожидание в очереди: %.1f ms", tx.lastWaitUs / 1000.0);
+        labelf(b, "TxDone -> завершение, посл./сред./макс.: %u / %u / %u us", tx.lastLatencyUs, tx.avgLatencyUs,
+               tx.maxLatencyUs);
+    }
+    {
+        // Средние затраты шины на кадр; для сравнения - оценка побайтового доступа arduino-LoRa
+        sets::Group g(b, "Шина SPI радиомодуля");
+        SpiStats spi = radio.getSpiStats();
+        labelf(b, "Транзакций всего: %u, шина занята %u ms", spi.transactions, spi.busUs / 1000);
+        for (int tx = 1; tx >= 0; tx--) {
+            SpiPacketStats stats = radio.getPacketStats(tx);
+            const char* name = tx ? "Передача" : "Приём";
+            if (stats.packets == 0) {
+                labelf(b, "%s: нет кадров", name);
+                continue;
+            }
+            uint32_t avgLen = stats.bytes / stats.packets;
+            uint32_t library = tx ? libraryTxTransactions(avgLen) : libraryRxTransactions(avgLen);
+            labelf(b, "%s (%u байт): %u транз., %u us; библиотека ~%u транз.", name, avgLen,
+                   stats.transactions / stats.packets, stats.busUs / stats.packets, library);
+        }
+    }
 }
 
 // Функция отображения вкладки с настройками
@@ -234,33 +597,33 @@ void UIBuilder::buildSettingsTab(sets::Builder& b) {
 
         // Виджет Select, который сохраняет выбранное значение в currentWifiModePersistent
         b.Select("Режим работы", "Только AP;Только STA;AP + STA", &currentWifiModePersistent);
-        logger.println("Текущий режим WiFi (persistent): " + String(currentWifiModePersistent));
+        LOGD(LOG_SINK_WEB, "Текущий режим WiFi (persistent): %d", currentWifiModePersistent);
 
         // Группа настроек для точки доступа (AP)
         if (currentWifiModePersistent == MY_WIFI_MODE_AP || currentWifiModePersistent == MY_WIFI_MODE_AP_STA) {
-            logger.println("Отображаем настройки точки доступа");
+            LOGD(LOG_SINK_WEB, "Отображаем настройки точки доступа");
             b.Label(H("ap_label"), "Настройки точки доступа:");
             b.Input(H("ap_ssid"), "SSID точки доступа", &currentApSSID);
             b.Pass("Пароль точки доступа", &currentApPass);
             b.reload();
         } else {
-            logger.println("Настройки точки доступа не отображаются");
+            LOGD(LOG_SINK_WEB, "Настройки точки доступа не отображаются");
         }
 
         // Группа настроек для подключения (STA)
         if (currentWifiModePersistent == MY_WIFI_MODE_STA || currentWifiModePersistent == MY_WIFI_MODE_AP_STA) {
-            logger.println("Отображаем настройки подключения к WiFi");
+            LOGD(LOG_SINK_WEB, "Отображаем настройки подключения к WiFi");
             b.Label(H("sta_label"), "Настройки подключения к WiFi:");
             b.Input(H("sta_ssid"), "SSID для подключения", &currentStaSSID);
             b.Pass("Пароль для подключения", &currentStaPass);
             b.reload();
         } else {
-            logger.println("Настройки подключения не отображаются");
+            LOGD(LOG_SINK_WEB, "Настройки подключения не отображаются");
         }
 
         // Кнопка применения настроек
         if (b.Button(DB_NAMESPACE::apply_wifi, "Применить настройки WiFi")) {
-            logger.println("Применяем настройки WiFi, новый режим: " + String(currentWifiModePersistent));
+            LOGI(LOG_SINK_WEB, "Применяем настройки WiFi, новый режим: %d", currentWifiModePersistent);
             _db->update(DB_NAMESPACE::wifi_mode, currentWifiModePersistent);
             _db->update(DB_NAMESPACE::ap_ssid, currentApSSID);
             _db->update(DB_NAMESPACE::ap_pass, currentApPass);
@@ -278,12 +641,16 @@ void UIBuilder::buildSettingsTab(sets::Builder& b) {
     static int currentLoraCodingRate = 0;
     static int currentLoraMaxAttempts = 0;
     static int currentLoraTxPower = 0;
+    static int currentLoraImplicitLength = 0;
+    static bool currentLoraCrc = false;
     if (!loraInit) {
         currentLoraSpreading = _db->get(DB_NAMESPACE::lora_spreading).toInt();
         currentLoraBandwidth = _db->get(DB_NAMESPACE::lora_bandwidth).toString();
         currentLoraCodingRate = _db->get(DB_NAMESPACE::lora_coding_rate).toInt();
         currentLoraMaxAttempts = _db->get(DB_NAMESPACE::lora_max_attempts).toInt();
         currentLoraTxPower = _db->get(DB_NAMESPACE::lora_tx_power).toInt();
+        currentLoraImplicitLength = _db->get(DB_NAMESPACE::lora_implicit_len).toInt();
+        currentLoraCrc = _db->get(DB_NAMESPACE::lora_crc).toBool();
         loraInit = true;
     }
     {
@@ -294,19 +661,23 @@ void UIBuilder::buildSettingsTab(sets::Builder& b) {
         b.Select(DB_NAMESPACE::lora_coding_rate_selected, "Coding Rate (4/x)", crOptions);
         b.Slider(DB_NAMESPACE::lora_max_attempts, "Макс. число попыток", 1.0f, 10.0f, 1.0f, "");
         b.Slider(DB_NAMESPACE::lora_tx_power, "Мощность передачи (dBm)", 2.0f, 20.0f, 1.0f, "");
+        // Неявный заголовок экономит эфир, если кадры близки к фиксированной длине
+        b.Number(H("lora_implicit_len_input"), "Неявный заголовок: длина кадра (0 - выкл., от " +
+                 String(LORA_IMPLICIT_MIN_LENGTH) + ")", &currentLoraImplicitLength);
+        b.Switch(H("lora_crc_input"), "CRC полезной нагрузки", &currentLoraCrc);
 
         // обработка действий
         switch (b.build.id) {
             case DB_NAMESPACE::lora_spreading_selected:
-                logger.println(String("current_lora_spreading:") + String(sfOptions[b.build.value]));
+                LOGD(LOG_SINK_WEB, "current_lora_spreading:%c", sfOptions[b.build.value]);
                 currentLoraSpreading = String(sfOptions[b.build.value]).toInt();
                 break;
             case DB_NAMESPACE::lora_bandwidth_selected:
-                logger.println(String("current_lora_bandwidth:") + String(bwOptions[b.build.value]));
+                LOGD(LOG_SINK_WEB, "current_lora_bandwidth:%c", bwOptions[b.build.value]);
                 currentLoraBandwidth = bwOptionsValues[b.build.value];
                 break;
             case DB_NAMESPACE::lora_coding_rate_selected:
-                logger.println(String("current_lora_coding_rate:") + String(crOptions[b.build.value]));
+                LOGD(LOG_SINK_WEB, "current_lora_coding_rate:%c", crOptions[b.build.value]);
                 currentLoraCodingRate = String(crOptions[b.build.value]).toInt();
                 break;
             case DB_NAMESPACE::lora_max_attempts:
@@ -319,14 +690,122 @@ void UIBuilder::buildSettingsTab(sets::Builder& b) {
                 break;
         }
 
+        LoRaParams requested;
+        requested.spreading = currentLoraSpreading;
+        requested.bandwidth = currentLoraBandwidth.toFloat();
+        requested.codingRate = currentLoraCodingRate;
+        requested.txPower = currentLoraTxPower;
+        requested.implicitLength = currentLoraImplicitLength;
+        requested.crc = currentLoraCrc;
+
+        // Параметры меняются на обоих узлах: пир получает предложение на старых
+        // настройках, сохранение в базу происходит после проверки связи
         if (b.Button(H("apply_lora"), "Применить настройки LoRa")) {
-            _db->update(DB_NAMESPACE::lora_spreading, currentLoraSpreading);
-            _db->update(DB_NAMESPACE::lora_bandwidth, currentLoraBandwidth.toFloat());
-            _db->update(DB_NAMESPACE::lora_coding_rate, currentLoraCodingRate);
             _db->update(DB_NAMESPACE::lora_max_attempts, currentLoraMaxAttempts);
-            _db->update(DB_NAMESPACE::lora_tx_power, currentLoraTxPower);
+            if (!loraManager->proposeSettings(requested)) {
+                logger.println(warn_() + "Смена параметров уже выполняется или параметры неверны");
+            }
+        }
+
+        // Только локально: для первичной настройки, когда пира ещё нет
+        if (b.Button(H("apply_lora_local"), "Применить только на этом узле")) {
+            _db->update(DB_NAMESPACE::lora_max_attempts, currentLoraMaxAttempts);
+            loraManager->saveParams(requested);
             loraManager->applySettings();
-            _needRestart = true; // Отметка о необходимости перезагрузки
+        }
+    }
+
+    // Перестройка частоты: число каналов и seed должны совпадать на обоих узлах
+    static bool hopInit = false;
+    static String currentHopSeed = "";
+    if (!hopInit) {
+        currentHopSeed = _db->get(DB_NAMESPACE::lora_hop_seed).toString();
+        hopInit = true;
+    }
+    {
+        sets::Group g(b, "Перестройка частоты");
+
+        b.Slider(DB_NAMESPACE::lora_hop_channels, "Число каналов (1 - выкл.)", 1.0f, (float)CHANNEL_PLAN_MAX, 1.0f, "");
+        b.Input(H("lora_hop_seed_input"), "Seed последовательности", &currentHopSeed);
+
+        if (b.Button(H("apply_hopping"), "Применить частотный план")) {
+            _db->update(DB_NAMESPACE::lora_hop_seed, (int32_t)currentHopSeed.toInt());
+            loraManager->applyChannelPlan();
+            if (spiLock(pdMS_TO_TICKS(5000))) {
+                loraManager->tuneLocked(loraManager->channelPlan().getCurrentChannel());
+                spiUnlock();
+            }
+            // Пустой список сканирования следует за каналами плана
+            spectrumScanner->applySettings();
+        }
+    }
+
+    // Сканирование эфира: занятость каналов и уровень шума
+    {
+        sets::Group g(b, "Сканирование эфира");
+
+        b.Switch(DB_NAMESPACE::scan_enabled, "Сканирование");
+        b.Input(DB_NAMESPACE::scan_freqs, "Частоты, MHz через ';' (пусто - каналы плана)");
+        b.Number(DB_NAMESPACE::scan_rate, "Отсчётов в секунду");
+
+        if (b.Button(H("apply_scan"), "Применить сканирование")) {
+            spectrumScanner->applySettings();
+        }
+    }
+
+    // Шлюз: пересылка принятых кадров на сервер
+    {
+        sets::Group g(b, "Шлюз UDP/MQTT");
+
+        b.Select(DB_NAMESPACE::gw_mode, "Режим", "Выкл.;UDP;MQTT");
+        b.Input(DB_NAMESPACE::gw_host, "Сервер / брокер");
+        b.Number(DB_NAMESPACE::gw_port, "Порт");
+        b.Input(DB_NAMESPACE::gw_topic, "Топик MQTT");
+
+        if (b.Button(H("apply_gateway"), "Применить настройки шлюза")) {
+            gateway->applySettings();
+        }
+    }
+
+    // Двоичный протокол по USB-порту для хоста; текстовый вывод в Serial отключается
+    {
+        sets::Group g(b, "Режим модема");
+
+        b.Switch(DB_NAMESPACE::modem_enabled, "Двоичный протокол");
+        b.Number(DB_NAMESPACE::modem_baud, "Скорость порта");
+
+        if (b.Button(H("apply_modem"), "Применить режим модема")) {
+            serialModem->applySettings();
+        }
+        if (serialModem->isActive()) {
+            ModemStats stats = serialModem->getStats();
+            b.Label("Кадров от хоста/хосту: " + String(stats.framesIn) + " / " + String(stats.framesOut));
+            b.Label("Байт от хоста/хосту: " + String(stats.bytesIn) + " / " + String(stats.bytesOut));
+            b.Label("Передано в эфир: " + String(stats.txSent));
+            b.Label("Ошибок кадров: " + String(stats.badFrames) + ", потеряно: " + String(stats.outDropped));
+        }
+    }
+
+    // Запись RX/TX кадров в pcap (LoRaTap) для Wireshark
+    {
+        sets::Group g(b, "Захват пакетов (pcap)");
+
+        b.Select(DB_NAMESPACE::capture_mode, "Режим", "Выкл.;Файл;TCP;Serial");
+
+        if (b.Button(H("apply_capture"), "Применить режим захвата")) {
+            packetCapture->applySettings();
+        }
+        if (packetCapture->isEnabled()) {
+            CaptureStats stats = packetCapture->getStats();
+            b.Label("Кадров записано: " + String(stats.captured) + ", байт: " + String(stats.bytesWritten));
+            b.Label("Потеряно (кольцо/вывод): " + String(stats.droppedRing) + " / " + String(stats.droppedSink));
+            int mode = _db->get(DB_NAMESPACE::capture_mode).toInt();
+            if (mode == CAPTURE_FILE) {
+                b.Label("Файлов: " + String(stats.files) + " в " + CAPTURE_DIR);
+            } else if (mode == CAPTURE_TCP) {
+                b.Label(String("Клиент: ") + (stats.clientConnected ? "подключен" : "нет") +
+                        ", порт " + String(CAPTURE_TCP_PORT));
+            }
         }
     }
 
@@ -348,30 +827,39 @@ void UIBuilder::buildSystemMonitorTab(sets::Builder& b) {
         return;
     }
 
-    systemMonitor->update(); // Обновляем данные мониторинга
-
+    // Данные обновляет задача мониторинга раз в секунду
     {
         sets::Group g(b, "CPU & Memory");
-        b.Label("CPU Usage: " + String(systemMonitor->getTotalCpuUsage()) + "%");
-        b.Label("Free Heap: " + String(systemMonitor->getFreeHeap() / 1024) + " kB");
-        b.Label("Min Free Heap: " + String(systemMonitor->getMinFreeHeap() / 1024) + " kB");
-        // UBaseType_t unusedStackWords = uxTaskGetStackHighWaterMark(NULL);
-        // size_t unusedStackBytes = unusedStackWords * sizeof(StackType_t); // Обычно 4 байта
-        // b.Label("Min Free Stack: " + String(unusedStackBytes / 1024) + " kB");
+        labelf(b, "CPU Usage 1s/10s/60s: %u/%u/%u%%", systemMonitor->getTotalCpuUsage(CPU_WINDOW_1S),
+               systemMonitor->getTotalCpuUsage(CPU_WINDOW_10S), systemMonitor->getTotalCpuUsage(CPU_WINDOW_60S));
+        for (uint8_t core = 0; core < portNUM_PROCESSORS; core++) {
+            labelf(b, "Core %u: %.1f/%.1f/%.1f%%", core, systemMonitor->getCoreUsage(core, CPU_WINDOW_1S),
+                   systemMonitor->getCoreUsage(core, CPU_WINDOW_10S), systemMonitor->getCoreUsage(core, CPU_WINDOW_60S));
+        }
+        labelf(b, "Free Heap: %u kB", systemMonitor->getFreeHeap() / 1024);
+        labelf(b, "Min Free Heap: %u kB", systemMonitor->getMinFreeHeap() / 1024);
+        for (uint8_t i = 0; i < heapCapsCount(); i++) {
+            HeapCapsInfo caps = heapCapsInfo(i);
+            if (caps.total > 0) {
+                labelf(b, "%s: %u kB free, block %u kB, fragmentation %.1f%%", caps.name, caps.free / 1024,
+                       caps.largest / 1024, caps.fragmentation);
+            }
+        }
     }
 
-    Serial.println("Отображение списка задач...");
+    serialLog.println("Отображение списка задач...");
     {
         sets::Group g(b, "Task Statistics");
 
-        // Получаем информацию о задачах
-        uint16_t taskCount = 0;
-        SystemMonitor::TaskInfo* tasks = systemMonitor->getTasksInfo(taskCount); // Исправлено: SystemMonitor::TaskInfo* -> TaskInfo*
-
-        if (tasks != nullptr && taskCount > 0) {
+        // Копии строк таблицы задач порциями
+        SystemMonitor::TaskInfo tasks[SYSTEM_MONITOR_COPY_ROWS];
+        uint16_t first = 0;
+        uint16_t taskCount;
+        while ((taskCount = systemMonitor->getTasksInfo(tasks, SYSTEM_MONITOR_COPY_ROWS, first)) > 0) {
+            first += taskCount;
             for (uint16_t i = 0; i < taskCount; i++) {
                 // Определяем текстовое состояние
-                String state;
+                const char* state;
                 switch (tasks[i].state) {
                     case eRunning:    state = "Running"; break;
                     case eReady:      state = "Ready"; break;
@@ -381,17 +869,196 @@ void UIBuilder::buildSystemMonitorTab(sets::Builder& b) {
                     default:          state = "Unknown"; break;
                 }
 
-                b.Label(String(tasks[i].name) + ": "+ String(tasks[i].cpuUsage) + "[" + state + "] " + String(tasks[i].stackHighWater) + " bytes free");
+                char core[4] = "*";
+                if (tasks[i].core >= 0) {
+                    snprintf(core, sizeof(core), "%d", tasks[i].core);
+                }
+                labelf(b, "%s (%s): %.1f/%.1f/%.1f%% [%s] %u bytes free", tasks[i].name, core,
+                       tasks[i].cpu[CPU_WINDOW_1S], tasks[i].cpu[CPU_WINDOW_10S], tasks[i].cpu[CPU_WINDOW_60S], state,
+                       (unsigned int)tasks[i].stackHighWater);
             }
-            // Внимание: Память для 'tasks' выделяется статически в getTasksInfo,
-            // поэтому освобождать ее здесь не нужно.
-            // vPortFree(tasks);
-        } 
+        }
+    }
+
+    {
+        // Все метрики реестра; значения читаются без блокировок
+        sets::Group g(b, "Метрики");
+        for (const Metric* m = Metric::first(); m; m = m->next()) {
+            switch (m->type()) {
+                case METRIC_COUNTER:
+                    labelf(b, "%s: %u", m->name(), static_cast<const Counter*>(m)->value());
+                    break;
+                case METRIC_GAUGE:
+                    labelf(b, "%s: %.2f", m->name(), static_cast<const Gauge*>(m)->value());
+                    break;
+                case METRIC_HISTOGRAM: {
+                    HistogramSnapshot h = static_cast<const Histogram*>(m)->snapshot();
+                    labelf(b, "%s: n=%u, сред. %.0f", m->name(), h.count, h.avg());
+                    break;
+                }
+            }
+        }
+        MetricsUpdateCost cost = metricsUpdateCost();
+        labelf(b, "Обновление, нс: счётчик %u, gauge %u, гистограмма %u, под мьютексом %u", cost.counterNs,
+               cost.gaugeNs, cost.histogramNs, cost.criticalNs);
+    }
+    {
+        // Отложенный журнал: горячие пути пишут запись в кольцо, текст собирает задача LogFormat
+        sets::Group g(b, "Журнал");
+        // Порядок пунктов - значения LogLevel в базе
+        if (b.Select(DB_NAMESPACE::log_level, "Уровень", "Информация;Предупреждения;Ошибки;Отладка")) {
+            logSetLevel(b.build.value.toInt());
+        }
+        LogRingStats log = logRingStats();
+        static const char* const rankNames[LOG_RANKS] = {"Отладка", "Информация", "Предупреждения", "Ошибки"};
+        for (uint8_t i = 0; i < LOG_RANKS; i++) {
+            labelf(b, "%s: выведено %u, пропущено %u", rankNames[i], log.written[i], log.suppressed[i]);
+        }
+        labelf(b, "Записей: %u, отброшено: %u", log.records, log.dropped);
+        labelf(b, "Байт записей: %u, текста: %u", log.bytes, log.lineBytes);
+        labelf(b, "Кольцо: %u / %u байт, пик %u", log.used, log.capacity, log.peak);
+        labelf(b, "Запись в кольцо: ~%u тактов, форматирование: ~%u", log.costCycles, log.formatCycles);
+        // Без учёта вычисления аргументов пропущенных вызовов (сборка String и т.п.)
+        labelf(b, "Сэкономлено пропусками: ~%u мс CPU", (uint32_t)(log.savedCycles / ESP.getCpuFreqMHz() / 1000));
+    }
+    {
+        // Выгрузка: GET /trace на порту API или в Serial; файл открывается в ui.perfetto.dev
+        sets::Group g(b, "Трассировка");
+        TraceStats trace = traceStats();
+        if (trace.capacity == 0) {
+            b.Label("Отключена (TRACE_ENABLED 0)");
+        } else {
+            labelf(b, "Событий записано: %u, в кольцах %u", trace.recorded, trace.capacity);
+            labelf(b, "Запись события: ~%u тактов", trace.costCycles);
+            if (b.Button(H("trace_serial"), "Выгрузить в Serial")) {
+                dumpToSerial("трассы", [](Print& out) { return traceWriteChrome(out); });
+            }
+        }
+    }
+    {
+        // Сэмплирующий профилировщик: свёрнутые стеки для flame graph
+        sets::Group g(b, "Профилировщик CPU");
+        char title[64];
+        b.Switch(DB_NAMESPACE::prof_enabled, "Отсчёты по таймеру");
+        snprintf(title, sizeof(title), "Отсчётов в секунду (до %u)", (unsigned int)PROFILER_MAX_RATE_HZ);
+        b.Number(DB_NAMESPACE::prof_rate, title);
+        snprintf(title, sizeof(title), "Глубина стека (до %u)", (unsigned int)PROFILER_MAX_DEPTH);
+        b.Number(DB_NAMESPACE::prof_depth, title);
+        snprintf(title, sizeof(title), "Отсчётов в кольце ядра (до %u)", (unsigned int)PROFILER_MAX_SAMPLES);
+        b.Number(DB_NAMESPACE::prof_samples, title);
+        b.Number(DB_NAMESPACE::prof_overhead, "Предел накладных расходов, %");
+        if (b.Button(H("apply_profiler"), "Применить профилировщик")) {
+            profiler->applySettings();
+        }
+
+        ProfilerStats prof = profiler->getStats();
+        if (prof.running) {
+            labelf(b, "Отсчётов: %u, в кольцах %u из %u", prof.samples, prof.buffered, prof.capacity);
+            labelf(b, "Частота: %u Hz, отсчёт ~%u тактов, %.1f%% ядра", prof.rateHz, prof.costCycles, prof.overhead);
+            if (b.Button(H("profile_serial"), "Выгрузить в Serial")) {
+                dumpToSerial("профиля CPU", [](Print& out) { return profiler->writeFolded(out); });
+            }
+        }
+    }
+    {
+        // Аудит стеков: наименьший остаток за всё время и рекомендуемый размер
+        sets::Group g(b, "Стеки задач");
+        uint8_t count = 0;
+        const StackAuditEntry* stacks = stackAuditor.getEntries(count);
+        for (uint8_t i = 0; i < count; i++) {
+            const StackAuditEntry& entry = stacks[i];
+            char line[UI_LABEL_SIZE];
+            size_t length = appendf(line, sizeof(line), 0, "%s%s: свободно %u",
+                                    entry.alert == STACK_CRITICAL ? "[!!] " : entry.alert == STACK_WARN ? "[!] " : "",
+                                    entry.name, entry.minFree);
+            if (entry.size > 0) {
+                appendf(line, sizeof(line), length, " из %u, рекомендуется %u", entry.size, entry.recommended);
+            }
+            b.Label(line);
+        }
+        int32_t reclaimable = stackAuditor.getReclaimable();
+        labelf(b, "%s%d байт", reclaimable >= 0 ? "Можно освободить: " : "Не хватает: ", abs(reclaimable));
+        labelf(b, "Стеки приложения: %s", TASK_STATIC_STACKS ? "статические (.bss)" : "в куче");
+        if (b.Button(H("stacks_serial"), "Размеры стеков в Serial")) {
+            dumpToSerial("размеров стеков", [](Print& out) { return stackAuditor.writeHeader(out); });
+        }
+    }
+    {
+        // Профиль кучи: выделения по задачам и местам вызова, утечки между снимками
+        sets::Group g(b, "Профиль кучи");
+        HeapProfileStats heap = heapProfileStats();
+        if (heap.failed > 0) {
+            labelf(b, "Неудачных выделений: %u, последнее %u байт", heap.failed, heap.lastFailedSize);
+        } else {
+            b.Label("Неудачных выделений: 0");
+        }
+        if (!heap.wrapped) {
+            b.Label("Выделения не перехватываются (HEAP_PROFILER_WRAP 0)");
+        } else {
+            labelf(b, "Выделений: %u, освобождений %u", heap.allocs, heap.frees);
+            labelf(b, "Темп: %.0f /s, %.1f kB/s", heap.allocRate, heap.allocBytesRate / 1024.0f);
+            labelf(b, "Выборка 1/%u: мест %u, живых %u, не вошло %u", (unsigned int)HEAP_PROFILER_SAMPLE_EVERY,
+                   heap.sites, heap.live, heap.dropped);
+
+            // Точный счёт задачи веб-интерфейса: выделения последнего построения вкладки
+            for (uint8_t i = 0; i < TAB_COUNT; i++) {
+                if (tabHeapCost[i].builds > 0) {
+                    labelf(b, "Вкладка %s: %u выделений, %u байт за построение", tabNames[i], tabHeapCost[i].allocs,
+                           tabHeapCost[i].bytes);
+                }
+            }
+
+            HeapTaskInfo tasks[8];
+            uint8_t taskCount = heapProfileTasks(tasks, 8);
+            char name[20];
+            for (uint8_t i = 0; i < taskCount && i < 5; i++) {
+                profileTaskName(tasks[i].task, name, sizeof(name));
+                labelf(b, "%s: %u kB в %u выделениях, живо %u байт", name, tasks[i].bytes / 1024, tasks[i].allocs,
+                       tasks[i].liveBytes);
+            }
+
+            if (b.Button(H("heap_snapshot"), "Снимок для поиска утечек")) {
+                heapProfileSnapshot();
+            }
+            HeapLeakReport leaks = heapLeakReport();
+            if (leaks.snapshots > 0) {
+                labelf(b, "Снимков: %u, за %u s: свободно %d байт, блоков %d", leaks.snapshots, leaks.intervalMs / 1000,
+                       leaks.freeDelta, leaks.blocksDelta);
+            }
+            HeapSiteInfo site;
+            for (uint8_t i = 0; i < leaks.count; i++) {
+                if (heapProfileSite(leaks.sites[i].site, site)) {
+                    profileTaskName(site.task, name, sizeof(name));
+                    labelf(b, "Не освобождено: %s 0x%x - %u байт в %u", name, site.stack[0], leaks.sites[i].bytes,
+                           leaks.sites[i].count);
+                }
+            }
+            if (b.Button(H("heap_serial"), "Места вызова в Serial")) {
+                dumpToSerial("профиля кучи", [](Print& out) { return heapProfileWriteFolded(out); });
+            }
+        }
+    }
+    {
+        // Затраты последнего ответа HTTP API (тело пишется в сокет порциями по JSON_WRITER_CHUNK)
+        char title[24];
+        snprintf(title, sizeof(title), "HTTP API :%u", (unsigned int)API_HTTP_PORT);
+        sets::Group g(b, title);
+        ApiRequestStats api = apiServer.getStats();
+        labelf(b, "Запросов: %u", api.requests);
+        if (api.requests > 0) {
+            labelf(b, "Последний ответ: %u байт за %.1f ms", api.lastBytes, api.lastUs / 1000.0);
+            labelf(b, "Изменение кучи: %d байт", api.lastHeapDelta);
+            labelf(b, "Макс. время ответа: %.1f ms", api.maxUs / 1000.0);
+        }
+        ApiRequestStats scrape = apiServer.getScrapeStats();
+        if (scrape.requests > 0) {
+            labelf(b, "/metrics: %u опросов, последний %u байт за %.1f ms, куча %d байт", scrape.requests,
+                   scrape.lastBytes, scrape.lastUs / 1000.0, scrape.lastHeapDelta);
+        }
     }
 
     // Кнопка обновления
     if (b.Button(H("refreshStats"), "Refresh Statistics")) {
-        systemMonitor->update();
         b.reload();
     }
 }
@@ -6,7 +6,7 @@
 #include "logging.h"
 #include "wifi-manager.h"
 #include "lora-manager.h"
-#include "plot-manager.h"
+#include "metrics-history.h"
 #include "system-monitor.h"
 #include "display-manager.h"
 
@@ -0,0 +1,223 @@
+// Имитация эфира: M узлов (M/2 линков со своими seed) на плане из N каналов.
+// Каждый узел ведёт обмены HLO/ACK, как taskSendHello/taskReceive: HLO раз в
+// 15-30 с, ACK на канале приёма HLO, переход на следующий шаг после обмена.
+// Кадры, перекрывшиеся по времени на одном канале, теряются оба (без захвата),
+// полудуплекс: передающий узел не слышит. Перестройку ведёт ChannelPlan.
+// Выход - суммарная пропускная способность (обменов в минуту) для N x M
+#include "test.h"
+#include "channel-plan.h"
+#include "lora-airtime.h"
+#include "config.h"
+#include <vector>
+
+static const uint32_t SIM_MS = 3600000;
+static const uint32_t TURNAROUND_MS = 10;
+static const uint32_t POLL_MS = 10;          // Опрос задачи приёма
+static const LoRaParams SIM_PARAMS = {9, 125.0f, 5, 10, 0, false};
+
+struct SimFrame {
+    int sender;
+    uint8_t channel;
+    uint32_t start;
+    uint32_t end;
+    bool ack;
+    int id;
+    uint32_t hop;
+    uint32_t mask;
+    bool collided;
+    uint8_t peerChannel;   // Канал пира в начале кадра
+};
+
+struct SimNode {
+    ChannelPlan plan;
+    int peer;
+    uint32_t nextHello;
+    int packetId;
+    int waitingId = -1;
+    uint32_t txStart = 0;
+    uint32_t txEnd = 0;
+    bool ackQueued = false;
+    uint32_t ackAt = 0;
+    int ackId = 0;
+    uint8_t ackChannel = 0;
+    uint32_t hellos = 0;
+    uint32_t exchanges = 0;
+};
+
+struct SimResult {
+    uint32_t hellos;
+    uint32_t exchanges;
+    uint32_t collided;
+    uint32_t frames;
+    uint32_t worstLink;   // Обменов у самого неудачного узла
+};
+
+static uint32_t simRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static SimResult simulate(uint8_t channels, int nodes) {
+    uint32_t rng = 0x12345678u ^ (channels * 977u) ^ (nodes * 131u);
+    uint32_t helloUs = loraAirtimeUs(SIM_PARAMS, 14);
+    uint32_t ackUs = loraAirtimeUs(SIM_PARAMS, 8);
+    std::vector<SimNode> node(nodes);
+    for (int i = 0; i < nodes; i++) {
+        // Пары узлов - линки, у каждого линка свой seed последовательности
+        node[i].plan.configure(channels, 1000 + i / 2);
+        node[i].peer = i ^ 1;
+        node[i].nextHello = simRandom(rng) % 30000;
+        node[i].packetId = i * 100000;
+    }
+    std::vector<SimFrame> air;
+    SimResult result = {0, 0, 0, 0, 0};
+
+    auto transmit = [&](int sender, uint32_t now, uint8_t channel, bool ack, int id, uint32_t hop, uint32_t mask) {
+        uint32_t duration = ((ack ? ackUs : helloUs) + 999) / 1000;
+        SimFrame frame = {sender, channel, now, now + duration, ack, id, hop, mask, false,
+                          node[node[sender].peer].plan.getCurrentChannel()};
+        for (SimFrame& other : air) {
+            if (other.channel == channel && other.end > now) {
+                other.collided = true;
+                frame.collided = true;
+            }
+        }
+        node[sender].txStart = now;
+        node[sender].txEnd = frame.end;
+        air.push_back(frame);
+        result.frames++;
+    };
+
+    auto deliver = [&](const SimFrame& frame) {
+        if (frame.collided) {
+            result.collided++;
+            return;
+        }
+        SimNode& peer = node[node[frame.sender].peer];
+        bool listening = frame.peerChannel == frame.channel && peer.plan.getCurrentChannel() == frame.channel &&
+                         !(peer.txStart < frame.end && peer.txEnd > frame.start);
+        if (!listening) {
+            return;
+        }
+        peer.plan.onHeard(frame.end);
+        if (!frame.ack) {
+            // ACK уходит на канале приёма HLO, переход - после постановки ACK
+            peer.ackQueued = true;
+            peer.ackAt = frame.end + TURNAROUND_MS;
+            peer.ackId = frame.id;
+            peer.ackChannel = peer.plan.getCurrentChannel();
+            if (peer.plan.isEnabled()) {
+                peer.plan.advance(frame.hop, frame.mask, frame.end);
+            }
+            return;
+        }
+        if (peer.plan.isEnabled()) {
+            peer.plan.completeExchange(frame.id, frame.end);
+        }
+        if (frame.id == peer.waitingId) {
+            peer.waitingId = -1;
+            peer.exchanges++;
+        }
+    };
+
+    uint32_t now = 0;
+    while (now < SIM_MS) {
+        // Ближайшее событие: опрос приёма, конец кадра, ACK или HLO
+        uint32_t next = now + POLL_MS;
+        for (const SimFrame& frame : air) {
+            next = min(next, frame.end);
+        }
+        for (const SimNode& n : node) {
+            next = min(next, max(n.nextHello, n.txEnd));
+            if (n.ackQueued) {
+                next = min(next, max(n.ackAt, n.txEnd));
+            }
+        }
+        now = next;
+
+        for (size_t i = 0; i < air.size();) {
+            if (air[i].end <= now) {
+                deliver(air[i]);
+                air.erase(air.begin() + i);
+            } else {
+                i++;
+            }
+        }
+
+        for (int i = 0; i < nodes; i++) {
+            SimNode& n = node[i];
+            n.plan.expireExchange(now);
+            n.plan.checkResync(now);
+            if (n.txEnd > now) {
+                continue;
+            }
+            if (n.ackQueued && n.ackAt <= now) {
+                n.ackQueued = false;
+                transmit(i, now, n.ackChannel, true, n.ackId, 0, 0);
+                continue;
+            }
+            if (n.nextHello <= now) {
+                // Как taskSendHello: незавершённый обмен закрывается, затем шаг и маска в HLO
+                uint32_t hop = 0;
+                uint32_t mask = 0;
+                int id = n.packetId++;
+                if (n.plan.isEnabled()) {
+                    n.plan.failPendingExchange(now);
+                    hop = n.plan.getHopIndex();
+                    n.plan.expireBlacklist(now);
+                    mask = n.plan.getBlacklistMask(now);
+                    n.plan.beginExchange(id, hop, mask, now, 2 * helloUs / 1000 + HOP_ACK_MARGIN_MS);
+                }
+                n.waitingId = id;
+                n.hellos++;
+                transmit(i, now, n.plan.getCurrentChannel(), false, id, hop, mask);
+                n.nextHello = now + 15000 + simRandom(rng) % 15000;
+            }
+        }
+    }
+
+    result.worstLink = UINT32_MAX;
+    for (const SimNode& n : node) {
+        result.hellos += n.hellos;
+        result.exchanges += n.exchanges;
+        result.worstLink = min(result.worstLink, n.exchanges);
+    }
+    return result;
+}
+
+int main() {
+    const uint8_t channelCounts[] = {1, 2, 4, 8, 16};
+    const int nodeCounts[] = {2, 8, 16, 32, 64};
+    const int columns = sizeof(channelCounts) / sizeof(channelCounts[0]);
+    const int rows = sizeof(nodeCounts) / sizeof(nodeCounts[0]);
+    float perMinute[rows][columns];
+
+    printf("SF%d/%.0f kHz, HLO %u us, ACK %u us, HLO every 15-30 s per node, %u min\n",
+           SIM_PARAMS.spreading, SIM_PARAMS.bandwidth, (unsigned)loraAirtimeUs(SIM_PARAMS, 14),
+           (unsigned)loraAirtimeUs(SIM_PARAMS, 8), (unsigned)(SIM_MS / 60000));
+    printf("exchanges/min (delivery %%, worst node exchanges)\n");
+    printf("%6s", "M \\ N");
+    for (int c = 0; c < columns; c++) {
+        printf(" %22u", channelCounts[c]);
+    }
+    printf("\n");
+    for (int r = 0; r < rows; r++) {
+        printf("%6d", nodeCounts[r]);
+        for (int c = 0; c < columns; c++) {
+            SimResult result = simulate(channelCounts[c], nodeCounts[r]);
+            perMinute[r][c] = result.exchanges * 60000.0f / SIM_MS;
+            printf(" %7.1f (%5.1f%%, %5u)", perMinute[r][c], 100.0f * result.exchanges / result.hellos,
+                   (unsigned)result.worstLink);
+        }
+        printf("\n");
+    }
+
+    // Один линк: коллизий почти нет, перестройка не должна терять обмены
+    CHECK(perMinute[0][3] >= perMinute[0][0] * 0.95f);
+    // Нагруженный эфир: каналы поднимают суммарную пропускную способность
+    CHECK(perMinute[rows - 1][3] > perMinute[rows - 1][0] * 1.5f);
+    CHECK(perMinute[rows - 1][columns - 1] > perMinute[rows - 1][2]);
+    return testResult();
+}
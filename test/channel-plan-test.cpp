@@ -0,0 +1,251 @@
+// Частотный план: последовательность каналов, исключение каналов и обмены
+// HLO/ACK двух узлов, в том числе встречные (оба узла ждут свой ACK)
+#include "test.h"
+#include "channel-plan.h"
+#include "config.h"
+
+static const uint8_t CHANNELS = 8;
+static const uint32_t SEED = 0x5EED;
+static const uint32_t ACK_TIMEOUT_MS = 3000;
+
+static void configurePair(ChannelPlan& a, ChannelPlan& b) {
+    a.configure(CHANNELS, SEED);
+    b.configure(CHANNELS, SEED);
+}
+
+static void testSequence() {
+    printf("sequence\n");
+    ChannelPlan a;
+    ChannelPlan b;
+    configurePair(a, b);
+    // Перестановка: каждый канал один раз за CHANNELS шагов, одинаково на обоих узлах
+    uint32_t seen = 0;
+    for (uint32_t hop = 0; hop < CHANNELS; hop++) {
+        CHECK_EQ(a.channelForHop(hop, 0), b.channelForHop(hop, 0));
+        seen |= 1UL << a.channelForHop(hop, 0);
+    }
+    CHECK_EQ(seen, (1UL << CHANNELS) - 1);
+    // Исключённый канал заменяется следующим по последовательности, домашний не исключается
+    for (uint32_t hop = 0; hop < CHANNELS; hop++) {
+        uint8_t channel = a.channelForHop(hop, 0);
+        uint32_t mask = 1UL << channel;
+        uint8_t replaced = a.channelForHop(hop, mask);
+        if (channel == 0) {
+            CHECK_EQ(replaced, 0);
+        } else {
+            CHECK(replaced != channel);
+            CHECK_EQ(replaced, a.channelForHop(hop + 1, mask));
+        }
+    }
+    // Выключенная перестройка - всегда домашний канал
+    ChannelPlan single;
+    single.configure(1, SEED);
+    CHECK(!single.isEnabled());
+    CHECK_EQ(single.channelForHop(5, 0), 0);
+}
+
+// Обычный обмен: A шлёт HLO с шагом hop, оба узла переходят на шаг hop + 1
+static void testExchange() {
+    printf("exchange\n");
+    ChannelPlan a;
+    ChannelPlan b;
+    configurePair(a, b);
+    uint32_t hop = a.getHopIndex();
+    a.beginExchange(1, hop, 0, 0, ACK_TIMEOUT_MS);
+    CHECK(b.advance(hop, 0, 10));
+    CHECK(!a.completeExchange(2, 100));   // Чужой ACK обмен не завершает
+    CHECK(a.completeExchange(1, 100));
+    CHECK(!a.completeExchange(1, 100));   // Повтор ACK - уже завершён
+    CHECK_EQ(a.getHopIndex(), hop + 1);
+    CHECK_EQ(b.getHopIndex(), hop + 1);
+    CHECK_EQ(a.getCurrentChannel(), b.getCurrentChannel());
+    CHECK_EQ(a.getCurrentChannel(), a.channelForHop(hop + 1, 0));
+    CHECK(!a.isHome());
+    CHECK_EQ(a.getStats(0).successes, 1);
+}
+
+// Встречные HLO с одним шагом: HLO пира не двигает узел, ждущий свой ACK
+// (переход отложен); после ACK оба узла на одном канале
+static void testCrossedSameHop() {
+    printf("crossed, same hop\n");
+    ChannelPlan a;
+    ChannelPlan b;
+    configurePair(a, b);
+    uint32_t hop = a.getHopIndex();
+    a.beginExchange(1, hop, 0, 0, ACK_TIMEOUT_MS);
+    b.beginExchange(7, hop, 0, 0, ACK_TIMEOUT_MS);
+    CHECK(!a.advance(hop, 0, 10));
+    CHECK(!b.advance(hop, 0, 10));
+    CHECK(a.isHome());
+    CHECK(b.isHome());
+    CHECK(a.completeExchange(1, 100));
+    CHECK(b.completeExchange(7, 100));
+    CHECK_EQ(a.getHopIndex(), hop + 1);
+    CHECK_EQ(b.getHopIndex(), hop + 1);
+    CHECK_EQ(a.getCurrentChannel(), b.getCurrentChannel());
+}
+
+// Встречные HLO с разными шагами (A уже ушёл вперёд): ACK своего обмена
+// обрабатывается на своём шаге, HLO пира его не портит. Узлы расходятся,
+// и следующий потерянный обмен возвращает обоих на домашний канал
+static void testCrossedDifferentHops() {
+    printf("crossed, different hops\n");
+    ChannelPlan a;
+    ChannelPlan b;
+    configurePair(a, b);
+    // A и B синхронно прошли два шага
+    for (int id = 1; id <= 2; id++) {
+        uint32_t hop = a.getHopIndex();
+        a.beginExchange(id, hop, 0, 0, ACK_TIMEOUT_MS);
+        CHECK(b.advance(hop, 0, 10));
+        CHECK(a.completeExchange(id, 100));
+    }
+    uint32_t hopA = a.getHopIndex();
+    // B потерял синхронизацию и вернулся домой, но сохранил номер шага
+    b.goHome();
+    CHECK(b.isHome());
+
+    uint32_t hopB = b.getHopIndex() + 5;
+    a.beginExchange(3, hopA, 0, 0, ACK_TIMEOUT_MS);
+    b.beginExchange(8, hopB, 0, 0, ACK_TIMEOUT_MS);
+    // HLO пира у ждущего узла канал не меняет
+    CHECK(!a.advance(hopB, 0, 10));
+    CHECK(!b.advance(hopA, 0, 10));
+    CHECK_EQ(a.getHopIndex(), hopA);
+    // Каждый ACK завершает обмен своего узла его собственным шагом
+    CHECK(a.completeExchange(3, 200));
+    CHECK_EQ(a.getHopIndex(), hopA + 1);
+    CHECK_EQ(a.getCurrentChannel(), a.channelForHop(hopA + 1, 0));
+    CHECK(b.completeExchange(8, 200));
+    CHECK_EQ(b.getHopIndex(), hopB + 1);
+
+    // Следующие HLO без ответа: оба узла сходятся на домашнем канале
+    if (a.getCurrentChannel() != b.getCurrentChannel()) {
+        a.beginExchange(4, a.getHopIndex(), 0, 0, ACK_TIMEOUT_MS);
+        b.beginExchange(9, b.getHopIndex(), 0, 0, ACK_TIMEOUT_MS);
+        CHECK(a.failPendingExchange(300));
+        CHECK(b.failPendingExchange(300));
+    }
+    CHECK_EQ(a.getCurrentChannel(), b.getCurrentChannel());
+
+    // На одном канале обмен снова синхронизирует шаг
+    uint32_t hop = a.getHopIndex();
+    a.beginExchange(5, hop, 0, 0, ACK_TIMEOUT_MS);
+    CHECK(b.advance(hop, 0, 10));
+    CHECK(a.completeExchange(5, 400));
+    CHECK_EQ(a.getHopIndex(), b.getHopIndex());
+    CHECK_EQ(a.getCurrentChannel(), b.getCurrentChannel());
+}
+
+// HLO пира во время ожидания ACK откладывается; ACK не пришёл - узел
+// идёт на шаг пира, куда тот уже перешёл, а не на домашний канал
+static void testDeferredAdvance() {
+    printf("deferred peer advance\n");
+    ChannelPlan a;
+    ChannelPlan b;
+    configurePair(a, b);
+    uint32_t hop = a.getHopIndex();
+    a.beginExchange(1, hop, 0, 0, ACK_TIMEOUT_MS);
+    b.beginExchange(7, hop, 0, 0, ACK_TIMEOUT_MS);
+    CHECK(!b.advance(hop, 0, 10));     // HLO A дошёл до B, B ответил ACK
+    CHECK(a.completeExchange(1, 20));  // ACK от B дошёл, A перешёл
+    // HLO B до A не дошёл: B переходит по HLO A, когда ожидание истекает
+    CHECK(!b.expireExchange(ACK_TIMEOUT_MS - 1));
+    CHECK(b.isHome());
+    CHECK(b.expireExchange(ACK_TIMEOUT_MS));
+    CHECK(!b.expireExchange(ACK_TIMEOUT_MS + 1));
+    CHECK_EQ(b.getHopIndex(), hop + 1);
+    CHECK_EQ(a.getCurrentChannel(), b.getCurrentChannel());
+    CHECK_EQ(b.getStats(0).attempts, 1);
+    CHECK_EQ(b.getStats(0).successes, 0);
+
+    // То же через failPendingExchange (следующий HLO раньше истечения)
+    hop = a.getHopIndex();
+    uint8_t channel = a.getCurrentChannel();
+    a.beginExchange(2, hop, 0, 100, ACK_TIMEOUT_MS);
+    b.beginExchange(8, hop, 0, 100, ACK_TIMEOUT_MS);
+    CHECK(!b.advance(hop, 0, 110));
+    CHECK(a.completeExchange(2, 120));
+    CHECK(b.failPendingExchange(200));
+    CHECK_EQ(b.getHopIndex(), hop + 1);
+    CHECK_EQ(a.getCurrentChannel(), b.getCurrentChannel());
+    CHECK_EQ(b.getStats(channel).attempts, 1);
+}
+
+// Обмен, чьё ожидание ACK истекло, HLO пира не блокирует: пир ведёт,
+// обмен засчитывается неудачным
+static void testStaleExchange() {
+    printf("stale exchange\n");
+    ChannelPlan a;
+    ChannelPlan b;
+    configurePair(a, b);
+    uint32_t hop = a.getHopIndex();
+    b.beginExchange(7, hop, 0, 0, ACK_TIMEOUT_MS);
+    a.beginExchange(1, hop, 0, ACK_TIMEOUT_MS + 100, ACK_TIMEOUT_MS);
+    CHECK(b.advance(hop, 0, ACK_TIMEOUT_MS + 110));
+    CHECK(a.completeExchange(1, ACK_TIMEOUT_MS + 120));
+    CHECK_EQ(a.getCurrentChannel(), b.getCurrentChannel());
+    CHECK_EQ(b.getStats(0).attempts, 1);
+    CHECK_EQ(b.getStats(0).successes, 0);
+    // Опоздавший ACK старого обмена уже ничего не меняет
+    CHECK(!b.completeExchange(7, ACK_TIMEOUT_MS + 200));
+    CHECK(!b.failPendingExchange(ACK_TIMEOUT_MS + 200));
+    CHECK_EQ(b.getHopIndex(), hop + 1);
+}
+
+// Потерянный ACK: узел возвращается домой, пир - после тишины HOP_RESYNC_MS
+static void testLostAck() {
+    printf("lost ACK and resync\n");
+    ChannelPlan a;
+    ChannelPlan b;
+    configurePair(a, b);
+    uint32_t hop = a.getHopIndex();
+    a.beginExchange(1, hop, 0, 0, ACK_TIMEOUT_MS);
+    CHECK(b.advance(hop, 0, 10));
+    b.onHeard(0);
+    CHECK(a.failPendingExchange(1000));
+    CHECK(!a.failPendingExchange(1000));
+    CHECK(a.isHome());
+    CHECK_EQ(a.getStats(0).attempts, 1);
+    CHECK_EQ(a.getStats(0).successes, 0);
+    CHECK(!b.checkResync(HOP_RESYNC_MS - 1));
+    CHECK(b.checkResync(HOP_RESYNC_MS));
+    CHECK(b.isHome());
+    CHECK_EQ(a.getCurrentChannel(), b.getCurrentChannel());
+}
+
+// Плохой канал исключается, но не больше, чем оставив два рабочих;
+// срок исключения истекает в expireBlacklist
+static void testBlacklist() {
+    printf("blacklist\n");
+    ChannelPlan plan;
+    plan.configure(4, SEED);
+    for (int i = 0; i < HOP_BLACKLIST_MIN_TRIES + 4; i++) {
+        for (uint8_t channel = 0; channel < 4; channel++) {
+            plan.recordResult(channel, false, 1000);
+        }
+    }
+    uint32_t mask = plan.getBlacklistMask(1000);
+    CHECK(mask & (1UL << 1));
+    CHECK(mask & (1UL << 2));
+    CHECK(!(mask & (1UL << 3)));   // Рабочими остаются каналы 0 и 3
+    CHECK(!(mask & 1UL));          // Домашний не исключается
+    CHECK_EQ(plan.getBlacklistMask(1000 + HOP_BLACKLIST_MS), 0);
+    // Геттер состояние не меняет, снимает исключение задача радио
+    CHECK(plan.getStats(1).blacklistedUntil != 0);
+    plan.expireBlacklist(1000 + HOP_BLACKLIST_MS);
+    CHECK_EQ(plan.getStats(1).blacklistedUntil, 0);
+    CHECK_EQ(plan.getStats(1).attempts, 0);
+}
+
+int main() {
+    testSequence();
+    testExchange();
+    testCrossedSameHop();
+    testCrossedDifferentHops();
+    testDeferredAdvance();
+    testStaleExchange();
+    testLostAck();
+    testBlacklist();
+    return testResult();
+}
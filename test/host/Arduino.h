@@ -0,0 +1,203 @@
+#pragma once
+// Ядро Arduino для сборки модулей скетча на хосте (test/CMakeLists.txt).
+// Только то, что нужно тестируемым модулям: String поверх std::string, Print,
+// время от часов хоста и ESP.getCycleCount() от счётчика тактов процессора
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define LOW     0
+#define HIGH    1
+#define INPUT   0x01
+#define OUTPUT  0x03
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define HEX 16
+#define DEC 10
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define PROGMEM
+#define F(x) x
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::min;
+using std::max;
+
+size_t strlcpy(char* dst, const char* src, size_t size);
+
+class String {
+public:
+    String(const char* s = "") : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    String(char c) : _s(1, c) {}
+    String(int v, unsigned char base = 10) : _s(format(v, base)) {}
+    String(unsigned int v, unsigned char base = 10) : _s(format(v, base)) {}
+    String(long v, unsigned char base = 10) : _s(format(v, base)) {}
+    String(unsigned long v, unsigned char base = 10) : _s(format(v, base)) {}
+    String(long long v, unsigned char base = 10) : _s(format(v, base)) {}
+    String(unsigned long long v, unsigned char base = 10) : _s(format(v, base)) {}
+    String(double v, unsigned int decimals = 2);
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+    void clear() { _s.clear(); }
+
+    char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : '\0'; }
+    char& operator[](unsigned int i) { return _s[i]; }
+    bool operator==(const String& other) const { return _s == other._s; }
+    bool operator==(const char* other) const { return _s == other; }
+    bool operator!=(const String& other) const { return _s != other._s; }
+    bool operator!=(const char* other) const { return _s != other; }
+    bool equals(const String& other) const { return _s == other._s; }
+
+    String& operator+=(const String& other) { _s += other._s; return *this; }
+    String& operator+=(const char* other) { _s += other; return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+    template <typename T>
+    String& operator+=(T v) { return *this += String(v); }
+    bool concat(const char* s, unsigned int n) { _s.append(s, n); return true; }
+    bool concat(const String& other) { _s += other._s; return true; }
+    bool concat(char c) { _s += c; return true; }
+
+    bool startsWith(const String& prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+    bool endsWith(const String& suffix) const {
+        return _s.size() >= suffix._s.size() &&
+               _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const { return find(_s.find(c, from)); }
+    int indexOf(const String& s, unsigned int from = 0) const { return find(_s.find(s._s, from)); }
+    int lastIndexOf(char c) const { return find(_s.rfind(c)); }
+    String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        return from < _s.size() && to > from ? String(_s.substr(from, to - from)) : String();
+    }
+    long toInt() const { return atol(_s.c_str()); }
+    float toFloat() const { return atof(_s.c_str()); }
+    void trim();
+    void remove(unsigned int index, unsigned int count = 1) {
+        if (index < _s.size()) _s.erase(index, count);
+    }
+    void replace(const String& from, const String& to);
+    void toUpperCase();
+
+    friend String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+    friend String operator+(const String& a, const char* b) { return String(a._s + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b._s); }
+    friend String operator+(const String& a, char b) { return String(a._s + b); }
+    template <typename T>
+    friend String operator+(const String& a, T b) { return a + String(b); }
+
+private:
+    template <typename T>
+    static std::string format(T v, unsigned char base);
+    static int find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+    std::string _s;
+};
+
+template <typename T>
+std::string String::format(T v, unsigned char base) {
+    char buffer[72];
+    if (base == 16) {
+        snprintf(buffer, sizeof(buffer), "%llx", (unsigned long long)v);
+    } else if (v < 0) {
+        snprintf(buffer, sizeof(buffer), "%lld", (long long)v);
+    } else {
+        snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)v);
+    }
+    return buffer;
+}
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t write(const char* s, size_t size) { return write((const uint8_t*)s, size); }
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str(), s.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    template <typename T>
+    size_t print(T v) { return print(String(v)); }
+    template <typename T>
+    size_t println(T v) { return print(v) + println(); }
+    size_t println() { return write("\r\n"); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    void setTimeout(unsigned long) {}
+};
+
+// Serial - стандартный вывод
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+    using Print::write;
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode);
+void detachInterrupt(uint8_t pin);
+// Фронт на выводе: обработчик прерывания вызывается в потоке теста; false - не подключён
+bool hostRaiseInterrupt(uint8_t pin);
+
+class EspClass {
+public:
+    // Такты процессора хоста (TSC на x86, иначе наносекунды); на виртуальных
+    // часах - от них, 240 МГц
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz();
+    uint32_t getFreeHeap() { return 0; }
+    uint32_t getMinFreeHeap() { return 0; }
+    uint32_t getMaxAllocHeap() { return 0; }
+    uint32_t getHeapSize() { return 0; }
+};
+
+extern EspClass ESP;
+
+inline uint32_t getCpuFrequencyMhz() {
+    return ESP.getCpuFreqMHz();
+}
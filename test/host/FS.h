@@ -0,0 +1,80 @@
+#pragma once
+// fs::FS для хоста поверх каталога: пути FS отсчитываются от корня root.
+// close() файла, открытого на запись, - fsync, как фиксация записи в LittleFS;
+// число фиксаций и открытий считается для замеров
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct FileImpl;
+
+class File : public Stream {
+public:
+    File() {}
+    explicit File(std::shared_ptr<FileImpl> impl) : _impl(impl) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    size_t read(uint8_t* buffer, size_t size);
+    bool seek(uint32_t position, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const;
+    const char* name() const;
+    const char* path() const;
+    bool isDirectory() const;
+    File openNextFile(const char* mode = FILE_READ);
+
+private:
+    std::shared_ptr<FileImpl> _impl;
+};
+
+class FS {
+public:
+    // Каталог root создаётся, если его нет
+    explicit FS(const std::string& root);
+
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool mkdir(const char* path);
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+    bool rmdir(const char* path);
+
+    // Удаление всего содержимого корня (между тестами)
+    void clear();
+
+    uint32_t opens() const { return _opens; }
+    uint32_t commits() const { return _commits; }
+
+private:
+    std::string hostPath(const char* path) const;
+
+    std::string _root;
+    uint32_t _opens = 0;
+    uint32_t _commits = 0;
+    friend struct FileImpl;
+};
+
+}  // namespace fs
+
+using fs::FS;
+using fs::File;
@@ -0,0 +1,5 @@
+#pragma once
+// GyverDB для хоста: модулям скетча нужен только DB_KEYS (ключи настроек)
+#include <Arduino.h>
+
+#define DB_KEYS(ns, ...) namespace ns { enum : size_t { __VA_ARGS__ }; }
@@ -0,0 +1,41 @@
+#pragma once
+// Шина SPI для хоста: байты уходят в подключённое устройство (HostSpiDevice),
+// транзакции и байты считаются
+#include <Arduino.h>
+
+#define MSBFIRST  1
+#define SPI_MODE0 0
+
+struct SPISettings {
+    SPISettings(uint32_t = 0, uint8_t = MSBFIRST, uint8_t = SPI_MODE0) {}
+};
+
+// Ведомое устройство на шине: select - начало транзакции
+class HostSpiDevice {
+public:
+    virtual ~HostSpiDevice() {}
+    virtual void select() = 0;
+    virtual uint8_t transfer(uint8_t data) = 0;
+    virtual void deselect() {}
+};
+
+class SPIClass {
+public:
+    void begin() {}
+    void beginTransaction(const SPISettings& settings);
+    void endTransaction();
+    uint8_t transfer(uint8_t data);
+    void transfer(uint8_t* data, size_t size);
+    void writeBytes(const uint8_t* data, size_t size);
+
+    void attach(HostSpiDevice* device) { _device = device; }
+    uint32_t transactions() const { return _transactions; }
+    uint32_t bytes() const { return _bytes; }
+
+private:
+    HostSpiDevice* _device = nullptr;
+    uint32_t _transactions = 0;
+    uint32_t _bytes = 0;
+};
+
+extern SPIClass SPI;
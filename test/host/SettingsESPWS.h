@@ -0,0 +1,35 @@
+#pragma once
+// SettingsESPWS для хоста: только sets::Logger - буфер веб-журнала (logging.h)
+#include <Arduino.h>
+#include <GyverDB.h>
+
+namespace sets {
+
+// Последние size байт текста; префиксы уровней - как у библиотеки
+class Logger : public Print {
+public:
+    explicit Logger(size_t size) : _size(size) {}
+
+    size_t write(uint8_t c) override {
+        _text += (char)c;
+        if (_text.size() > _size) {
+            _text.erase(0, _text.size() - _size);
+        }
+        return 1;
+    }
+    using Print::write;
+
+    void clear() { _text.clear(); }
+    size_t length() const { return _text.size(); }
+    const char* c_str() const { return _text.c_str(); }
+
+    static const char* info() { return "INFO: "; }
+    static const char* warn() { return "WARN: "; }
+    static const char* error() { return "ERROR: "; }
+
+private:
+    size_t _size;
+    std::string _text;
+};
+
+}  // namespace sets
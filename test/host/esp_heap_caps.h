@@ -0,0 +1,21 @@
+#pragma once
+// Куча ESP-IDF для хоста: PSRAM нет, heap_caps_malloc(MALLOC_CAP_SPIRAM) - nullptr
+#include <stdlib.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+
+inline void* heap_caps_malloc(size_t size, uint32_t caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? nullptr : malloc(size);
+}
+
+inline void heap_caps_free(void* p) {
+    free(p);
+}
+
+inline size_t heap_caps_get_free_size(uint32_t) {
+    return 0;
+}
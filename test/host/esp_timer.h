@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+
+// Монотонные часы хоста, мкс от запуска
+int64_t esp_timer_get_time();
+
+// Виртуальные часы теста: после hostClockSet esp_timer_get_time, millis и
+// micros возвращают заданное время, пока hostClockReal() не вернёт часы хоста
+void hostClockSet(int64_t us);
+void hostClockAdvance(int64_t us);
+void hostClockReal();
@@ -0,0 +1,42 @@
+#pragma once
+// FreeRTOS ESP-IDF для сборки на хосте: критические участки - спин-блокировка
+// с вложенностью, как portMUX на ESP32; номер ядра задаёт тест (hostSetCoreId)
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+typedef void* TaskHandle_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portNUM_PROCESSORS 2
+
+typedef struct {
+    volatile uint32_t owner;   // 0 - свободен, иначе номер потока хоста
+    volatile uint32_t count;   // Глубина вложенности
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+
+void vPortEnterCritical(portMUX_TYPE* mux);
+void vPortExitCritical(portMUX_TYPE* mux);
+
+#define portENTER_CRITICAL(mux)     vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)      vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)  vPortExitCritical(mux)
+#define portYIELD_FROM_ISR()
+
+// Ядро, на котором "выполняется" текущий поток хоста
+BaseType_t xPortGetCoreID();
+void hostSetCoreId(BaseType_t core);
+
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
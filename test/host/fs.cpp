@@ -0,0 +1,177 @@
+// fs::FS поверх каталога хоста
+#include <FS.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs {
+
+struct FileImpl {
+    FS* owner = nullptr;
+    FILE* file = nullptr;
+    bool directory = false;
+    bool writing = false;
+    std::string path;       // Путь внутри FS
+    std::string name;       // Последний компонент пути
+    std::vector<std::string> entries;
+    size_t nextEntry = 0;
+
+    ~FileImpl() { close(); }
+
+    void close() {
+        if (!file) {
+            return;
+        }
+        if (writing) {
+            fflush(file);
+            fsync(fileno(file));
+            owner->_commits++;
+        }
+        fclose(file);
+        file = nullptr;
+    }
+};
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    return _impl && _impl->file ? fwrite(buffer, 1, size, _impl->file) : 0;
+}
+
+int File::available() {
+    return _impl && _impl->file ? (int)(size() - position()) : 0;
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+    return _impl && _impl->file ? fread(buffer, 1, size, _impl->file) : 0;
+}
+
+bool File::seek(uint32_t position, SeekMode mode) {
+    static const int whence[] = {SEEK_SET, SEEK_CUR, SEEK_END};
+    return _impl && _impl->file && fseek(_impl->file, position, whence[mode]) == 0;
+}
+
+size_t File::position() const {
+    return _impl && _impl->file ? (size_t)ftell(_impl->file) : 0;
+}
+
+size_t File::size() const {
+    if (!_impl || !_impl->file) {
+        return 0;
+    }
+    fflush(_impl->file);
+    struct stat st;
+    return fstat(fileno(_impl->file), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::close() {
+    if (_impl) {
+        _impl->close();
+        _impl.reset();
+    }
+}
+
+File::operator bool() const {
+    return _impl && (_impl->file || _impl->directory);
+}
+
+const char* File::name() const {
+    return _impl ? _impl->name.c_str() : "";
+}
+
+const char* File::path() const {
+    return _impl ? _impl->path.c_str() : "";
+}
+
+bool File::isDirectory() const {
+    return _impl && _impl->directory;
+}
+
+File File::openNextFile(const char* mode) {
+    if (!_impl || !_impl->directory || _impl->nextEntry >= _impl->entries.size()) {
+        return File();
+    }
+    std::string path = _impl->path + "/" + _impl->entries[_impl->nextEntry++];
+    return _impl->owner->open(path.c_str(), mode);
+}
+
+FS::FS(const std::string& root) : _root(root) {
+    ::mkdir(_root.c_str(), 0755);
+}
+
+std::string FS::hostPath(const char* path) const {
+    return _root + (path[0] == '/' ? "" : "/") + path;
+}
+
+File FS::open(const char* path, const char* mode, bool) {
+    std::string host = hostPath(path);
+    auto impl = std::make_shared<FileImpl>();
+    impl->owner = this;
+    impl->path = path;
+    impl->name = impl->path.substr(impl->path.find_last_of('/') + 1);
+
+    struct stat st;
+    if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(host.c_str());
+        if (!dir) {
+            return File();
+        }
+        while (dirent* entry = readdir(dir)) {
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+                impl->entries.push_back(entry->d_name);
+            }
+        }
+        closedir(dir);
+        impl->directory = true;
+        return File(impl);
+    }
+    impl->writing = strcmp(mode, FILE_READ) != 0;
+    impl->file = fopen(host.c_str(), impl->writing ? (mode[0] == 'a' ? "ab+" : "wb+") : "rb");
+    if (!impl->file) {
+        return File();
+    }
+    _opens++;
+    return File(impl);
+}
+
+bool FS::exists(const char* path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+    return unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const char* path) {
+    return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+static void removeTree(const std::string& path) {
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        unlink(path.c_str());
+        return;
+    }
+    while (dirent* entry = readdir(dir)) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            removeTree(path + "/" + entry->d_name);
+        }
+    }
+    closedir(dir);
+    ::rmdir(path.c_str());
+}
+
+void FS::clear() {
+    removeTree(_root);
+    ::mkdir(_root.c_str(), 0755);
+}
+
+}  // namespace fs
@@ -0,0 +1,341 @@
+// Реализация ядра Arduino и FreeRTOS для тестов на хосте
+#include <Arduino.h>
+#include <SPI.h>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static const auto hostStart = std::chrono::steady_clock::now();
+static std::mt19937 hostRandom(1);
+
+static std::atomic<bool> hostClockVirtual(false);
+static std::atomic<int64_t> hostClockUs(0);
+
+int64_t esp_timer_get_time() {
+    if (hostClockVirtual.load()) {
+        return hostClockUs.load();
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - hostStart).count();
+}
+
+void hostClockSet(int64_t us) {
+    hostClockUs = us;
+    hostClockVirtual = true;
+}
+
+void hostClockAdvance(int64_t us) {
+    hostClockUs += us;
+}
+
+void hostClockReal() {
+    hostClockVirtual = false;
+}
+
+unsigned long millis() {
+    return (unsigned long)(esp_timer_get_time() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)esp_timer_get_time();
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+long random(long max) {
+    return max > 0 ? (long)(hostRandom() % (unsigned long)max) : 0;
+}
+
+long random(long min, long max) {
+    return max > min ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long seed) {
+    hostRandom.seed(seed);
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t length = strlen(src);
+    if (size > 0) {
+        size_t n = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return length;
+}
+
+// На виртуальных часах такты идут от них же с частотой ядра ESP32: счётчик
+// переполняется каждые ~17.9 с виртуального времени, как на устройстве
+static const uint32_t HOST_VIRTUAL_MHZ = 240;
+
+uint32_t EspClass::getCycleCount() {
+    if (hostClockVirtual.load()) {
+        return (uint32_t)(hostClockUs.load() * HOST_VIRTUAL_MHZ);
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+uint32_t EspClass::getCpuFreqMHz() {
+    if (hostClockVirtual.load()) {
+        return HOST_VIRTUAL_MHZ;
+    }
+    // Частота счётчика тактов: замер по часам хоста один раз
+    static uint32_t mhz = 0;
+    if (mhz == 0) {
+        int64_t startUs = esp_timer_get_time();
+        uint32_t start = getCycleCount();
+        while (esp_timer_get_time() - startUs < 20000) {
+        }
+        mhz = (getCycleCount() - start) / (uint32_t)(esp_timer_get_time() - startUs);
+    }
+    return mhz;
+}
+
+String::String(double v, unsigned int decimals) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, v);
+    _s = buffer;
+}
+
+void String::trim() {
+    size_t begin = _s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        _s.clear();
+        return;
+    }
+    size_t end = _s.find_last_not_of(" \t\r\n");
+    _s = _s.substr(begin, end - begin + 1);
+}
+
+void String::replace(const String& from, const String& to) {
+    if (from._s.empty()) {
+        return;
+    }
+    size_t pos = 0;
+    while ((pos = _s.find(from._s, pos)) != std::string::npos) {
+        _s.replace(pos, from._s.size(), to._s);
+        pos += to._s.size();
+    }
+}
+
+void String::toUpperCase() {
+    for (char& c : _s) {
+        c = toupper((unsigned char)c);
+    }
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (size--) {
+        written += write(*buffer++);
+    }
+    return written;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length <= 0) {
+        return 0;
+    }
+    return write((const uint8_t*)buffer, min((size_t)length, sizeof(buffer) - 1));
+}
+
+// FreeRTOS
+
+static std::atomic<uint32_t> hostThreadCount(0);
+static thread_local uint32_t hostThreadId = 0;
+static thread_local BaseType_t hostCoreId = 0;
+
+static uint32_t currentThreadId() {
+    if (hostThreadId == 0) {
+        hostThreadId = ++hostThreadCount;
+    }
+    return hostThreadId;
+}
+
+void vPortEnterCritical(portMUX_TYPE* mux) {
+    uint32_t self = currentThreadId();
+    if (__atomic_load_n(&mux->owner, __ATOMIC_ACQUIRE) == self) {
+        mux->count++;
+        return;
+    }
+    uint32_t expected = 0;
+    while (!__atomic_compare_exchange_n(&mux->owner, &expected, self, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        expected = 0;
+        std::this_thread::yield();
+    }
+    mux->count = 1;
+}
+
+void vPortExitCritical(portMUX_TYPE* mux) {
+    if (--mux->count == 0) {
+        __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+    }
+}
+
+BaseType_t xPortGetCoreID() {
+    return hostCoreId;
+}
+
+void hostSetCoreId(BaseType_t core) {
+    hostCoreId = core;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    delay(ticks);
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)millis();
+}
+
+// Задача - поток хоста: дескриптор - адрес его локальной переменной
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    static thread_local char task;
+    return &task;
+}
+
+// Счётный семафор с пределом: мьютекс - 1 из 1, двоичный - 0 из 1
+struct HostSemaphore {
+    std::mutex mutex;
+    std::condition_variable ready;
+    uint32_t count;
+    uint32_t limit;
+};
+
+static SemaphoreHandle_t hostSemaphoreCreate(uint32_t count, uint32_t limit) {
+    SemaphoreHandle_t semaphore = new HostSemaphore();
+    semaphore->count = count;
+    semaphore->limit = limit;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return hostSemaphoreCreate(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return hostSemaphoreCreate(0, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+    auto available = [semaphore]() { return semaphore->count > 0; };
+    if (ticks == portMAX_DELAY) {
+        semaphore->ready.wait(lock, available);
+    } else if (!semaphore->ready.wait_for(lock, std::chrono::milliseconds(ticks), available)) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    if (semaphore->count >= semaphore->limit) {
+        return pdFALSE;
+    }
+    semaphore->count++;
+    semaphore->ready.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* woken) {
+    if (woken) {
+        *woken = pdFALSE;
+    }
+    return xSemaphoreGive(semaphore);
+}
+
+// Выводы и прерывания
+
+static void (*hostInterrupts[64])() = {};
+static uint8_t hostPins[64] = {};
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    hostPins[pin & 63] = value;
+}
+
+int digitalRead(uint8_t pin) {
+    return hostPins[pin & 63];
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(), int) {
+    hostInterrupts[pin & 63] = handler;
+}
+
+void detachInterrupt(uint8_t pin) {
+    hostInterrupts[pin & 63] = nullptr;
+}
+
+bool hostRaiseInterrupt(uint8_t pin) {
+    void (*handler)() = hostInterrupts[pin & 63];
+    if (!handler) {
+        return false;
+    }
+    handler();
+    return true;
+}
+
+// SPI
+
+SPIClass SPI;
+
+void SPIClass::beginTransaction(const SPISettings&) {
+    _transactions++;
+    if (_device) {
+        _device->select();
+    }
+}
+
+void SPIClass::endTransaction() {
+    if (_device) {
+        _device->deselect();
+    }
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+    _bytes++;
+    return _device ? _device->transfer(data) : 0;
+}
+
+void SPIClass::transfer(uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        data[i] = transfer(data[i]);
+    }
+}
+
+void SPIClass::writeBytes(const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        transfer(data[i]);
+    }
+}
@@ -0,0 +1,216 @@
+// JsonWriter против сборки ответа в String, как раньше делали обработчики:
+// таблица задач (/api/tasks) и история метрик (/api/history). Оба способа
+// дают один и тот же текст; сравниваются время на хосте, число выделений
+// памяти и пик занятой кучи. Выделения считает замена operator new
+#include "test.h"
+#include "json-writer.h"
+#include <chrono>
+#include <new>
+
+static const int TASKS = 16;
+static const int SAMPLES = 120;
+static const int ROUNDS = 2000;
+
+static size_t allocations = 0;
+static size_t liveBytes = 0;
+static size_t peakBytes = 0;
+
+// Размер блока хранится перед ним, чтобы считать занятую кучу
+void* operator new(size_t size) {
+    allocations++;
+    liveBytes += size;
+    peakBytes = max(peakBytes, liveBytes);
+    size_t* block = (size_t*)malloc(size + sizeof(max_align_t));
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *block = size;
+    return (char*)block + sizeof(max_align_t);
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) {
+        return;
+    }
+    size_t* block = (size_t*)((char*)p - sizeof(max_align_t));
+    liveBytes -= *block;
+    free(block);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+// Сокет: копит ответ в статическом буфере для сравнения
+class Sink : public Print {
+public:
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        if (used + size <= sizeof(text)) {
+            memcpy(text + used, buffer, size);
+        }
+        used += size;
+        writes++;
+        return size;
+    }
+    void reset() {
+        used = 0;
+        writes = 0;
+    }
+    bool equals(const Sink& other) const { return used == other.used && memcmp(text, other.text, used) == 0; }
+
+    char text[16384];
+    size_t used = 0;
+    size_t writes = 0;
+};
+
+struct Task {
+    char name[16];
+    uint32_t priority;
+    uint32_t stackFree;
+    const char* state;
+    float cpu;
+};
+
+static Task tasks[TASKS];
+static float rssi[SAMPLES];
+static uint32_t heap[SAMPLES];
+
+static void fillData() {
+    static const char* const states[] = {"RUN", "READY", "BLOCK", "SUSP"};
+    for (int i = 0; i < TASKS; i++) {
+        snprintf(tasks[i].name, sizeof(tasks[i].name), "task-%d", i);
+        tasks[i].priority = i % 5 + 1;
+        tasks[i].stackFree = 1000 + 37 * i;
+        tasks[i].state = states[i % 4];
+        tasks[i].cpu = 0.7f * i;
+    }
+    for (int i = 0; i < SAMPLES; i++) {
+        rssi[i] = -120.0f + 0.25f * i;
+        heap[i] = 180000 + 13 * i;
+    }
+}
+
+static void tasksWriter(Print& out) {
+    JsonWriter json(out);
+    json.beginObject();
+    json.field("tasks", (uint32_t)TASKS);
+    json.key("list");
+    json.beginArray();
+    for (int i = 0; i < TASKS; i++) {
+        json.beginObject();
+        json.field("name", (const char*)tasks[i].name);
+        json.field("priority", tasks[i].priority);
+        json.field("stack_free", tasks[i].stackFree);
+        json.field("state", tasks[i].state);
+        json.field("cpu", tasks[i].cpu, 1);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    json.flush();
+}
+
+static void tasksString(Print& out) {
+    String body = "{\"tasks\":" + String(TASKS) + ",\"list\":[";
+    for (int i = 0; i < TASKS; i++) {
+        if (i) {
+            body += ",";
+        }
+        body += "{\"name\":\"" + String(tasks[i].name) + "\",\"priority\":" + String(tasks[i].priority) +
+                ",\"stack_free\":" + String(tasks[i].stackFree) + ",\"state\":\"" + String(tasks[i].state) +
+                "\",\"cpu\":" + String(tasks[i].cpu, 1) + "}";
+    }
+    body += "]}";
+    out.print(body);
+}
+
+static void historyWriter(Print& out) {
+    JsonWriter json(out);
+    json.beginObject();
+    json.key("rssi");
+    json.beginArray();
+    for (int i = 0; i < SAMPLES; i++) {
+        json.value(rssi[i], 1);
+    }
+    json.endArray();
+    json.key("free_heap");
+    json.beginArray();
+    for (int i = 0; i < SAMPLES; i++) {
+        json.value(heap[i]);
+    }
+    json.endArray();
+    json.endObject();
+    json.flush();
+}
+
+static void historyString(Print& out) {
+    String body = "{\"rssi\":[";
+    for (int i = 0; i < SAMPLES; i++) {
+        if (i) {
+            body += ",";
+        }
+        body += String(rssi[i], 1);
+    }
+    body += "],\"free_heap\":[";
+    for (int i = 0; i < SAMPLES; i++) {
+        if (i) {
+            body += ",";
+        }
+        body += String(heap[i]);
+    }
+    body += "]}";
+    out.print(body);
+}
+
+struct Cost {
+    double us;
+    double allocations;
+    size_t peakBytes;
+    size_t writes;
+};
+
+static Cost measure(void (*build)(Print&), Sink& sink) {
+    // Пик кучи - по одному ответу
+    sink.reset();
+    size_t startAllocations = allocations;
+    peakBytes = liveBytes;
+    size_t base = liveBytes;
+    build(sink);
+    Cost cost;
+    cost.allocations = (double)(allocations - startAllocations);
+    cost.peakBytes = peakBytes - base;
+    cost.writes = sink.writes;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        sink.used = 0;
+        build(sink);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    cost.us = std::chrono::duration<double, std::micro>(elapsed).count() / ROUNDS;
+    return cost;
+}
+
+static void compare(const char* name, void (*writer)(Print&), void (*string)(Print&)) {
+    static Sink fromWriter;
+    static Sink fromString;
+    Cost w = measure(writer, fromWriter);
+    Cost s = measure(string, fromString);
+    CHECK(fromWriter.equals(fromString));
+    printf("  %-8s %5u B: JsonWriter %.2f us, %.0f allocations, %u B heap, %u writes; "
+           "String %.2f us, %.0f allocations, %u B heap\n",
+           name, (unsigned)fromWriter.used, w.us, w.allocations, (unsigned)w.peakBytes,
+           (unsigned)w.writes, s.us, s.allocations, (unsigned)s.peakBytes);
+    CHECK_EQ(w.allocations, 0);
+    CHECK(s.allocations > 0);
+    CHECK(s.peakBytes >= fromString.used);
+}
+
+int main() {
+    fillData();
+    printf("JsonWriter vs String, %d rounds\n", ROUNDS);
+    compare("tasks", tasksWriter, tasksString);
+    compare("history", historyWriter, historyString);
+    return testResult();
+}
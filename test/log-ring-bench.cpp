@@ -0,0 +1,150 @@
+// Отложенный журнал против форматирования на вызывающем, как было до
+// log-ring.h: строка приёма из taskReceive (раньше serialLog.printf под
+// мьютексом SPI - здесь только его snprintf, без UART) и предупреждение
+// веб-журнала (раньше logger.println со склейкой String). Сравниваются время
+// вызова на хосте и выделения памяти; отдельно - сколько стоит та же запись
+// задаче журнала (logRingFlush). Текст после кольца совпадает с прежним.
+// Выделения считает замена operator new
+#include "test.h"
+#include "log-ring.h"
+#include "logging.h"
+#include <chrono>
+#include <new>
+
+static const uint32_t ROUNDS = 200000;
+// Записей между выводами кольца: строка приёма - около 60 байт, пачка
+// помещается в LOG_RING_SIZE
+static const uint32_t BATCH = 32;
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* block = malloc(size);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+struct Cost {
+    double ns;          // На вызов
+    double allocations; // На вызов
+};
+
+// Время пачек вызова fn; между пачками (вне замера) - between
+template <typename F, typename B>
+static Cost measure(F fn, B between) {
+    double ns = 0;
+    size_t count = 0;
+    for (uint32_t done = 0; done < ROUNDS; done += BATCH) {
+        size_t before = allocations;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < BATCH; i++) {
+            fn(done + i);
+        }
+        ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        count += allocations - before;
+        between();
+    }
+    return {ns / ROUNDS, (double)count / ROUNDS};
+}
+
+// Вывод кольца вне замера
+static void drain() {
+    logRingFlush();
+}
+
+static void print(const char* name, const Cost& cost) {
+    printf("  %-34s %8.1f ns %8.2f allocations\n", name, cost.ns, cost.allocations);
+}
+
+static const char* const RX_FORMAT = "Received: %s [RxDone: %lld us, RSSI: %d dBm, SNR: %.1f dB]";
+
+static void benchmarkReceive() {
+    printf("taskReceive line, per call\n");
+    String incoming = "HLO:1234:node-7f3a";
+    int64_t rxDoneUs = 1234567890;
+    int rssi = -97;
+    float snr = 7.25f;
+
+    char line[LOG_RING_LINE];
+    Cost before = measure(
+        [&](uint32_t i) {
+            snprintf(line, sizeof(line), RX_FORMAT, incoming.c_str(), (long long)(rxDoneUs + i), rssi, snr);
+        },
+        [] {});
+    Cost deferred = measure(
+        [&](uint32_t i) { LOGI(LOG_SINK_SERIAL, RX_FORMAT, incoming, rxDoneUs + i, rssi, snr); }, drain);
+
+    // Задача журнала: форматирование и вывод той же записи
+    uint32_t flushed = 0;
+    double flushNs = 0;
+    for (uint32_t done = 0; done < ROUNDS; done += BATCH) {
+        for (uint32_t i = 0; i < BATCH; i++) {
+            LOGI(LOG_SINK_SERIAL, RX_FORMAT, incoming, rxDoneUs + done + i, rssi, snr);
+        }
+        auto start = std::chrono::steady_clock::now();
+        flushed += logRingFlush();
+        flushNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+    print("snprintf (was serialLog.printf)", before);
+    print("LOGI into the ring", deferred);
+    printf("  %-34s %8.1f ns\n", "logRingFlush, per record", flushNs / ROUNDS);
+    CHECK_EQ(flushed, ROUNDS);
+    CHECK_EQ(deferred.allocations, 0.0);
+    CHECK(deferred.ns < before.ns);
+
+    // Текст записи - тот же, что давал printf
+    uint8_t record[LOG_RING_MAX_RECORD];
+    LogEncoder e = {record + sizeof(LogRecordHeader), record + sizeof(record), 0};
+    logEncodeAll(e, incoming, rxDoneUs, rssi, snr);
+    LogRecordHeader header = {RX_FORMAT, 0, (uint16_t)(e.pos - record), LOG_INFO, e.argc};
+    memcpy(record, &header, sizeof(header));
+    char formatted[LOG_RING_LINE];
+    logFormatRecord(record, formatted, sizeof(formatted));
+    snprintf(line, sizeof(line), RX_FORMAT, incoming.c_str(), (long long)rxDoneUs, rssi, snr);
+    CHECK(strcmp(formatted, line) == 0);
+}
+
+static void benchmarkWeb() {
+    printf("web log warning, per call\n");
+    uint32_t timeoutMs = 250;
+    Cost before = measure(
+        [&](uint32_t i) { logger.println(warn_() + "TxDone не получен за " + String(timeoutMs + i) + " мс"); },
+        [] {});
+    Cost deferred = measure([&](uint32_t i) { LOGW(LOG_SINK_WEB, "TxDone не получен за %u мс", timeoutMs + i); },
+                            drain);
+    print("String + logger.println", before);
+    print("LOGW into the ring", deferred);
+    CHECK_EQ(deferred.allocations, 0.0);
+    CHECK(deferred.ns < before.ns);
+
+    // В веб-журнал после кольца попадает тот же текст
+    logger.clear();
+    logger.println(warn_() + "TxDone не получен за " + String(timeoutMs) + " мс");
+    std::string expected = logger.c_str();
+    logger.clear();
+    LOGW(LOG_SINK_WEB, "TxDone не получен за %u мс", timeoutMs);
+    logRingFlush();
+    CHECK(expected == logger.c_str());
+}
+
+int main() {
+    serialLog.setMuted(true);
+    benchmarkReceive();
+    benchmarkWeb();
+    LogRingStats stats = logRingStats();
+    printf("ring: %u records, %u dropped, peak %u of %u bytes\n", stats.records, stats.dropped, stats.peak,
+           stats.capacity);
+    CHECK_EQ(stats.dropped, 0);
+    return testResult();
+}
@@ -0,0 +1,117 @@
+// Реестр метрик: стоимость обновления Counter, Gauge и Histogram в одном
+// потоке и в двух потоках "разных ядер" против ++ под portENTER_CRITICAL и
+// одного общего атомарного слова. Затем - учёт ACK в statistics: повторные
+// и устаревшие ACK не поднимают доставку выше 100%
+#include "test.h"
+#include "metrics.h"
+#include "statistics.h"
+#include <chrono>
+#include <thread>
+
+static const uint32_t ROUNDS = 2000000;
+
+static Counter counter(nullptr, nullptr);
+static Gauge gauge(nullptr, nullptr);
+static Histogram histogram(nullptr, nullptr, 64, 8);
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint32_t plain = 0;
+static std::atomic<uint32_t> shared(0);
+
+static void criticalIncrement() {
+    portENTER_CRITICAL(&lock);
+    plain = plain + 1;
+    portEXIT_CRITICAL(&lock);
+}
+
+// Среднее время одного вызова, нс; threads потоков на ядрах 0 и 1 одновременно.
+// Время двух потоков - по часам, на вызов одного потока: без спора оно равно
+// однопоточному
+template <typename F>
+static double measureNs(int threads, F fn) {
+    auto body = [&fn](int core) {
+        hostSetCoreId(core);
+        for (uint32_t i = 0; i < ROUNDS; i++) {
+            fn(i);
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    if (threads == 1) {
+        body(0);
+    } else {
+        std::thread other(body, 1);
+        body(0);
+        other.join();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / ROUNDS;
+}
+
+static void benchmark() {
+    // На одном процессоре хоста потоки идут по очереди - спор не измерить
+    bool parallel = std::thread::hardware_concurrency() >= 2;
+    printf("update cost, ns per call (%u calls per thread)\n", ROUNDS);
+    printf("  %-28s %10s %10s\n", "", "1 thread", "2 threads");
+    struct Case {
+        const char* name;
+        double (*run)(int threads);
+    };
+    const Case cases[] = {
+        {"Counter::inc", [](int t) { return measureNs(t, [](uint32_t) { counter.inc(); }); }},
+        {"Gauge::set", [](int t) { return measureNs(t, [](uint32_t i) { gauge.set(i); }); }},
+        {"Gauge::smooth", [](int t) { return measureNs(t, [](uint32_t i) { gauge.smooth(i, 0.2f); }); }},
+        {"Histogram::observe", [](int t) { return measureNs(t, [](uint32_t i) { histogram.observe(i & 1023); }); }},
+        {"shared atomic fetch_add", [](int t) {
+             return measureNs(t, [](uint32_t) { shared.fetch_add(1, std::memory_order_relaxed); });
+         }},
+        {"++ under portENTER_CRITICAL", [](int t) { return measureNs(t, [](uint32_t) { criticalIncrement(); }); }},
+    };
+    for (const Case& c : cases) {
+        double single = c.run(1);
+        if (parallel) {
+            printf("  %-28s %10.1f %10.1f\n", c.name, single, c.run(2));
+        } else {
+            printf("  %-28s %10.1f %10s\n", c.name, single, "1 CPU");
+        }
+    }
+    // Ни одно обновление не потеряно
+    uint32_t calls = (parallel ? 3 : 1) * ROUNDS;
+    CHECK_EQ(counter.value(), calls);
+    CHECK_EQ(histogram.snapshot().count, calls);
+    CHECK_EQ(shared.load(), calls);
+    CHECK_EQ(plain, calls);
+}
+
+// HLO 0..9 ушли и подтверждены; затем повторные ACK и ACK на ID, слот
+// которых после оборота кольца занят другим пакетом или пуст
+static void testAckAccounting() {
+    printf("ACK accounting\n");
+    for (int id = 0; id < 10; id++) {
+        updateStats(false);
+        recordPacketTx(id, 1000 + id);
+    }
+    for (int id = 0; id < 10; id++) {
+        updatePacketStatus(id, true);
+    }
+    CHECK_EQ(totalReceived.value(), 10);
+    updatePacketStatus(3, true);
+    updatePacketStatus(103, true);   // Слот 3 занят HLO 3
+    updatePacketStatus(55, true);    // HLO 55 не уходил
+    updatePacketStatus(-1, true);
+    updatePacketStatus(4, false);
+    CHECK_EQ(totalReceived.value(), 10);
+    // HLO 103 ушёл в тот же слот: старый ACK 3 не считается, новый считается
+    updateStats(false);
+    recordPacketTx(103, 5000);
+    updatePacketStatus(3, true);
+    CHECK_EQ(totalReceived.value(), 10);
+    updatePacketStatus(103, true);
+    CHECK_EQ(totalReceived.value(), 11);
+    CHECK_EQ(totalSent.value(), 11);
+    CHECK(successRateSmoothed.value() <= 100.0f);
+}
+
+int main() {
+    benchmark();
+    testAckAccounting();
+    return testResult();
+}
@@ -0,0 +1,299 @@
+// Согласованная смена параметров на имитации радио: два узла, кадр доходит,
+// только если параметры приёмника совпадают с параметрами передатчика и кадр
+// не выброшен правилом потерь. Время - виртуальное, шаг как у опроса задачи приёма
+#include "test.h"
+#include "param-switch.h"
+#include "config.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+static const uint32_t STEP_MS = 100;
+static const uint32_t HELLO_MS = 15000;
+
+static const LoRaParams OLD_PARAMS = {12, 31.25f, 8, 10, 0, false};
+static const LoRaParams NEW_PARAMS = {9, 125.0f, 5, 14, 0, true};
+
+static bool sameParams(const LoRaParams& a, const LoRaParams& b) {
+    return a.spreading == b.spreading && a.bandwidth == b.bandwidth && a.codingRate == b.codingRate &&
+           a.implicitLength == b.implicitLength && a.crc == b.crc;
+}
+
+// Узел: ParamSwitch и его окружение, радио - текущие параметры
+struct SimNode : public ParamSwitchPort {
+    const char* name;
+    LoRaParams radio = OLD_PARAMS;
+    LoRaParams saved = OLD_PARAMS;
+    uint32_t saves = 0;
+    uint16_t nextSeq;
+    std::mutex mutex;
+    ParamSwitch paramSwitch;
+
+    SimNode(const char* n, uint16_t seq) : name(n), nextSeq(seq), paramSwitch(*this) {}
+
+    void applyParams(const LoRaParams& params) override { radio = params; }
+    void saveParams(const LoRaParams& params) override {
+        saved = params;
+        saves++;
+    }
+    void lockParamSwitch() override { mutex.lock(); }
+    void unlockParamSwitch() override { mutex.unlock(); }
+    uint16_t randomSequence() override { return nextSeq; }
+    void logParamSwitch(bool warning, const char* text) override {
+        printf("  [%s] %s%s\n", name, warning ? "WARN " : "", text);
+    }
+};
+
+// Правило потерь: первые count кадров с префиксом prefix от узла from не доходят
+struct LossRule {
+    const SimNode* from;
+    std::string prefix;
+    int count;
+};
+
+struct SimLink {
+    SimNode a{"A", 100};
+    SimNode b{"B", 200};
+    std::vector<LossRule> losses;
+    bool failTxDone = false;   // Ответ не передан: TxDone не пришёл
+    uint32_t now = 0;
+    uint32_t lastHello = 0;
+    bool hello = false;        // Фоновый трафик HLO от A
+
+    SimNode& peer(SimNode& node) { return &node == &a ? b : a; }
+
+    bool lost(const SimNode& from, const char* frame) {
+        for (LossRule& rule : losses) {
+            if (rule.from == &from && rule.count != 0 && strncmp(frame, rule.prefix.c_str(), rule.prefix.size()) == 0) {
+                if (rule.count > 0) rule.count--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Передача кадра; reply - ответ на принятый кадр (его TxDone сообщается в onSent)
+    void send(SimNode& from, const char* frame, bool reply) {
+        if (reply && failTxDone) {
+            from.paramSwitch.onSent(false);
+            return;
+        }
+        LoRaParams onAir = from.radio;
+        SimNode& to = peer(from);
+        bool delivered = !lost(from, frame) && sameParams(onAir, to.radio);
+        // TxDone приходит независимо от того, услышал ли кадр пир
+        if (reply) {
+            from.paramSwitch.onSent(true);
+        }
+        if (!delivered) {
+            return;
+        }
+        to.paramSwitch.onTraffic(now);
+        char answer[ParamSwitch::FRAME_SIZE];
+        if (to.paramSwitch.handleMessage(frame, to.radio, now, answer, sizeof(answer)) && answer[0]) {
+            send(to, answer, true);
+        }
+    }
+
+    void step() {
+        for (SimNode* node : {&a, &b}) {
+            char frame[ParamSwitch::FRAME_SIZE];
+            if (node->paramSwitch.poll(now, frame, sizeof(frame))) {
+                send(*node, frame, false);
+            }
+        }
+        if (hello && now - lastHello >= HELLO_MS) {
+            lastHello = now;
+            send(a, "HLO:1", false);
+        }
+        now += STEP_MS;
+    }
+
+    void run(uint32_t ms) {
+        for (uint32_t end = now + ms; now < end;) {
+            step();
+        }
+    }
+
+    bool propose(uint8_t attempts) {
+        return a.paramSwitch.propose(a.radio, NEW_PARAMS, attempts, now);
+    }
+
+    bool idle() {
+        return a.paramSwitch.getState() == ParamSwitch::IDLE && b.paramSwitch.getState() == ParamSwitch::IDLE;
+    }
+};
+
+// Время до завершения любого исхода: повторы CFG и окно отката
+static const uint32_t SETTLE_MS = 5 * PARAM_SWITCH_RETRY_MS + PARAM_SWITCH_ROLLBACK_MS + 10000;
+
+static void testSwitch() {
+    printf("switch\n");
+    SimLink link;
+    CHECK(link.propose(5));
+    link.run(SETTLE_MS);
+    CHECK(link.idle());
+    CHECK(sameParams(link.a.radio, NEW_PARAMS));
+    CHECK(sameParams(link.b.radio, NEW_PARAMS));
+    CHECK(sameParams(link.a.saved, NEW_PARAMS));
+    CHECK(sameParams(link.b.saved, NEW_PARAMS));
+    CHECK_EQ(link.a.paramSwitch.getRollbackCount(), 0);
+    CHECK_EQ(link.b.paramSwitch.getRollbackCount(), 0);
+}
+
+static void testInvalidProposal() {
+    printf("invalid proposal\n");
+    SimLink link;
+    LoRaParams bad = NEW_PARAMS;
+    bad.spreading = 13;
+    CHECK(!link.a.paramSwitch.propose(link.a.radio, bad, 5, 0));
+    // Кадр с недопустимыми параметрами пира не переключает
+    char reply[ParamSwitch::FRAME_SIZE];
+    CHECK(link.b.paramSwitch.handleMessage("CFG:7:13:125.00:5:14:0:1", link.b.radio, 0, reply, sizeof(reply)));
+    CHECK_EQ(reply[0], '\0');
+    CHECK(link.idle());
+}
+
+// Потерянные CFG повторяются; пока повторы есть, переключение проходит
+static void testCfgLoss() {
+    printf("CFG loss, recovered by retry\n");
+    SimLink link;
+    link.losses.push_back({&link.a, "CFG:", 2});
+    CHECK(link.propose(5));
+    link.run(SETTLE_MS);
+    CHECK(link.idle());
+    CHECK(sameParams(link.a.radio, NEW_PARAMS));
+    CHECK(sameParams(link.b.radio, NEW_PARAMS));
+    CHECK(sameParams(link.a.saved, NEW_PARAMS));
+    CHECK(sameParams(link.b.saved, NEW_PARAMS));
+}
+
+// Все CFG потеряны: инициатор сдаётся, ни один узел не переключался
+static void testCfgLossExhausted() {
+    printf("CFG loss, attempts exhausted\n");
+    SimLink link;
+    link.losses.push_back({&link.a, "CFG:", -1});
+    CHECK(link.propose(3));
+    link.run(SETTLE_MS);
+    CHECK(link.idle());
+    CHECK(sameParams(link.a.radio, OLD_PARAMS));
+    CHECK(sameParams(link.b.radio, OLD_PARAMS));
+    CHECK_EQ(link.a.saves, 0);
+    CHECK_EQ(link.b.saves, 0);
+    CHECK_EQ(link.a.paramSwitch.getRollbackCount(), 0);
+}
+
+// CFA потерян: ответчик уже на новых параметрах, инициатор - на старых.
+// Оба возвращаются к старым, ничего не сохранено
+static void testCfaLoss() {
+    printf("CFA loss\n");
+    SimLink link;
+    link.losses.push_back({&link.b, "CFA:", -1});
+    CHECK(link.propose(5));
+    link.run(STEP_MS * 2);
+    CHECK_EQ(link.b.paramSwitch.getState(), ParamSwitch::VERIFYING);
+    CHECK(sameParams(link.b.radio, NEW_PARAMS));
+    CHECK(sameParams(link.a.radio, OLD_PARAMS));
+    link.run(SETTLE_MS);
+    CHECK(link.idle());
+    CHECK(sameParams(link.a.radio, OLD_PARAMS));
+    CHECK(sameParams(link.b.radio, OLD_PARAMS));
+    CHECK_EQ(link.a.saves, 0);
+    CHECK_EQ(link.b.saves, 0);
+    CHECK_EQ(link.b.paramSwitch.getRollbackCount(), 1);
+}
+
+// CFA не ушёл в эфир (нет TxDone): ответчик остаётся на старых параметрах,
+// следующий CFG начинает предложение заново
+static void testCfaNotSent() {
+    printf("CFA not sent\n");
+    SimLink link;
+    link.failTxDone = true;
+    CHECK(link.propose(5));
+    link.run(STEP_MS * 2);
+    CHECK_EQ(link.b.paramSwitch.getState(), ParamSwitch::IDLE);
+    CHECK(sameParams(link.b.radio, OLD_PARAMS));
+    link.failTxDone = false;
+    link.run(SETTLE_MS);
+    CHECK(link.idle());
+    CHECK(sameParams(link.a.saved, NEW_PARAMS));
+    CHECK(sameParams(link.b.saved, NEW_PARAMS));
+}
+
+// Первые CFC потеряны: повтор CFC через PARAM_SWITCH_RETRY_MS доходит
+static void testCfcLoss() {
+    printf("CFC loss, recovered by retry\n");
+    SimLink link;
+    link.losses.push_back({&link.a, "CFC:", 2});
+    CHECK(link.propose(5));
+    link.run(SETTLE_MS);
+    CHECK(link.idle());
+    CHECK(sameParams(link.a.radio, NEW_PARAMS));
+    CHECK(sameParams(link.b.radio, NEW_PARAMS));
+    CHECK(sameParams(link.a.saved, NEW_PARAMS));
+    CHECK(sameParams(link.b.saved, NEW_PARAMS));
+    CHECK_EQ(link.a.paramSwitch.getRollbackCount(), 0);
+}
+
+// Все CFC потеряны и другого трафика нет: оба узла откатываются
+static void testCfcLossRollback() {
+    printf("CFC loss, rollback\n");
+    SimLink link;
+    link.losses.push_back({&link.a, "CFC:", -1});
+    CHECK(link.propose(5));
+    link.run(SETTLE_MS);
+    CHECK(link.idle());
+    CHECK(sameParams(link.a.radio, OLD_PARAMS));
+    CHECK(sameParams(link.b.radio, OLD_PARAMS));
+    CHECK_EQ(link.a.saves, 0);
+    CHECK_EQ(link.b.saves, 0);
+    CHECK_EQ(link.a.paramSwitch.getRollbackCount(), 1);
+    CHECK_EQ(link.b.paramSwitch.getRollbackCount(), 1);
+}
+
+// CFC потеряны, но ответчику хватает HLO; CFK потерян - повторный CFC
+// получает ответ и после сохранения параметров
+static void testCfcLossWithTraffic() {
+    printf("CFC loss with traffic, CFK loss\n");
+    SimLink link;
+    link.hello = true;
+    link.losses.push_back({&link.a, "CFC:", 3});
+    link.losses.push_back({&link.b, "CFK:", 1});
+    CHECK(link.propose(5));
+    link.run(SETTLE_MS);
+    CHECK(link.idle());
+    CHECK(sameParams(link.a.saved, NEW_PARAMS));
+    CHECK(sameParams(link.b.saved, NEW_PARAMS));
+    CHECK_EQ(link.a.saves, 1);
+    CHECK_EQ(link.b.saves, 1);
+}
+
+// Встречные предложения: побеждает больший seq, узлы переключаются на его параметры
+static void testCrossedProposals() {
+    printf("crossed proposals\n");
+    SimLink link;
+    LoRaParams other = NEW_PARAMS;
+    other.spreading = 10;
+    CHECK(link.a.paramSwitch.propose(link.a.radio, NEW_PARAMS, 5, 0));
+    CHECK(link.b.paramSwitch.propose(link.b.radio, other, 5, 0));
+    link.run(SETTLE_MS);
+    CHECK(link.idle());
+    CHECK(sameParams(link.a.radio, other));
+    CHECK(sameParams(link.b.radio, other));
+    CHECK(sameParams(link.a.saved, other));
+    CHECK(sameParams(link.b.saved, other));
+}
+
+int main() {
+    testSwitch();
+    testInvalidProposal();
+    testCfgLoss();
+    testCfgLossExhausted();
+    testCfaLoss();
+    testCfaNotSent();
+    testCfcLoss();
+    testCfcLossRollback();
+    testCfcLossWithTraffic();
+    testCrossedProposals();
+    return testResult();
+}
@@ -0,0 +1,164 @@
+// Метки RxDone/TxDone из прерывания DIO0 на модели SX127x: тест задаёт
+// виртуальное время и подаёт фронт DIO0 (hostRaiseInterrupt) в нужный
+// момент - с задержкой обработчика, раньше или позже опроса, во время
+// передачи или вовсе без фронта
+#include "test.h"
+#include "sx127x-sim.h"
+#include "radio-events.h"
+#include <random>
+#include <thread>
+
+LoRaRadio radio;
+
+static const uint8_t DIO0 = LoRaBoardPins::dio0;
+static const int64_t POLL_US = 10000;   // Период опроса задачи приёма
+
+// Фронт DIO0 в момент edgeUs, обработчик запускается через latencyUs
+static void raiseDio0(int64_t edgeUs, int64_t latencyUs) {
+    hostClockSet(edgeUs + latencyUs);
+    CHECK(hostRaiseInterrupt(DIO0));
+}
+
+static void testRxDone() {
+    printf("RxDone stamp\n");
+    uint32_t fallbacks = radioFallbackCount();
+    raiseDio0(1000000, 12);
+    // Задача приёма замечает кадр при опросе, метка - из прерывания
+    hostClockSet(1000000 + 7000);
+    CHECK_EQ(radioTakeRxDoneUs(), 1000012);
+    CHECK_EQ(radioFallbackCount(), fallbacks);
+    // Метка забрана: следующий кадр без фронта получает время опроса
+    hostClockSet(1050000);
+    CHECK_EQ(radioTakeRxDoneUs(), 1050000);
+    CHECK_EQ(radioFallbackCount(), fallbacks + 1);
+}
+
+static void testTxDone(Sx127xSim& chip) {
+    printf("TxDone stamp and DIO0 remap\n");
+    uint32_t fallbacks = radioFallbackCount();
+    hostClockSet(2000000);
+    const uint8_t frame[] = "HLO:1";
+    radioBeginTx();
+    CHECK_EQ(chip.dio0Mapping(), 1);
+    CHECK(radio.startTransmit(frame, sizeof(frame) - 1));
+    CHECK_EQ(radioLastTxStartUs(), 2000000);
+    // Эфир 144 мс, обработчик через 9 мкс после фронта
+    chip.finishTx();
+    raiseDio0(2144000, 9);
+    CHECK(radioWaitTxDone(0));
+    hostClockSet(2144500);
+    CHECK(radio.isTxDone());
+    CHECK_EQ(radioEndTx(), 2144009);
+    CHECK_EQ(radioLastTxDoneUs(), 2144009);
+    CHECK_EQ(chip.dio0Mapping(), 0);
+    CHECK_EQ(radioFallbackCount(), fallbacks);
+    // Фронт TxDone не стал меткой RxDone
+    hostClockSet(2200000);
+    CHECK_EQ(radioTakeRxDoneUs(), 2200000);
+    CHECK_EQ(radioFallbackCount(), fallbacks + 1);
+}
+
+// Фронт TxDone потерян: ожидание истекает, метка - момент опроса регистра
+static void testMissedTxDone(Sx127xSim& chip) {
+    printf("missed TxDone edge\n");
+    uint32_t fallbacks = radioFallbackCount();
+    hostClockSet(3000000);
+    radioBeginTx();
+    chip.finishTx();
+    CHECK(!radioWaitTxDone(1));
+    hostClockSet(3150000);
+    CHECK(radio.isTxDone());
+    CHECK_EQ(radioEndTx(), 3150000);
+    CHECK_EQ(radioFallbackCount(), fallbacks + 1);
+    CHECK_EQ(chip.dio0Mapping(), 0);
+}
+
+// Отдача от прошлой передачи, дождавшейся опросом, не будит следующую
+static void testStaleTxDone(Sx127xSim& chip) {
+    printf("stale TxDone give\n");
+    hostClockSet(4000000);
+    radioBeginTx();
+    chip.finishTx();
+    raiseDio0(4100000, 5);
+    CHECK(radio.isTxDone());
+    radioEndTx();   // Семафор не забран: задача увидела TxDone опросом
+    hostClockSet(4200000);
+    radioBeginTx();
+    CHECK(!radioWaitTxDone(1));
+    raiseDio0(4300000, 5);
+    CHECK(radioWaitTxDone(0));
+    chip.finishTx();
+    CHECK(radio.isTxDone());
+    CHECK_EQ(radioEndTx(), 4300005);
+}
+
+// Задача передачи спит на семафоре, фронт приходит из другого потока
+static void testWaitWakesOnInterrupt(Sx127xSim& chip) {
+    printf("TX task woken by DIO0\n");
+    hostClockSet(5000000);
+    radioBeginTx();
+    std::thread isr([&chip]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        chip.finishTx();
+        raiseDio0(5144000, 7);
+    });
+    CHECK(radioWaitTxDone(2000));
+    isr.join();
+    CHECK(radio.isTxDone());
+    CHECK_EQ(radioEndTx(), 5144007);
+}
+
+static void testSignalDetected(Sx127xSim& chip) {
+    printf("signal detected\n");
+    chip.regs[sx127x::REG_MODEM_STAT] = 0x10;   // Только RxOnGoing без преамбулы
+    CHECK(!radioSignalDetected());
+    chip.regs[sx127x::REG_MODEM_STAT] = 0x01;
+    CHECK(radioSignalDetected());
+    chip.regs[sx127x::REG_MODEM_STAT] = 0x08;
+    CHECK(radioSignalDetected());
+}
+
+// Ошибка метки RxDone на потоке кадров: из прерывания (задержка обработчика
+// 2-20 мкс) против момента опроса каждые 10 мс, как было до прерывания
+static void testStampError() {
+    printf("stamp error, interrupt vs poll\n");
+    std::mt19937 rng(29);
+    std::uniform_int_distribution<int64_t> arrival(0, POLL_US - 1);
+    std::uniform_int_distribution<int64_t> latency(2, 20);
+    const int frames = 10000;
+    int64_t interruptMax = 0, interruptSum = 0, pollMax = 0, pollSum = 0;
+    int64_t t = 10000000;
+    for (int i = 0; i < frames; i++) {
+        t += 200000;
+        int64_t edge = t + arrival(rng);
+        raiseDio0(edge, latency(rng));
+        int64_t poll = (edge / POLL_US + 1) * POLL_US;
+        hostClockSet(poll);
+        int64_t interruptError = radioTakeRxDoneUs() - edge;
+        int64_t pollError = poll - edge;
+        interruptMax = max(interruptMax, interruptError);
+        interruptSum += interruptError;
+        pollMax = max(pollMax, pollError);
+        pollSum += pollError;
+    }
+    printf("  %d frames: interrupt stamp error avg %.1f us, max %lld us; poll stamp error avg %.1f us, max %lld us\n",
+           frames, (double)interruptSum / frames, (long long)interruptMax, (double)pollSum / frames,
+           (long long)pollMax);
+    CHECK(interruptMax <= 20);
+    CHECK(pollSum > 100 * interruptSum);
+}
+
+int main() {
+    Sx127xSim chip;
+    hostClockSet(1);
+    CHECK(radio.begin(433000000));
+    setupRadioEvents();
+    testRxDone();
+    testTxDone(chip);
+    testMissedTxDone(chip);
+    testStaleTxDone(chip);
+    testWaitWakesOnInterrupt(chip);
+    testSignalDetected(chip);
+    testStampError();
+    return testResult();
+}
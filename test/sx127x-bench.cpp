@@ -0,0 +1,158 @@
+// Драйвер SX127x против побайтового доступа arduino-LoRa на модели шины:
+// транзакции SPI и байты на шине на кадр приёма и передачи. Доступ
+// библиотеки воспроизведён по её исходному коду (LoRa.cpp 0.8):
+// beginPacket/write/endPacket и parsePacket/available/read. Опрос TxDone в
+// endPacket() не считается - он идёт всё эфирное время кадра
+#include "test.h"
+#include "sx127x-sim.h"
+
+LoRaRadio radio;
+
+// Регистровый доступ arduino-LoRa: транзакция на каждый регистр и байт FIFO
+class LibraryAccess {
+public:
+    // beginPacket() + write(buffer, size) + endPacket() без опроса TxDone
+    void transmit(const uint8_t* data, size_t len) {
+        // isTransmitting(): режим и флаг TxDone
+        readRegister(sx127x::REG_OP_MODE);
+        readRegister(sx127x::REG_IRQ_FLAGS);
+        idle();
+        explicitHeaderMode();
+        writeRegister(sx127x::REG_FIFO_ADDR_PTR, 0);
+        writeRegister(sx127x::REG_PAYLOAD_LENGTH, 0);
+        uint8_t current = readRegister(sx127x::REG_PAYLOAD_LENGTH);
+        for (size_t i = 0; i < len; i++) {
+            writeRegister(sx127x::REG_FIFO, data[i]);
+        }
+        writeRegister(sx127x::REG_PAYLOAD_LENGTH, current + len);
+        writeRegister(sx127x::REG_OP_MODE, sx127x::MODE_LONG_RANGE | sx127x::MODE_TX);
+        writeRegister(sx127x::REG_IRQ_FLAGS, sx127x::IRQ_TX_DONE);
+    }
+
+    // parsePacket() + while (available()) read() + packetRssi() + packetSnr()
+    size_t receive(uint8_t* data, size_t size) {
+        uint8_t flags = readRegister(sx127x::REG_IRQ_FLAGS);
+        explicitHeaderMode();
+        writeRegister(sx127x::REG_IRQ_FLAGS, flags);
+        if (!(flags & sx127x::IRQ_RX_DONE)) {
+            return 0;
+        }
+        _packetIndex = 0;
+        readRegister(sx127x::REG_RX_NB_BYTES);
+        writeRegister(sx127x::REG_FIFO_ADDR_PTR, readRegister(sx127x::REG_FIFO_RX_CURRENT_ADDR));
+        idle();
+        size_t len = 0;
+        while (available()) {
+            int c = read();
+            if (c >= 0 && len < size) {
+                data[len++] = c;
+            }
+        }
+        readRegister(sx127x::REG_PKT_RSSI_VALUE);
+        readRegister(sx127x::REG_PKT_SNR_VALUE);
+        return len;
+    }
+
+private:
+    int available() { return readRegister(sx127x::REG_RX_NB_BYTES) - _packetIndex; }
+
+    int read() {
+        if (!available()) {
+            return -1;
+        }
+        _packetIndex++;
+        return readRegister(sx127x::REG_FIFO);
+    }
+
+    void idle() { writeRegister(sx127x::REG_OP_MODE, sx127x::MODE_LONG_RANGE | sx127x::MODE_STDBY); }
+
+    void explicitHeaderMode() {
+        writeRegister(sx127x::REG_MODEM_CONFIG_1, readRegister(sx127x::REG_MODEM_CONFIG_1) & 0xFE);
+    }
+
+    uint8_t readRegister(uint8_t address) { return single(address & 0x7F, 0); }
+    void writeRegister(uint8_t address, uint8_t value) { single(address | 0x80, value); }
+
+    uint8_t single(uint8_t address, uint8_t value) {
+        SPI.beginTransaction(SPISettings(sx127x::SPI_FREQUENCY, MSBFIRST, SPI_MODE0));
+        SPI.transfer(address);
+        uint8_t response = SPI.transfer(value);
+        SPI.endTransaction();
+        return response;
+    }
+
+    int _packetIndex = 0;
+};
+
+struct BusCost {
+    uint32_t transactions;
+    uint32_t bytes;
+};
+
+static BusCost since(uint32_t transactions, uint32_t bytes) {
+    return {SPI.transactions() - transactions, SPI.bytes() - bytes};
+}
+
+static void fillFrame(uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        data[i] = (uint8_t)('A' + i % 26);
+    }
+}
+
+int main() {
+    Sx127xSim chip;
+    hostClockSet(1);
+    CHECK(radio.begin(433000000));
+    LibraryAccess library;
+
+    printf("SPI per frame at %u MHz (bus bytes = us of clocking)\n", (unsigned)(sx127x::SPI_FREQUENCY / 1000000));
+    printf("%5s  %22s  %22s  %22s  %22s\n", "len", "TX driver", "TX arduino-LoRa", "RX driver", "RX arduino-LoRa");
+    const size_t lengths[] = {16, 64, 255};
+    for (size_t len : lengths) {
+        uint8_t frame[255];
+        uint8_t out[255];
+        fillFrame(frame, len);
+
+        // Передача: драйвер - FIFO одной транзакцией
+        uint32_t t = SPI.transactions(), b = SPI.bytes();
+        CHECK(radio.startTransmit(frame, len));
+        chip.finishTx();
+        CHECK(radio.isTxDone());
+        BusCost txDriver = since(t, b);
+        CHECK(memcmp(chip.fifo, frame, len) == 0);
+
+        t = SPI.transactions(), b = SPI.bytes();
+        library.transmit(frame, len);
+        BusCost txLibrary = since(t, b);
+        CHECK(memcmp(chip.fifo, frame, len) == 0);
+
+        // Приём: драйвер - parsePacket, FIFO одной транзакцией, RSSI и SNR
+        chip.receive(frame, len);
+        t = SPI.transactions(), b = SPI.bytes();
+        CHECK_EQ(radio.parsePacket(), len);
+        CHECK_EQ(radio.readPacket(out, sizeof(out)), len);
+        radio.packetRssi();
+        radio.packetSnr();
+        BusCost rxDriver = since(t, b);
+        CHECK(memcmp(out, frame, len) == 0);
+
+        chip.receive(frame, len);
+        memset(out, 0, sizeof(out));
+        t = SPI.transactions(), b = SPI.bytes();
+        CHECK_EQ(library.receive(out, sizeof(out)), len);
+        BusCost rxLibrary = since(t, b);
+        CHECK(memcmp(out, frame, len) == 0);
+
+        printf("%5u  %8u tx, %6u B  %8u tx, %6u B  %8u tx, %6u B  %8u tx, %6u B\n", (unsigned)len,
+               txDriver.transactions, txDriver.bytes, txLibrary.transactions, txLibrary.bytes,
+               rxDriver.transactions, rxDriver.bytes, rxLibrary.transactions, rxLibrary.bytes);
+
+        // Оценка библиотеки на вкладке статуса совпадает с воспроизведённым доступом
+        CHECK_EQ(txLibrary.transactions, libraryTxTransactions(len));
+        CHECK_EQ(rxLibrary.transactions, libraryRxTransactions(len));
+        // Число транзакций драйвера от длины кадра не зависит
+        CHECK(txDriver.transactions <= 10);
+        CHECK(rxDriver.transactions <= 10);
+    }
+    return testResult();
+}
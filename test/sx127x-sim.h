@@ -0,0 +1,81 @@
+#pragma once
+// Модель SX127x на шине SPI хоста: файл регистров и FIFO. Первый байт
+// транзакции - адрес (бит 7 - запись), дальше адрес растёт на каждый байт,
+// кроме RegFifo: он читает и пишет FIFO по RegFifoAddrPtr. RegIrqFlags
+// сбрасывается записью единиц. Кадры эфира тест кладёт через receive(),
+// окончание передачи - через finishTx()
+#include <SPI.h>
+#include "sx127x.h"
+
+class Sx127xSim : public HostSpiDevice {
+public:
+    Sx127xSim() {
+        memset(regs, 0, sizeof(regs));
+        memset(fifo, 0, sizeof(fifo));
+        regs[sx127x::REG_VERSION] = 0x12;
+        regs[sx127x::REG_OP_MODE] = sx127x::MODE_LONG_RANGE | sx127x::MODE_STDBY;
+        SPI.attach(this);
+    }
+    ~Sx127xSim() override { SPI.attach(nullptr); }
+
+    void select() override { _state = ADDRESS; }
+
+    uint8_t transfer(uint8_t data) override {
+        if (_state == ADDRESS) {
+            _address = data & 0x7F;
+            _state = (data & 0x80) ? WRITE : READ;
+            return 0;
+        }
+        uint8_t address = _address;
+        if (address != sx127x::REG_FIFO) {
+            _address = (_address + 1) & 0x7F;
+        }
+        if (_state == WRITE) {
+            write(address, data);
+            return 0;
+        }
+        if (address == sx127x::REG_FIFO) {
+            return fifo[regs[sx127x::REG_FIFO_ADDR_PTR]++];
+        }
+        return regs[address];
+    }
+
+    // Принятый кадр в FIFO и флаг RxDone
+    void receive(const uint8_t* data, size_t len, uint8_t rssi = 80, int8_t snr = 28) {
+        uint8_t base = regs[sx127x::REG_FIFO_RX_BASE_ADDR];
+        for (size_t i = 0; i < len; i++) {
+            fifo[(uint8_t)(base + i)] = data[i];
+        }
+        regs[sx127x::REG_FIFO_RX_CURRENT_ADDR] = base;
+        regs[sx127x::REG_RX_NB_BYTES] = (uint8_t)len;
+        regs[sx127x::REG_PKT_RSSI_VALUE] = rssi;
+        regs[sx127x::REG_PKT_SNR_VALUE] = (uint8_t)snr;
+        regs[sx127x::REG_IRQ_FLAGS] |= sx127x::IRQ_RX_DONE;
+    }
+
+    void finishTx() {
+        regs[sx127x::REG_IRQ_FLAGS] |= sx127x::IRQ_TX_DONE;
+        regs[sx127x::REG_OP_MODE] = sx127x::MODE_LONG_RANGE | sx127x::MODE_STDBY;
+    }
+
+    // DIO0: 0 - RxDone, 1 - TxDone (RegDioMapping1, биты 7..6)
+    uint8_t dio0Mapping() const { return regs[sx127x::REG_DIO_MAPPING_1] >> 6; }
+
+    uint8_t regs[128];
+    uint8_t fifo[256];
+
+private:
+    void write(uint8_t address, uint8_t data) {
+        if (address == sx127x::REG_FIFO) {
+            fifo[regs[sx127x::REG_FIFO_ADDR_PTR]++] = data;
+        } else if (address == sx127x::REG_IRQ_FLAGS) {
+            regs[address] &= ~data;
+        } else {
+            regs[address] = data;
+        }
+    }
+
+    enum State { ADDRESS, READ, WRITE };
+    State _state = ADDRESS;
+    uint8_t _address = 0;
+};
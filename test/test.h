@@ -0,0 +1,33 @@
+#pragma once
+// Проверки тестов на хосте: неудача печатается и считается, main()
+// возвращает testResult() - ctest отмечает тест проваленным
+#include <stdio.h>
+
+static int testFailures = 0;
+static int testChecks = 0;
+
+#define CHECK(cond)                                                               \
+    do {                                                                          \
+        testChecks++;                                                             \
+        if (!(cond)) {                                                            \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);       \
+            testFailures++;                                                       \
+        }                                                                         \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                \
+    do {                                                                          \
+        testChecks++;                                                             \
+        long long a_ = (long long)(actual);                                       \
+        long long e_ = (long long)(expected);                                     \
+        if (a_ != e_) {                                                           \
+            printf("%s:%d: %s == %lld, expected %lld\n", __FILE__, __LINE__,      \
+                   #actual, a_, e_);                                              \
+            testFailures++;                                                       \
+        }                                                                         \
+    } while (0)
+
+static inline int testResult() {
+    printf("%d checks, %d failed\n", testChecks, testFailures);
+    return testFailures ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+// Синхронизация времени на имитации двух узлов: часы опорного и ведомого
+// узлов уходят с разной скоростью (дрейф ведомого ещё и плавает, как от
+// температуры), метки TxDone/RxDone маяков сдвинуты задержкой прерывания,
+// часть отсчётов - выбросы. Оценивается ошибка localToGlobal ведомого
+// относительно часов опорного узла между маяками.
+// Вторая часть - публикация коэффициентов: читатели в других потоках не
+// должны увидеть снимок фильтра, собранный из двух пересчётов
+#include "test.h"
+#include "time-sync.h"
+#include "config.h"
+#include <atomic>
+#include <random>
+#include <thread>
+
+static const uint32_t ROOT_ID = 0x100;
+static const uint32_t FOLLOWER_ID = 0x200;
+static const double ROOT_DRIFT = 20e-6;
+static const double FOLLOWER_DRIFT = -15e-6;
+static const double FOLLOWER_WANDER = 2e-6;         // Амплитуда плавания дрейфа
+static const double WANDER_PERIOD_S = 7200.0;
+static const uint32_t SIM_S = 6 * 3600;
+static const uint32_t WARMUP_S = 10 * TIME_SYNC_BEACON_MS / 1000;
+static const int LATENCY_MIN_US = 20;               // Задержка метки в прерывании
+static const int LATENCY_MAX_US = 80;
+static const int OUTLIER_PERCENT = 2;
+static const int OUTLIER_US = 8000;                 // Больше TIME_SYNC_OUTLIER_US
+
+static void testDriftingClocks() {
+    printf("drifting clocks\n");
+    TimeSync root;
+    TimeSync follower;
+    root.setNodeId(ROOT_ID);
+    follower.setNodeId(FOLLOWER_ID);
+
+    std::mt19937 rng(28);
+    std::uniform_int_distribution<int> latency(LATENCY_MIN_US, LATENCY_MAX_US);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    // Часы узлов в микросекундах, шаг имитации - секунда
+    double rootClock = 1e6;
+    double followerClock = 37e6;
+    double sumSq = 0;
+    double maxError = 0;
+    uint32_t measured = 0;
+    uint32_t outliers = 0;
+    double driftError = 0;
+    for (uint32_t s = 0; s < SIM_S; s++) {
+        double wander = FOLLOWER_WANDER * sin(2 * M_PI * s / WANDER_PERIOD_S);
+        rootClock += 1e6 * (1 + ROOT_DRIFT);
+        followerClock += 1e6 * (1 + FOLLOWER_DRIFT + wander);
+        uint32_t nowMs = s * 1000;
+
+        if (root.shouldBeacon(nowMs)) {
+            String beacon = root.buildBeacon();
+            int64_t txUs = (int64_t)rootClock + latency(rng);
+            int64_t rxUs = (int64_t)followerClock + latency(rng);
+            if (percent(rng) < OUTLIER_PERCENT) {
+                rxUs += OUTLIER_US;
+                outliers++;
+            }
+            // Передатчик узнаёт метку TxDone после передачи, приёмник уже принял маяк
+            CHECK(follower.handleBeacon(beacon, rxUs, nowMs));
+            root.onBeaconSent(txUs, nowMs);
+        }
+        follower.shouldBeacon(nowMs);
+
+        if (s < WARMUP_S) {
+            continue;
+        }
+        // Часы опорного узла - глобальное время
+        double error = (double)follower.localToGlobal((int64_t)followerClock) - rootClock;
+        sumSq += error * error;
+        maxError = max(maxError, fabs(error));
+        measured++;
+        // Обратное преобразование сходится до микросекунды
+        int64_t local = (int64_t)followerClock;
+        CHECK(llabs(follower.globalToLocal(follower.localToGlobal(local)) - local) <= 1);
+        double trueSkew = (1 + ROOT_DRIFT) / (1 + FOLLOWER_DRIFT + wander) - 1;
+        driftError = max(driftError, fabs(follower.getDriftPpm() - trueSkew * 1e6));
+    }
+    double rms = sqrt(sumSq / measured);
+    printf("  %u h, beacon every %u s, latency %d-%d us, %u outliers of %d us\n", SIM_S / 3600,
+           TIME_SYNC_BEACON_MS / 1000, LATENCY_MIN_US, LATENCY_MAX_US, (unsigned)outliers, OUTLIER_US);
+    printf("  error: rms %.1f us, max %.1f us; drift error max %.2f ppm; reported accuracy %u us\n", rms,
+           maxError, driftError, (unsigned)follower.getAccuracyUs());
+
+    CHECK(root.isRoot());
+    CHECK(!follower.isRoot());
+    CHECK_EQ(follower.getRootId(), ROOT_ID);
+    CHECK(follower.isSynced());
+    CHECK_EQ(follower.getSampleCount(), TIME_SYNC_SAMPLES);
+    CHECK(rms < 100);
+    CHECK(maxError < 300);
+    CHECK(driftError < 1.0);
+}
+
+// Снимок, собранный из двух записей, заметен: в каждой записи все поля равны
+static void testTornReads() {
+    printf("seqlocked fit under concurrent readers\n");
+    SeqLocked<TimeSyncFit> fit;
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> torn(0);
+    std::atomic<uint32_t> reads(0);
+    auto reader = [&]() {
+        while (!done.load()) {
+            TimeSyncFit copy = fit.read();
+            if (copy.offsetUs != copy.refLocalUs || copy.skew != (double)copy.refLocalUs ||
+                copy.accuracyUs != (uint32_t)copy.refLocalUs || copy.rootId != (uint32_t)copy.refLocalUs) {
+                torn++;
+            }
+            reads++;
+        }
+    };
+    std::thread first(reader);
+    std::thread second(reader);
+    // Пишем, пока читатели не наберут своё: на одном процессоре хоста они
+    // могут не получить времени за фиксированное число записей
+    for (int64_t i = 1; i <= 200000 || reads.load() < 100000; i++) {
+        fit.write([i](TimeSyncFit& value) {
+            value.rootId = (uint32_t)i;
+            value.refLocalUs = i;
+            value.offsetUs = i;
+            value.skew = (double)i;
+            value.accuracyUs = (uint32_t)i;
+        });
+    }
+    done = true;
+    first.join();
+    second.join();
+    printf("  %u reads, %u torn\n", (unsigned)reads.load(), (unsigned)torn.load());
+    CHECK(reads.load() > 0);
+    CHECK_EQ(torn.load(), 0);
+}
+
+int main() {
+    testDriftingClocks();
+    testTornReads();
+    return testResult();
+}
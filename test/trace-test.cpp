@@ -0,0 +1,121 @@
+// Трассировщик на виртуальных часах: такты CCOUNT идут от них с частотой
+// 240 МГц и переполняются каждые 17.9 с. Метки выгрузки Chrome trace должны
+// совпадать с esp_timer в момент записи - и при частых событиях, и после
+// паузы дольше периода переполнения. В конце - стоимость одной записи по
+// часам хоста
+#include "test.h"
+#include "trace.h"
+#include "system-monitor.h"
+#include <chrono>
+#include <vector>
+
+// Монитор задач в тест не входит: выгрузка идёт без имён потоков
+SystemMonitor* systemMonitor = nullptr;
+
+uint16_t SystemMonitor::getTasksInfo(TaskInfo* out, uint16_t maxTasks, uint16_t first) {
+    return 0;
+}
+
+class Capture : public Print {
+public:
+    size_t write(uint8_t c) override {
+        text += (char)c;
+        return 1;
+    }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        text.append((const char*)buffer, size);
+        return size;
+    }
+    std::string text;
+};
+
+// Метки "ts" событий с аргументом arg, мкс
+static std::vector<double> exportedStamps() {
+    Capture capture;
+    traceWriteChrome(capture);
+    std::vector<double> stamps;
+    size_t at = 0;
+    while ((at = capture.text.find("\"ts\":", at)) != std::string::npos) {
+        at += 5;
+        stamps.push_back(strtod(capture.text.c_str() + at, nullptr));
+    }
+    return stamps;
+}
+
+// События в моменты times (мкс): метки выгрузки равны им до такта. Выгружаются
+// только события последних TRACE_ANCHORS опорных пар - хвост times; exported -
+// сколько их
+static bool recordAt(const std::vector<int64_t>& times, size_t* exported = nullptr) {
+    for (size_t i = 0; i < times.size(); i++) {
+        hostClockSet(times[i]);
+        traceRecord(TRACE_SELF_TEST, TRACE_PHASE_INSTANT, i);
+    }
+    std::vector<double> stamps = exportedStamps();
+    size_t count = min(stamps.size(), times.size());
+    if (exported) {
+        *exported = count;
+    }
+    bool ok = count > 0;
+    for (size_t i = 0; i < count; i++) {
+        double stamp = stamps[stamps.size() - count + i];
+        int64_t time = times[times.size() - count + i];
+        if (fabs(stamp - time) > 0.01) {
+            printf("  event at %lld us exported as %.3f us (error %.3f s)\n", (long long)time, stamp,
+                   (stamp - time) / 1e6);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static void testFrequentEvents() {
+    printf("frequent events across CCOUNT overflow\n");
+    // Событие каждые 100 мс в течение 25 с: CCOUNT переполняется
+    std::vector<int64_t> times;
+    for (int64_t t = 1000000; t < 26000000; t += 100000) {
+        times.push_back(t);
+    }
+    size_t exported = 0;
+    CHECK(recordAt(times, &exported));
+    printf("  %u of %u events exported\n", (unsigned)exported, (unsigned)times.size());
+    // Опорная пара раз в 4 с: в выгрузке не меньше трёх полных периодов
+    CHECK(exported >= 120);
+}
+
+static void testLongPause() {
+    printf("pause longer than the CCOUNT period\n");
+    // 20 с без событий - разность тактов 505 млн, меньше 2^30: по одним
+    // тактам пауза не видна
+    CHECK(recordAt({100000000, 120000000, 120000500}));
+    // Пауза в целое число периодов переполнения - такты совпадают
+    int64_t period = (int64_t)(4294967296.0 / 240);
+    CHECK(recordAt({200000000, 200000000 + 3 * period, 200000000 + 3 * period + 10}));
+}
+
+// Стоимость записи: часы хоста, такты - TSC
+static void benchmark() {
+    printf("record cost\n");
+    hostClockReal();
+    const uint32_t rounds = 2000000;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < rounds; i++) {
+        traceRecord(TRACE_SELF_TEST, TRACE_PHASE_INSTANT, i);
+    }
+    double recordNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    volatile int64_t sink = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < rounds; i++) {
+        sink = sink + esp_timer_get_time();
+    }
+    double timerNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+    printf("  traceRecord %.1f ns per event, of which esp_timer_get_time %.1f ns\n", recordNs, timerNs);
+    CHECK(recordNs > 0);
+}
+
+int main() {
+    testFrequentEvents();
+    testLongPause();
+    benchmark();
+    return testResult();
+}
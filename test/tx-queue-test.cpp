@@ -0,0 +1,251 @@
+// Очередь store-and-forward на файловой системе поверх каталога: доставка
+// DAT/DAK между двумя очередями, восстановление после перезагрузки,
+// переход сегментов и вытеснение, повторы и бюджет эфира. В конце - замер
+// постановки в очередь с пакетным сбросом против сброса каждой записи и
+// разгрузки очереди
+#include "test.h"
+#include "tx-queue.h"
+#include "config.h"
+#include <chrono>
+#include <vector>
+
+static const LoRaParams PARAMS = {9, 125.0f, 5, 0, 0, false};
+static const uint32_t START_MS = 10000;   // Бюджет эфира копится с нуля
+
+static FS storage("tx-queue-test.fs");
+static FS peerStorage("tx-queue-test-peer.fs");
+
+static String payload(uint32_t i, size_t size = 24) {
+    String text = "msg-" + String(i) + "-";
+    while (text.length() < size) {
+        text += 'x';
+    }
+    return text;
+}
+
+// Разгрузка очереди sender в receiver; delivered - принятые тексты
+static uint32_t drain(TxQueue& sender, TxQueue& receiver, uint32_t& now, std::vector<String>* delivered,
+                      uint32_t limit = UINT32_MAX) {
+    uint32_t count = 0;
+    String frame;
+    String reply;
+    String text;
+    while (count < limit && sender.poll(PARAMS, now, frame)) {
+        sender.onSent(1000, now);
+        CHECK(receiver.handleMessage(frame, now, reply, text));
+        CHECK(reply.startsWith("DAK:"));
+        if (delivered && text.length()) {
+            delivered->push_back(text);
+        }
+        sender.onTraffic(now);
+        String ignored;
+        CHECK(sender.handleMessage(reply, now, ignored, ignored));
+        count++;
+        now += 10;
+    }
+    return count;
+}
+
+static void testDelivery() {
+    printf("delivery\n");
+    storage.clear();
+    peerStorage.clear();
+    TxQueue sender;
+    TxQueue receiver;
+    CHECK(sender.begin(storage));
+    CHECK(receiver.begin(peerStorage));
+    uint32_t now = START_MS;
+    for (uint32_t i = 0; i < 20; i++) {
+        CHECK(sender.enqueue(payload(i), now));
+    }
+    CHECK_EQ(sender.getStats(now).depth, 20);
+    // Пир не слышен - не передаём
+    String frame;
+    CHECK(!sender.poll(PARAMS, now, frame));
+    sender.onTraffic(now);
+    std::vector<String> delivered;
+    CHECK_EQ(drain(sender, receiver, now, &delivered), 20);
+    CHECK_EQ(delivered.size(), 20);
+    for (uint32_t i = 0; i < delivered.size(); i++) {
+        CHECK(delivered[i] == payload(i));
+    }
+    TxQueueStats stats = sender.getStats(now);
+    CHECK_EQ(stats.depth, 0);
+    CHECK_EQ(stats.delivered, 20);
+    CHECK_EQ(receiver.getStats(now).received, 20);
+}
+
+// Сброшенные сообщения переживают перезагрузку, подтверждённые не повторяются
+static void testRestart() {
+    printf("restart\n");
+    storage.clear();
+    peerStorage.clear();
+    uint32_t now = START_MS;
+    TxQueue receiver;
+    receiver.begin(peerStorage);
+    {
+        TxQueue sender;
+        sender.begin(storage);
+        for (uint32_t i = 0; i < 10; i++) {
+            sender.enqueue(payload(i), now);
+        }
+        sender.onTraffic(now);
+        CHECK_EQ(drain(sender, receiver, now, nullptr, 4), 4);
+        sender.flush(now);
+    }
+    TxQueue sender;
+    CHECK(sender.begin(storage));
+    CHECK_EQ(sender.getStats(now).depth, 6);
+    sender.onTraffic(now);
+    std::vector<String> delivered;
+    CHECK_EQ(drain(sender, receiver, now, &delivered), 6);
+    CHECK_EQ(delivered.size(), 6);
+    CHECK(delivered.size() == 6 && delivered[0] == payload(4) && delivered[5] == payload(9));
+    // Новые сообщения продолжают seq: получатель не примет их за повтор
+    sender.enqueue(payload(100), now);
+    delivered.clear();
+    CHECK_EQ(drain(sender, receiver, now, &delivered), 1);
+    CHECK_EQ(delivered.size(), 1);
+}
+
+// Объём ограничен TXQ_MAX_BYTES: старые сегменты вытесняются целиком
+static void testEviction() {
+    printf("segments and eviction\n");
+    storage.clear();
+    TxQueue sender;
+    sender.begin(storage);
+    uint32_t now = START_MS;
+    const uint32_t total = 2 * TXQ_MAX_BYTES / (TXQ_MAX_PAYLOAD + 10);
+    for (uint32_t i = 0; i < total; i++) {
+        CHECK(sender.enqueue(payload(i, TXQ_MAX_PAYLOAD), now));
+    }
+    sender.flush(now);
+    TxQueueStats stats = sender.getStats(now);
+    CHECK(stats.bytes <= TXQ_MAX_BYTES);
+    CHECK(stats.dropped > 0);
+    CHECK_EQ(stats.depth + stats.dropped, total);
+    // Голова - первое невытесненное сообщение
+    peerStorage.clear();
+    TxQueue receiver;
+    receiver.begin(peerStorage);
+    sender.onTraffic(now);
+    std::vector<String> delivered;
+    drain(sender, receiver, now, &delivered, 1);
+    CHECK(delivered.size() == 1 && delivered[0] == payload(stats.dropped, TXQ_MAX_PAYLOAD));
+}
+
+// DAK не пришёл: тот же seq повторяется; повтор у получателя не доставляется второй раз
+static void testRetry() {
+    printf("retry and duplicate\n");
+    storage.clear();
+    peerStorage.clear();
+    TxQueue sender;
+    TxQueue receiver;
+    sender.begin(storage);
+    receiver.begin(peerStorage);
+    uint32_t now = START_MS;
+    sender.enqueue(payload(1), now);
+    sender.onTraffic(now);
+    String first;
+    String second;
+    CHECK(sender.poll(PARAMS, now, first));
+    sender.onSent(1000, now);
+    CHECK(!sender.poll(PARAMS, now + 10, second));   // Ждём DAK
+    now += 10000;
+    sender.onTraffic(now);
+    CHECK(sender.poll(PARAMS, now, second));
+    CHECK(first == second);
+    CHECK_EQ(sender.getStats(now).retries, 1);
+
+    String reply;
+    String text;
+    receiver.handleMessage(first, now, reply, text);
+    CHECK(text == payload(1));
+    receiver.handleMessage(second, now, reply, text);
+    CHECK(reply.startsWith("DAK:"));
+    CHECK(text.length() == 0);
+}
+
+// Бюджет эфира исчерпан - передача ждёт пополнения
+static void testDutyCycle() {
+    printf("duty cycle\n");
+    storage.clear();
+    peerStorage.clear();
+    TxQueue sender;
+    TxQueue receiver;
+    sender.begin(storage);
+    receiver.begin(peerStorage);
+    uint32_t now = START_MS;
+    sender.enqueue(payload(1), now);
+    sender.enqueue(payload(2), now);
+    sender.onTraffic(now);
+    String frame;
+    String reply;
+    String text;
+    CHECK(sender.poll(PARAMS, now, frame));
+    // Кадр занял эфир на 10 с - бюджет за START_MS и ещё 90 с при 10%
+    sender.onSent(10000000, now);
+    receiver.handleMessage(frame, now, reply, text);
+    sender.handleMessage(reply, now, text, text);
+    CHECK(!sender.poll(PARAMS, now + 1000, frame));
+    CHECK(sender.getStats(now + 1000).dutyWaitMs > 0);
+    sender.onTraffic(now + 90000);
+    CHECK(sender.poll(PARAMS, now + 90000 + 1000, frame));
+}
+
+// Замер: постановка N сообщений с пакетным сбросом и со сбросом каждой записи,
+// затем разгрузка. Время - по часам хоста, фиксация - fsync при закрытии файла
+static void benchmark() {
+    printf("benchmark\n");
+    const uint32_t messages = 1000;   // 50 КБ - меньше TXQ_MAX_BYTES, без вытеснения
+    double enqueueUs[2];
+    uint32_t commits[2];
+    for (int batched = 1; batched >= 0; batched--) {
+        storage.clear();
+        TxQueue sender;
+        sender.begin(storage);
+        uint32_t startCommits = storage.commits();
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < messages; i++) {
+            sender.enqueue(payload(i, 40), START_MS + i);
+            if (!batched) {
+                sender.flush(START_MS + i);
+            }
+        }
+        sender.flush(START_MS + messages);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        enqueueUs[batched] = std::chrono::duration<double, std::micro>(elapsed).count() / messages;
+        commits[batched] = storage.commits() - startCommits;
+    }
+    printf("  enqueue %u x 40 B: batched %.1f us/msg, %u commits; flush per message %.1f us/msg, %u commits\n",
+           messages, enqueueUs[1], commits[1], enqueueUs[0], commits[0]);
+    CHECK(commits[1] * 10 < commits[0]);
+
+    peerStorage.clear();
+    TxQueue receiver;
+    receiver.begin(peerStorage);
+    TxQueue sender;
+    sender.begin(storage);
+    uint32_t now = START_MS;
+    sender.onTraffic(now);
+    uint32_t opens = storage.opens();
+    auto start = std::chrono::steady_clock::now();
+    uint32_t drained = drain(sender, receiver, now, nullptr);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    printf("  drain %u: %.1f us/msg, %.2f file opens/msg\n", drained,
+           std::chrono::duration<double, std::micro>(elapsed).count() / drained,
+           (double)(storage.opens() - opens) / drained);
+    CHECK_EQ(drained, messages);
+}
+
+int main() {
+    testDelivery();
+    testRestart();
+    testEviction();
+    testRetry();
+    testDutyCycle();
+    benchmark();
+    storage.clear();
+    peerStorage.clear();
+    return testResult();
+}
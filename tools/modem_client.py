@@ -0,0 +1,244 @@
+#!/usr/bin/env python3
+"""Reference host client for the serial modem mode (see main/serial-modem.h).
+
+Frame on the wire: COBS(<type:1><seq:2><body><crc16:2>) 0x00, little-endian,
+CRC16-CCITT (init 0xFFFF) over type..body.
+
+Usage:
+  modem_client.py PORT listen                 print received LoRa frames
+  modem_client.py PORT send TEXT              transmit a frame, wait for TX_DONE
+  modem_client.py PORT enqueue TEXT           put a message into the store-and-forward queue
+  modem_client.py PORT stats                  modem counters
+  modem_client.py PORT bench [--size N] [--count N] [--window N]
+                                              serial link throughput and latency (PING/PONG)
+
+Requires pyserial (pip install pyserial).
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+import serial
+
+MODEM_TX = 0x01
+MODEM_PING = 0x02
+MODEM_STATS = 0x03
+MODEM_ENQUEUE = 0x04
+MODEM_TX_DONE = 0x81
+MODEM_PONG = 0x82
+MODEM_STATS_RE = 0x83
+MODEM_ENQ_DONE = 0x84
+MODEM_RX = 0x90
+
+STATUS_TEXT = {0: "ok", 1: "busy", 2: "invalid"}
+
+RX_HEADER = struct.Struct("<qqIhhBBI")
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_index = 0
+    code = 1
+    for byte in data:
+        if byte == 0:
+            out[code_index] = code
+            code_index = len(out)
+            out.append(0)
+            code = 1
+        else:
+            out.append(byte)
+            code += 1
+            if code == 0xFF:
+                out[code_index] = code
+                code_index = len(out)
+                out.append(0)
+                code = 1
+    out[code_index] = code
+    out.append(0)
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            return None
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+class Modem:
+    def __init__(self, port, baud):
+        self.serial = serial.Serial(port, baud, timeout=0.05)
+        self.buffer = bytearray()
+        self.seq = 0
+        self.bad_frames = 0
+
+    def send(self, frame_type, body=b""):
+        self.seq = (self.seq + 1) & 0xFFFF
+        raw = struct.pack("<BH", frame_type, self.seq) + body
+        raw += struct.pack("<H", crc16(raw))
+        self.serial.write(cobs_encode(raw))
+        return self.seq
+
+    def frames(self, timeout):
+        """Yield (type, seq, body) until timeout seconds pass without data."""
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            chunk = self.serial.read(self.serial.in_waiting or 1)
+            if not chunk:
+                continue
+            deadline = time.monotonic() + timeout
+            self.buffer += chunk
+            while True:
+                end = self.buffer.find(b"\x00")
+                if end < 0:
+                    break
+                encoded = bytes(self.buffer[:end])
+                del self.buffer[:end + 1]
+                if not encoded:
+                    continue
+                raw = cobs_decode(encoded)
+                # Text printed before switching to modem mode decodes to garbage - CRC rejects it
+                if raw is None or len(raw) < 5 or struct.unpack("<H", raw[-2:])[0] != crc16(raw[:-2]):
+                    self.bad_frames += 1
+                    continue
+                frame_type, seq = struct.unpack("<BH", raw[:3])
+                yield frame_type, seq, raw[3:-2]
+
+    def wait_for(self, frame_type, seq, timeout):
+        for got_type, got_seq, body in self.frames(timeout):
+            if got_type == frame_type and got_seq == seq:
+                return body
+            if got_type == MODEM_RX:
+                print_rx(body)
+        return None
+
+
+def print_rx(body):
+    rx_us, global_us, freq, rssi, snr10, sf, cr, bw = RX_HEADER.unpack_from(body)
+    data = body[RX_HEADER.size:]
+    text = data.decode("utf-8", errors="replace")
+    print(f"RX t={rx_us}us net={global_us}us {freq / 1e6:.3f}MHz SF{sf} BW{bw / 1000:g}k CR4/{cr} "
+          f"RSSI={rssi}dBm SNR={snr10 / 10:.1f}dB len={len(data)}: {text!r}")
+
+
+def cmd_listen(modem, args):
+    while True:
+        for frame_type, _, body in modem.frames(1.0):
+            if frame_type == MODEM_RX:
+                print_rx(body)
+
+
+def cmd_send(modem, args):
+    seq = modem.send(MODEM_TX, args.text.encode())
+    # Time on air at SF12 can take tens of seconds
+    body = modem.wait_for(MODEM_TX_DONE, seq, args.timeout)
+    if body is None:
+        sys.exit("no TX_DONE")
+    status, tx_done_us, airtime_us = struct.unpack("<BqI", body)
+    print(f"status={STATUS_TEXT.get(status, status)} tx_done={tx_done_us}us airtime={airtime_us / 1000:.1f}ms")
+
+
+def cmd_enqueue(modem, args):
+    seq = modem.send(MODEM_ENQUEUE, args.text.encode())
+    body = modem.wait_for(MODEM_ENQ_DONE, seq, 2.0)
+    if body is None:
+        sys.exit("no reply")
+    print(f"status={STATUS_TEXT.get(body[0], body[0])}")
+
+
+def cmd_stats(modem, args):
+    seq = modem.send(MODEM_STATS)
+    body = modem.wait_for(MODEM_STATS_RE, seq, 2.0)
+    if body is None:
+        sys.exit("no reply")
+    names = ("frames_in", "frames_out", "bytes_in", "bytes_out", "bad_frames", "out_dropped", "tx_sent")
+    for name, value in zip(names, struct.unpack("<7I", body)):
+        print(f"{name}: {value}")
+
+
+def cmd_bench(modem, args):
+    """PING/PONG with a sliding window: measures the serial path only, not the radio."""
+    payload = bytes((i * 7 + 1) & 0xFF for i in range(args.size))
+    pending = {}
+    latencies = []
+    sent = received = 0
+    start = time.monotonic()
+    while received < args.count:
+        while sent < args.count and len(pending) < args.window:
+            pending[modem.send(MODEM_PING, payload)] = time.monotonic()
+            sent += 1
+        progress = False
+        for frame_type, seq, body in modem.frames(0.5):
+            if frame_type == MODEM_PONG and seq in pending:
+                if body[8:] != payload:
+                    modem.bad_frames += 1
+                latencies.append(time.monotonic() - pending.pop(seq))
+                received += 1
+                progress = True
+                break
+        if not progress:
+            # Lost frames are not retransmitted
+            lost = len(pending)
+            pending.clear()
+            received += lost
+    elapsed = time.monotonic() - start
+    latencies.sort()
+    frame_bytes = len(cobs_encode(b"\x00" * (args.size + 5)))
+    ok = len(latencies)
+    print(f"{ok}/{args.count} echoed in {elapsed:.2f}s, {ok / elapsed:.0f} frames/s, "
+          f"{ok * frame_bytes * 2 / elapsed / 1024:.1f} KiB/s both directions")
+    if latencies:
+        print(f"latency ms: min {latencies[0] * 1e3:.2f}, median {latencies[ok // 2] * 1e3:.2f}, "
+              f"p99 {latencies[min(ok - 1, int(ok * 0.99))] * 1e3:.2f}, max {latencies[-1] * 1e3:.2f}")
+    print(f"bad frames: {modem.bad_frames}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port")
+    parser.add_argument("--baud", type=int, default=921600)
+    sub = parser.add_subparsers(dest="command", required=True)
+    sub.add_parser("listen")
+    send = sub.add_parser("send")
+    send.add_argument("text")
+    send.add_argument("--timeout", type=float, default=60.0)
+    enqueue = sub.add_parser("enqueue")
+    enqueue.add_argument("text")
+    sub.add_parser("stats")
+    bench = sub.add_parser("bench")
+    bench.add_argument("--size", type=int, default=200)
+    bench.add_argument("--count", type=int, default=1000)
+    bench.add_argument("--window", type=int, default=4)
+    args = parser.parse_args()
+
+    modem = Modem(args.port, args.baud)
+    commands = {"listen": cmd_listen, "send": cmd_send, "enqueue": cmd_enqueue,
+                "stats": cmd_stats, "bench": cmd_bench}
+    try:
+        commands[args.command](modem, args)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""Symbolise CPU profiler output (see main/profiler.h) into folded stacks.
+
+The device writes one line per distinct stack, root first:
+  TASK;0xCALLER;...;0xPC COUNT
+This script maps every address to a function name with addr2line against the
+firmware ELF and merges stacks that land in the same functions. The output
+is the usual folded format for flamegraph.pl or speedscope.
+
+Usage:
+  profile_fold.py ELF INPUT [--addr2line TOOL] [--lines] > cpu.folded
+  flamegraph.pl cpu.folded > cpu.svg
+
+INPUT is a file with a Serial dump (other log lines are skipped), "-" for
+stdin, or the device URL, e.g. http://192.168.4.1:8080/profile. Fetching
+the URL clears the rings on the device.
+
+The ELF is in the sketch build directory (Arduino IDE: Sketch > Export
+Compiled Binary). The default addr2line is the ESP32 one; pass
+xtensa-esp32s3-elf-addr2line for ESP32-S3.
+"""
+
+import argparse
+import collections
+import re
+import subprocess
+import sys
+import urllib.request
+
+LINE_RE = re.compile(r"^([^;\s]+)((?:;0x[0-9a-fA-F]{8})+) (\d+)\s*$")
+
+
+def read_lines(source):
+    if source.startswith("http://") or source.startswith("https://"):
+        with urllib.request.urlopen(source, timeout=10) as response:
+            return response.read().decode("utf-8", "replace").splitlines()
+    if source == "-":
+        return sys.stdin.read().splitlines()
+    with open(source, encoding="utf-8", errors="replace") as f:
+        return f.read().splitlines()
+
+
+def parse(lines):
+    stacks = []
+    for line in lines:
+        match = LINE_RE.match(line.strip())
+        if match:
+            task, addresses, count = match.groups()
+            stacks.append((task, addresses[1:].split(";"), int(count)))
+    return stacks
+
+
+def symbolise(elf, addresses, tool, with_lines):
+    """Map each address to "function" or "function (file:line)" with one addr2line call."""
+    addresses = sorted(addresses)
+    if not addresses:
+        return {}
+    result = subprocess.run([tool, "-e", elf, "-f", "-C", "-a"] + addresses,
+                            capture_output=True, text=True, check=True)
+    names = {}
+    out = result.stdout.splitlines()
+    # With -a every address gives three lines: address, function, file:line
+    starts = [i for i, line in enumerate(out) if re.match(r"^0x[0-9a-fA-F]+$", line)]
+    for i in starts:
+        if i + 2 >= len(out):
+            break
+        address = "0x%08x" % int(out[i], 16)
+        function = out[i + 1]
+        location = out[i + 2].split(" (")[0]
+        if function == "??":
+            function = address
+        if with_lines and not location.startswith("??"):
+            function = "%s (%s)" % (function, location.rsplit("/", 1)[-1])
+        names[address] = function
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf")
+    parser.add_argument("input")
+    parser.add_argument("--addr2line", default="xtensa-esp32-elf-addr2line")
+    parser.add_argument("--lines", action="store_true", help="add file:line to frame names")
+    args = parser.parse_args()
+
+    stacks = parse(read_lines(args.input))
+    if not stacks:
+        sys.exit("no profiler samples in input")
+    addresses = {a.lower() for _, frames, _ in stacks for a in frames}
+    names = symbolise(args.elf, addresses, args.addr2line, args.lines)
+
+    folded = collections.Counter()
+    for task, frames, count in stacks:
+        path = [task] + [names.get(a.lower(), a).replace(";", ":") for a in frames]
+        folded[";".join(path)] += count
+    for path, count in sorted(folded.items()):
+        print(path, count)
+
+    total = sum(folded.values())
+    print("%d samples, %d stacks" % (total, len(folded)), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()